@@ -0,0 +1,525 @@
+// Bench.cpp – microbenchmarks for puzzle loading, the scanner, parser and both execution engines.
+//
+// Usage:
+//   conch_bench [--filter text] [--min-ms N] [--puzzles dir]
+//   conch_bench --profile [--puzzles dir]
+//
+// Prints one fixed-column row per benchmark so two runs can be diffed directly:
+// iterations, ns/op, source or executed lines per second, and heap allocations per op.
+// --profile instead runs every puzzle's starter program and prints how often each opcode
+// followed another, the data behind the pairs FuseBytecode fuses.
+
+#include "../TestApp/AllocationCounter.h"
+#include "../TestApp/Puzzle.h"
+#include "../TestApp/TestRunner.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/Conchpiler/fusion.h"
+#include "../src/Conchpiler/parser.h"
+#include "../src/Conchpiler/thread.h"
+#include "../src/Conchpiler/trace.h"
+
+namespace
+{
+
+struct BenchOptions
+{
+    std::string Filter;
+    double MinMilliseconds = 200.0;
+    std::filesystem::path PuzzleDir = "TestApp/Puzzles";
+    bool bProfile = false;
+};
+
+struct BenchResult
+{
+    std::string Name;
+    uint64_t Iterations = 0;
+    double NsPerOp = 0.0;
+    // source lines for parse benchmarks, executed lines for run benchmarks; 0 when not meaningful
+    double LinesPerSecond = 0.0;
+    double AllocationsPerOp = 0.0;
+};
+
+// Runs Op in growing batches until a batch takes at least MinMilliseconds, then reports that batch.
+BenchResult Measure(const std::string& Name, const BenchOptions& Options, uint64_t LinesPerOp,
+                    const std::function<void()>& Op)
+{
+    using Clock = std::chrono::steady_clock;
+    Op();
+
+    BenchResult Result;
+    Result.Name = Name;
+    uint64_t Iterations = 1;
+    while (true)
+    {
+        const uint64_t AllocationsBefore = GetAllocationCount();
+        const Clock::time_point Start = Clock::now();
+        for (uint64_t i = 0; i < Iterations; ++i)
+            Op();
+        const double Elapsed = std::chrono::duration<double, std::nano>(Clock::now() - Start).count();
+        const uint64_t Allocations = GetAllocationCount() - AllocationsBefore;
+
+        if (Elapsed >= Options.MinMilliseconds * 1e6 || Iterations >= (uint64_t(1) << 30))
+        {
+            Result.Iterations = Iterations;
+            Result.NsPerOp = Elapsed / static_cast<double>(Iterations);
+            Result.LinesPerSecond = LinesPerOp > 0 ? static_cast<double>(LinesPerOp) * 1e9 / Result.NsPerOp : 0.0;
+            Result.AllocationsPerOp = static_cast<double>(Allocations) / static_cast<double>(Iterations);
+            return Result;
+        }
+        Iterations *= 2;
+    }
+}
+
+void PrintHeader()
+{
+    std::printf("%-32s %12s %14s %14s %12s\n", "benchmark", "iterations", "ns/op", "lines/sec", "allocs/op");
+}
+
+void PrintResult(const BenchResult& Result)
+{
+    char Lines[32] = "-";
+    if (Result.LinesPerSecond > 0.0)
+        std::snprintf(Lines, sizeof(Lines), "%.0f", Result.LinesPerSecond);
+    std::printf("%-32s %12llu %14.1f %14s %12.1f\n", Result.Name.c_str(),
+                static_cast<unsigned long long>(Result.Iterations), Result.NsPerOp, Lines,
+                Result.AllocationsPerOp);
+    std::fflush(stdout);
+}
+
+// ============================================================
+// Workloads
+// ============================================================
+
+std::vector<std::string> MakeLargeProgram(size_t BlockCount)
+{
+    static const char* const Block[] = {
+        "SET X ADD X 1",
+        "SET Y MUL X 3",
+        "IF GTR Y X",
+        "  SWP Z",
+        "  DECR Z",
+        "SET OUT0 X",
+        "XOR Z Y",
+        "INCR Y",
+    };
+    std::vector<std::string> Lines;
+    Lines.reserve(BlockCount * (sizeof(Block) / sizeof(Block[0])) + 1);
+    for (size_t i = 0; i < BlockCount; ++i)
+        for (const char* Line : Block)
+            Lines.push_back(Line);
+    Lines.push_back("RET X");
+    return Lines;
+}
+
+std::vector<int32> MakeDat(size_t Count)
+{
+    std::vector<int32> Values(Count);
+    for (size_t i = 0; i < Count; ++i)
+        Values[i] = static_cast<int32>(i % 97) + 1;
+    return Values;
+}
+
+bool ParseOrReport(const std::vector<std::string>& Code, ConThread& Thread)
+{
+    ConParser Parser;
+    if (Parser.Parse(Code, Thread))
+        return true;
+    for (const std::string& Error : Parser.GetErrors())
+        std::fprintf(stderr, "%s\n", Error.c_str());
+    return false;
+}
+
+// lines a run executes, counted once up front with the line-stepping interpreter
+uint64_t CountExecutedLines(ConThread& Thread)
+{
+    Thread.ResetState();
+    Thread.BeginRun();
+    uint64_t Lines = 0;
+    ConStepResult Result = ConStepResult::Running;
+    while (Result == ConStepResult::Running)
+    {
+        Result = Thread.StepLine();
+        if (Result != ConStepResult::Blocked && Result != ConStepResult::Error)
+            ++Lines;
+    }
+    return Lines;
+}
+
+struct RunWorkload
+{
+    const char* Name;
+    std::vector<std::string> Code;
+    size_t DatSize;
+    size_t OutSize;
+};
+
+bool Selected(const BenchOptions& Options, const std::string& Name)
+{
+    return Options.Filter.empty() || Name.find(Options.Filter) != std::string::npos;
+}
+
+// the same program parsed from its lines and from one buffer scanned up front
+void BenchParse(const BenchOptions& Options)
+{
+    const std::vector<std::string> Code = MakeLargeProgram(500);
+    const std::string Name = "parse/" + std::to_string(Code.size()) + "_lines";
+    if (Selected(Options, Name))
+    {
+        PrintResult(Measure(Name, Options, Code.size(), [&Code]()
+        {
+            ConParser Parser;
+            ConThread Thread;
+            Parser.Parse(Code, Thread);
+        }));
+    }
+    if (Selected(Options, Name + "/buffer"))
+    {
+        std::string Source;
+        for (const std::string& Line : Code)
+            Source += Line + "\n";
+        ConScannedSource Scanned;
+        Scanner::ScanSource(Source, Scanned);
+        PrintResult(Measure(Name + "/buffer", Options, Code.size(), [&Scanned]()
+        {
+            ConParser Parser;
+            ConThread Thread;
+            Parser.Parse(Scanned, Thread);
+        }));
+    }
+}
+
+// the same program scanned line by line into owning tokens and as one buffer into token views
+void BenchScan(const BenchOptions& Options)
+{
+    const std::vector<std::string> Code = MakeLargeProgram(500);
+    const std::string Prefix = "scan/" + std::to_string(Code.size()) + "_lines";
+    if (Selected(Options, Prefix + "/lines"))
+    {
+        PrintResult(Measure(Prefix + "/lines", Options, Code.size(), [&Code]()
+        {
+            Scanner().Scan(Code);
+        }));
+    }
+    if (Selected(Options, Prefix + "/buffer"))
+    {
+        std::string Source;
+        for (const std::string& Line : Code)
+            Source += Line + "\n";
+        ConScannedSource Scanned;
+        PrintResult(Measure(Prefix + "/buffer", Options, Code.size(), [&Source, &Scanned]()
+        {
+            Scanner::ScanSource(Source, Scanned);
+        }));
+    }
+}
+
+// one generated puzzle with large DAT lists, read from JSON each time and then through its binary cache
+void BenchLoad(const BenchOptions& Options)
+{
+    const size_t ValueCount = 100000;
+    const std::string Prefix = "load/dat_" + std::to_string(ValueCount);
+    if (!Selected(Options, Prefix + "/json") && !Selected(Options, Prefix + "/cache"))
+        return;
+
+    const std::filesystem::path Path = std::filesystem::temp_directory_path() / "conch_bench_load.json";
+    {
+        std::ofstream Out(Path);
+        Out << "{\"title\": \"Load\", \"tests\": [";
+        for (size_t Test = 0; Test < 4; ++Test)
+        {
+            Out << (Test > 0 ? ", " : "") << "{\"name\": \"t" << Test << "\", \"dat\": [{\"name\": \"DAT0\", \"values\": [";
+            for (size_t i = 0; i < ValueCount / 4; ++i)
+                Out << (i > 0 ? ", " : "") << static_cast<int32>((i * 7919) % 2000001) - 1000000;
+            Out << "]}], \"out\": [{\"name\": \"OUT0\", \"expectedSize\": 1}]}";
+        }
+        Out << "]}";
+    }
+
+    const std::string File = Path.string();
+    PuzzleData Puzzle;
+    std::string Error;
+    if (Selected(Options, Prefix + "/json"))
+    {
+        PrintResult(Measure(Prefix + "/json", Options, 0, [&]()
+        {
+            LoadPuzzleFromFile(File, Puzzle, Error);
+        }));
+    }
+    if (Selected(Options, Prefix + "/cache"))
+    {
+        PrintResult(Measure(Prefix + "/cache", Options, 0, [&]()
+        {
+            LoadPuzzleCached(File, Puzzle, Error);
+        }));
+    }
+    std::error_code EC;
+    std::filesystem::remove(GetPuzzleCachePath(File), EC);
+    std::filesystem::remove(Path, EC);
+}
+
+void BenchRuns(const BenchOptions& Options)
+{
+    const std::vector<RunWorkload> Workloads = {
+        {"redo_loop_9990", {"SET Y 9990", "REDO IF Y", "  SET X ADD X Y", "  DECR Y", "RET X"}, 0, 0},
+        {"pop_stream_9000", {"POP X DAT0", "REDO IF X", "  SET Y ADD Y X", "  POP X DAT0", "RET Y"}, 9000, 0},
+        {"at_stream_9000", {"SET Y 9000", "REDO IF Y", "  DECR Y", "  AT X DAT0 Y", "  SET Z ADD Z X", "RET Z"}, 9000, 0},
+        {"out_append_9000", {"SET Y 9000", "REDO IF Y", "  SET OUT0 Y", "  DECR Y", "RET"}, 0, 9000},
+    };
+    const struct { const char* Suffix; ConExecutionEngine Engine; bool bOptimize; } Engines[] = {
+        {"tree", ConExecutionEngine::Tree, false},
+        {"bytecode", ConExecutionEngine::Bytecode, false},
+        {"optimized", ConExecutionEngine::Bytecode, true},
+    };
+
+    for (const RunWorkload& Workload : Workloads)
+    {
+        for (const auto& Engine : Engines)
+        {
+            const std::string Name = std::string("run/") + Workload.Name + "/" + Engine.Suffix;
+            if (!Selected(Options, Name))
+                continue;
+
+            ConThread Thread;
+            if (!ParseOrReport(Workload.Code, Thread))
+                continue;
+            if (Workload.DatSize > 0)
+            {
+                ConVariableList* Dat = Thread.FindListVar("DAT0");
+                Dat->SetRole(ConListRole::Input);
+                Dat->SetValues(MakeDat(Workload.DatSize));
+            }
+            if (Workload.OutSize > 0)
+            {
+                ConVariableList* Out = Thread.FindListVar("OUT0");
+                Out->SetRole(ConListRole::Output);
+                Out->SetExpectedSize(Workload.OutSize);
+            }
+            const uint64_t Lines = CountExecutedLines(Thread);
+            Thread.SetExecutionEngine(Engine.Engine);
+            Thread.SetBytecodeOptimization(Engine.bOptimize);
+            PrintResult(Measure(Name, Options, Lines, [&Thread]()
+            {
+                Thread.ResetState();
+                Thread.Execute();
+            }));
+            if (Thread.HadRuntimeError())
+                std::fprintf(stderr, "%s: %s\n", Name.c_str(), Thread.GetRuntimeErrors().front().c_str());
+        }
+    }
+}
+
+// a run that reads both ends of a large DAT list, copied into the list per run or borrowed in place
+void BenchInputs(const BenchOptions& Options)
+{
+    const size_t ValueCount = 1000000;
+    const std::vector<std::string> Code = {"POP X DAT0", "AT Y DAT0 999999", "SET X ADD X Y", "RET X"};
+    const std::vector<int32> Values = MakeDat(ValueCount);
+    for (const bool bBorrow : {false, true})
+    {
+        const std::string Name = "inputs/dat_" + std::to_string(ValueCount) + (bBorrow ? "/borrow" : "/copy");
+        if (!Selected(Options, Name))
+            continue;
+        ConThread Thread;
+        if (!ParseOrReport(Code, Thread))
+            return;
+        ConVariableList* Dat = Thread.FindListVar("DAT0");
+        Dat->SetRole(ConListRole::Input);
+        PrintResult(Measure(Name, Options, 0, [&]()
+        {
+            Thread.ResetState();
+            if (bBorrow)
+                Dat->BorrowValues(Values.data(), Values.size());
+            else
+                Dat->SetValues(Values);
+            Thread.Execute();
+        }));
+    }
+}
+
+// the same program over many inputs: one scalar run per input against one lockstep batch
+void BenchLanes(const BenchOptions& Options)
+{
+    const size_t LaneCount = 64;
+    const std::vector<std::string> Code = {
+        "POP X DAT0", "REDO IF X", "  SET Y ADD Y MUL X 3", "  XOR Z Y", "  POP X DAT0", "RET Y"};
+    const std::string Name = "lanes/pop_math_256x" + std::to_string(LaneCount);
+    if (!Selected(Options, Name))
+        return;
+
+    ConThread Thread;
+    if (!ParseOrReport(Code, Thread))
+        return;
+    std::vector<std::vector<int32>> Inputs(LaneCount);
+    for (size_t Lane = 0; Lane < LaneCount; ++Lane)
+    {
+        Inputs[Lane] = MakeDat(256 - Lane % 7);
+        Inputs[Lane].push_back(0);
+    }
+    ConVariableList* Dat = Thread.FindListVar("DAT0");
+    Dat->SetRole(ConListRole::Input);
+    auto Setup = [&](size_t Lane)
+    {
+        Thread.ResetState();
+        Dat->SetValues(Inputs[Lane]);
+    };
+
+    uint64_t Lines = 0;
+    for (size_t Lane = 0; Lane < LaneCount; ++Lane)
+    {
+        Setup(Lane);
+        Lines += CountExecutedLines(Thread);
+    }
+
+    Thread.SetExecutionEngine(ConExecutionEngine::Bytecode);
+    PrintResult(Measure(Name + "/scalar", Options, Lines, [&]()
+    {
+        for (size_t Lane = 0; Lane < LaneCount; ++Lane)
+        {
+            Setup(Lane);
+            Thread.Execute();
+        }
+    }));
+
+    ConBatchState Batch;
+    Thread.BeginBatch(Batch, LaneCount);
+    PrintResult(Measure(Name + "/batch", Options, Lines, [&]()
+    {
+        for (size_t Lane = 0; Lane < LaneCount; ++Lane)
+        {
+            Setup(Lane);
+            Thread.CaptureBatchLane(Batch, Lane);
+        }
+        Thread.ExecuteBatch(Batch);
+    }));
+}
+
+std::vector<PuzzleData> LoadPuzzles(const BenchOptions& Options)
+{
+    std::vector<PuzzleData> Puzzles;
+    for (const std::filesystem::path& File : FindPuzzleFiles(Options.PuzzleDir))
+    {
+        PuzzleData Puzzle;
+        std::string Error;
+        if (LoadPuzzleFromFile(File.string(), Puzzle, Error))
+            Puzzles.push_back(std::move(Puzzle));
+    }
+    return Puzzles;
+}
+
+void BenchPuzzleSuite(const BenchOptions& Options)
+{
+    std::vector<PuzzleData> Puzzles = LoadPuzzles(Options);
+    if (Puzzles.empty())
+    {
+        std::fprintf(stderr, "No puzzles found in %s; skipping suite benchmarks\n", Options.PuzzleDir.string().c_str());
+        return;
+    }
+
+    std::vector<PuzzleRunJob> Jobs(Puzzles.size());
+    for (size_t i = 0; i < Puzzles.size(); ++i)
+    {
+        Jobs[i].Puzzle = &Puzzles[i];
+        Jobs[i].Code = Puzzles[i].StarterCode;
+    }
+
+    const unsigned WorkerCounts[] = {1, DefaultWorkerCount()};
+    for (const unsigned Workers : WorkerCounts)
+    {
+        const std::string Name = "suite/puzzles/" + std::to_string(Workers) + "_workers";
+        if (!Selected(Options, Name))
+            continue;
+        PrintResult(Measure(Name, Options, 0, [&Jobs, Workers]()
+        {
+            RunPuzzleSuite(Jobs, Workers);
+        }));
+        if (Workers == WorkerCounts[0] && WorkerCounts[1] == 1)
+            break;
+    }
+}
+
+// records every test of every starter program and tallies which opcode followed which
+int ProfileOpcodePairs(const BenchOptions& Options)
+{
+    const std::vector<PuzzleData> Puzzles = LoadPuzzles(Options);
+    if (Puzzles.empty())
+    {
+        std::fprintf(stderr, "No puzzles found in %s\n", Options.PuzzleDir.string().c_str());
+        return 1;
+    }
+
+    ConOpcodePairProfile Profile;
+    ConTraceRecorder Recorder(1 << 20);
+    for (const PuzzleData& Puzzle : Puzzles)
+    {
+        ConThread Thread;
+        if (!ParseOrReport(Puzzle.StarterCode, Thread))
+            continue;
+        Thread.SetTraceRecorder(&Recorder);
+        for (const PuzzleTestCase& Test : Puzzle.Tests)
+        {
+            RunTestCase(Test, Thread);
+            Profile.AddRun(Thread.GetBytecode(), Recorder.GetLog());
+        }
+        if (Recorder.GetDroppedCount() > 0)
+            std::fprintf(stderr, "%s: trace buffer wrapped, counts are partial\n", Puzzle.Title.c_str());
+    }
+
+    std::printf("%-10s %-10s %12s %8s\n", "first", "second", "count", "share");
+    for (const ConOpcodePairProfile::Entry& Entry : Profile.GetSortedEntries())
+    {
+        std::printf("%-10s %-10s %12llu %7.1f%%\n", GetOpcodeName(Entry.First), GetOpcodeName(Entry.Second),
+                    static_cast<unsigned long long>(Entry.Count),
+                    100.0 * static_cast<double>(Entry.Count) / static_cast<double>(Profile.GetTotal()));
+    }
+    return 0;
+}
+
+bool ParseArguments(int Argc, char** Argv, BenchOptions& Options)
+{
+    for (int i = 1; i < Argc; ++i)
+    {
+        const std::string Arg = Argv[i];
+        if (Arg == "--profile") { Options.bProfile = true; continue; }
+        if (i + 1 >= Argc) return false;
+        if (Arg == "--filter")       Options.Filter = Argv[++i];
+        else if (Arg == "--min-ms")  Options.MinMilliseconds = std::atof(Argv[++i]);
+        else if (Arg == "--puzzles") Options.PuzzleDir = Argv[++i];
+        else return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int Argc, char** Argv)
+{
+    BenchOptions Options;
+    if (!ParseArguments(Argc, Argv, Options))
+    {
+        std::cerr << "Usage: conch_bench [--filter text] [--min-ms N] [--puzzles dir]\n"
+                     "       conch_bench --profile [--puzzles dir]\n";
+        return 2;
+    }
+    if (Options.bProfile)
+        return ProfileOpcodePairs(Options);
+
+    PrintHeader();
+    BenchParse(Options);
+    BenchScan(Options);
+    BenchLoad(Options);
+    BenchRuns(Options);
+    BenchInputs(Options);
+    BenchLanes(Options);
+    BenchPuzzleSuite(Options);
+    return 0;
+}
@@ -0,0 +1,410 @@
+// Grader.cpp – headless batch grader. Scores many solution files against a puzzle
+// directory and streams one JSON object per submission (JSON Lines).
+//
+// Usage:
+//   conch_grade <puzzle_dir> <solution_dir | manifest> [-o results.jsonl] [-j workers] [-b batch] [-l] [-p] [-c]
+//
+// A solution directory pairs files by name: `<puzzle>.<ext>` grades against
+// `<puzzle>.json`, and every file inside a `<puzzle>/` subdirectory does too.
+// A manifest is a text file with one `<puzzle> <solution path>` pair per line;
+// relative paths resolve against the manifest's directory and `#` starts a comment.
+// With -l each submission's tests run together as lockstep lanes of one batch.
+// With -p each result also carries a per-source-line profile summed over its tests.
+// With -c puzzles load through a binary `<puzzle>.json.cache` written next to each file.
+
+#include "../TestApp/Puzzle.h"
+#include "../TestApp/TestRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+
+struct GradeSubmission
+{
+    std::string PuzzleName;
+    std::filesystem::path SolutionPath;
+};
+
+struct GradeOptions
+{
+    std::filesystem::path PuzzleDir;
+    std::filesystem::path Solutions;
+    std::string OutputPath = "-";
+    unsigned WorkerCount = 0;
+    size_t BatchSize = 0;
+    bool bBatchLanes = false;
+    bool bProfileLines = false;
+    bool bPuzzleCache = false;
+    bool bOptimizeBytecode = false;
+    ConExecutionBudget Budget = DefaultTestBudget();
+};
+
+// ============================================================
+// Submission sources
+// ============================================================
+
+// Yields submissions one at a time so a manifest never has to be held in memory.
+struct SubmissionSource
+{
+    virtual ~SubmissionSource() = default;
+    virtual bool Next(GradeSubmission& Out) = 0;
+};
+
+struct DirectorySource final : public SubmissionSource
+{
+    explicit DirectorySource(const std::filesystem::path& Dir)
+    {
+        std::error_code EC;
+        for (const auto& Entry : std::filesystem::directory_iterator(Dir, EC))
+        {
+            std::error_code EntryEC;
+            if (Entry.is_directory(EntryEC))
+            {
+                const std::string Puzzle = Entry.path().filename().string();
+                for (const auto& Inner : std::filesystem::directory_iterator(Entry.path(), EntryEC))
+                {
+                    std::error_code InnerEC;
+                    if (Inner.is_regular_file(InnerEC) && !InnerEC)
+                        Pending.push_back({Puzzle, Inner.path()});
+                }
+            }
+            else if (Entry.is_regular_file(EntryEC) && !EntryEC)
+            {
+                Pending.push_back({Entry.path().stem().string(), Entry.path()});
+            }
+        }
+        // directory order is unspecified; sort so repeated runs write identical files
+        std::sort(Pending.begin(), Pending.end(),
+            [](const GradeSubmission& A, const GradeSubmission& B){ return A.SolutionPath < B.SolutionPath; });
+    }
+
+    bool Next(GradeSubmission& Out) override
+    {
+        if (Cursor >= Pending.size()) return false;
+        Out = Pending[Cursor++];
+        return true;
+    }
+
+private:
+    std::vector<GradeSubmission> Pending;
+    size_t Cursor = 0;
+};
+
+struct ManifestSource final : public SubmissionSource
+{
+    explicit ManifestSource(const std::filesystem::path& Path)
+        : Input(Path), BaseDir(Path.parent_path())
+    {
+    }
+
+    bool IsOpen() const { return static_cast<bool>(Input); }
+
+    bool Next(GradeSubmission& Out) override
+    {
+        std::string Line;
+        while (std::getline(Input, Line))
+        {
+            const size_t Comment = Line.find('#');
+            if (Comment != std::string::npos) Line.erase(Comment);
+            std::istringstream Fields(Line);
+            std::string Puzzle;
+            if (!(Fields >> Puzzle)) continue;
+            std::string Solution;
+            std::getline(Fields >> std::ws, Solution);
+            while (!Solution.empty() && (Solution.back() == ' ' || Solution.back() == '\t' || Solution.back() == '\r'))
+                Solution.pop_back();
+            Out.PuzzleName = Puzzle;
+            Out.SolutionPath = std::filesystem::path(Solution);
+            if (Out.SolutionPath.is_relative()) Out.SolutionPath = BaseDir / Out.SolutionPath;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::ifstream Input;
+    std::filesystem::path BaseDir;
+};
+
+// ============================================================
+// JSON output
+// ============================================================
+
+std::string JsonString(const std::string& Text)
+{
+    std::string Out = "\"";
+    for (const char Ch : Text)
+    {
+        switch (Ch)
+        {
+        case '"':  Out += "\\\""; break;
+        case '\\': Out += "\\\\"; break;
+        case '\n': Out += "\\n"; break;
+        case '\r': Out += "\\r"; break;
+        case '\t': Out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(Ch) < 0x20)
+            {
+                static const char* Hex = "0123456789abcdef";
+                Out += "\\u00";
+                Out += Hex[(Ch >> 4) & 0xF];
+                Out += Hex[Ch & 0xF];
+            }
+            else
+            {
+                Out += Ch;
+            }
+            break;
+        }
+    }
+    Out += "\"";
+    return Out;
+}
+
+std::string JsonStringArray(const std::vector<std::string>& Values)
+{
+    std::string Out = "[";
+    for (size_t i = 0; i < Values.size(); ++i)
+    {
+        if (i) Out += ",";
+        Out += JsonString(Values[i]);
+    }
+    return Out + "]";
+}
+
+const char* StatusName(TestCaseStatus Status)
+{
+    switch (Status)
+    {
+    case TestCaseStatus::Passed:              return "pass";
+    case TestCaseStatus::SetupFailed:         return "setup_error";
+    case TestCaseStatus::RuntimeError:        return "runtime_error";
+    case TestCaseStatus::ExpectationMismatch: return "fail";
+    case TestCaseStatus::BudgetExhausted:     return "budget_exhausted";
+    }
+    return "fail";
+}
+
+// one line per submission; "status" is pass, fail, parse_error or load_error
+void WriteResultLine(std::ostream& Out,
+                     const GradeSubmission& Submission,
+                     const PuzzleData* Puzzle,
+                     const std::string& LoadError,
+                     const PuzzleRunResult* Run)
+{
+    Out << "{\"puzzle\":" << JsonString(Submission.PuzzleName)
+        << ",\"solution\":" << JsonString(Submission.SolutionPath.generic_string());
+    if (!LoadError.empty())
+    {
+        Out << ",\"status\":\"load_error\",\"errors\":" << JsonStringArray({LoadError}) << "}\n";
+        return;
+    }
+    if (!Run->bParsed)
+    {
+        Out << ",\"status\":\"parse_error\",\"errors\":" << JsonStringArray(Run->ParseErrors) << "}\n";
+        return;
+    }
+
+    long long DynamicCycles = 0;
+    for (const TestCaseResult& Test : Run->Tests) DynamicCycles += Test.ExecutedCycles;
+    Out << ",\"status\":" << (Run->AllPassed() ? "\"pass\"" : "\"fail\"")
+        << ",\"staticCycles\":" << Run->StaticCycles
+        << ",\"dynamicCycles\":" << DynamicCycles
+        << ",\"tests\":[";
+    for (size_t i = 0; i < Run->Tests.size(); ++i)
+    {
+        const TestCaseResult& Test = Run->Tests[i];
+        if (i) Out << ",";
+        Out << "{\"name\":" << JsonString(Puzzle->Tests[i].Name)
+            << ",\"status\":\"" << StatusName(Test.Status) << "\""
+            << ",\"cycles\":" << Test.ExecutedCycles;
+        if (!Test.Messages.empty()) Out << ",\"messages\":" << JsonStringArray(Test.Messages);
+        Out << "}";
+    }
+    Out << "]";
+    if (!Run->LineProfile.empty())
+    {
+        Out << ",\"lines\":[";
+        for (size_t i = 0; i < Run->LineProfile.size(); ++i)
+        {
+            const ConLineProfile& Counters = Run->LineProfile[i].Counters;
+            if (i) Out << ",";
+            Out << "{\"line\":" << Run->LineProfile[i].Line
+                << ",\"executions\":" << Counters.Executions
+                << ",\"cycles\":" << Counters.Cycles;
+            if (Counters.IfTaken + Counters.IfNotTaken > 0)
+                Out << ",\"ifTaken\":" << Counters.IfTaken << ",\"ifNotTaken\":" << Counters.IfNotTaken;
+            if (Counters.RedoIterations + Counters.RedoExits > 0)
+                Out << ",\"redoIterations\":" << Counters.RedoIterations << ",\"redoExits\":" << Counters.RedoExits;
+            Out << "}";
+        }
+        Out << "]";
+    }
+    Out << "}\n";
+}
+
+// ============================================================
+// Command line
+// ============================================================
+
+void PrintUsage()
+{
+    std::cerr << "Usage: conch_grade <puzzle_dir> <solution_dir | manifest> "
+                 "[-o results.jsonl] [-j workers] [-b batch] [-l] [-p] [-c] [-O] [-m cycles] [-t ms]\n";
+}
+
+bool ParseArguments(int Argc, char** Argv, GradeOptions& Options)
+{
+    std::vector<std::string> Positional;
+    for (int i = 1; i < Argc; ++i)
+    {
+        const std::string Arg = Argv[i];
+        const bool bHasValue = i + 1 < Argc;
+        if (Arg == "-o" && bHasValue)      Options.OutputPath = Argv[++i];
+        else if (Arg == "-j" && bHasValue) Options.WorkerCount = static_cast<unsigned>(std::strtoul(Argv[++i], nullptr, 10));
+        else if (Arg == "-b" && bHasValue) Options.BatchSize = static_cast<size_t>(std::strtoul(Argv[++i], nullptr, 10));
+        else if (Arg == "-l")              Options.bBatchLanes = true;
+        else if (Arg == "-p")              Options.bProfileLines = true;
+        else if (Arg == "-c")              Options.bPuzzleCache = true;
+        else if (Arg == "-O")              Options.bOptimizeBytecode = true;
+        else if (Arg == "-m" && bHasValue) Options.Budget.MaxCycles = static_cast<int32>(std::strtol(Argv[++i], nullptr, 10));
+        else if (Arg == "-t" && bHasValue) Options.Budget.MaxDuration = std::chrono::milliseconds(std::strtol(Argv[++i], nullptr, 10));
+        else if (!Arg.empty() && Arg[0] == '-') return false;
+        else Positional.push_back(Arg);
+    }
+    if (Positional.size() != 2) return false;
+    Options.PuzzleDir = Positional[0];
+    Options.Solutions = Positional[1];
+    return true;
+}
+
+} // namespace
+
+int main(int Argc, char** Argv)
+{
+    GradeOptions Options;
+    if (!ParseArguments(Argc, Argv, Options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    // puzzles are small and shared by every submission, so they are loaded up front
+    std::vector<PuzzleData> Puzzles;
+    std::unordered_map<std::string, size_t> PuzzleIndex;
+    for (const std::filesystem::path& File : FindPuzzleFiles(Options.PuzzleDir))
+    {
+        PuzzleData Puzzle;
+        std::string Error;
+        const bool bLoaded = Options.bPuzzleCache ? LoadPuzzleCached(File.string(), Puzzle, Error)
+                                                  : LoadPuzzleFromFile(File.string(), Puzzle, Error);
+        if (!bLoaded)
+        {
+            std::cerr << "Skipping " << File.string() << ": " << Error << "\n";
+            continue;
+        }
+        PuzzleIndex[File.stem().string()] = Puzzles.size();
+        Puzzles.push_back(std::move(Puzzle));
+    }
+    if (Puzzles.empty())
+    {
+        std::cerr << "No puzzles found in " << Options.PuzzleDir.string() << "\n";
+        return 2;
+    }
+
+    std::unique_ptr<SubmissionSource> Source;
+    std::error_code EC;
+    if (std::filesystem::is_directory(Options.Solutions, EC))
+    {
+        Source = std::make_unique<DirectorySource>(Options.Solutions);
+    }
+    else
+    {
+        auto Manifest = std::make_unique<ManifestSource>(Options.Solutions);
+        if (!Manifest->IsOpen())
+        {
+            std::cerr << "Unable to open manifest: " << Options.Solutions.string() << "\n";
+            return 2;
+        }
+        Source = std::move(Manifest);
+    }
+
+    std::ofstream OutFile;
+    if (Options.OutputPath != "-")
+    {
+        OutFile.open(Options.OutputPath);
+        if (!OutFile)
+        {
+            std::cerr << "Unable to write to file: " << Options.OutputPath << "\n";
+            return 2;
+        }
+    }
+    std::ostream& Out = Options.OutputPath == "-" ? std::cout : OutFile;
+
+    const unsigned Workers = Options.WorkerCount > 0 ? Options.WorkerCount : DefaultWorkerCount();
+    // only one batch of programs and results is alive at a time, which bounds memory
+    const size_t BatchSize = Options.BatchSize > 0 ? Options.BatchSize : static_cast<size_t>(Workers) * 16;
+
+    size_t Graded = 0;
+    size_t Passed = 0;
+    bool bMoreSubmissions = true;
+    std::vector<GradeSubmission> Batch;
+    std::vector<std::string> LoadErrors;
+    std::vector<PuzzleRunJob> Jobs;
+    std::vector<size_t> JobForSubmission;
+    while (bMoreSubmissions)
+    {
+        Batch.clear();
+        LoadErrors.clear();
+        Jobs.clear();
+        JobForSubmission.clear();
+
+        GradeSubmission Submission;
+        while (Batch.size() < BatchSize && (bMoreSubmissions = Source->Next(Submission)))
+        {
+            std::string Error;
+            PuzzleRunJob Job;
+            const auto Found = PuzzleIndex.find(Submission.PuzzleName);
+            if (Found == PuzzleIndex.end())
+            {
+                Error = "No puzzle named '" + Submission.PuzzleName + "'";
+            }
+            else if (LoadCodeFromFile(Submission.SolutionPath.string(), Job.Code, Error))
+            {
+                Job.Puzzle = &Puzzles[Found->second];
+            }
+            JobForSubmission.push_back(Error.empty() ? Jobs.size() : static_cast<size_t>(-1));
+            if (Error.empty()) Jobs.push_back(std::move(Job));
+            Batch.push_back(Submission);
+            LoadErrors.push_back(Error);
+        }
+
+        const std::vector<PuzzleRunResult> Results = RunPuzzleSuite(Jobs, Workers, Options.bBatchLanes, Options.bProfileLines, Options.Budget,
+                                                                     Options.bOptimizeBytecode);
+        for (size_t i = 0; i < Batch.size(); ++i)
+        {
+            const bool bLoaded = LoadErrors[i].empty();
+            const PuzzleRunResult* Run = bLoaded ? &Results[JobForSubmission[i]] : nullptr;
+            const PuzzleData* Puzzle = bLoaded ? Jobs[JobForSubmission[i]].Puzzle : nullptr;
+            WriteResultLine(Out, Batch[i], Puzzle, LoadErrors[i], Run);
+            ++Graded;
+            if (Run && Run->AllPassed()) ++Passed;
+        }
+        Out.flush();
+    }
+
+    std::cerr << "Graded " << Graded << " submission(s): " << Passed << " passed, "
+              << (Graded - Passed) << " did not.\n";
+    return Passed == Graded ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// Optimizer.cpp – searches for a cheaper program that still passes every test of a puzzle.
+//
+// Usage:
+//   conch_opt <puzzle.json> <solution> [-t seconds] [-j workers] [-s seed] [-n candidates] [-o out]
+//
+// The best program found is written to out (stdout by default) and a summary to stderr. The
+// exit code is 0 when the search found something cheaper than the starting solution.
+
+#include "../TestApp/Puzzle.h"
+#include "../TestApp/Superoptimizer.h"
+#include "../TestApp/TestRunner.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct OptimizerOptions
+{
+    std::string PuzzlePath;
+    std::string SolutionPath;
+    std::string OutputPath = "-";
+    SuperoptimizerOptions Search;
+};
+
+void PrintUsage()
+{
+    std::cerr << "Usage: conch_opt <puzzle.json> <solution> [-t seconds] [-j workers] [-s seed] [-n candidates] [-o out]\n";
+}
+
+bool ParseArguments(int Argc, char** Argv, OptimizerOptions& Options)
+{
+    std::vector<std::string> Positional;
+    for (int i = 1; i < Argc; ++i)
+    {
+        const std::string Arg = Argv[i];
+        const bool bHasValue = i + 1 < Argc;
+        if (Arg == "-o" && bHasValue)      Options.OutputPath = Argv[++i];
+        else if (Arg == "-t" && bHasValue) Options.Search.TimeBudgetSeconds = std::strtod(Argv[++i], nullptr);
+        else if (Arg == "-j" && bHasValue) Options.Search.WorkerCount = static_cast<unsigned>(std::strtoul(Argv[++i], nullptr, 10));
+        else if (Arg == "-s" && bHasValue) Options.Search.Seed = std::strtoull(Argv[++i], nullptr, 10);
+        else if (Arg == "-n" && bHasValue) Options.Search.MaxCandidates = std::strtoull(Argv[++i], nullptr, 10);
+        else if (!Arg.empty() && Arg[0] == '-') return false;
+        else Positional.push_back(Arg);
+    }
+    if (Positional.size() != 2) return false;
+    Options.PuzzlePath = Positional[0];
+    Options.SolutionPath = Positional[1];
+    return true;
+}
+
+} // namespace
+
+int main(int Argc, char** Argv)
+{
+    OptimizerOptions Options;
+    if (!ParseArguments(Argc, Argv, Options))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    PuzzleData Puzzle;
+    std::vector<std::string> Code;
+    std::string Error;
+    if (!LoadPuzzleFromFile(Options.PuzzlePath, Puzzle, Error) || !LoadCodeFromFile(Options.SolutionPath, Code, Error))
+    {
+        std::cerr << Error << "\n";
+        return 2;
+    }
+
+    const SuperoptimizerResult Result = Superoptimize(Puzzle, Code, Options.Search);
+    if (!Result.bStartValid)
+    {
+        std::cerr << Result.Error << "\n";
+        return 2;
+    }
+
+    std::ofstream OutFile;
+    if (Options.OutputPath != "-")
+    {
+        OutFile.open(Options.OutputPath);
+        if (!OutFile)
+        {
+            std::cerr << "Unable to write to file: " << Options.OutputPath << "\n";
+            return 2;
+        }
+    }
+    std::ostream& Out = Options.OutputPath == "-" ? std::cout : OutFile;
+    for (const std::string& Line : Result.BestCode) Out << Line << "\n";
+
+    std::cerr << "Static cycles: " << Result.StartStaticCycles << " -> " << Result.BestStaticCycles
+              << ", dynamic cycles: " << Result.StartDynamicCycles << " -> " << Result.BestDynamicCycles << "\n"
+              << "Candidates: " << Result.CandidatesTried << " tried, " << Result.CandidatesUnique
+              << " unique, " << Result.CandidatesVerified << " run on the tests\n";
+    return Result.Improved() ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+// Atomic because the parallel runner allocates from several threads at once.
+std::atomic<uint64_t> GAllocationCount{0};
+}
+
+uint64_t GetAllocationCount()
+{
+    return GAllocationCount.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t Size)
+{
+    GAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* Ptr = std::malloc(Size == 0 ? 1 : Size))
+        return Ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* Ptr) noexcept
+{
+    std::free(Ptr);
+}
+
+void operator delete(void* Ptr, std::size_t) noexcept
+{
+    std::free(Ptr);
+}
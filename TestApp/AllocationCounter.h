@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// ============================================================
+// Global allocation counter shared by the tests and the benchmarks
+// ============================================================
+
+// Number of global operator new calls made so far by any thread. Linking AllocationCounter.cpp
+// replaces the global allocation functions; they live in their own translation unit so the
+// compiler never inlines them next to a caller's new/delete pair.
+uint64_t GetAllocationCount();
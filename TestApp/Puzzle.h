@@ -2,6 +2,9 @@
 
 #include "SimpleJson.h"
 
+#include "../src/Conchpiler/mapped_file.h"
+
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -10,6 +13,15 @@ struct PuzzleListSpec
 {
     std::string Name;
     std::vector<int> Values;
+    // DAT lists may name a binary file of int32 values instead, relative to the puzzle file.
+    // It is mapped when the puzzle loads and test runs borrow it without copying.
+    std::string File;
+    std::shared_ptr<const ConMappedFile> Mapped;
+
+    ConListView GetValueView() const
+    {
+        return Mapped ? Mapped->GetValues() : ConListView{Values.data(), Values.size()};
+    }
 };
 
 struct PuzzleOutSpec
@@ -54,6 +66,15 @@ struct PuzzleData
 };
 
 bool LoadPuzzleFromFile(const std::string& Path, PuzzleData& OutData, std::string& OutError);
+// BaseDir resolves relative DAT list files; the current directory when empty
+bool LoadPuzzleFromText(const std::string& Text, PuzzleData& OutData, std::string& OutError,
+                        const std::string& BaseDir = std::string());
+
+// Loads through a binary cache kept next to the JSON file (see GetPuzzleCachePath). The cache is
+// trusted while the source size and modification time match, revalidated by content hash when only
+// the time moved, and rebuilt otherwise; failing to write it never fails the load.
+bool LoadPuzzleCached(const std::string& Path, PuzzleData& OutData, std::string& OutError);
+std::string GetPuzzleCachePath(const std::string& Path);
 
 bool ParseRegisterName(const std::string& Name, int& OutIndex);
 
@@ -1,404 +1,563 @@
 #include "SimpleJson.h"
 
 #include <cctype>
+#include <limits>
 #include <sstream>
 
 namespace
 {
-class SimpleJsonParser
+bool ParseValue(SimpleJsonCursor& Cursor, SimpleJsonValue& OutValue)
 {
-public:
-    explicit SimpleJsonParser(const std::string& InText)
-        : Text(InText)
+    switch (Cursor.PeekType())
     {
-    }
-
-    bool Parse(SimpleJsonValue& OutValue)
-    {
-        SkipWhitespace();
-        if (!ParseValue(OutValue))
+    case SimpleJsonValue::Type::Null:
+        if (!Cursor.ReadNull())
         {
             return false;
         }
-        SkipWhitespace();
-        if (!IsAtEnd())
+        OutValue.SetNull();
+        return true;
+    case SimpleJsonValue::Type::Boolean:
+    {
+        bool bValue = false;
+        if (!Cursor.ReadBool(bValue))
         {
-            ErrorMessage = "Unexpected trailing characters";
             return false;
         }
+        OutValue.SetBool(bValue);
         return true;
     }
-
-    const std::string& GetError() const
+    case SimpleJsonValue::Type::Number:
     {
-        return ErrorMessage;
-    }
-
-private:
-    bool IsAtEnd() const
-    {
-        return Index >= Text.size();
-    }
-
-    char Peek() const
-    {
-        return IsAtEnd() ? '\0' : Text[Index];
-    }
-
-    char Consume()
-    {
-        return IsAtEnd() ? '\0' : Text[Index++];
-    }
-
-    void SkipWhitespace()
-    {
-        while (!IsAtEnd())
+        double Number = 0.0;
+        if (!Cursor.ReadNumber(Number))
         {
-            const char Ch = Peek();
-            if (Ch == ' ' || Ch == '\t' || Ch == '\n' || Ch == '\r')
-            {
-                ++Index;
-            }
-            else
-            {
-                break;
-            }
+            return false;
         }
+        OutValue.SetNumber(Number);
+        return true;
     }
-
-    bool Match(const char Expected)
+    case SimpleJsonValue::Type::String:
     {
-        if (Peek() == Expected)
+        std::string Value;
+        if (!Cursor.ReadString(Value))
         {
-            ++Index;
-            return true;
+            return false;
         }
-        return false;
+        OutValue.SetString(std::move(Value));
+        return true;
     }
-
-    bool ParseValue(SimpleJsonValue& OutValue)
+    case SimpleJsonValue::Type::Array:
     {
-        if (IsAtEnd())
+        SimpleJsonValue::Array Elements;
+        if (!Cursor.BeginArray())
         {
-            ErrorMessage = "Unexpected end of input";
             return false;
         }
-        const char Ch = Peek();
-        if (Ch == 'n')
-        {
-            return ParseNull(OutValue);
-        }
-        if (Ch == 't' || Ch == 'f')
+        while (Cursor.NextElement())
         {
-            return ParseBool(OutValue);
+            Elements.emplace_back();
+            if (!ParseValue(Cursor, Elements.back()))
+            {
+                return false;
+            }
         }
-        if (Ch == '"')
+        if (Cursor.HasError())
         {
-            return ParseString(OutValue);
+            return false;
         }
-        if (Ch == '[')
+        OutValue.SetArray(std::move(Elements));
+        return true;
+    }
+    case SimpleJsonValue::Type::Object:
+    {
+        SimpleJsonValue::Object Members;
+        if (!Cursor.BeginObject())
         {
-            return ParseArray(OutValue);
+            return false;
         }
-        if (Ch == '{')
+        std::string Key;
+        while (Cursor.NextMember(Key))
         {
-            return ParseObject(OutValue);
+            SimpleJsonValue Value;
+            if (!ParseValue(Cursor, Value))
+            {
+                return false;
+            }
+            Members[Key] = std::move(Value);
         }
-        return ParseNumber(OutValue);
-    }
-
-    bool ParseNull(SimpleJsonValue& OutValue)
-    {
-        if (Text.compare(Index, 4, "null") != 0)
+        if (Cursor.HasError())
         {
-            ErrorMessage = "Invalid token, expected 'null'";
             return false;
         }
-        Index += 4;
-        OutValue.SetNull();
+        OutValue.SetObject(std::move(Members));
         return true;
     }
+    }
+    return false;
+}
+}
+
+SimpleJsonCursor::SimpleJsonCursor(const std::string& InText)
+    : Text(InText)
+{
+}
 
-    bool ParseBool(SimpleJsonValue& OutValue)
+void SimpleJsonCursor::SkipWhitespace()
+{
+    while (!IsAtEnd())
     {
-        if (Text.compare(Index, 4, "true") == 0)
+        const char Ch = Peek();
+        if (Ch == ' ' || Ch == '\t' || Ch == '\n' || Ch == '\r')
         {
-            Index += 4;
-            OutValue.SetBool(true);
-            return true;
+            ++Index;
         }
-        if (Text.compare(Index, 5, "false") == 0)
+        else
         {
-            Index += 5;
-            OutValue.SetBool(false);
-            return true;
+            break;
         }
-        ErrorMessage = "Invalid boolean literal";
+    }
+}
+
+bool SimpleJsonCursor::Match(const char Expected)
+{
+    if (Peek() == Expected)
+    {
+        ++Index;
+        return true;
+    }
+    return false;
+}
+
+bool SimpleJsonCursor::Fail(const char* Message)
+{
+    ErrorMessage = Message;
+    return false;
+}
+
+bool SimpleJsonCursor::ExpectValue()
+{
+    SkipWhitespace();
+    return IsAtEnd() ? Fail("Unexpected end of input") : true;
+}
+
+SimpleJsonValue::Type SimpleJsonCursor::PeekType()
+{
+    SkipWhitespace();
+    switch (Peek())
+    {
+    case '\0':
+    case 'n':
+        return SimpleJsonValue::Type::Null;
+    case 't':
+    case 'f':
+        return SimpleJsonValue::Type::Boolean;
+    case '"':
+        return SimpleJsonValue::Type::String;
+    case '[':
+        return SimpleJsonValue::Type::Array;
+    case '{':
+        return SimpleJsonValue::Type::Object;
+    default:
+        return SimpleJsonValue::Type::Number;
+    }
+}
+
+bool SimpleJsonCursor::ReadNull()
+{
+    if (!ExpectValue())
+    {
         return false;
     }
+    if (Text.compare(Index, 4, "null") != 0)
+    {
+        return Fail("Invalid token, expected 'null'");
+    }
+    Index += 4;
+    return true;
+}
 
-    bool ParseString(SimpleJsonValue& OutValue)
+bool SimpleJsonCursor::ReadBool(bool& bOutValue)
+{
+    if (!ExpectValue())
     {
-        if (!Match('"'))
-        {
-            ErrorMessage = "Expected opening quote for string";
-            return false;
-        }
-        std::string Value;
-        while (!IsAtEnd())
-        {
-            const char Ch = Consume();
-            if (Ch == '"')
-            {
-                OutValue.SetString(Value);
-                return true;
-            }
-            if (Ch == '\\')
-            {
-                if (!ParseEscape(Value))
-                {
-                    return false;
-                }
-            }
-            else
-            {
-                Value.push_back(Ch);
-            }
-        }
-        ErrorMessage = "Unterminated string";
         return false;
     }
+    if (Text.compare(Index, 4, "true") == 0)
+    {
+        Index += 4;
+        bOutValue = true;
+        return true;
+    }
+    if (Text.compare(Index, 5, "false") == 0)
+    {
+        Index += 5;
+        bOutValue = false;
+        return true;
+    }
+    return Fail("Invalid boolean literal");
+}
 
-    bool ParseEscape(std::string& OutValue)
+bool SimpleJsonCursor::ScanNumber(size_t& OutStart)
+{
+    OutStart = Index;
+    if (Peek() == '-')
     {
-        if (IsAtEnd())
-        {
-            ErrorMessage = "Unterminated escape sequence";
-            return false;
-        }
-        const char Escaped = Consume();
-        switch (Escaped)
+        ++Index;
+    }
+    if (!std::isdigit(static_cast<unsigned char>(Peek())))
+    {
+        return Fail("Invalid number literal");
+    }
+    if (Peek() == '0')
+    {
+        ++Index;
+    }
+    else
+    {
+        while (std::isdigit(static_cast<unsigned char>(Peek())))
         {
-        case '"': OutValue.push_back('"'); return true;
-        case '\\': OutValue.push_back('\\'); return true;
-        case '/': OutValue.push_back('/'); return true;
-        case 'b': OutValue.push_back('\b'); return true;
-        case 'f': OutValue.push_back('\f'); return true;
-        case 'n': OutValue.push_back('\n'); return true;
-        case 'r': OutValue.push_back('\r'); return true;
-        case 't': OutValue.push_back('\t'); return true;
-        case 'u':
-            return ParseUnicodeEscape(OutValue);
-        default:
-            ErrorMessage = "Unsupported escape sequence";
-            return false;
+            ++Index;
         }
     }
 
-    bool ParseUnicodeEscape(std::string& OutValue)
+    if (Peek() == '.')
     {
-        if (Index + 4 > Text.size())
-        {
-            ErrorMessage = "Invalid unicode escape";
-            return false;
-        }
-        int CodePoint = 0;
-        for (int i = 0; i < 4; ++i)
-        {
-            const char Ch = Text[Index + i];
-            if (!std::isxdigit(static_cast<unsigned char>(Ch)))
-            {
-                ErrorMessage = "Invalid unicode escape";
-                return false;
-            }
-            CodePoint <<= 4;
-            if (Ch >= '0' && Ch <= '9')
-            {
-                CodePoint += Ch - '0';
-            }
-            else if (Ch >= 'a' && Ch <= 'f')
-            {
-                CodePoint += 10 + (Ch - 'a');
-            }
-            else
-            {
-                CodePoint += 10 + (Ch - 'A');
-            }
-        }
-        Index += 4;
-        if (CodePoint <= 0x7F)
+        ++Index;
+        if (!std::isdigit(static_cast<unsigned char>(Peek())))
         {
-            OutValue.push_back(static_cast<char>(CodePoint));
+            return Fail("Invalid fractional literal");
         }
-        else
+        while (std::isdigit(static_cast<unsigned char>(Peek())))
         {
-            std::ostringstream Oss;
-            Oss << "\\u" << std::hex << CodePoint;
-            OutValue += Oss.str();
+            ++Index;
         }
-        return true;
     }
 
-    bool ParseNumber(SimpleJsonValue& OutValue)
+    if (Peek() == 'e' || Peek() == 'E')
     {
-        const size_t Start = Index;
-        if (Peek() == '-')
+        ++Index;
+        if (Peek() == '+' || Peek() == '-')
         {
             ++Index;
         }
         if (!std::isdigit(static_cast<unsigned char>(Peek())))
         {
-            ErrorMessage = "Invalid number literal";
-            return false;
+            return Fail("Invalid exponent");
         }
-        if (Peek() == '0')
+        while (std::isdigit(static_cast<unsigned char>(Peek())))
         {
             ++Index;
         }
-        else
+    }
+    return true;
+}
+
+bool SimpleJsonCursor::ReadNumber(double& OutValue)
+{
+    size_t Start = 0;
+    if (!ExpectValue() || !ScanNumber(Start))
+    {
+        return false;
+    }
+    try
+    {
+        OutValue = std::stod(Text.substr(Start, Index - Start));
+        return true;
+    }
+    catch (...)
+    {
+        return Fail("Failed to parse number");
+    }
+}
+
+bool SimpleJsonCursor::ReadInt(int& OutValue)
+{
+    if (!ExpectValue())
+    {
+        return false;
+    }
+    // plain integers that fit are accumulated directly; anything else takes the double path
+    size_t Cursor = Index;
+    const bool bNegative = Text[Cursor] == '-';
+    if (bNegative)
+    {
+        ++Cursor;
+    }
+    long long Magnitude = 0;
+    size_t Digits = 0;
+    if (Cursor < Text.size() && Text[Cursor] == '0')
+    {
+        ++Cursor;
+        Digits = 1;
+    }
+    else
+    {
+        while (Cursor < Text.size() && std::isdigit(static_cast<unsigned char>(Text[Cursor])) && Digits < 10)
         {
-            while (std::isdigit(static_cast<unsigned char>(Peek())))
-            {
-                ++Index;
-            }
+            Magnitude = Magnitude * 10 + (Text[Cursor] - '0');
+            ++Cursor;
+            ++Digits;
         }
+    }
+    const char Next = Cursor < Text.size() ? Text[Cursor] : '\0';
+    const long long Value = bNegative ? -Magnitude : Magnitude;
+    if (Digits > 0 && Next != '.' && Next != 'e' && Next != 'E' && !std::isdigit(static_cast<unsigned char>(Next))
+        && Value >= std::numeric_limits<int>::min() && Value <= std::numeric_limits<int>::max())
+    {
+        OutValue = static_cast<int>(Value);
+        Index = Cursor;
+        return true;
+    }
 
-        if (Peek() == '.')
+    double Number = 0.0;
+    if (!ReadNumber(Number))
+    {
+        return false;
+    }
+    OutValue = static_cast<int>(Number);
+    return true;
+}
+
+bool SimpleJsonCursor::ReadString(std::string& OutValue)
+{
+    if (!ExpectValue())
+    {
+        return false;
+    }
+    if (!Match('"'))
+    {
+        return Fail("Expected opening quote for string");
+    }
+    OutValue.clear();
+    while (!IsAtEnd())
+    {
+        const char Ch = Text[Index++];
+        if (Ch == '"')
         {
-            ++Index;
-            if (!std::isdigit(static_cast<unsigned char>(Peek())))
-            {
-                ErrorMessage = "Invalid fractional literal";
-                return false;
-            }
-            while (std::isdigit(static_cast<unsigned char>(Peek())))
-            {
-                ++Index;
-            }
+            return true;
         }
-
-        if (Peek() == 'e' || Peek() == 'E')
+        if (Ch == '\\')
         {
-            ++Index;
-            if (Peek() == '+' || Peek() == '-')
+            if (!ParseEscape(OutValue))
             {
-                ++Index;
-            }
-            if (!std::isdigit(static_cast<unsigned char>(Peek())))
-            {
-                ErrorMessage = "Invalid exponent";
                 return false;
             }
-            while (std::isdigit(static_cast<unsigned char>(Peek())))
-            {
-                ++Index;
-            }
-        }
-
-        const std::string NumberLiteral = Text.substr(Start, Index - Start);
-        try
-        {
-            const double Value = std::stod(NumberLiteral);
-            OutValue.SetNumber(Value);
-            return true;
         }
-        catch (...)
+        else
         {
-            ErrorMessage = "Failed to parse number";
-            return false;
+            OutValue.push_back(Ch);
         }
     }
+    return Fail("Unterminated string");
+}
+
+bool SimpleJsonCursor::ParseEscape(std::string& OutValue)
+{
+    if (IsAtEnd())
+    {
+        return Fail("Unterminated escape sequence");
+    }
+    const char Escaped = Text[Index++];
+    switch (Escaped)
+    {
+    case '"': OutValue.push_back('"'); return true;
+    case '\\': OutValue.push_back('\\'); return true;
+    case '/': OutValue.push_back('/'); return true;
+    case 'b': OutValue.push_back('\b'); return true;
+    case 'f': OutValue.push_back('\f'); return true;
+    case 'n': OutValue.push_back('\n'); return true;
+    case 'r': OutValue.push_back('\r'); return true;
+    case 't': OutValue.push_back('\t'); return true;
+    case 'u':
+        return ParseUnicodeEscape(OutValue);
+    default:
+        return Fail("Unsupported escape sequence");
+    }
+}
 
-    bool ParseArray(SimpleJsonValue& OutValue)
+bool SimpleJsonCursor::ParseUnicodeEscape(std::string& OutValue)
+{
+    if (Index + 4 > Text.size())
+    {
+        return Fail("Invalid unicode escape");
+    }
+    int CodePoint = 0;
+    for (int i = 0; i < 4; ++i)
     {
-        if (!Match('['))
+        const char Ch = Text[Index + i];
+        if (!std::isxdigit(static_cast<unsigned char>(Ch)))
         {
-            ErrorMessage = "Expected '['";
-            return false;
+            return Fail("Invalid unicode escape");
         }
-        SimpleJsonValue::Array Elements;
-        SkipWhitespace();
-        if (Match(']'))
+        CodePoint <<= 4;
+        if (Ch >= '0' && Ch <= '9')
         {
-            OutValue.SetArray(std::move(Elements));
-            return true;
+            CodePoint += Ch - '0';
         }
-        while (true)
+        else if (Ch >= 'a' && Ch <= 'f')
         {
-            SimpleJsonValue Element;
-            if (!ParseValue(Element))
-            {
-                return false;
-            }
-            Elements.push_back(Element);
-            SkipWhitespace();
-            if (Match(']'))
-            {
-                OutValue.SetArray(std::move(Elements));
-                return true;
-            }
-            if (!Match(','))
-            {
-                ErrorMessage = "Expected ',' or ']'";
-                return false;
-            }
-            SkipWhitespace();
+            CodePoint += 10 + (Ch - 'a');
         }
+        else
+        {
+            CodePoint += 10 + (Ch - 'A');
+        }
+    }
+    Index += 4;
+    if (CodePoint <= 0x7F)
+    {
+        OutValue.push_back(static_cast<char>(CodePoint));
+    }
+    else
+    {
+        std::ostringstream Oss;
+        Oss << "\\u" << std::hex << CodePoint;
+        OutValue += Oss.str();
     }
+    return true;
+}
 
-    bool ParseObject(SimpleJsonValue& OutValue)
+bool SimpleJsonCursor::SkipValue()
+{
+    switch (PeekType())
+    {
+    case SimpleJsonValue::Type::Null:
+        return ReadNull();
+    case SimpleJsonValue::Type::Boolean:
+    {
+        bool bValue = false;
+        return ReadBool(bValue);
+    }
+    case SimpleJsonValue::Type::Number:
+    {
+        double Number = 0.0;
+        return ReadNumber(Number);
+    }
+    case SimpleJsonValue::Type::String:
     {
-        if (!Match('{'))
+        std::string Value;
+        return ReadString(Value);
+    }
+    case SimpleJsonValue::Type::Array:
+        if (!BeginArray())
         {
-            ErrorMessage = "Expected '{'";
             return false;
         }
-        SimpleJsonValue::Object Members;
-        SkipWhitespace();
-        if (Match('}'))
-        {
-            OutValue.SetObject(std::move(Members));
-            return true;
-        }
-        while (true)
+        while (NextElement())
         {
-            SimpleJsonValue KeyValue;
-            if (!ParseString(KeyValue))
-            {
-                return false;
-            }
-            SkipWhitespace();
-            if (!Match(':'))
+            if (!SkipValue())
             {
-                ErrorMessage = "Expected ':' after key";
                 return false;
             }
-            SkipWhitespace();
-            SimpleJsonValue Value;
-            if (!ParseValue(Value))
-            {
-                return false;
-            }
-            Members[KeyValue.AsString()] = Value;
-            SkipWhitespace();
-            if (Match('}'))
-            {
-                OutValue.SetObject(std::move(Members));
-                return true;
-            }
-            if (!Match(','))
+        }
+        return !HasError();
+    case SimpleJsonValue::Type::Object:
+    {
+        if (!BeginObject())
+        {
+            return false;
+        }
+        std::string Key;
+        while (NextMember(Key))
+        {
+            if (!SkipValue())
             {
-                ErrorMessage = "Expected ',' or '}'";
                 return false;
             }
-            SkipWhitespace();
         }
+        return !HasError();
+    }
+    }
+    return false;
+}
+
+bool SimpleJsonCursor::BeginArray()
+{
+    if (!ExpectValue())
+    {
+        return false;
+    }
+    if (!Match('['))
+    {
+        return Fail("Expected '['");
+    }
+    bFirstInContainer.push_back(true);
+    return true;
+}
+
+bool SimpleJsonCursor::NextElement()
+{
+    return NextInContainer(']', "Expected ',' or ']'");
+}
+
+bool SimpleJsonCursor::BeginObject()
+{
+    if (!ExpectValue())
+    {
+        return false;
+    }
+    if (!Match('{'))
+    {
+        return Fail("Expected '{'");
+    }
+    bFirstInContainer.push_back(true);
+    return true;
+}
+
+bool SimpleJsonCursor::NextMember(std::string& OutKey)
+{
+    if (!NextInContainer('}', "Expected ',' or '}'"))
+    {
+        return false;
+    }
+    SkipWhitespace();
+    if (Peek() != '"')
+    {
+        return Fail("Expected opening quote for string");
+    }
+    if (!ReadString(OutKey))
+    {
+        return false;
     }
+    SkipWhitespace();
+    if (!Match(':'))
+    {
+        return Fail("Expected ':' after key");
+    }
+    return true;
+}
+
+bool SimpleJsonCursor::NextInContainer(const char Close, const char* SeparatorError)
+{
+    if (HasError() || bFirstInContainer.empty())
+    {
+        return false;
+    }
+    SkipWhitespace();
+    if (Match(Close))
+    {
+        bFirstInContainer.pop_back();
+        return false;
+    }
+    // a separator must be followed by another element, so trailing commas still fail
+    if (bFirstInContainer.back())
+    {
+        bFirstInContainer.back() = false;
+        return true;
+    }
+    if (!Match(','))
+    {
+        return Fail(SeparatorError);
+    }
+    SkipWhitespace();
+    return true;
+}
 
-    const std::string& Text;
-    size_t Index = 0;
-    std::string ErrorMessage;
-};
+bool SimpleJsonCursor::Finish()
+{
+    SkipWhitespace();
+    return IsAtEnd() ? true : Fail("Unexpected trailing characters");
 }
 
 SimpleJsonValue::SimpleJsonValue()
@@ -472,10 +631,10 @@ SimpleJsonValue* SimpleJsonValue::Find(const std::string& Key)
 
 bool SimpleJsonValue::Parse(const std::string& Text, SimpleJsonValue& OutValue, std::string& OutError)
 {
-    SimpleJsonParser Parser(Text);
-    if (!Parser.Parse(OutValue))
+    SimpleJsonCursor Cursor(Text);
+    if (!ParseValue(Cursor, OutValue) || !Cursor.Finish())
     {
-        OutError = Parser.GetError();
+        OutError = Cursor.GetError();
         return false;
     }
     return true;
@@ -63,3 +63,59 @@ private:
     Object ObjectValue;
 };
 
+// Pull reader over JSON text for loaders that fill their own structures instead of building a
+// SimpleJsonValue tree; SimpleJsonValue::Parse is built on it. Each read skips whitespace
+// first. After a failed read GetError says why and the cursor must not be used further.
+//
+//   Cursor.BeginObject();
+//   std::string Key;
+//   while (Cursor.NextMember(Key)) { ...read or SkipValue()... }
+//   if (Cursor.HasError()) ...
+class SimpleJsonCursor
+{
+public:
+    explicit SimpleJsonCursor(const std::string& InText);
+
+    // the type of the next value, judged by its first character; Null at the end of input
+    SimpleJsonValue::Type PeekType();
+
+    bool ReadNull();
+    bool ReadBool(bool& bOutValue);
+    bool ReadNumber(double& OutValue);
+    // converts like SimpleJsonValue::AsInt, but plain integer literals never go through double
+    bool ReadInt(int& OutValue);
+    bool ReadString(std::string& OutValue);
+    // reads and discards one value of any type
+    bool SkipValue();
+
+    bool BeginArray();
+    // true when another element follows; false at ']' or on error
+    bool NextElement();
+    bool BeginObject();
+    // true with the key of the next member, positioned at its value; false at '}' or on error
+    bool NextMember(std::string& OutKey);
+
+    // fails unless only whitespace remains
+    bool Finish();
+
+    bool HasError() const { return !ErrorMessage.empty(); }
+    const std::string& GetError() const { return ErrorMessage; }
+
+private:
+    bool IsAtEnd() const { return Index >= Text.size(); }
+    char Peek() const { return IsAtEnd() ? '\0' : Text[Index]; }
+    void SkipWhitespace();
+    bool Match(char Expected);
+    bool Fail(const char* Message);
+    bool ExpectValue();
+    bool ScanNumber(size_t& OutStart);
+    bool ParseEscape(std::string& OutValue);
+    bool ParseUnicodeEscape(std::string& OutValue);
+    bool NextInContainer(char Close, const char* SeparatorError);
+
+    const std::string& Text;
+    size_t Index = 0;
+    std::string ErrorMessage;
+    // one entry per open array or object: true until its first element has been read
+    std::vector<bool> bFirstInContainer;
+};
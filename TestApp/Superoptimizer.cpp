@@ -0,0 +1,527 @@
+#include "Superoptimizer.h"
+#include "TestRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "../src/Conchpiler/thread.h"
+
+namespace
+{
+
+// a rejected move may still be taken with probability exp(-CostIncrease / Temperature)
+constexpr double Temperature = 2.0;
+// a walk that has not found anything cheaper for this long starts again from the shared best
+constexpr uint64_t RestartInterval = 2000;
+constexpr int MutationAttempts = 16;
+
+struct ProgramLine
+{
+    int Indent = 0;
+    std::vector<std::string> Tokens;
+};
+
+using Program = std::vector<ProgramLine>;
+
+struct CandidateScore
+{
+    bool bParsed = false;
+    // false while only the static estimate is known, or when the program cannot be run safely
+    bool bRan = false;
+    bool bRunnable = true;
+    int StaticCycles = 0;
+    int DynamicCycles = 0;
+    int FailedTests = 0;
+
+    bool Passed() const { return bParsed && bRan && FailedTests == 0; }
+    int Cost(int Penalty) const { return StaticCycles + Penalty * FailedTests; }
+};
+
+// ============================================================
+// Program text
+// ============================================================
+
+Program SplitProgram(const std::vector<std::string>& Code)
+{
+    Program Lines;
+    Lines.reserve(Code.size());
+    for (const std::string& Text : Code)
+    {
+        ProgramLine Line;
+        size_t Pos = 0;
+        while (Pos < Text.size() && (Text[Pos] == ' ' || Text[Pos] == '\t'))
+            Line.Indent += Text[Pos++] == '\t' ? 4 : 1;
+        std::istringstream Words(Text.substr(Pos));
+        std::string Word;
+        while (Words >> Word) Line.Tokens.push_back(Word);
+        if (Line.Tokens.empty()) Line.Indent = 0;
+        Lines.push_back(std::move(Line));
+    }
+    // trailing blank lines never change a program
+    while (!Lines.empty() && Lines.back().Tokens.empty()) Lines.pop_back();
+    return Lines;
+}
+
+std::vector<std::string> RenderProgram(const Program& Lines)
+{
+    std::vector<std::string> Code;
+    Code.reserve(Lines.size());
+    for (const ProgramLine& Line : Lines)
+    {
+        std::string Text(static_cast<size_t>(Line.Indent), ' ');
+        for (size_t i = 0; i < Line.Tokens.size(); ++i)
+        {
+            if (i) Text += ' ';
+            Text += Line.Tokens[i];
+        }
+        Code.push_back(std::move(Text));
+    }
+    return Code;
+}
+
+std::string JoinLines(const std::vector<std::string>& Code)
+{
+    std::string Joined;
+    for (const std::string& Line : Code)
+    {
+        Joined += Line;
+        Joined += '\n';
+    }
+    return Joined;
+}
+
+bool IsRegisterToken(const std::string& Token)
+{
+    return Token == "X" || Token == "Y" || Token == "Z" || Token == "XC" || Token == "YC" || Token == "ZC";
+}
+
+bool IsNumberToken(const std::string& Token)
+{
+    const size_t Start = !Token.empty() && Token[0] == '-' ? 1 : 0;
+    if (Start >= Token.size()) return false;
+    for (size_t i = Start; i < Token.size(); ++i)
+        if (std::isdigit(static_cast<unsigned char>(Token[i])) == 0) return false;
+    return true;
+}
+
+bool IsListToken(const std::string& Token)
+{
+    for (const char* Prefix : {"DAT", "OUT", "LIST"})
+    {
+        const std::string P = Prefix;
+        if (Token.size() > P.size() && Token.compare(0, P.size(), P) == 0 &&
+            std::isdigit(static_cast<unsigned char>(Token[P.size()])) != 0)
+            return true;
+    }
+    return false;
+}
+
+bool IsLabelToken(const std::string& Token)
+{
+    return !Token.empty() && Token.back() == ':';
+}
+
+// operators that take the same operands, so swapping one for another keeps the line well formed
+const std::vector<std::vector<std::string>>& OperatorFamilies()
+{
+    static const std::vector<std::vector<std::string>> Families = {
+        {"ADD", "SUB", "MUL", "DIV", "AND", "OR", "XOR"},
+        {"INCR", "DECR"},
+        {"GTR", "LSR", "EQL"},
+        {"IF", "IFN"}};
+    return Families;
+}
+
+const std::vector<std::string>* FindFamily(const std::string& Token)
+{
+    for (const std::vector<std::string>& Family : OperatorFamilies())
+        if (std::find(Family.begin(), Family.end(), Token) != Family.end())
+            return &Family;
+    return nullptr;
+}
+
+// ============================================================
+// Mutation
+// ============================================================
+
+// tokens a mutation may substitute, gathered from the starting program
+struct TokenPools
+{
+    std::vector<std::string> Registers = {"X", "Y", "Z", "XC", "YC", "ZC"};
+    std::vector<std::string> Lists;
+    std::vector<int> Literals;
+    int IndentUnit = 2;
+};
+
+TokenPools CollectPools(const Program& Start)
+{
+    TokenPools Pools;
+    Pools.Literals = {0, 1, 2};
+    int SmallestIndent = 0;
+    for (const ProgramLine& Line : Start)
+    {
+        if (Line.Indent > 0 && (SmallestIndent == 0 || Line.Indent < SmallestIndent))
+            SmallestIndent = Line.Indent;
+        for (const std::string& Token : Line.Tokens)
+        {
+            if (IsListToken(Token) && std::find(Pools.Lists.begin(), Pools.Lists.end(), Token) == Pools.Lists.end())
+                Pools.Lists.push_back(Token);
+            else if (IsNumberToken(Token) && Token.size() < 10)
+            {
+                const int Value = std::stoi(Token);
+                if (std::find(Pools.Literals.begin(), Pools.Literals.end(), Value) == Pools.Literals.end())
+                    Pools.Literals.push_back(Value);
+            }
+        }
+    }
+    if (SmallestIndent > 0) Pools.IndentUnit = SmallestIndent;
+    return Pools;
+}
+
+template <typename T>
+const T& PickFrom(const std::vector<T>& Values, std::mt19937_64& Rng)
+{
+    return Values[std::uniform_int_distribution<size_t>(0, Values.size() - 1)(Rng)];
+}
+
+size_t PickIndex(size_t Count, std::mt19937_64& Rng)
+{
+    return std::uniform_int_distribution<size_t>(0, Count - 1)(Rng);
+}
+
+// replaces one operand or operator with another of its kind; false if the token has no kind
+bool ReplaceToken(std::string& Token, const TokenPools& Pools, std::mt19937_64& Rng)
+{
+    if (IsRegisterToken(Token))
+    {
+        Token = PickFrom(Pools.Registers, Rng);
+        return true;
+    }
+    if (IsListToken(Token))
+    {
+        if (Pools.Lists.size() < 2) return false;
+        Token = PickFrom(Pools.Lists, Rng);
+        return true;
+    }
+    if (IsNumberToken(Token))
+    {
+        if (Token.size() < 10 && std::uniform_int_distribution<int>(0, 2)(Rng) == 0)
+            Token = std::to_string(std::stoi(Token) + (std::uniform_int_distribution<int>(0, 1)(Rng) ? 1 : -1));
+        else
+            Token = std::to_string(PickFrom(Pools.Literals, Rng));
+        return true;
+    }
+    if (const std::vector<std::string>* Family = FindFamily(Token))
+    {
+        Token = PickFrom(*Family, Rng);
+        return true;
+    }
+    return false;
+}
+
+// index of the first token after a leading label
+size_t FirstEditableToken(const ProgramLine& Line)
+{
+    return !Line.Tokens.empty() && IsLabelToken(Line.Tokens[0]) ? 1 : 0;
+}
+
+// applies one random edit; false if the edit picked does not apply to this program
+bool MutateOnce(Program& Lines, const TokenPools& Pools, std::mt19937_64& Rng)
+{
+    if (Lines.empty()) return false;
+    const size_t LineIndex = PickIndex(Lines.size(), Rng);
+    ProgramLine& Line = Lines[LineIndex];
+    switch (std::uniform_int_distribution<int>(0, 7)(Rng))
+    {
+    case 0: // delete a line
+        if (Lines.size() < 2) return false;
+        Lines.erase(Lines.begin() + static_cast<std::ptrdiff_t>(LineIndex));
+        return true;
+    case 1: // move a line
+    {
+        const size_t Target = PickIndex(Lines.size(), Rng);
+        if (Target == LineIndex) return false;
+        ProgramLine Moved = std::move(Line);
+        Lines.erase(Lines.begin() + static_cast<std::ptrdiff_t>(LineIndex));
+        Lines.insert(Lines.begin() + static_cast<std::ptrdiff_t>(Target), std::move(Moved));
+        return true;
+    }
+    case 2: // copy a line somewhere else
+    {
+        ProgramLine Copy = Line;
+        Lines.insert(Lines.begin() + static_cast<std::ptrdiff_t>(PickIndex(Lines.size() + 1, Rng)), std::move(Copy));
+        return true;
+    }
+    case 3: // re-indent a line by one level
+    {
+        if (Line.Tokens.empty()) return false;
+        const int Delta = std::uniform_int_distribution<int>(0, 1)(Rng) ? Pools.IndentUnit : -Pools.IndentUnit;
+        if (Line.Indent + Delta < 0) return false;
+        Line.Indent += Delta;
+        return true;
+    }
+    case 4: // substitute an operand or operator
+    case 5:
+    {
+        const size_t First = FirstEditableToken(Line);
+        if (Line.Tokens.size() <= First) return false;
+        return ReplaceToken(Line.Tokens[First + PickIndex(Line.Tokens.size() - First, Rng)], Pools, Rng);
+    }
+    case 6: // drop an argument
+    {
+        const size_t First = FirstEditableToken(Line) + 1;
+        if (Line.Tokens.size() <= First) return false;
+        Line.Tokens.erase(Line.Tokens.begin() + static_cast<std::ptrdiff_t>(First + PickIndex(Line.Tokens.size() - First, Rng)));
+        return true;
+    }
+    default: // exchange two arguments
+    {
+        const size_t First = FirstEditableToken(Line) + 1;
+        if (Line.Tokens.size() < First + 2) return false;
+        const size_t A = First + PickIndex(Line.Tokens.size() - First, Rng);
+        const size_t B = First + PickIndex(Line.Tokens.size() - First, Rng);
+        if (A == B || Line.Tokens[A] == Line.Tokens[B]) return false;
+        std::swap(Line.Tokens[A], Line.Tokens[B]);
+        return true;
+    }
+    }
+}
+
+bool Mutate(Program& Lines, const TokenPools& Pools, std::mt19937_64& Rng)
+{
+    for (int Attempt = 0; Attempt < MutationAttempts; ++Attempt)
+        if (MutateOnce(Lines, Pools, Rng)) return true;
+    return false;
+}
+
+// ============================================================
+// Scoring
+// ============================================================
+
+// JUMP is the only backward branch without an iteration limit; a mutated loop exit could
+// spin forever, so such candidates are scored statically but never run
+bool HasBackwardJump(const ConThread& Thread)
+{
+    const std::vector<ConInstruction>& Instructions = Thread.GetBytecode().Instructions;
+    for (size_t i = 0; i < Instructions.size(); ++i)
+    {
+        const ConInstruction& Inst = Instructions[i];
+        if (Inst.Opcode == ConOpcode::Jump && Inst.Target >= 0 && static_cast<size_t>(Inst.Target) <= i)
+            return true;
+    }
+    return false;
+}
+
+// parses Code and, unless its static estimate alone exceeds CostBound, runs it on every test
+CandidateScore ScoreCandidate(const PuzzleData& Puzzle, const std::vector<std::string>& Code,
+                              double CostBound, bool bAllowBackwardJumps)
+{
+    CandidateScore Score;
+    ConThread Thread;
+    std::vector<std::string> Errors;
+    Score.bParsed = ComputeStaticCycleCount(Code, Thread, Score.StaticCycles, Errors);
+    if (!Score.bParsed || Score.StaticCycles > CostBound)
+        return Score;
+    // the check runs on the optimized form the tests will execute
+    Thread.SetBytecodeOptimization(true);
+    Thread.CompileBytecode();
+    if (!bAllowBackwardJumps && HasBackwardJump(Thread))
+    {
+        Score.bRunnable = false;
+        return Score;
+    }
+    Thread.SetRuntimeErrorEcho(false);
+    for (const TestCaseResult& Result : RunTestCaseBatch(Puzzle.Tests, Thread))
+    {
+        Score.DynamicCycles += Result.ExecutedCycles;
+        if (!Result.Passed()) ++Score.FailedTests;
+    }
+    Score.bRan = true;
+    return Score;
+}
+
+// state every worker reads and updates
+struct SearchState
+{
+    const PuzzleData* Puzzle = nullptr;
+    const SuperoptimizerOptions* Options = nullptr;
+    TokenPools Pools;
+    std::chrono::steady_clock::time_point Deadline;
+
+    std::mutex Mutex;
+    std::unordered_map<std::string, CandidateScore> Scores;
+    Program Best;
+    int BestStaticCycles = 0;
+    int BestDynamicCycles = 0;
+
+    std::atomic<uint64_t> Tried{0};
+    std::atomic<uint64_t> Unique{0};
+    std::atomic<uint64_t> Verified{0};
+};
+
+// the cached score for Code when it is good enough, otherwise a fresh one
+CandidateScore LookupOrScore(SearchState& State, const std::string& Key,
+                             const std::vector<std::string>& Code, double CostBound)
+{
+    {
+        std::lock_guard<std::mutex> Lock(State.Mutex);
+        const auto It = State.Scores.find(Key);
+        if (It != State.Scores.end())
+        {
+            const CandidateScore& Known = It->second;
+            if (Known.bRan || !Known.bParsed || !Known.bRunnable || Known.StaticCycles > CostBound)
+                return Known;
+        }
+    }
+    const CandidateScore Score = ScoreCandidate(*State.Puzzle, Code, CostBound, false);
+    if (Score.bRan) ++State.Verified;
+    std::lock_guard<std::mutex> Lock(State.Mutex);
+    const auto Inserted = State.Scores.emplace(Key, Score);
+    if (Inserted.second) ++State.Unique;
+    else if (Score.bRan) Inserted.first->second = Score;
+    return Score;
+}
+
+void OfferBest(SearchState& State, const Program& Candidate, const CandidateScore& Score)
+{
+    std::lock_guard<std::mutex> Lock(State.Mutex);
+    if (Score.StaticCycles < State.BestStaticCycles ||
+        (Score.StaticCycles == State.BestStaticCycles && Score.DynamicCycles < State.BestDynamicCycles))
+    {
+        State.Best = Candidate;
+        State.BestStaticCycles = Score.StaticCycles;
+        State.BestDynamicCycles = Score.DynamicCycles;
+    }
+}
+
+bool ClaimCandidate(SearchState& State)
+{
+    if (std::chrono::steady_clock::now() >= State.Deadline) return false;
+    const uint64_t Limit = State.Options->MaxCandidates;
+    return State.Tried++ < Limit || Limit == 0;
+}
+
+// one annealing walk; it keeps going until the candidate or time budget is spent
+void RunWalk(SearchState& State, const Program& Start, const CandidateScore& StartScore, uint64_t Seed)
+{
+    const int Penalty = State.Options->FailingTestPenalty;
+    std::mt19937_64 Rng(Seed);
+    std::uniform_real_distribution<double> Unit(0.0, 1.0);
+    Program Current = Start;
+    int CurrentCost = StartScore.Cost(Penalty);
+    int LowestCost = CurrentCost;
+    uint64_t SinceImprovement = 0;
+
+    while (ClaimCandidate(State))
+    {
+        if (++SinceImprovement > RestartInterval)
+        {
+            std::lock_guard<std::mutex> Lock(State.Mutex);
+            Current = State.Best;
+            CurrentCost = State.BestStaticCycles;
+            LowestCost = CurrentCost;
+            SinceImprovement = 0;
+        }
+
+        Program Candidate = Current;
+        if (!Mutate(Candidate, State.Pools, Rng)) continue;
+        const std::vector<std::string> Code = RenderProgram(Candidate);
+        // drawing the acceptance threshold first lets hopeless candidates skip the test run
+        const double CostBound = CurrentCost - Temperature * std::log(std::max(Unit(Rng), 1e-12));
+        const CandidateScore Score = LookupOrScore(State, JoinLines(Code), Code, CostBound);
+        if (!Score.bRan) continue;
+
+        if (Score.Passed()) OfferBest(State, Candidate, Score);
+        const int Cost = Score.Cost(Penalty);
+        if (Cost <= CostBound)
+        {
+            Current = std::move(Candidate);
+            CurrentCost = Cost;
+            if (Cost < LowestCost)
+            {
+                LowestCost = Cost;
+                SinceImprovement = 0;
+            }
+        }
+    }
+}
+
+} // namespace
+
+// ============================================================
+// Superoptimizer
+// ============================================================
+
+std::string CanonicalizeProgram(const std::vector<std::string>& Code)
+{
+    return JoinLines(RenderProgram(SplitProgram(Code)));
+}
+
+SuperoptimizerResult Superoptimize(const PuzzleData& Puzzle,
+                                   const std::vector<std::string>& Start,
+                                   const SuperoptimizerOptions& Options)
+{
+    SuperoptimizerResult Result;
+    Result.BestCode = Start;
+
+    // the starting program is trusted to terminate, backward JUMPs included
+    const CandidateScore StartScore = ScoreCandidate(Puzzle, Start, std::numeric_limits<double>::infinity(), true);
+    Result.StartStaticCycles = Result.BestStaticCycles = StartScore.StaticCycles;
+    Result.StartDynamicCycles = Result.BestDynamicCycles = StartScore.DynamicCycles;
+    if (!StartScore.bParsed)
+    {
+        Result.Error = "Starting program does not parse";
+        return Result;
+    }
+    if (!StartScore.Passed())
+    {
+        Result.Error = "Starting program fails " + std::to_string(StartScore.FailedTests) + " of " +
+                       std::to_string(Puzzle.Tests.size()) + " tests";
+        return Result;
+    }
+    Result.bStartValid = true;
+
+    const Program StartProgram = SplitProgram(Start);
+    SearchState State;
+    State.Puzzle = &Puzzle;
+    State.Options = &Options;
+    State.Pools = CollectPools(StartProgram);
+    State.Deadline = std::chrono::steady_clock::now() +
+                     std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                         std::chrono::duration<double>(Options.TimeBudgetSeconds));
+    State.Best = StartProgram;
+    State.BestStaticCycles = StartScore.StaticCycles;
+    State.BestDynamicCycles = StartScore.DynamicCycles;
+    State.Scores.emplace(JoinLines(RenderProgram(StartProgram)), StartScore);
+    State.Unique = 1;
+    State.Verified = 1;
+
+    const unsigned WorkerCount = Options.WorkerCount > 0 ? Options.WorkerCount : DefaultWorkerCount();
+    std::vector<std::thread> Workers;
+    for (unsigned i = 1; i < WorkerCount; ++i)
+        Workers.emplace_back(RunWalk, std::ref(State), std::cref(StartProgram), std::cref(StartScore), Options.Seed + i);
+    RunWalk(State, StartProgram, StartScore, Options.Seed);
+    for (std::thread& Worker : Workers)
+        Worker.join();
+
+    Result.CandidatesTried = Options.MaxCandidates > 0 ? std::min(State.Tried.load(), Options.MaxCandidates) : State.Tried.load();
+    Result.CandidatesUnique = State.Unique;
+    Result.CandidatesVerified = State.Verified;
+    if (State.BestStaticCycles < Result.StartStaticCycles ||
+        (State.BestStaticCycles == Result.StartStaticCycles && State.BestDynamicCycles < Result.StartDynamicCycles))
+    {
+        Result.BestCode = RenderProgram(State.Best);
+        Result.BestStaticCycles = State.BestStaticCycles;
+        Result.BestDynamicCycles = State.BestDynamicCycles;
+    }
+    return Result;
+}
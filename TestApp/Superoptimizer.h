@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Puzzle.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================
+// Superoptimizer: stochastic search for cheaper equivalent programs
+// ============================================================
+
+struct SuperoptimizerOptions
+{
+    // wall-clock budget for the whole search
+    double TimeBudgetSeconds = 10.0;
+    // 0 picks DefaultWorkerCount
+    unsigned WorkerCount = 0;
+    // worker i seeds its generator with Seed + i, so one worker with MaxCandidates set is reproducible
+    uint64_t Seed = 1;
+    // stop after this many candidates across all workers; 0 runs until the time budget is spent
+    uint64_t MaxCandidates = 0;
+    // cost added per failing test, so the search can walk through broken programs on its way
+    // to a cheaper correct one
+    int FailingTestPenalty = 8;
+};
+
+struct SuperoptimizerResult
+{
+    // false when the starting program does not parse or does not pass every test
+    bool bStartValid = false;
+    std::string Error;
+    int StartStaticCycles = 0;
+    int StartDynamicCycles = 0;
+    // the cheapest program that passes every test; the start program if nothing beat it
+    std::vector<std::string> BestCode;
+    int BestStaticCycles = 0;
+    // summed over the tests; breaks ties between programs with the same static estimate
+    int BestDynamicCycles = 0;
+    // mutations generated, distinct canonical programs among them, and programs run on the tests
+    uint64_t CandidatesTried = 0;
+    uint64_t CandidatesUnique = 0;
+    uint64_t CandidatesVerified = 0;
+
+    bool Improved() const
+    {
+        return BestStaticCycles < StartStaticCycles ||
+               (BestStaticCycles == StartStaticCycles && BestDynamicCycles < StartDynamicCycles);
+    }
+};
+
+// Whitespace-normalised source used to recognise candidates that were already scored: one
+// line per source line, indentation expanded to spaces and tokens separated by single spaces.
+std::string CanonicalizeProgram(const std::vector<std::string>& Code);
+
+// Mutates Start line by line and token by token (delete, move, copy and re-indent lines; swap
+// registers, literals, lists and operators of the same arity) and keeps the cheapest variant
+// that passes every test in Puzzle. Cost is the static cycle estimate, then dynamic cycles.
+// Each worker runs its own annealing walk; scores are shared through a table keyed by
+// canonical form so no program is verified twice.
+SuperoptimizerResult Superoptimize(const PuzzleData& Puzzle,
+                                   const std::vector<std::string>& Start,
+                                   const SuperoptimizerOptions& Options = SuperoptimizerOptions());
@@ -1,4 +1,5 @@
 #include "Puzzle.h"
+#include "TestRunner.h"
 
 #include <algorithm>
 #include <cctype>
@@ -76,19 +77,6 @@ std::string RegisterName(size_t Index)
     return "R" + std::to_string(Index);
 }
 
-std::string FormatListValues(const std::vector<int>& Values)
-{
-    std::ostringstream Oss;
-    Oss << "[";
-    for (size_t i = 0; i < Values.size(); ++i)
-    {
-        if (i) Oss << ", ";
-        Oss << Values[i];
-    }
-    Oss << "]";
-    return Oss.str();
-}
-
 std::vector<std::pair<std::string,int>>
 SortRegisterMap(const std::unordered_map<std::string,int>& Registers)
 {
@@ -102,21 +90,6 @@ SortRegisterMap(const std::unordered_map<std::string,int>& Registers)
 // Puzzle file helpers
 // ============================================================
 
-std::vector<std::filesystem::path> FindPuzzleFiles(const std::filesystem::path& Dir)
-{
-    std::vector<std::filesystem::path> Files;
-    std::error_code EC;
-    for (const auto& Entry : std::filesystem::directory_iterator(Dir, EC))
-    {
-        std::error_code EntryEC;
-        if (Entry.is_regular_file(EntryEC) && !EntryEC &&
-            Entry.path().extension() == ".json")
-            Files.push_back(Entry.path());
-    }
-    std::sort(Files.begin(), Files.end());
-    return Files;
-}
-
 std::filesystem::path FindPuzzlesDirectory(const std::filesystem::path& ExecutablePath)
 {
     std::vector<std::filesystem::path> Candidates;
@@ -209,19 +182,6 @@ std::filesystem::path SelectPuzzleInteractively(const std::filesystem::path& Puz
     }
 }
 
-bool LoadCodeFromFile(const std::string& Path,
-                      std::vector<std::string>& OutCode,
-                      std::string& OutError)
-{
-    std::ifstream Input(Path);
-    if (!Input) { OutError = "Unable to open file: " + Path; return false; }
-    std::vector<std::string> Lines;
-    std::string Line;
-    while (std::getline(Input, Line)) Lines.push_back(Line);
-    OutCode = std::move(Lines);
-    return true;
-}
-
 bool SaveCodeToFile(const std::string& Path,
                     const std::vector<std::string>& Code,
                     std::string& OutError)
@@ -236,121 +196,6 @@ bool SaveCodeToFile(const std::string& Path,
     return true;
 }
 
-// ============================================================
-// Test-runner helpers
-// ============================================================
-
-bool ApplyTestSetup(const PuzzleTestCase& Test,
-                    ConThread& Thread,
-                    std::vector<std::string>& Messages)
-{
-    bool bSuccess = true;
-    for (const auto& Pair : Test.InitialRegisters)
-    {
-        int Idx = 0;
-        if (!ParseRegisterName(Pair.first, Idx))
-        {
-            Messages.push_back("Unknown register '" + Pair.first + "'");
-            bSuccess = false;
-            continue;
-        }
-        Thread.SetThreadValue(static_cast<size_t>(Idx), Pair.second);
-    }
-    for (const PuzzleListSpec& Spec : Test.DatInputs)
-    {
-        ConVariableList* List = Thread.FindListVar(Spec.Name);
-        if (!List)
-        {
-            Messages.push_back(Spec.Name + " is not defined in this program");
-            bSuccess = false;
-            continue;
-        }
-        std::vector<int32> Values;
-        Values.reserve(Spec.Values.size());
-        for (int V : Spec.Values) Values.push_back(static_cast<int32>(V));
-        List->SetRole(ConListRole::Input);
-        List->SetExpectedSize(std::numeric_limits<size_t>::max());
-        List->SetValues(Values);
-        List->Reset();
-    }
-    for (const PuzzleOutSpec& Spec : Test.OutSpecs)
-    {
-        ConVariableList* List = Thread.FindListVar(Spec.Name);
-        if (!List)
-        {
-            Messages.push_back(Spec.Name + " is not defined in this program");
-            bSuccess = false;
-            continue;
-        }
-        List->SetRole(ConListRole::Output);
-        List->SetValues({});
-        List->SetExpectedSize(static_cast<size_t>(Spec.ExpectedSize));
-        List->Reset();
-    }
-    return bSuccess;
-}
-
-std::vector<std::string> ValidateExpectations(const PuzzleTestCase& Test,
-                                              const ConThread& Thread)
-{
-    std::vector<std::string> Issues;
-    for (const auto& Pair : Test.Expectation.Registers)
-    {
-        int Idx = 0;
-        if (!ParseRegisterName(Pair.first, Idx))
-        {
-            Issues.push_back("Unknown register '" + Pair.first + "'");
-            continue;
-        }
-        const int Actual = Thread.GetThreadValue(static_cast<size_t>(Idx));
-        if (Actual != Pair.second)
-            Issues.push_back("Expected " + Pair.first + "=" +
-                             std::to_string(Pair.second) + ", got " +
-                             std::to_string(Actual));
-    }
-    for (const PuzzleOutSpec& Spec : Test.OutSpecs)
-    {
-        const ConVariableList* List = Thread.FindListVar(Spec.Name);
-        if (!List) { Issues.push_back("Undefined " + Spec.Name); continue; }
-        const size_t ActualSize  = List->Size();
-        const size_t ExpectedSize = static_cast<size_t>(Spec.ExpectedSize);
-        if (ActualSize != ExpectedSize)
-            Issues.push_back("Expected " + Spec.Name + " size=" +
-                             std::to_string(ExpectedSize) + ", got " +
-                             std::to_string(ActualSize));
-    }
-    for (const PuzzleListSpec& Spec : Test.Expectation.ExpectedOut)
-    {
-        const ConVariableList* List = Thread.FindListVar(Spec.Name);
-        if (!List) { Issues.push_back("Undefined " + Spec.Name); continue; }
-        const std::vector<int32>& Actual = List->GetValues();
-        const std::vector<int> Copy(Actual.begin(), Actual.end());
-        if (Copy.size() != Spec.Values.size() ||
-            !std::equal(Copy.begin(), Copy.end(), Spec.Values.begin()))
-            Issues.push_back("Expected " + Spec.Name + "=" +
-                             FormatListValues(Spec.Values) + ", got " +
-                             FormatListValues(Copy));
-    }
-    return Issues;
-}
-
-bool ComputeStaticCycleCount(const std::vector<std::string>& Code,
-                             int& OutCycles,
-                             std::vector<std::string>& Errors)
-{
-    ConParser Parser;
-    ConThread Thread;
-    if (!Parser.Parse(Code, Thread))
-    {
-        Errors = Parser.GetErrors();
-        return false;
-    }
-    Thread.SetTraceEnabled(false);
-    Thread.UpdateCycleCount();
-    OutCycles = Thread.GetCycleCount();
-    return true;
-}
-
 // Runs all tests and returns a vector of output lines (no ANSI codes).
 // Each entry is one display line.
 std::vector<std::string> CollectTestOutput(const PuzzleData& Puzzle,
@@ -365,15 +210,32 @@ std::vector<std::string> CollectTestOutput(const PuzzleData& Puzzle,
         return Out;
     }
 
-    std::vector<std::string> ParseErrors;
-    int StaticCycles = 0;
-    if (!ComputeStaticCycleCount(Code, StaticCycles, ParseErrors))
+    // trace lines go straight to stdout, so traced runs stay serial to keep them in test order
+    PuzzleRunResult Run;
+    if (bDebugTrace)
+    {
+        ConThread Thread;
+        Run.bParsed = ComputeStaticCycleCount(Code, Thread, Run.StaticCycles, Run.ParseErrors);
+        if (Run.bParsed)
+        {
+            Thread.SetTraceEnabled(true);
+            for (const PuzzleTestCase& Test : Puzzle.Tests)
+                Run.Tests.push_back(RunTestCase(Test, Thread));
+        }
+    }
+    else
+    {
+        Run = RunPuzzleTests(Puzzle, Code);
+    }
+
+    if (!Run.bParsed)
     {
         Out.push_back("Syntax errors detected:");
-        for (const std::string& E : ParseErrors)
+        for (const std::string& E : Run.ParseErrors)
             Out.push_back("  " + E);
         return Out;
     }
+    const int StaticCycles = Run.StaticCycles;
     Out.push_back("Static cycle estimate: " + std::to_string(StaticCycles));
 
     if (!Puzzle.History.empty())
@@ -402,74 +264,56 @@ std::vector<std::string> CollectTestOutput(const PuzzleData& Puzzle,
     for (size_t TestIndex = 0; TestIndex < Puzzle.Tests.size(); ++TestIndex)
     {
         const PuzzleTestCase& Test = Puzzle.Tests[TestIndex];
+        const TestCaseResult& Result = Run.Tests[TestIndex];
         Out.push_back("Test " + std::to_string(TestIndex + 1) + "/" +
                       std::to_string(Puzzle.Tests.size()) + ": " + Test.Name);
 
-        ConParser Parser;
-        ConThread Thread;
-        if (!Parser.Parse(Code, Thread))
+        if (Result.Status == TestCaseStatus::SetupFailed)
         {
-            Out.push_back("  FAIL: Parse error during execution.");
-            for (const std::string& E : Parser.GetErrors())
-                Out.push_back("    " + E);
+            Out.push_back("  FAIL: Test setup failed:");
+            for (const std::string& M : Result.Messages) Out.push_back("    " + M);
             bAllPassed = false;
             continue;
         }
-        Thread.SetTraceEnabled(bDebugTrace);
-        Thread.UpdateCycleCount();
-
-        std::vector<std::string> SetupMsgs;
-        if (!ApplyTestSetup(Test, Thread, SetupMsgs))
+        if (Result.Status == TestCaseStatus::BudgetExhausted)
         {
-            Out.push_back("  FAIL: Test setup failed:");
-            for (const std::string& M : SetupMsgs) Out.push_back("    " + M);
+            Out.push_back("  FAIL: Stopped:");
+            for (const std::string& M : Result.Messages) Out.push_back("    " + M);
             bAllPassed = false;
             continue;
         }
-
-        Thread.Execute();
-        if (Thread.HadRuntimeError())
+        if (Result.Status == TestCaseStatus::RuntimeError)
         {
             Out.push_back("  FAIL: Runtime error:");
-            for (const std::string& E : Thread.GetRuntimeErrors())
+            for (const std::string& E : Result.Messages)
                 Out.push_back("    " + E);
             bAllPassed = false;
             continue;
         }
 
-        const auto Issues = ValidateExpectations(Test, Thread);
-        if (!Issues.empty())
+        if (Result.Status == TestCaseStatus::ExpectationMismatch)
         {
             Out.push_back("  FAIL: Expectation mismatch:");
-            for (const std::string& I : Issues) Out.push_back("    " + I);
+            for (const std::string& I : Result.Messages) Out.push_back("    " + I);
             bAllPassed = false;
         }
         else
         {
-            Out.push_back("  PASS");
+            Out.push_back("  PASS (" + std::to_string(Result.ExecutedCycles) + " cycles executed)");
         }
 
         // Register states
         std::string RegLine = "  Regs:";
-        for (size_t i = 0; i < Thread.GetThreadVarCount(); ++i)
+        for (size_t i = 0; i < Result.Registers.size(); ++i)
             RegLine += " " + RegisterName(i) + "=" +
-                       std::to_string(Thread.GetThreadValue(i));
+                       std::to_string(Result.Registers[i]);
         Out.push_back(RegLine);
 
-        const std::vector<std::string> ListNames = Thread.GetListNames();
-        if (!ListNames.empty())
+        if (!Result.Lists.empty())
         {
             std::string ListLine = "  Lists:";
-            for (const std::string& N : ListNames)
-            {
-                const ConVariableList* L = Thread.FindListVar(N);
-                if (L)
-                {
-                    const std::vector<int32>& V = L->GetValues();
-                    std::vector<int> C(V.begin(), V.end());
-                    ListLine += " " + N + "=" + FormatListValues(C);
-                }
-            }
+            for (const auto& List : Result.Lists)
+                ListLine += " " + List.first + "=" + FormatListValues(List.second);
             Out.push_back(ListLine);
         }
         Out.push_back("");
@@ -481,6 +325,76 @@ std::vector<std::string> CollectTestOutput(const PuzzleData& Puzzle,
     return Out;
 }
 
+// Runs all tests with line profiling and returns the code annotated with what each line cost
+// over the whole suite (no ANSI). The bar is the line's share of the executed cycles.
+std::vector<std::string> CollectLineProfile(const PuzzleData& Puzzle,
+                                            const std::vector<std::string>& Code)
+{
+    std::vector<std::string> Out;
+    if (Code.empty())
+    {
+        Out.push_back("ERROR: No code to run. Write some code first.");
+        return Out;
+    }
+
+    const PuzzleRunResult Run = RunPuzzleTests(Puzzle, Code, 0, true);
+    if (!Run.bParsed)
+    {
+        Out.push_back("Syntax errors detected:");
+        for (const std::string& E : Run.ParseErrors)
+            Out.push_back("  " + E);
+        return Out;
+    }
+
+    uint64_t TotalCycles = 0;
+    std::unordered_map<int, const ConLineProfile*> ByLine;
+    for (const SourceLineProfile& Entry : Run.LineProfile)
+    {
+        TotalCycles += Entry.Counters.Cycles;
+        ByLine[Entry.Line] = &Entry.Counters;
+    }
+    size_t Failed = 0;
+    for (const TestCaseResult& Test : Run.Tests)
+        if (!Test.Passed()) ++Failed;
+
+    Out.push_back("Profiled " + std::to_string(Run.Tests.size()) + " test(s): " +
+                  std::to_string(TotalCycles) + " cycles executed" +
+                  (Failed ? ", " + std::to_string(Failed) + " failed" : std::string()) + ".");
+    Out.push_back("Branches: IF taken/not taken, REDO looped/exited.");
+    Out.push_back("");
+    Out.push_back("Line    Runs  Cycles  Share  Heat        Branches      Source");
+
+    const int HeatWidth = 10;
+    for (size_t i = 0; i < Code.size(); ++i)
+    {
+        const auto Found = ByLine.find(static_cast<int>(i + 1));
+        char Buf[96];
+        if (Found == ByLine.end())
+        {
+            std::snprintf(Buf, sizeof(Buf), "%4d  %49s", static_cast<int>(i + 1), "");
+            Out.push_back(Buf + Code[i]);
+            continue;
+        }
+        const ConLineProfile& P = *Found->second;
+        const double Share = TotalCycles ? static_cast<double>(P.Cycles) / static_cast<double>(TotalCycles) : 0.0;
+        const int HeatCells = P.Cycles ? std::max(1, static_cast<int>(Share * HeatWidth + 0.5)) : 0;
+        std::string Branches;
+        if (P.IfTaken + P.IfNotTaken > 0)
+            Branches = "if " + std::to_string(P.IfTaken) + "/" + std::to_string(P.IfNotTaken);
+        else if (P.RedoIterations + P.RedoExits > 0)
+            Branches = "redo " + std::to_string(P.RedoIterations) + "/" + std::to_string(P.RedoExits);
+        std::snprintf(Buf, sizeof(Buf), "%4d  %6llu  %6llu  %4.1f%%  %-10s  %-12s  ",
+                      static_cast<int>(i + 1),
+                      static_cast<unsigned long long>(P.Executions),
+                      static_cast<unsigned long long>(P.Cycles),
+                      Share * 100.0,
+                      std::string(static_cast<size_t>(HeatCells), '#').c_str(),
+                      Branches.c_str());
+        Out.push_back(Buf + Code[i]);
+    }
+    return Out;
+}
+
 // Build a vector of lines describing the puzzle overview (no ANSI).
 std::vector<std::string> CollectPuzzleOverview(const PuzzleData& Puzzle)
 {
@@ -524,7 +438,8 @@ std::vector<std::string> CollectPuzzleOverview(const PuzzleData& Puzzle)
         {
             std::string Line = "     DAT:";
             for (const PuzzleListSpec& S : T.DatInputs)
-                Line += " " + S.Name + "=" + FormatListValues(S.Values);
+                Line += " " + S.Name + "=" + (S.File.empty() ? FormatListValues(S.Values)
+                                                             : S.File + " (" + std::to_string(S.GetValueView().size()) + " values)");
             Out.push_back(Line);
         }
         if (!T.OutSpecs.empty())
@@ -580,6 +495,7 @@ std::vector<std::string> BuildHelpLines()
         "Actions:",
         "  Ctrl+R or F5      Run tests",
         "  Ctrl+P            Show puzzle overview",
+        "  Ctrl+L            Show per-line profile of the tests",
         "  F1                Show this help",
         "  Ctrl+D            Toggle debug trace",
         "",
@@ -701,7 +617,7 @@ enum class EditorKey
     Enter,
     Tab,
     Escape,
-    CtrlS, CtrlO, CtrlR, CtrlQ, CtrlK, CtrlU, CtrlP, CtrlD,
+    CtrlS, CtrlO, CtrlR, CtrlQ, CtrlK, CtrlU, CtrlP, CtrlD, CtrlL,
     F1, F5,
     Unknown,
 };
@@ -844,6 +760,7 @@ KeyInput ReadKey()
     case 0x15:  Result.Key = EditorKey::CtrlU;     return Result; // ^U
     case 0x10:  Result.Key = EditorKey::CtrlP;     return Result; // ^P
     case 0x04:  Result.Key = EditorKey::CtrlD;     return Result; // ^D
+    case 0x0C:  Result.Key = EditorKey::CtrlL;     return Result; // ^L
     }
 
     // Printable ASCII
@@ -862,7 +779,7 @@ KeyInput ReadKey()
 // Editor state
 // ============================================================
 
-enum class OverlayKind { None, TestOutput, PuzzleInfo, Help };
+enum class OverlayKind { None, TestOutput, PuzzleInfo, LineProfile, Help };
 
 struct EditorState
 {
@@ -899,6 +816,9 @@ struct EditorState
     // Set to true to exit the editor loop
     bool bQuitRequested = false;
 
+    // Live diagnostics; re-parses only the lines edited since the last redraw
+    ConIncrementalParser Live;
+
     void SetStatus(const std::string& Msg)
     {
         StatusMsg = Msg;
@@ -987,6 +907,7 @@ void DrawEditorScreen(EditorState& E)
         const char* OverlayTitle =
             E.OverlayType == OverlayKind::TestOutput  ? " Test Results " :
             E.OverlayType == OverlayKind::PuzzleInfo  ? " Puzzle Info " :
+            E.OverlayType == OverlayKind::LineProfile ? " Line Profile " :
                                                         " Help ";
 
         // First line: overlay title bar
@@ -1134,7 +1055,11 @@ void DrawEditorScreen(EditorState& E)
                 "  Col " + std::to_string(E.CursorCol + 1);
             const std::string Keys =
                 "  ^S:Save  ^O:Open  ^R:Run  ^P:Puzzle  ^Q:Quit  F1:Help";
-            Buf += TruncateTo(PadRight(Pos + Keys, E.ScreenCols), E.ScreenCols);
+            // a syntax error takes the place of the key hints until it is fixed
+            const std::string Live = E.Live.IsValid()
+                ? "  Cycles " + std::to_string(E.Live.GetCycleCount()) + Keys
+                : "  " + (E.Live.GetErrors().empty() ? std::string("Syntax error") : E.Live.GetErrors().front());
+            Buf += TruncateTo(PadRight(Pos + Live, E.ScreenCols), E.ScreenCols);
         }
     }
     Buf += COLOR_RESET;
@@ -1234,6 +1159,11 @@ bool HandleEditorKey(EditorState& E, const KeyInput& Ki, const PuzzleData& Puzzl
             E.OverlayType   = OverlayKind::TestOutput;
             E.OverlayScroll = 0;
             return true;
+        case EditorKey::CtrlL:
+            E.OverlayLines  = CollectLineProfile(Puzzle, E.Lines);
+            E.OverlayType   = OverlayKind::LineProfile;
+            E.OverlayScroll = 0;
+            return true;
         default:
             // Any other key closes the overlay
             E.OverlayType  = OverlayKind::None;
@@ -1355,6 +1285,13 @@ bool HandleEditorKey(EditorState& E, const KeyInput& Ki, const PuzzleData& Puzzl
         E.OverlayScroll = 0;
         return true;
 
+    // -- Line profile ------------------------------------------
+    case EditorKey::CtrlL:
+        E.OverlayLines  = CollectLineProfile(Puzzle, E.Lines);
+        E.OverlayType   = OverlayKind::LineProfile;
+        E.OverlayScroll = 0;
+        return true;
+
     // -- Puzzle overview ---------------------------------------
     case EditorKey::CtrlP:
         E.OverlayLines  = CollectPuzzleOverview(Puzzle);
@@ -1574,6 +1511,7 @@ void RunEditor(EditorState& E, const PuzzleData& Puzzle)
     {
         E.UpdateSize();
         E.UpdateScroll();
+        E.Live.Update(E.Lines);
         DrawEditorScreen(E);
 
         const KeyInput Ki = ReadKey();
@@ -0,0 +1,437 @@
+#include "TestRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "../src/Conchpiler/parser.h"
+
+namespace
+{
+
+// Runs Body on WorkerCount threads, the calling thread being one of them. Every thread gets
+// its own copy of Body, so state declared inside it is private to that worker.
+template <typename BodyType>
+void RunOnWorkers(unsigned WorkerCount, const BodyType& Body)
+{
+    std::vector<std::thread> Workers;
+    Workers.reserve(WorkerCount > 0 ? WorkerCount - 1 : 0);
+    for (unsigned i = 1; i < WorkerCount; ++i)
+        Workers.emplace_back(Body);
+    Body();
+    for (std::thread& Worker : Workers)
+        Worker.join();
+}
+
+unsigned ClampWorkers(unsigned WorkerCount, size_t TaskCount)
+{
+    if (WorkerCount == 0) WorkerCount = DefaultWorkerCount();
+    if (TaskCount < WorkerCount) WorkerCount = static_cast<unsigned>(std::max<size_t>(TaskCount, 1));
+    return WorkerCount;
+}
+
+void CaptureFinalState(const ConThread& Thread, TestCaseResult& Result)
+{
+    Result.Registers.reserve(Thread.GetThreadVarCount());
+    for (size_t i = 0; i < Thread.GetThreadVarCount(); ++i)
+        Result.Registers.push_back(Thread.GetThreadValue(i));
+    for (const std::string& Name : Thread.GetListNames())
+    {
+        const ConVariableList* List = Thread.FindListVar(Name);
+        if (!List) continue;
+        const ConListView Values = List->GetView();
+        Result.Lists.emplace_back(Name, std::vector<int>(Values.begin(), Values.end()));
+    }
+}
+
+// the settings a suite worker's thread runs with; optimized bytecode only when asked for
+void ConfigureSuiteThread(ConThread& Thread, bool bProfileLines, bool bOptimizeBytecode,
+                          const ConExecutionBudget& Budget)
+{
+    Thread.SetTraceEnabled(false);
+    // errors are reported through each TestCaseResult; echoing them from several workers at once
+    // would interleave them on stderr
+    Thread.SetRuntimeErrorEcho(false);
+    Thread.SetExecutionEngine(ConExecutionEngine::Bytecode);
+    Thread.SetBytecodeOptimization(bOptimizeBytecode);
+    Thread.SetLineProfiling(bProfileLines);
+    Thread.SetExecutionBudget(Budget);
+}
+
+// resets the thread and applies the test's inputs, leaving its engine settings alone; false
+// leaves Result marked SetupFailed
+bool PrepareTestCase(const PuzzleTestCase& Test, ConThread& Thread, TestCaseResult& Result)
+{
+    Thread.ResetState();
+    if (Thread.IsLineProfilingEnabled()) Thread.ResetLineProfile();
+    if (ApplyTestSetup(Test, Thread, Result.Messages))
+        return true;
+    Result.Status = TestCaseStatus::SetupFailed;
+    return false;
+}
+
+// scores a thread that has just run Test
+void FinishTestCase(const PuzzleTestCase& Test, const ConThread& Thread, TestCaseResult& Result)
+{
+    Result.ExecutedCycles = Thread.GetExecutedCycleCount();
+    if (Thread.HadRuntimeError())
+    {
+        Result.Status = TestCaseStatus::RuntimeError;
+        Result.Messages = Thread.GetRuntimeErrors();
+    }
+    else if (Thread.WasBudgetExhausted())
+    {
+        Result.Status = TestCaseStatus::BudgetExhausted;
+        Result.Messages.push_back(std::string("Execution budget exhausted (") +
+                                  GetBudgetLimitName(Thread.GetExhaustedBudgetLimit()) + ") after " +
+                                  std::to_string(Result.ExecutedCycles) + " cycles");
+    }
+    else
+    {
+        Result.Messages = ValidateExpectations(Test, Thread);
+        if (!Result.Messages.empty())
+            Result.Status = TestCaseStatus::ExpectationMismatch;
+    }
+    CaptureFinalState(Thread, Result);
+    if (Thread.IsLineProfilingEnabled()) Result.LineProfile = Thread.GetLineProfile();
+}
+
+// sums each result's per-test profiles by source line; LineNumbers maps a job's parsed lines
+void SummarizeLineProfiles(std::vector<PuzzleRunResult>& Results,
+                           const std::vector<std::vector<int>>& LineNumbers)
+{
+    for (size_t JobIndex = 0; JobIndex < Results.size(); ++JobIndex)
+    {
+        std::map<int, ConLineProfile> BySourceLine;
+        for (const TestCaseResult& Test : Results[JobIndex].Tests)
+            for (size_t i = 0; i < Test.LineProfile.size() && i < LineNumbers[JobIndex].size(); ++i)
+                if (Test.LineProfile[i].Executions > 0)
+                    BySourceLine[LineNumbers[JobIndex][i]].Merge(Test.LineProfile[i]);
+        for (const auto& Entry : BySourceLine)
+            Results[JobIndex].LineProfile.push_back({Entry.first, Entry.second});
+    }
+}
+
+} // namespace
+
+// ============================================================
+// Test-runner helpers
+// ============================================================
+
+std::vector<std::filesystem::path> FindPuzzleFiles(const std::filesystem::path& Dir)
+{
+    std::vector<std::filesystem::path> Files;
+    std::error_code EC;
+    for (const auto& Entry : std::filesystem::directory_iterator(Dir, EC))
+    {
+        std::error_code EntryEC;
+        if (Entry.is_regular_file(EntryEC) && !EntryEC &&
+            Entry.path().extension() == ".json")
+            Files.push_back(Entry.path());
+    }
+    std::sort(Files.begin(), Files.end());
+    return Files;
+}
+
+bool LoadCodeFromFile(const std::string& Path,
+                      std::vector<std::string>& OutCode,
+                      std::string& OutError)
+{
+    std::ifstream Input(Path);
+    if (!Input) { OutError = "Unable to open file: " + Path; return false; }
+    std::vector<std::string> Lines;
+    std::string Line;
+    while (std::getline(Input, Line)) Lines.push_back(Line);
+    OutCode = std::move(Lines);
+    return true;
+}
+
+std::string FormatListValues(const std::vector<int>& Values)
+{
+    std::ostringstream Oss;
+    Oss << "[";
+    for (size_t i = 0; i < Values.size(); ++i)
+    {
+        if (i) Oss << ", ";
+        Oss << Values[i];
+    }
+    Oss << "]";
+    return Oss.str();
+}
+
+bool ApplyTestSetup(const PuzzleTestCase& Test,
+                    ConThread& Thread,
+                    std::vector<std::string>& Messages)
+{
+    bool bSuccess = true;
+    for (const auto& Pair : Test.InitialRegisters)
+    {
+        int Idx = 0;
+        if (!ParseRegisterName(Pair.first, Idx))
+        {
+            Messages.push_back("Unknown register '" + Pair.first + "'");
+            bSuccess = false;
+            continue;
+        }
+        Thread.SetThreadValue(static_cast<size_t>(Idx), Pair.second);
+    }
+    for (const PuzzleListSpec& Spec : Test.DatInputs)
+    {
+        ConVariableList* List = Thread.FindListVar(Spec.Name);
+        if (!List)
+        {
+            Messages.push_back(Spec.Name + " is not defined in this program");
+            bSuccess = false;
+            continue;
+        }
+        // inputs are read in place from the puzzle, which outlives the run
+        const ConListView Values = Spec.GetValueView();
+        List->SetRole(ConListRole::Input);
+        List->SetExpectedSize(std::numeric_limits<size_t>::max());
+        List->BorrowValues(Values.Data, Values.Count);
+    }
+    for (const PuzzleOutSpec& Spec : Test.OutSpecs)
+    {
+        ConVariableList* List = Thread.FindListVar(Spec.Name);
+        if (!List)
+        {
+            Messages.push_back(Spec.Name + " is not defined in this program");
+            bSuccess = false;
+            continue;
+        }
+        List->SetRole(ConListRole::Output);
+        List->Clear();
+        List->SetExpectedSize(static_cast<size_t>(Spec.ExpectedSize));
+        List->Reset();
+    }
+    return bSuccess;
+}
+
+std::vector<std::string> ValidateExpectations(const PuzzleTestCase& Test,
+                                              const ConThread& Thread)
+{
+    std::vector<std::string> Issues;
+    for (const auto& Pair : Test.Expectation.Registers)
+    {
+        int Idx = 0;
+        if (!ParseRegisterName(Pair.first, Idx))
+        {
+            Issues.push_back("Unknown register '" + Pair.first + "'");
+            continue;
+        }
+        const int Actual = Thread.GetThreadValue(static_cast<size_t>(Idx));
+        if (Actual != Pair.second)
+            Issues.push_back("Expected " + Pair.first + "=" +
+                             std::to_string(Pair.second) + ", got " +
+                             std::to_string(Actual));
+    }
+    for (const PuzzleOutSpec& Spec : Test.OutSpecs)
+    {
+        const ConVariableList* List = Thread.FindListVar(Spec.Name);
+        if (!List) { Issues.push_back("Undefined " + Spec.Name); continue; }
+        const size_t ActualSize  = List->Size();
+        const size_t ExpectedSize = static_cast<size_t>(Spec.ExpectedSize);
+        if (ActualSize != ExpectedSize)
+            Issues.push_back("Expected " + Spec.Name + " size=" +
+                             std::to_string(ExpectedSize) + ", got " +
+                             std::to_string(ActualSize));
+    }
+    for (const PuzzleListSpec& Spec : Test.Expectation.ExpectedOut)
+    {
+        const ConVariableList* List = Thread.FindListVar(Spec.Name);
+        if (!List) { Issues.push_back("Undefined " + Spec.Name); continue; }
+        const ConListView Actual = List->GetView();
+        const std::vector<int> Copy(Actual.begin(), Actual.end());
+        if (Copy.size() != Spec.Values.size() ||
+            !std::equal(Copy.begin(), Copy.end(), Spec.Values.begin()))
+            Issues.push_back("Expected " + Spec.Name + "=" +
+                             FormatListValues(Spec.Values) + ", got " +
+                             FormatListValues(Copy));
+    }
+    return Issues;
+}
+
+ConExecutionBudget DefaultTestBudget()
+{
+    ConExecutionBudget Budget;
+    Budget.MaxCycles = 100000000;
+    return Budget;
+}
+
+bool ComputeStaticCycleCount(const std::vector<std::string>& Code,
+                             ConThread& OutThread,
+                             int& OutCycles,
+                             std::vector<std::string>& Errors)
+{
+    ConParser Parser;
+    if (!Parser.Parse(Code, OutThread))
+    {
+        Errors = Parser.GetErrors();
+        return false;
+    }
+    OutThread.SetTraceEnabled(false);
+    OutThread.SetExecutionEngine(ConExecutionEngine::Bytecode);
+    OutThread.SetExecutionBudget(DefaultTestBudget());
+    OutThread.UpdateCycleCount();
+    OutCycles = OutThread.GetCycleCount();
+    return true;
+}
+
+// ============================================================
+// Parallel runner
+// ============================================================
+
+bool PuzzleRunResult::AllPassed() const
+{
+    if (!bParsed) return false;
+    for (const TestCaseResult& Test : Tests)
+        if (!Test.Passed()) return false;
+    return true;
+}
+
+unsigned DefaultWorkerCount()
+{
+    const unsigned Count = std::thread::hardware_concurrency();
+    return Count > 0 ? Count : 1;
+}
+
+TestCaseResult RunTestCase(const PuzzleTestCase& Test, ConThread& Thread)
+{
+    TestCaseResult Result;
+    if (!PrepareTestCase(Test, Thread, Result))
+        return Result;
+    Thread.Execute();
+    FinishTestCase(Test, Thread, Result);
+    return Result;
+}
+
+std::vector<TestCaseResult> RunTestCaseBatch(const std::vector<PuzzleTestCase>& Tests, ConThread& Thread)
+{
+    std::vector<TestCaseResult> Results(Tests.size());
+    if (Thread.IsTraceEnabled() || Thread.GetTraceRecorder() != nullptr || Thread.IsLineProfilingEnabled())
+    {
+        for (size_t i = 0; i < Tests.size(); ++i)
+            Results[i] = RunTestCase(Tests[i], Thread);
+        return Results;
+    }
+
+    // each test is set up once and captured into the next lane; tests whose setup fails never
+    // get one, and the unused lanes are dropped before the run
+    ConBatchState Batch;
+    Thread.BeginBatch(Batch, Tests.size());
+    std::vector<size_t> LaneTests;
+    for (size_t i = 0; i < Tests.size(); ++i)
+    {
+        if (!PrepareTestCase(Tests[i], Thread, Results[i]))
+            continue;
+        Thread.CaptureBatchLane(Batch, LaneTests.size());
+        LaneTests.push_back(i);
+    }
+    if (LaneTests.empty())
+        return Results;
+    Batch.TruncateLanes(LaneTests.size());
+    Thread.ExecuteBatch(Batch);
+    for (size_t Lane = 0; Lane < LaneTests.size(); ++Lane)
+    {
+        Thread.RestoreBatchLane(Batch, Lane);
+        FinishTestCase(Tests[LaneTests[Lane]], Thread, Results[LaneTests[Lane]]);
+    }
+    return Results;
+}
+
+std::vector<PuzzleRunResult> RunPuzzleSuite(const std::vector<PuzzleRunJob>& Jobs,
+                                            unsigned WorkerCount,
+                                            bool bBatchLanes,
+                                            bool bProfileLines,
+                                            const ConExecutionBudget& Budget,
+                                            bool bOptimizeBytecode)
+{
+    std::vector<PuzzleRunResult> Results(Jobs.size());
+    std::vector<std::vector<int>> LineNumbers(bProfileLines ? Jobs.size() : 0);
+
+    // pass 1: parse every program once for its diagnostics and static estimate
+    {
+        std::atomic<size_t> NextJob{0};
+        RunOnWorkers(ClampWorkers(WorkerCount, Jobs.size()), [&]()
+        {
+            for (size_t JobIndex = NextJob++; JobIndex < Jobs.size(); JobIndex = NextJob++)
+            {
+                PuzzleRunResult& Result = Results[JobIndex];
+                ConThread Thread;
+                Result.bParsed = ComputeStaticCycleCount(Jobs[JobIndex].Code, Thread,
+                                                         Result.StaticCycles, Result.ParseErrors);
+                if (Result.bParsed)
+                    Result.Tests.resize(Jobs[JobIndex].Puzzle->Tests.size());
+                if (bProfileLines && Result.bParsed)
+                    for (size_t i = 0; i < Thread.GetLineCount(); ++i)
+                        LineNumbers[JobIndex].push_back(Thread.GetSourceLineNumber(i));
+            }
+        });
+    }
+
+    // pass 2 with lanes: one task per job, its tests run together as one batch
+    if (bBatchLanes)
+    {
+        std::atomic<size_t> NextJob{0};
+        RunOnWorkers(ClampWorkers(WorkerCount, Jobs.size()), [&]()
+        {
+            for (size_t JobIndex = NextJob++; JobIndex < Jobs.size(); JobIndex = NextJob++)
+            {
+                if (Results[JobIndex].Tests.empty()) continue;
+                ConThread Thread;
+                ConParser Parser;
+                Parser.Parse(Jobs[JobIndex].Code, Thread);
+                ConfigureSuiteThread(Thread, bProfileLines, bOptimizeBytecode, Budget);
+                Results[JobIndex].Tests = RunTestCaseBatch(Jobs[JobIndex].Puzzle->Tests, Thread);
+            }
+        });
+        if (bProfileLines) SummarizeLineProfiles(Results, LineNumbers);
+        return Results;
+    }
+
+    // pass 2: one task per test case, job-major so a worker usually keeps its parsed program
+    std::vector<std::pair<size_t, size_t>> Tasks;
+    for (size_t JobIndex = 0; JobIndex < Jobs.size(); ++JobIndex)
+        for (size_t TestIndex = 0; TestIndex < Results[JobIndex].Tests.size(); ++TestIndex)
+            Tasks.emplace_back(JobIndex, TestIndex);
+
+    std::atomic<size_t> NextTask{0};
+    RunOnWorkers(ClampWorkers(WorkerCount, Tasks.size()), [&]()
+    {
+        std::unique_ptr<ConThread> Thread;
+        size_t ParsedJob = std::numeric_limits<size_t>::max();
+        for (size_t TaskIndex = NextTask++; TaskIndex < Tasks.size(); TaskIndex = NextTask++)
+        {
+            const size_t JobIndex = Tasks[TaskIndex].first;
+            const size_t TestIndex = Tasks[TaskIndex].second;
+            if (JobIndex != ParsedJob)
+            {
+                Thread = std::make_unique<ConThread>();
+                ConParser Parser;
+                Parser.Parse(Jobs[JobIndex].Code, *Thread);
+                ConfigureSuiteThread(*Thread, bProfileLines, bOptimizeBytecode, Budget);
+                ParsedJob = JobIndex;
+            }
+            // every slot is written by exactly one worker, so the merge needs no locking
+            Results[JobIndex].Tests[TestIndex] = RunTestCase(Jobs[JobIndex].Puzzle->Tests[TestIndex], *Thread);
+        }
+    });
+    if (bProfileLines) SummarizeLineProfiles(Results, LineNumbers);
+    return Results;
+}
+
+PuzzleRunResult RunPuzzleTests(const PuzzleData& Puzzle,
+                               const std::vector<std::string>& Code,
+                               unsigned WorkerCount,
+                               bool bProfileLines)
+{
+    std::vector<PuzzleRunJob> Jobs(1);
+    Jobs[0].Puzzle = &Puzzle;
+    Jobs[0].Code = Code;
+    return std::move(RunPuzzleSuite(Jobs, WorkerCount, false, bProfileLines)[0]);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Puzzle.h"
+
+#include "../src/Conchpiler/thread.h"
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ============================================================
+// Test-runner helpers shared by the IDE and batch runs
+// ============================================================
+
+std::vector<std::filesystem::path> FindPuzzleFiles(const std::filesystem::path& Dir);
+
+bool LoadCodeFromFile(const std::string& Path,
+                      std::vector<std::string>& OutCode,
+                      std::string& OutError);
+
+std::string FormatListValues(const std::vector<int>& Values);
+
+bool ApplyTestSetup(const PuzzleTestCase& Test,
+                    ConThread& Thread,
+                    std::vector<std::string>& Messages);
+
+std::vector<std::string> ValidateExpectations(const PuzzleTestCase& Test,
+                                              const ConThread& Thread);
+
+// The budget puzzle tests run under: far more cycles than any solution needs, so only a program
+// that never finishes (an unbounded JUMP loop, say) is stopped by it.
+ConExecutionBudget DefaultTestBudget();
+
+// Parses the program once; the thread is reset between test runs rather than re-parsed. The
+// thread gets DefaultTestBudget and the plain bytecode engine; callers that want optimized
+// bytecode turn it on themselves.
+bool ComputeStaticCycleCount(const std::vector<std::string>& Code,
+                             ConThread& OutThread,
+                             int& OutCycles,
+                             std::vector<std::string>& Errors);
+
+// ============================================================
+// Parallel runner
+// ============================================================
+
+enum class TestCaseStatus
+{
+    Passed,
+    SetupFailed,
+    RuntimeError,
+    ExpectationMismatch,
+    // the run was stopped by its ConExecutionBudget
+    BudgetExhausted
+};
+
+struct TestCaseResult
+{
+    TestCaseStatus Status = TestCaseStatus::Passed;
+    // setup errors, runtime errors, expectation issues or the exhausted budget, depending on Status
+    std::vector<std::string> Messages;
+    int ExecutedCycles = 0;
+    // final machine state; left empty when setup failed
+    std::vector<int> Registers;
+    std::vector<std::pair<std::string, std::vector<int>>> Lists;
+    // this run's per-line counters when the thread profiles lines, index-aligned with its lines
+    std::vector<ConLineProfile> LineProfile;
+
+    bool Passed() const { return Status == TestCaseStatus::Passed; }
+};
+
+// a source line's counters; the generated REDO check is merged into its loop's line
+struct SourceLineProfile
+{
+    int Line = 0;
+    ConLineProfile Counters;
+};
+
+struct PuzzleRunResult
+{
+    bool bParsed = false;
+    std::vector<std::string> ParseErrors;
+    int StaticCycles = 0;
+    // index-aligned with PuzzleData::Tests
+    std::vector<TestCaseResult> Tests;
+    // summed over every test, ordered by source line; only filled by profiled runs
+    std::vector<SourceLineProfile> LineProfile;
+
+    bool AllPassed() const;
+};
+
+struct PuzzleRunJob
+{
+    const PuzzleData* Puzzle = nullptr;
+    std::vector<std::string> Code;
+};
+
+// hardware_concurrency, or 1 when it is unknown
+unsigned DefaultWorkerCount();
+
+// Runs one test on an already parsed thread with the engine settings it already has; the
+// thread is reset first.
+TestCaseResult RunTestCase(const PuzzleTestCase& Test, ConThread& Thread);
+
+// Runs every test as a lane of one lockstep batch (see ConThread::ExecuteBatch). Results are
+// identical to calling RunTestCase on each test in turn, which is what a traced or profiled
+// thread gets.
+std::vector<TestCaseResult> RunTestCaseBatch(const std::vector<PuzzleTestCase>& Tests, ConThread& Thread);
+
+// Spreads the test cases of every job across WorkerCount threads (0 picks DefaultWorkerCount).
+// Each worker parses its own copy of a program and reuses it for consecutive tests, so no
+// runtime state is shared between workers. With bBatchLanes a job's tests run together
+// through RunTestCaseBatch instead. With bProfileLines every result carries its line profile.
+// Results are index-aligned with Jobs regardless of the order in which workers finish. Workers
+// do not echo runtime errors; they are in each test's Messages. Every
+// test runs under Budget; a batch shares one deadline between its lanes. Tests run on the plain
+// bytecode engine unless bOptimizeBytecode asks for the optimized one.
+std::vector<PuzzleRunResult> RunPuzzleSuite(const std::vector<PuzzleRunJob>& Jobs,
+                                            unsigned WorkerCount = 0,
+                                            bool bBatchLanes = false,
+                                            bool bProfileLines = false,
+                                            const ConExecutionBudget& Budget = DefaultTestBudget(),
+                                            bool bOptimizeBytecode = false);
+
+PuzzleRunResult RunPuzzleTests(const PuzzleData& Puzzle,
+                               const std::vector<std::string>& Code,
+                               unsigned WorkerCount = 0,
+                               bool bProfileLines = false);
@@ -1,21 +1,49 @@
 // parser_tests.cpp – standalone regression tests for the Conch parser.
 //
-// Build (from repo root):
-//   g++ -std=c++17 TestApp/parser_tests.cpp src/Conchpiler/line.cpp \
-//       src/Conchpiler/op.cpp src/Conchpiler/parser.cpp \
-//       src/Conchpiler/scanner.cpp src/Conchpiler/thread.cpp \
-//       src/Conchpiler/variable.cpp -I TestApp -I src -o /tmp/parser_tests
+// Build (from repo root), passing these sources on one command line:
+//   g++ -std=c++17 -I TestApp -I src -pthread -o /tmp/parser_tests
+//       TestApp/parser_tests.cpp
+//       src/Conchpiler/arena.cpp
+//       src/Conchpiler/batch.cpp
+//       src/Conchpiler/budget.cpp
+//       src/Conchpiler/bytecode.cpp
+//       src/Conchpiler/fusion.cpp
+//       src/Conchpiler/line.cpp
+//       src/Conchpiler/mapped_file.cpp
+//       src/Conchpiler/op.cpp
+//       src/Conchpiler/parser.cpp
+//       src/Conchpiler/program.cpp
+//       src/Conchpiler/scanner.cpp
+//       src/Conchpiler/thread.cpp
+//       src/Conchpiler/trace.cpp
+//       src/Conchpiler/variable.cpp
+//       TestApp/AllocationCounter.cpp
+//       TestApp/Puzzle.cpp
+//       TestApp/SimpleJson.cpp
+//       TestApp/Superoptimizer.cpp
+//       TestApp/TestRunner.cpp
 // Run:
 //   /tmp/parser_tests
 
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "../src/Conchpiler/arena.h"
 #include "../src/Conchpiler/parser.h"
+#include "../src/Conchpiler/program.h"
 #include "../src/Conchpiler/thread.h"
+#include "../src/Conchpiler/trace.h"
 #include "../src/Conchpiler/variable.h"
+#include "AllocationCounter.h"
+#include "Superoptimizer.h"
+#include "TestRunner.h"
 
 namespace
 {
@@ -76,6 +104,89 @@ std::vector<int32> RunProgram(
     return std::vector<int32>(V.begin(), V.end());
 }
 
+// Observable state after one run, used to compare the execution engines.
+struct EngineRun
+{
+    bool bParsed = false;
+    std::vector<int32> Out0;
+    std::vector<int32> Registers;
+    std::vector<std::string> Errors;
+    bool bReturned = false;
+    int32 ReturnValue = 0;
+    int32 StaticCycles = 0;
+    int32 ExecutedCycles = 0;
+
+    bool operator==(const EngineRun& Other) const
+    {
+        return bParsed == Other.bParsed && Out0 == Other.Out0 && Registers == Other.Registers
+            && Errors == Other.Errors && bReturned == Other.bReturned && ReturnValue == Other.ReturnValue
+            && StaticCycles == Other.StaticCycles && ExecutedCycles == Other.ExecutedCycles;
+    }
+};
+
+void SetupEngineRun(ConThread& Thread, const std::vector<int32>& Dat0, int32 Out0ExpectedSize, int32 InitX)
+{
+    Thread.ResetState();
+    Thread.SetThreadValue(0, InitX);
+    if (ConVariableList* Dat = Thread.FindListVar("DAT0"))
+    {
+        Dat->SetRole(ConListRole::Input);
+        Dat->SetValues(Dat0);
+        Dat->Reset();
+    }
+    if (ConVariableList* Out = Thread.FindListVar("OUT0"))
+    {
+        Out->SetRole(ConListRole::Output);
+        Out->SetValues({});
+        Out->SetExpectedSize(static_cast<size_t>(Out0ExpectedSize));
+        Out->Reset();
+    }
+}
+
+EngineRun CaptureEngineRun(const ConThread& Thread)
+{
+    EngineRun Run;
+    Run.bParsed = true;
+    if (const ConVariableList* Out = Thread.FindListVar("OUT0"))
+    {
+        // a restored list may still be reading a snapshot's values rather than owning them
+        const ConListView View = Out->GetView();
+        Run.Out0.assign(View.begin(), View.end());
+    }
+    for (size_t Index = 0; Index < Thread.GetThreadVarCount(); ++Index)
+    {
+        Run.Registers.push_back(Thread.GetThreadValue(Index));
+        Run.Registers.push_back(Thread.GetThreadCacheValue(Index));
+    }
+    Run.Errors = Thread.GetRuntimeErrors();
+    Run.bReturned = Thread.DidReturn();
+    Run.ReturnValue = Thread.GetReturnValue();
+    Run.StaticCycles = Thread.GetCycleCount();
+    Run.ExecutedCycles = Thread.GetExecutedCycleCount();
+    return Run;
+}
+
+EngineRun RunWithEngine(
+    const std::vector<std::string>& Lines,
+    ConExecutionEngine Engine,
+    const std::vector<int32>& Dat0,
+    int32 Out0ExpectedSize,
+    int32 InitX = 0)
+{
+    ConParser Parser;
+    ConThread Thread;
+    if (!Parser.Parse(Lines, Thread))
+    {
+        return EngineRun();
+    }
+
+    Thread.SetTraceEnabled(false);
+    Thread.SetExecutionEngine(Engine);
+    SetupEngineRun(Thread, Dat0, Out0ExpectedSize, InitX);
+    Thread.Execute();
+    return CaptureEngineRun(Thread);
+}
+
 // Run the program and expect a specific error during *parsing*.
 bool ExpectParseError(const std::vector<std::string>& Lines, const std::string& ExpectedFragment)
 {
@@ -392,6 +503,1830 @@ TestResult Test_RedoSingleVariableTruthy()
     return R;
 }
 
+// The bytecode engine must be observably identical to the tree interpreter,
+// including runtime error text.
+TestResult Test_BytecodeMatchesTree()
+{
+    TestResult R;
+    R.Name = "Bytecode engine matches tree interpreter";
+
+    struct Case
+    {
+        std::vector<std::string> Lines;
+        std::vector<int32> Dat0;
+        int32 OutSize;
+        int32 InitX;
+    };
+    const std::vector<Case> Cases = {
+        // find the max
+        {{"POP X DAT0", "POP Y DAT0", "REDO IF Y GTR 0", "  IF GTR Y X", "    SET X Y", "  POP Y DAT0", "SET OUT0 X", "RET"},
+         {3, 1, 4, 1, 5, 9, 2, 6}, 1, 0},
+        // counted loop with cache reads and inline math
+        {{"SET Y 4", "REDO IF Y", "  SET X ADD X Y", "  SET OUT0 MUL X 2", "  DECR Y", "SWP X", "RET X"},
+         {}, 4, 1},
+        // labels and conditional jumps
+        {{"TOP: POP X DAT0", "JUMP EQL X 0 DONE", "SET OUT0 XOR X 5", "JUMP TOP", "DONE: RET Y"},
+         {7, 2, 9, 0}, 3, 0},
+        // random access and bitwise ops
+        {{"AT X DAT0 2", "SET Y NOT X", "AND Y 12", "OR X Y", "SET OUT0 SUB X Y", "SET OUT0 DIV X 0", "RET"},
+         {1, 2, 3}, 2, 0},
+        // OUT overflow is a runtime error
+        {{"SET OUT0 1", "SET OUT0 2", "RET"}, {}, 1, 0},
+        // inverted conditions and skipped loops
+        {{"REDO IFN X LSR 3", "  SET OUT0 X", "IFN X", "  SET OUT0 7", "INCR X", "IF EQL X 1", "  SET OUT0 X", "RET"},
+         {}, 3, 0},
+        // runaway loop hits the iteration cap
+        {{"REDO IF X", "  INCR Y", "RET"}, {}, 1, 1},
+    };
+
+    for (size_t Index = 0; Index < Cases.size(); ++Index)
+    {
+        const Case& C = Cases[Index];
+        const EngineRun Tree = RunWithEngine(C.Lines, ConExecutionEngine::Tree, C.Dat0, C.OutSize, C.InitX);
+        const EngineRun Bytecode = RunWithEngine(C.Lines, ConExecutionEngine::Bytecode, C.Dat0, C.OutSize, C.InitX);
+        if (!Tree.bParsed)
+        {
+            R.Reason = "Parse failed for case " + std::to_string(Index);
+            return R;
+        }
+        if (!(Tree == Bytecode))
+        {
+            R.Reason = "Engines diverged on case " + std::to_string(Index);
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+// Executed cycles follow the path taken: straight-line code matches the static
+// estimate, skipped IF bodies are not charged and every REDO re-check is.
+TestResult Test_ExecutedCycleCount()
+{
+    TestResult R;
+    R.Name = "Executed cycles follow the taken path";
+
+    // X, Y and Z are always declared, so VarCount = 3
+    const EngineRun Straight = RunWithEngine({"SET X 1", "SET Y X", "RET"}, ConExecutionEngine::Tree, {}, 1);
+    if (!Straight.bParsed || Straight.ExecutedCycles != Straight.StaticCycles)
+    {
+        R.Reason = "Straight-line program should execute exactly its static estimate";
+        return R;
+    }
+
+    // SET Y 5 costs 1 + 3 and is skipped when X = 0
+    const EngineRun Skipped = RunWithEngine({"SET Y 0", "IF X", "  SET Y 5", "RET"}, ConExecutionEngine::Tree, {}, 1, 0);
+    if (!Skipped.bParsed || Skipped.ExecutedCycles != Skipped.StaticCycles - 4)
+    {
+        R.Reason = "Skipped IF body should not be charged";
+        return R;
+    }
+
+    // SET Y 3 (4), then per iteration: head (0 + 3) + INCR X (4) + DECR Y (4) + re-check (1 + 3), then RET (1)
+    const EngineRun Loop = RunWithEngine({"SET Y 3", "REDO IF Y", "  INCR X", "  DECR Y", "RET"}, ConExecutionEngine::Tree, {}, 1);
+    const int32 Expected = 4 + 3 * (3 + 4 + 4 + 4) + 1;
+    if (!Loop.bParsed || Loop.ExecutedCycles != Expected)
+    {
+        R.Reason = "Expected " + std::to_string(Expected) + " executed cycles, got " + std::to_string(Loop.ExecutedCycles);
+        return R;
+    }
+    const EngineRun LoopBytecode = RunWithEngine({"SET Y 3", "REDO IF Y", "  INCR X", "  DECR Y", "RET"}, ConExecutionEngine::Bytecode, {}, 1);
+    if (LoopBytecode.ExecutedCycles != Loop.ExecutedCycles)
+    {
+        R.Reason = "Bytecode engine charged a different cycle count";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+// Once a program has run, executing it again must not allocate: ops read their
+// operands in place and the thread reuses its loop bookkeeping.
+TestResult Test_ExecuteDoesNotAllocate()
+{
+    TestResult R;
+    R.Name = "Steady-state Execute makes no heap allocations";
+
+    const std::vector<std::string> Lines = {
+        "SET Y 50",
+        "REDO IF Y",
+        "  SET X ADD X Y",
+        "  SET Z MUL X 3",
+        "  SUB Z Y",
+        "  IF GTR Z X",
+        "    XOR Z 7",
+        "  DECR Y",
+        "RET X"
+    };
+
+    const ConExecutionEngine Engines[] = {ConExecutionEngine::Tree, ConExecutionEngine::Bytecode};
+    for (const ConExecutionEngine Engine : Engines)
+    {
+        ConParser Parser;
+        ConThread Thread;
+        if (!Parser.Parse(Lines, Thread))
+        {
+            R.Reason = "Parse failed";
+            return R;
+        }
+        // tracing is opt-in, so a thread that never touched SetTraceEnabled runs untraced
+        if (Thread.IsTraceEnabled())
+        {
+            R.Reason = "Tracing should be off by default";
+            return R;
+        }
+        Thread.SetExecutionEngine(Engine);
+        Thread.Execute();
+
+        const uint64_t Before = GetAllocationCount();
+        Thread.Execute();
+        const uint64_t Allocations = GetAllocationCount() - Before;
+        if (Thread.HadRuntimeError())
+        {
+            R.Reason = "Unexpected runtime error";
+            return R;
+        }
+        if (Allocations != 0)
+        {
+            R.Reason = std::to_string(Allocations) + " allocations during Execute ("
+                + (Engine == ConExecutionEngine::Tree ? "tree" : "bytecode") + ")";
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+// One parse can serve many runs: ResetState rewinds registers, caches, list
+// cursors and OUT buffers so every run starts from the parsed state.
+TestResult Test_ResetStateReusesThread()
+{
+    TestResult R;
+    R.Name = "ResetState lets one parse run many times";
+
+    ConParser Parser;
+    ConThread Thread;
+    if (!Parser.Parse({"POP X DAT0", "POP Y DAT0", "SET OUT0 ADD X Y", "SWP X", "RET X"}, Thread))
+    {
+        R.Reason = "Parse failed";
+        return R;
+    }
+    Thread.SetTraceEnabled(false);
+    ConVariableList* Dat = Thread.FindListVar("DAT0");
+    ConVariableList* Out = Thread.FindListVar("OUT0");
+    if (!Dat || !Out)
+    {
+        R.Reason = "Missing DAT0 or OUT0";
+        return R;
+    }
+    Dat->SetRole(ConListRole::Input);
+    Dat->SetValues({4, 5});
+    Out->SetRole(ConListRole::Output);
+    Out->SetExpectedSize(1);
+
+    for (int Run = 0; Run < 3; ++Run)
+    {
+        Thread.ResetState();
+        if (Thread.GetThreadValue(0) != 0 || Thread.GetThreadCacheValue(0) != 0 || !Out->GetValues().empty())
+        {
+            R.Reason = "ResetState left state from the previous run";
+            return R;
+        }
+        Thread.Execute();
+        if (Thread.HadRuntimeError() || Out->GetValues() != std::vector<int32>{9} || Thread.GetReturnValue() != 0)
+        {
+            R.Reason = "Run " + std::to_string(Run) + " produced a different result";
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+// Two threads stream values through a mailbox; a pair that only listens deadlocks.
+TestResult Test_ProgramSendListen()
+{
+    TestResult R;
+    R.Name = "ConProgram runs SEND/LSTN threads in lockstep";
+
+    ConParser Parser;
+    ConThread Producer;
+    ConThread Consumer;
+    const bool bParsed =
+        Parser.Parse({"POP X DAT0", "REDO IF X", "  SEND T1 X", "  POP X DAT0", "SEND T1 0", "RET"}, Producer) &&
+        Parser.Parse({"LSTN X T0", "REDO IF X", "  SET OUT0 MUL X 2", "  LSTN X T0", "RET"}, Consumer);
+    if (!bParsed)
+    {
+        R.Reason = "Parse failed";
+        return R;
+    }
+    ConVariableList* Dat = Producer.FindListVar("DAT0");
+    Dat->SetRole(ConListRole::Input);
+    Dat->SetValues({3, 1, 4});
+    ConVariableList* Out = Consumer.FindListVar("OUT0");
+    Out->SetRole(ConListRole::Output);
+    Out->SetExpectedSize(3);
+
+    ConProgram Program;
+    Program.AddThread(std::move(Producer));
+    Program.AddThread(std::move(Consumer));
+    for (size_t Index = 0; Index < Program.GetThreadCount(); ++Index)
+    {
+        Program.GetThread(Index).SetTraceEnabled(false);
+    }
+    Program.Execute();
+    if (Program.HadRuntimeError())
+    {
+        R.Reason = "Unexpected error: " + Program.GetRuntimeErrors().front();
+        return R;
+    }
+    if (Program.GetThread(1).FindListVar("OUT0")->GetValues() != std::vector<int32>{6, 2, 8})
+    {
+        R.Reason = "Expected OUT0=[6, 2, 8]";
+        return R;
+    }
+    const int32 Elapsed = Program.GetExecutedCycleCount();
+    const int32 Producing = Program.GetThread(0).GetExecutedCycleCount();
+    const int32 Consuming = Program.GetThread(1).GetExecutedCycleCount();
+    if (Elapsed < Producing || Elapsed < Consuming || Elapsed >= Producing + Consuming)
+    {
+        R.Reason = "Lockstep cycles should overlap the two threads' work";
+        return R;
+    }
+
+    ConProgram Stuck;
+    ConThread A;
+    ConThread B;
+    Parser.Parse({"LSTN X T1", "RET"}, A);
+    Parser.Parse({"LSTN X T0", "RET"}, B);
+    Stuck.AddThread(std::move(A));
+    Stuck.AddThread(std::move(B));
+    Stuck.GetThread(0).SetTraceEnabled(false);
+    Stuck.GetThread(1).SetTraceEnabled(false);
+    Stuck.Execute();
+    if (!Stuck.HadDeadlock() || Stuck.GetRuntimeErrors().front().find("T0 blocked on LSTN from T1") == std::string::npos)
+    {
+        R.Reason = "Expected mutual LSTN to report a deadlock";
+        return R;
+    }
+
+    // a thread waiting on SEND or LSTN spends no steps, however long the other side takes: the
+    // first sender blocks on its second SEND (capacity 1), the second listener on its first LSTN
+    const std::vector<std::vector<std::string>> SenderCode = {
+        {"SEND T1 7", "SEND T1 7", "RET"},
+        {"SET Y 50", "REDO IF Y", "  DECR Y", "SEND T1 7", "SEND T1 7", "RET"},
+    };
+    const std::vector<std::vector<std::string>> ListenerCode = {
+        {"SET Y 50", "REDO IF Y", "  DECR Y", "LSTN X T0", "LSTN X T0", "RET X"},
+        {"LSTN X T0", "LSTN X T0", "RET X"},
+    };
+    for (size_t Case = 0; Case < SenderCode.size(); ++Case)
+    {
+        ConProgram Waiting;
+        ConThread Sender;
+        ConThread Listener;
+        Parser.Parse(SenderCode[Case], Sender);
+        Parser.Parse(ListenerCode[Case], Listener);
+        // only the waiting side is tight: three lines, each run exactly once
+        ConExecutionBudget ThreeSteps;
+        ThreeSteps.MaxSteps = 3;
+        (Case == 0 ? Sender : Listener).SetExecutionBudget(ThreeSteps);
+        Waiting.AddThread(std::move(Sender));
+        Waiting.AddThread(std::move(Listener));
+        Waiting.GetThread(0).SetTraceEnabled(false);
+        Waiting.GetThread(1).SetTraceEnabled(false);
+        Waiting.Execute();
+        if (Waiting.WasBudgetExhausted() || Waiting.HadRuntimeError() || Waiting.GetThread(1).GetReturnValue() != 7)
+        {
+            R.Reason = std::string("Cycles spent blocked on ") + (Case == 0 ? "SEND" : "LSTN") + " should not count as steps";
+            return R;
+        }
+    }
+
+    ConThread Alone;
+    Parser.Parse({"SEND T0 1", "RET"}, Alone);
+    Alone.SetTraceEnabled(false);
+    Alone.Execute();
+    if (Alone.GetRuntimeErrors() != std::vector<std::string>{"[line 1, col 1] SEND requires a multi-thread program"})
+    {
+        R.Reason = "SEND outside a program should be a runtime error";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_ParallelRunnerIsDeterministic()
+{
+    TestResult R;
+    R.Name = "Parallel runner merges results in puzzle order";
+
+    PuzzleData Puzzle;
+    for (int Index = 0; Index < 200; ++Index)
+    {
+        PuzzleTestCase Test;
+        Test.Name = "Case " + std::to_string(Index);
+        Test.DatInputs.push_back({"DAT0", {Index + 1, Index + 2}});
+        Test.OutSpecs.push_back({"OUT0", 2});
+        // every seventh case expects the wrong answer so failures are part of the merge too
+        const int Factor = Index % 7 == 0 ? 3 : 2;
+        Test.Expectation.ExpectedOut.push_back({"OUT0", {(Index + 1) * Factor, (Index + 2) * Factor}});
+        Puzzle.Tests.push_back(Test);
+    }
+    const std::vector<std::string> Code = {"POP X DAT0", "REDO IF X GTR 0", "  MUL X 2", "  SET OUT0 X", "  POP X DAT0", "RET"};
+
+    const PuzzleRunResult Serial = RunPuzzleTests(Puzzle, Code, 1);
+    const PuzzleRunResult Parallel = RunPuzzleTests(Puzzle, Code, 8);
+    if (!Serial.bParsed || !Parallel.bParsed || Serial.StaticCycles != Parallel.StaticCycles)
+    {
+        R.Reason = "Both runs should parse with the same static estimate";
+        return R;
+    }
+    if (Parallel.Tests.size() != Puzzle.Tests.size())
+    {
+        R.Reason = "Expected one result per test case";
+        return R;
+    }
+    for (size_t Index = 0; Index < Puzzle.Tests.size(); ++Index)
+    {
+        const TestCaseResult& A = Serial.Tests[Index];
+        const TestCaseResult& B = Parallel.Tests[Index];
+        if (A.Status != B.Status || A.Messages != B.Messages || A.ExecutedCycles != B.ExecutedCycles ||
+            A.Registers != B.Registers || A.Lists != B.Lists)
+        {
+            R.Reason = "Result " + std::to_string(Index) + " differs between serial and parallel runs";
+            return R;
+        }
+        if (B.Passed() != (Index % 7 != 0))
+        {
+            R.Reason = "Result " + std::to_string(Index) + " landed in the wrong slot";
+            return R;
+        }
+    }
+
+    std::vector<PuzzleRunJob> Jobs(3);
+    Jobs[0].Puzzle = &Puzzle;
+    Jobs[0].Code = Code;
+    Jobs[1].Puzzle = &Puzzle;
+    Jobs[1].Code = {"BOGUS X"};
+    Jobs[2].Puzzle = &Puzzle;
+    Jobs[2].Code = {"RET"};
+    const std::vector<PuzzleRunResult> Suite = RunPuzzleSuite(Jobs, 4);
+    if (Suite.size() != 3 || !Suite[0].bParsed || Suite[1].bParsed || !Suite[2].bParsed ||
+        Suite[0].Tests.size() != Puzzle.Tests.size() || Suite[1].Tests.size() != 0 || Suite[2].AllPassed())
+    {
+        R.Reason = "Suite results should stay aligned with their jobs";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_TraceRecorderMatchesLiveTrace()
+{
+    TestResult R;
+    R.Name = "Recorded binary trace decodes to the live trace";
+
+    const std::vector<std::string> Lines = {
+        "POP X DAT0",
+        "REDO IF X GTR 0",
+        "  MUL X 2",
+        "  SET OUT0 X",
+        "  POP X DAT0",
+        "SWP Y",
+        "RET"
+    };
+    ConParser Parser;
+    ConThread Thread;
+    if (!Parser.Parse(Lines, Thread))
+    {
+        R.Reason = "Parse failed";
+        return R;
+    }
+    auto Setup = [&Thread]()
+    {
+        Thread.ResetState();
+        ConVariableList* Dat = Thread.FindListVar("DAT0");
+        Dat->SetRole(ConListRole::Input);
+        Dat->SetValues({3, 1, 4});
+        ConVariableList* Out = Thread.FindListVar("OUT0");
+        Out->SetRole(ConListRole::Output);
+        Out->SetExpectedSize(3);
+        Out->Reset();
+    };
+
+    const ConExecutionEngine Engines[] = {ConExecutionEngine::Tree, ConExecutionEngine::Bytecode};
+    for (const ConExecutionEngine Engine : Engines)
+    {
+        Thread.SetExecutionEngine(Engine);
+
+        Setup();
+        Thread.SetTraceEnabled(true);
+        std::ostringstream Live;
+        std::streambuf* Previous = std::cout.rdbuf(Live.rdbuf());
+        Thread.Execute();
+        std::cout.rdbuf(Previous);
+        Thread.SetTraceEnabled(false);
+
+        Setup();
+        ConTraceRecorder Recorder;
+        Thread.SetTraceRecorder(&Recorder);
+        Thread.Execute();
+        Thread.SetTraceRecorder(nullptr);
+
+        std::string Error;
+        ConTraceLog Loaded;
+        const std::string Path = "parser_tests_trace.bin";
+        if (!WriteTraceFile(Path, Recorder.GetLog(), Error) || !ReadTraceFile(Path, Loaded, Error))
+        {
+            R.Reason = "Trace file round trip failed: " + Error;
+            return R;
+        }
+        std::remove(Path.c_str());
+
+        std::ostringstream Decoded;
+        RenderTrace(Loaded, Decoded);
+        if (Live.str().empty() || Decoded.str() != Live.str())
+        {
+            R.Reason = "Decoded trace differs from the live trace";
+            return R;
+        }
+    }
+
+    Setup();
+    ConTraceRecorder Small(4);
+    Thread.SetTraceRecorder(&Small);
+    Thread.Execute();
+    if (Small.GetLog().Records.size() != 4 || Small.GetDroppedCount() == 0)
+    {
+        R.Reason = "A full ring buffer should keep only its newest records";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_RegisterFileSurvivesThreadMove()
+{
+    TestResult R;
+    R.Name = "Registers live in one register file that survives thread moves";
+
+    const std::vector<std::string> Lines = {
+        "SET X 4",
+        "SET Y ADD X 3",
+        "SWP Y",
+        "SET Z ADD X YC",
+        "RET Z"
+    };
+
+    ConParser Parser;
+    ConThread Parsed;
+    if (!Parser.Parse(Lines, Parsed))
+    {
+        R.Reason = "Parse failed";
+        return R;
+    }
+    ConThread Thread = std::move(Parsed);
+
+    const ConRegisterFile* File = Thread.GetThreadVar(0)->GetFile();
+    if (File == nullptr || File->Size() != Thread.GetThreadVarCount())
+    {
+        R.Reason = "Register file should hold every declared register";
+        return R;
+    }
+    for (size_t Index = 0; Index < Thread.GetThreadVarCount(); ++Index)
+    {
+        const ConVariableCached* Var = Thread.GetThreadVar(Index);
+        if (Var->GetFile() != File || Var->GetIndex() != static_cast<int32>(Index))
+        {
+            R.Reason = "Register " + std::to_string(Index) + " is not slot " + std::to_string(Index) + " of the file";
+            return R;
+        }
+    }
+
+    const ConExecutionEngine Engines[] = {ConExecutionEngine::Tree, ConExecutionEngine::Bytecode};
+    for (const ConExecutionEngine Engine : Engines)
+    {
+        Thread.ResetState();
+        Thread.SetExecutionEngine(Engine);
+        Thread.Execute();
+        if (Thread.GetReturnValue() != 11 || File->Values[2] != 11 || File->Values[1] != 0 || File->Caches[1] != 7)
+        {
+            R.Reason = std::string("Unexpected register state (") + (Engine == ConExecutionEngine::Tree ? "tree" : "bytecode") + ")";
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+struct ArenaDestructorCounter
+{
+    explicit ArenaDestructorCounter(int* InCount) : Count(InCount) {}
+    ~ArenaDestructorCounter() { ++*Count; }
+    int* Count;
+    std::vector<int32> Payload = std::vector<int32>(4, 1);
+};
+
+TestResult Test_ArenaOwnsParsedProgram()
+{
+    TestResult R;
+    R.Name = "Parsed programs live in one arena with interned literals";
+
+    int Destroyed = 0;
+    {
+        ConArena Arena(256);
+        for (int i = 0; i < 64; ++i)
+        {
+            Arena.New<ArenaDestructorCounter>(&Destroyed);
+        }
+        if (Arena.GetBlockCount() < 2)
+        {
+            R.Reason = "Arena should have grown past its first block";
+            return R;
+        }
+        Arena.Reset();
+        if (Destroyed != 64 || Arena.GetBlockCount() != 1 || Arena.GetBytesUsed() != 0)
+        {
+            R.Reason = "Reset should destroy every object and keep a single block";
+            return R;
+        }
+        Arena.New<ArenaDestructorCounter>(&Destroyed);
+        ConArena Moved = std::move(Arena);
+    }
+    if (Destroyed != 65)
+    {
+        R.Reason = "Destroying a moved arena should destroy its objects exactly once";
+        return R;
+    }
+
+    // a repeated literal costs nothing extra; a new value costs one more literal
+    ConParser Parser;
+    ConThread Shared;
+    ConThread Distinct;
+    if (!Parser.Parse({"SET X 7", "SET Y ADD X 7", "RET Y"}, Shared)
+        || !Parser.Parse({"SET X 7", "SET Y ADD X 8", "RET Y"}, Distinct))
+    {
+        R.Reason = "Parse failed";
+        return R;
+    }
+    if (Distinct.GetStorage().GetBytesUsed() <= Shared.GetStorage().GetBytesUsed())
+    {
+        R.Reason = "Repeated literal was not interned";
+        return R;
+    }
+    Shared.Execute();
+    Distinct.Execute();
+    if (Shared.GetReturnValue() != 14 || Distinct.GetReturnValue() != 15)
+    {
+        R.Reason = "Interned literals changed the result";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_BatchLanesMatchScalar()
+{
+    TestResult R;
+    R.Name = "Lockstep batch lanes match scalar runs";
+
+    struct Lane
+    {
+        std::vector<int32> Dat0;
+        int32 OutSize;
+        int32 InitX;
+    };
+    const std::vector<std::vector<std::string>> Programs = {
+        // straight-line math stays converged
+        {"POP X DAT0", "SET Y MUL X 3", "SET Z ADD Y XC", "SWP Z", "SET OUT0 DIV Y X", "RET Z"},
+        // data-dependent branches and loops split the lanes apart
+        {"POP X DAT0", "POP Y DAT0", "REDO IF Y GTR 0", "  IF GTR Y X", "    SET X Y", "  POP Y DAT0", "SET OUT0 X", "RET"},
+        {"TOP: POP X DAT0", "JUMP EQL X 0 DONE", "SET OUT0 XOR X 5", "JUMP TOP", "DONE: RET Y"},
+        // some lanes overflow OUT0 or hit the iteration cap while the others finish
+        {"REDO IF X", "  INCR Y", "  SET OUT0 Y", "  DECR X", "RET Y"},
+    };
+    const std::vector<Lane> Lanes = {
+        {{3, 1, 4, 1, 5, 9, 2, 6}, 4, 0},
+        {{7, 2, 9, 0}, 3, 2},
+        {{}, 0, 0},
+        {{5, 5, 5, 5, 0, 8}, 1, 12000},
+        {{0}, 2, 1},
+        {{1, 2, 3, 4, 5, 6, 7, 8, 9, 0}, 10, 7},
+    };
+
+    for (size_t ProgramIndex = 0; ProgramIndex < Programs.size(); ++ProgramIndex)
+    {
+        ConParser Parser;
+        ConThread Thread;
+        if (!Parser.Parse(Programs[ProgramIndex], Thread))
+        {
+            R.Reason = "Parse failed for program " + std::to_string(ProgramIndex);
+            return R;
+        }
+        Thread.SetTraceEnabled(false);
+
+        ConBatchState Batch;
+        Thread.BeginBatch(Batch, Lanes.size());
+        for (size_t Index = 0; Index < Lanes.size(); ++Index)
+        {
+            SetupEngineRun(Thread, Lanes[Index].Dat0, Lanes[Index].OutSize, Lanes[Index].InitX);
+            Thread.CaptureBatchLane(Batch, Index);
+        }
+        Thread.ExecuteBatch(Batch);
+
+        for (size_t Index = 0; Index < Lanes.size(); ++Index)
+        {
+            const Lane& L = Lanes[Index];
+            const EngineRun Scalar = RunWithEngine(Programs[ProgramIndex], ConExecutionEngine::Bytecode, L.Dat0, L.OutSize, L.InitX);
+            Thread.RestoreBatchLane(Batch, Index);
+            if (!(CaptureEngineRun(Thread) == Scalar))
+            {
+                R.Reason = "Lane " + std::to_string(Index) + " diverged from its scalar run on program " + std::to_string(ProgramIndex);
+                return R;
+            }
+        }
+        // lanes of a straight-line program never split, so each instruction is dispatched once
+        if (ProgramIndex == 0 && Batch.GroupSteps != Thread.GetBytecode().Instructions.size())
+        {
+            R.Reason = "Straight-line program should run fully converged";
+            return R;
+        }
+    }
+
+    // tests whose setup fails get no lane, and the lanes after them keep their own inputs
+    PuzzleData Puzzle;
+    for (int Index = 0; Index < 5; ++Index)
+    {
+        PuzzleTestCase Test;
+        Test.DatInputs.push_back({Index == 1 ? "DAT7" : "DAT0", {Index, Index + 3}});
+        if (Index == 3)
+            Test.InitialRegisters["Q"] = 1;
+        Test.OutSpecs.push_back({"OUT0", 1});
+        Test.Expectation.ExpectedOut.push_back({"OUT0", {Index + Index + 3}});
+        Puzzle.Tests.push_back(Test);
+    }
+    ConParser Parser;
+    ConThread Runner;
+    Parser.Parse({"POP X DAT0", "POP Y DAT0", "SET OUT0 ADD X Y", "RET"}, Runner);
+    Runner.SetExecutionEngine(ConExecutionEngine::Bytecode);
+    const std::vector<TestCaseResult> Batched = RunTestCaseBatch(Puzzle.Tests, Runner);
+    for (size_t Index = 0; Index < Puzzle.Tests.size(); ++Index)
+    {
+        const TestCaseResult Alone = RunTestCase(Puzzle.Tests[Index], Runner);
+        const TestCaseResult& Lane = Batched[Index];
+        const bool bSetupFails = Index == 1 || Index == 3;
+        if (Lane.Status != Alone.Status || Lane.Messages != Alone.Messages || Lane.ExecutedCycles != Alone.ExecutedCycles ||
+            Lane.Registers != Alone.Registers || Lane.Lists != Alone.Lists || Lane.Passed() == bSetupFails)
+        {
+            R.Reason = "Batched test " + std::to_string(Index) + " should match its scalar run around failed setups";
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_SuperoptimizerFindsCheaperProgram()
+{
+    TestResult R;
+    R.Name = "Superoptimizer finds a cheaper program that passes";
+
+    if (CanonicalizeProgram({"\tSET  X 1 ", "RET", "", ""}) != CanonicalizeProgram({"    SET X 1", "RET"}))
+    {
+        R.Reason = "Programs differing only in whitespace should share a canonical form";
+        return R;
+    }
+
+    PuzzleData Puzzle;
+    for (int Index = 0; Index < 6; ++Index)
+    {
+        PuzzleTestCase Test;
+        Test.Name = "Case " + std::to_string(Index);
+        Test.DatInputs.push_back({"DAT0", {Index + 1, Index + 5, 0}});
+        Test.OutSpecs.push_back({"OUT0", 2});
+        Test.Expectation.ExpectedOut.push_back({"OUT0", {(Index + 1) * 2, (Index + 5) * 2}});
+        Puzzle.Tests.push_back(Test);
+    }
+    // a dead store and a needless copy through Y
+    const std::vector<std::string> Code = {"SET Z 5", "POP X DAT0", "REDO IF X", "  SET Y X", "  SET OUT0 MUL Y 2", "  POP X DAT0", "RET"};
+
+    SuperoptimizerOptions Options;
+    Options.WorkerCount = 1;
+    Options.MaxCandidates = 4000;
+    Options.TimeBudgetSeconds = 60.0;
+    const SuperoptimizerResult Result = Superoptimize(Puzzle, Code, Options);
+    if (!Result.bStartValid || !Result.Improved() || Result.BestStaticCycles >= Result.StartStaticCycles)
+    {
+        R.Reason = "Expected a lower static estimate than " + std::to_string(Result.StartStaticCycles);
+        return R;
+    }
+    if (Result.CandidatesTried != Options.MaxCandidates || Result.CandidatesUnique > Result.CandidatesTried ||
+        Result.CandidatesVerified > Result.CandidatesUnique)
+    {
+        R.Reason = "Candidate counters are inconsistent";
+        return R;
+    }
+    const PuzzleRunResult Check = RunPuzzleTests(Puzzle, Result.BestCode, 1);
+    if (!Check.AllPassed() || Check.StaticCycles != Result.BestStaticCycles)
+    {
+        R.Reason = "Optimised program should pass every test at the reported estimate";
+        return R;
+    }
+    const SuperoptimizerResult Failing = Superoptimize(Puzzle, {"POP X DAT0", "RET"}, Options);
+    if (Failing.bStartValid || Failing.Error.empty())
+    {
+        R.Reason = "A start program that fails its tests should be rejected";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_OptimizedBytecodeMatchesPlain()
+{
+    TestResult R;
+    R.Name = "Optimized bytecode keeps results and executed cycles";
+
+    const std::vector<std::vector<std::string>> Programs = {
+        // literal conditions, folded arithmetic and code after RET
+        {"IF 0", "  SET Y 4", "IF GTR 3 2", "  SET Y ADD 2 3", "SET Z MUL 4 5", "", "JUMP EQL 1 2 SKIP", "SET OUT0 NOT 0", "SKIP: POP X DAT0", "RET Y", "SET Y 9", "INCR Z"},
+        {"JUMP END", "SET X 99", "SET OUT0 X", "END: RET X"},
+        {"POP X DAT0", "REDO IF X", "  IF 1", "    SET OUT0 MUL X 2", "  POP X DAT0", "REDO IF 1", "  INCR Y", "  IFN LSR Y 3", "    RET Y", "RET Y"},
+        {"TOP: POP X DAT0", "JUMP EQL X 0 DONE", "", "SET OUT0 XOR X 5", "JUMP TOP", "DONE: RET Y"},
+        {"REDO IF X", "  INCR Y", "  SET OUT0 Y", "  DECR X", "REDO IF 0", "  SET Y 7", "RET Y"},
+        // folded writes that overflow OUT0 report the error of the op they came from
+        {"SET Y 5", "REDO IF Y", "  SET OUT0 NOT 4", "  SET OUT0 ADD 1 2", "  DECR Y", "RET Y"},
+        {"SET OUT0 7", "SET Y 5", "REDO IF Y", "  SET OUT0 NOT 4", "  SET OUT0 ADD 1 2", "  DECR Y", "RET Y"},
+    };
+    const std::vector<std::vector<int32>> Inputs = {{3, 1, 4, 1, 5, 0}, {}, {7, 2, 9, 0}, {5, 5, 5, 5, 5, 5, 5, 5, 0}};
+    const std::vector<int32> InitXs = {0, 3};
+
+    size_t PlainSize = 0;
+    size_t OptimizedSize = 0;
+    for (size_t ProgramIndex = 0; ProgramIndex < Programs.size(); ++ProgramIndex)
+    {
+        ConParser Parser;
+        ConThread Plain;
+        ConThread Optimized;
+        if (!Parser.Parse(Programs[ProgramIndex], Plain) || !ConParser().Parse(Programs[ProgramIndex], Optimized))
+        {
+            R.Reason = "Parse failed for program " + std::to_string(ProgramIndex);
+            return R;
+        }
+        for (ConThread* Thread : {&Plain, &Optimized})
+        {
+            Thread->SetTraceEnabled(false);
+            Thread->SetRuntimeErrorEcho(false);
+            Thread->SetExecutionEngine(ConExecutionEngine::Bytecode);
+        }
+        Optimized.SetBytecodeOptimization(true);
+
+        std::vector<EngineRun> TreeRuns;
+        for (size_t InputIndex = 0; InputIndex < Inputs.size(); ++InputIndex)
+        {
+            for (const int32 InitX : InitXs)
+            {
+                TreeRuns.push_back(RunWithEngine(Programs[ProgramIndex], ConExecutionEngine::Tree, Inputs[InputIndex], 4, InitX));
+                SetupEngineRun(Plain, Inputs[InputIndex], 4, InitX);
+                Plain.Execute();
+                SetupEngineRun(Optimized, Inputs[InputIndex], 4, InitX);
+                Optimized.Execute();
+                if (!(CaptureEngineRun(Plain) == TreeRuns.back()) || !(CaptureEngineRun(Optimized) == TreeRuns.back()))
+                {
+                    R.Reason = "Program " + std::to_string(ProgramIndex) + " diverged from the tree on input " + std::to_string(InputIndex);
+                    return R;
+                }
+            }
+        }
+
+        // optimized lanes match too
+        ConBatchState Batch;
+        Optimized.BeginBatch(Batch, TreeRuns.size());
+        for (size_t Lane = 0; Lane < TreeRuns.size(); ++Lane)
+        {
+            SetupEngineRun(Optimized, Inputs[Lane / InitXs.size()], 4, InitXs[Lane % InitXs.size()]);
+            Optimized.CaptureBatchLane(Batch, Lane);
+        }
+        Optimized.ExecuteBatch(Batch);
+        for (size_t Lane = 0; Lane < TreeRuns.size(); ++Lane)
+        {
+            Optimized.RestoreBatchLane(Batch, Lane);
+            if (!(CaptureEngineRun(Optimized) == TreeRuns[Lane]))
+            {
+                R.Reason = "Optimized lane " + std::to_string(Lane) + " of program " + std::to_string(ProgramIndex) + " diverged from the tree";
+                return R;
+            }
+        }
+        if (!Optimized.GetBytecode().bOptimized || Plain.GetBytecode().bOptimized)
+        {
+            R.Reason = "Only the opted-in thread should run optimized bytecode";
+            return R;
+        }
+        PlainSize += Plain.GetBytecode().Instructions.size();
+        OptimizedSize += Optimized.GetBytecode().Instructions.size();
+        if (ProgramIndex == 0 && Optimized.GetBytecode().Instructions.size() * 2 > Plain.GetBytecode().Instructions.size())
+        {
+            R.Reason = "Literal conditions and dead code should mostly fold away";
+            return R;
+        }
+    }
+    if (OptimizedSize >= PlainSize)
+    {
+        R.Reason = "Optimization should shrink the executed program";
+        return R;
+    }
+
+    // tracing always runs the plain form so every line is reported
+    ConThread Traced;
+    ConParser().Parse(Programs[0], Traced);
+    Traced.SetExecutionEngine(ConExecutionEngine::Bytecode);
+    Traced.SetBytecodeOptimization(true);
+    Traced.SetTraceRecorder(nullptr);
+    Traced.SetTraceEnabled(true);
+    std::ostringstream Sink;
+    std::streambuf* Previous = std::cout.rdbuf(Sink.rdbuf());
+    SetupEngineRun(Traced, Inputs[0], 4, 0);
+    Traced.Execute();
+    std::cout.rdbuf(Previous);
+    if (Traced.GetBytecode().bOptimized)
+    {
+        R.Reason = "Traced runs should use the plain bytecode";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_FusedBytecodeMatchesPlain()
+{
+    TestResult R;
+    R.Name = "Fused bytecode matches plain runs, scalar and batched";
+
+    const std::vector<std::vector<std::string>> Programs = {
+        // Pop->LoopHead, Set->Pop, Pop->Redo and Redo->LoopHead; OUT0 overflows on long inputs
+        {"POP X DAT0", "REDO IF X", "  IF GTR X 4", "    SET Y X", "  SET OUT0 X", "  POP X DAT0", "RET Y"},
+        // the iteration cap is raised from inside a fused Redo
+        {"REDO IF 1", "  INCR Y", "RET Y"},
+        // the loop exits into another loop entered through a fused Pop->LoopHead
+        {"REDO IF X", "  DECR X", "  IF X", "    SET OUT0 X", "POP Z DAT0", "REDO IF Z", "  SET Y ADD Y Z", "  POP Z DAT0", "RET Y"},
+    };
+    const std::vector<std::vector<int32>> Inputs = {{3, 9, 4, 1, 5, 0}, {}, {7, 2, 9, 0}, {5, 6, 7, 8, 9, 1, 2, 0}};
+    const std::vector<int32> InitXs = {0, 2, 6};
+
+    std::vector<bool> bSeen(4, false);
+    for (size_t ProgramIndex = 0; ProgramIndex < Programs.size(); ++ProgramIndex)
+    {
+        ConThread Plain;
+        ConThread Fused;
+        if (!ConParser().Parse(Programs[ProgramIndex], Plain) || !ConParser().Parse(Programs[ProgramIndex], Fused))
+        {
+            R.Reason = "Parse failed for program " + std::to_string(ProgramIndex);
+            return R;
+        }
+        for (ConThread* Thread : {&Plain, &Fused})
+        {
+            Thread->SetTraceEnabled(false);
+            Thread->SetRuntimeErrorEcho(false);
+            Thread->SetExecutionEngine(ConExecutionEngine::Bytecode);
+        }
+        Fused.SetBytecodeOptimization(true);
+
+        std::vector<EngineRun> Expected;
+        for (const std::vector<int32>& Input : Inputs)
+        {
+            for (const int32 InitX : InitXs)
+            {
+                SetupEngineRun(Plain, Input, 3, InitX);
+                Plain.Execute();
+                Expected.push_back(CaptureEngineRun(Plain));
+                SetupEngineRun(Fused, Input, 3, InitX);
+                Fused.Execute();
+                if (!(CaptureEngineRun(Fused) == Expected.back()))
+                {
+                    R.Reason = "Program " + std::to_string(ProgramIndex) + " diverged in lane " + std::to_string(Expected.size() - 1);
+                    return R;
+                }
+            }
+        }
+        for (const ConInstruction& Inst : Fused.GetBytecode().Instructions)
+        {
+            const size_t Index = static_cast<size_t>(Inst.Opcode) - ConOpcodeBaseCount;
+            if (Inst.Opcode >= ConOpcode::PopRedo && Index < bSeen.size())
+            {
+                bSeen[Index] = true;
+            }
+        }
+
+        ConBatchState Batch;
+        Fused.BeginBatch(Batch, Expected.size());
+        for (size_t Lane = 0; Lane < Expected.size(); ++Lane)
+        {
+            SetupEngineRun(Fused, Inputs[Lane / InitXs.size()], 3, InitXs[Lane % InitXs.size()]);
+            Fused.CaptureBatchLane(Batch, Lane);
+        }
+        Fused.ExecuteBatch(Batch);
+        for (size_t Lane = 0; Lane < Expected.size(); ++Lane)
+        {
+            Fused.RestoreBatchLane(Batch, Lane);
+            if (!(CaptureEngineRun(Fused) == Expected[Lane]))
+            {
+                R.Reason = "Batched lane " + std::to_string(Lane) + " diverged on program " + std::to_string(ProgramIndex);
+                return R;
+            }
+        }
+    }
+    for (const bool bFound : bSeen)
+    {
+        if (!bFound)
+        {
+            R.Reason = "Every fused opcode should be produced by at least one program";
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_LineProfileCountsExecution()
+{
+    TestResult R;
+    R.Name = "Line profile counts executions, cycles and branches";
+
+    const std::vector<std::string> Code = {"POP X DAT0", "REDO IF X", "  IF GTR X 4", "    INCR Y", "  POP X DAT0", "RET Y"};
+    const std::vector<int32> Input = {3, 9, 4, 6, 0};
+    std::vector<ConLineProfile> Profiles[2];
+    int32 ExecutedCycles[2] = {};
+    const ConExecutionEngine Engines[2] = {ConExecutionEngine::Tree, ConExecutionEngine::Bytecode};
+    for (size_t EngineIndex = 0; EngineIndex < 2; ++EngineIndex)
+    {
+        ConThread Thread;
+        if (!ConParser().Parse(Code, Thread))
+        {
+            R.Reason = "Parse failed";
+            return R;
+        }
+        Thread.SetTraceEnabled(false);
+        Thread.SetExecutionEngine(Engines[EngineIndex]);
+        Thread.SetBytecodeOptimization(true);
+        Thread.SetLineProfiling(true);
+        SetupEngineRun(Thread, Input, 0, 0);
+        Thread.Execute();
+        if (Thread.GetBytecode().bOptimized)
+        {
+            R.Reason = "Profiled runs should use the plain bytecode";
+            return R;
+        }
+        Profiles[EngineIndex] = Thread.GetLineProfile();
+        ExecutedCycles[EngineIndex] = Thread.GetExecutedCycleCount();
+        if (Profiles[EngineIndex].size() != Thread.GetLineCount())
+        {
+            R.Reason = "Profile should have one entry per parsed line";
+            return R;
+        }
+
+        // a second run accumulates until the profile is reset
+        SetupEngineRun(Thread, Input, 0, 0);
+        Thread.Execute();
+        if (Thread.GetLineProfile()[0].Executions != 2)
+        {
+            R.Reason = "Profiles should accumulate over runs";
+            return R;
+        }
+        Thread.ResetLineProfile();
+        if (Thread.GetLineProfile()[0].Executions != 0)
+        {
+            R.Reason = "ResetLineProfile should clear the counters";
+            return R;
+        }
+    }
+
+    uint64_t CycleSum = 0;
+    ConLineProfile Redo;
+    ConLineProfile If;
+    for (size_t Index = 0; Index < Profiles[1].size(); ++Index)
+    {
+        const ConLineProfile& Tree = Profiles[0][Index];
+        const ConLineProfile& Line = Profiles[1][Index];
+        if (Tree.Executions != Line.Executions || Tree.Cycles != Line.Cycles || Tree.IfTaken != Line.IfTaken
+            || Tree.IfNotTaken != Line.IfNotTaken || Tree.RedoIterations != Line.RedoIterations || Tree.RedoExits != Line.RedoExits)
+        {
+            R.Reason = "Engines disagree on line " + std::to_string(Index);
+            return R;
+        }
+        CycleSum += Line.Cycles;
+        Redo.Merge(Line.RedoIterations + Line.RedoExits > 0 ? Line : ConLineProfile());
+        If.Merge(Line.IfTaken + Line.IfNotTaken > 0 ? Line : ConLineProfile());
+    }
+    if (CycleSum != static_cast<uint64_t>(ExecutedCycles[1]) || ExecutedCycles[0] != ExecutedCycles[1])
+    {
+        R.Reason = "Line cycles should add up to the executed cycles";
+        return R;
+    }
+    // four values before the terminating 0: the body runs four times, and two of them exceed 4
+    if (Redo.RedoIterations != 3 || Redo.RedoExits != 1 || If.IfTaken != 2 || If.IfNotTaken != 2)
+    {
+        R.Reason = "Unexpected branch counts: redo " + std::to_string(Redo.RedoIterations) + "/" +
+                   std::to_string(Redo.RedoExits) + ", if " + std::to_string(If.IfTaken) + "/" + std::to_string(If.IfNotTaken);
+        return R;
+    }
+
+    // the suite runner sums its tests by source line, lanes or not
+    PuzzleData Puzzle;
+    Puzzle.Tests.resize(2);
+    Puzzle.Tests[0].DatInputs.push_back({"DAT0", {3, 9, 4, 6, 0}});
+    Puzzle.Tests[1].DatInputs.push_back({"DAT0", {5, 0}});
+    std::vector<PuzzleRunJob> Jobs(1);
+    Jobs[0].Puzzle = &Puzzle;
+    Jobs[0].Code = Code;
+    for (const bool bLanes : {false, true})
+    {
+        const PuzzleRunResult Run = RunPuzzleSuite(Jobs, 1, bLanes, true)[0];
+        uint64_t SuiteCycles = 0;
+        for (const SourceLineProfile& Entry : Run.LineProfile) SuiteCycles += Entry.Counters.Cycles;
+        const int32 Expected = Run.Tests[0].ExecutedCycles + Run.Tests[1].ExecutedCycles;
+        // the REDO line carries both its head and its generated loop check
+        if (Run.LineProfile.size() != Code.size() || Run.LineProfile[1].Line != 2
+            || Run.LineProfile[1].Counters.RedoExits != 2 || SuiteCycles != static_cast<uint64_t>(Expected))
+        {
+            R.Reason = std::string("Suite profile is wrong") + (bLanes ? " with lanes" : "");
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_PuzzleLoaderAndCache()
+{
+    TestResult R;
+    R.Name = "Streaming puzzle loader matches the schema and its cache round trips";
+
+    const std::string Text =
+        "{\"title\": \"Cache\", \"naiveSolution\": [\"RET X\"], \"starterCode\": [\"RET Y\"],"
+        " \"tests\": [{\"inputs\": [{\"name\": \"DAT9\"}],"
+        " \"dat\": [{\"name\": \"dat0\", \"values\": [2147483647, -2147483648, 2.9, -0, 1e3]}],"
+        " \"registers\": {\"x\": 7}, \"out\": [{\"name\": \"out0\", \"size\": 4, \"expectedSize\": 2}]}]}";
+    PuzzleData Puzzle;
+    std::string Error;
+    if (!LoadPuzzleFromText(Text, Puzzle, Error))
+    {
+        R.Reason = "Load failed: " + Error;
+        return R;
+    }
+    // the preferred alias wins even when a lesser one is invalid or comes first
+    const PuzzleTestCase& Test = Puzzle.Tests[0];
+    const std::vector<int> ExpectedValues = {2147483647, -2147483647 - 1, 2, 0, 1000};
+    if (Puzzle.StarterCode != std::vector<std::string>{"RET Y"} || Test.Name != "Unnamed Test" || Test.DatInputs.size() != 1
+        || Test.DatInputs[0].Name != "DAT0" || Test.DatInputs[0].Values != ExpectedValues
+        || Test.InitialRegisters.at("X") != 7 || Test.OutSpecs[0].ExpectedSize != 2)
+    {
+        R.Reason = "Loaded puzzle does not match the file";
+        return R;
+    }
+
+    // malformed JSON is reported ahead of schema errors, and schema errors in field order
+    const std::pair<const char*, const char*> Failures[] = {
+        {"{\"title\": 3, \"tests\": [1,]}", "Invalid number literal"},
+        {"{\"tests\": [{}], \"title\": 3}", "Puzzle title must be a string"},
+        {"{\"tests\": [{\"dat\": [{\"name\": \"OUT0\", \"values\": [\"a\"]}]}]}", "Expected list name starting with 'DAT'"},
+        {"{\"title\": \"t\"}", "Puzzle requires an array of tests"},
+        {"{\"tests\": []} x", "Unexpected trailing characters"},
+    };
+    for (const auto& Failure : Failures)
+    {
+        PuzzleData Ignored;
+        Error.clear();
+        if (LoadPuzzleFromText(Failure.first, Ignored, Error) || Error != Failure.second)
+        {
+            R.Reason = std::string("Expected '") + Failure.second + "', got '" + Error + "'";
+            return R;
+        }
+    }
+
+    const std::string Path = "parser_tests_puzzle.json";
+    const std::string CachePath = GetPuzzleCachePath(Path);
+    std::ofstream(Path) << Text;
+    PuzzleData Cached[2];
+    for (PuzzleData& Data : Cached)
+    {
+        if (!LoadPuzzleCached(Path, Data, Error))
+        {
+            R.Reason = "Cached load failed: " + Error;
+            return R;
+        }
+    }
+    const bool bWroteCache = std::ifstream(CachePath).good();
+    const bool bRoundTrip = Cached[1].Title == Puzzle.Title && Cached[1].StarterCode == Puzzle.StarterCode
+        && Cached[1].Tests[0].DatInputs[0].Values == ExpectedValues && Cached[1].Tests[0].InitialRegisters == Test.InitialRegisters
+        && Cached[1].Tests[0].OutSpecs[0].Name == "OUT0";
+
+    // a change in size always invalidates the cache
+    std::ofstream(Path) << "{\"title\": \"Changed\", \"tests\": [{}]}";
+    PuzzleData Changed;
+    const bool bReloaded = LoadPuzzleCached(Path, Changed, Error) && Changed.Title == "Changed";
+    std::remove(Path.c_str());
+    std::remove(CachePath.c_str());
+    if (!bWroteCache || !bRoundTrip || !bReloaded)
+    {
+        R.Reason = !bWroteCache ? "No cache file was written" : !bRoundTrip ? "Cached puzzle differs" : "Stale cache was used";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_BorrowedDatListsReadInPlace()
+{
+    TestResult R;
+    R.Name = "DAT lists read borrowed and mapped memory in place";
+
+    // POP past the end and AT out of range both read 0, as with owned values
+    const std::vector<std::string> Code = {"POP X DAT0", "REDO IF X", "  SET Y ADD Y X", "  POP X DAT0",
+                                           "AT X DAT0 -1", "SET Y ADD Y X", "AT X DAT0 2", "SET Y ADD Y X", "RET Y"};
+    const std::vector<int32> Input = {4, 9, 2, 0, 7};
+    ConThread Thread;
+    if (!ConParser().Parse(Code, Thread))
+    {
+        R.Reason = "Parse failed";
+        return R;
+    }
+    Thread.SetTraceEnabled(false);
+    SetupEngineRun(Thread, Input, 0, 0);
+    Thread.Execute();
+    const int32 Owned = Thread.GetReturnValue();
+
+    ConVariableList* Dat = Thread.FindListVar("DAT0");
+    for (const ConExecutionEngine Engine : {ConExecutionEngine::Tree, ConExecutionEngine::Bytecode})
+    {
+        Thread.ResetState();
+        Thread.SetExecutionEngine(Engine);
+        Dat->BorrowValues(Input.data(), Input.size());
+        Thread.Execute();
+        if (Thread.GetReturnValue() != Owned || !Dat->IsBorrowed() || !Dat->GetValues().empty()
+            || Dat->GetView().begin() != Input.data())
+        {
+            R.Reason = "Borrowed run should match the owned run without copying";
+            return R;
+        }
+    }
+
+    // the first write copies the borrowed values into the list
+    ConVariableList Copy;
+    Copy.BorrowValues(Input.data(), Input.size());
+    Copy.Push(5);
+    if (Copy.IsBorrowed() || Copy.GetValues() != std::vector<int32>{4, 9, 2, 0, 7, 5} || Input.size() != 5)
+    {
+        R.Reason = "Writing to a borrowed list should copy it first";
+        return R;
+    }
+
+    // a puzzle DAT list can come from a binary file, which tests map and borrow
+    const std::string DataPath = "parser_tests_dat.i32";
+    const std::string PuzzlePath = "parser_tests_mapped.json";
+    std::ofstream(DataPath, std::ios::binary).write(reinterpret_cast<const char*>(Input.data()),
+                                                     static_cast<std::streamsize>(Input.size() * sizeof(int32)));
+    std::ofstream(PuzzlePath) << "{\"tests\": [{\"dat\": [{\"name\": \"DAT0\", \"file\": \"" + DataPath + "\"}]}]}";
+    PuzzleData Puzzle;
+    std::string Error;
+    const bool bLoaded = LoadPuzzleFromFile(PuzzlePath, Puzzle, Error);
+    int32 Mapped = 0;
+    if (bLoaded && RunTestCase(Puzzle.Tests[0], Thread).Passed())
+    {
+        Mapped = Thread.GetReturnValue();
+    }
+    std::ofstream(DataPath, std::ios::binary) << "odd";
+    ConMappedFile Odd;
+    const bool bRejectedOdd = !Odd.Open(DataPath, Error);
+    std::remove(DataPath.c_str());
+    std::remove(PuzzlePath.c_str());
+    if (!bLoaded || !Puzzle.Tests[0].DatInputs[0].Mapped || Mapped != Owned || !bRejectedOdd)
+    {
+        R.Reason = !bLoaded ? "Mapped puzzle failed to load: " + Error : !bRejectedOdd ? "A partial int32 should be rejected" : "Mapped run differs";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_IncrementalParserMatchesFullParse()
+{
+    TestResult R;
+    R.Name = "Incremental re-parse matches a full parse after each edit";
+
+    std::vector<std::string> Code = {"SET X 3", "top: REDO IF X", "  SET Y ADD Y X", "  SET X SUB X 1", "RET Y"};
+    ConIncrementalParser Live;
+    // each edit lists how many lines it should parse again
+    const auto Check = [&](const size_t Expected, const std::string& Step) -> bool
+    {
+        const bool bValid = Live.Update(Code);
+        ConThread Thread;
+        ConParser Full;
+        const bool bFull = Full.Parse(Code, Thread);
+        Thread.UpdateCycleCount();
+        if (bValid != bFull || Live.GetErrors() != Full.GetErrors()
+            || (bFull && Live.GetCycleCount() != Thread.GetCycleCount()) || Live.GetReparsedLineCount() != Expected)
+        {
+            R.Reason = Step + " differs from a full parse or re-parsed " + std::to_string(Live.GetReparsedLineCount()) + " lines";
+            return false;
+        }
+        return true;
+    };
+
+    if (!Check(5, "First update")) return R;
+    if (!Check(0, "Unchanged text")) return R;
+    Code[2] = "  SET Y ADD Y Q";
+    if (!Check(1, "Unknown variable")) return R;
+    Code[2] = "  SET Y ADD Y X";
+    if (!Check(1, "Fixed variable")) return R;
+    Code.insert(Code.begin(), "SET Z 1 $");
+    if (!Check(1, "Inserted scan error")) return R;
+    Code[0] = "JUMP nowhere";
+    if (!Check(1, "Missing label")) return R;
+    Code[0] = "JUMP top";
+    if (!Check(1, "Resolved label")) return R;
+    // removing a line leaves the clean lines below it alone
+    Code.erase(Code.begin() + 1);
+    if (!Check(0, "Removed line")) return R;
+    Code.insert(Code.begin() + 3, "  SET Z 1 $");
+    if (!Check(1, "Scan error in a block")) return R;
+    // a scan error below an edit is scanned again so its message has the new line number
+    Code.insert(Code.begin(), "SET X 3");
+    if (!Check(2, "Line above a scan error")) return R;
+    Code.erase(Code.begin() + 4);
+    if (!Check(0, "Removed scan error")) return R;
+
+    // on a long program an edit parses only the lines it touched
+    Code.clear();
+    for (int32 Block = 0; Block < 2000; ++Block)
+    {
+        const std::string Label = "L" + std::to_string(Block);
+        Code.push_back(Label + ": SET X " + std::to_string(Block));
+        Code.push_back("REDO IF X");
+        Code.push_back("  DECR X");
+        Code.push_back("  SET Y ADD Y X");
+        Code.push_back("JUMP GTR Y 100 " + Label);
+    }
+    Code.push_back("RET Y");
+    // the final RET Y is shared with the previous text
+    if (!Check(Code.size() - 1, "Long program")) return R;
+    Code[5003] = "  SET Y ADD Y 2";
+    if (!Check(1, "Edit in a long program")) return R;
+    Code.insert(Code.begin(), "SET Z 1");
+    if (!Check(1, "Line inserted above everything")) return R;
+    Code[1 + 5 * 700] = "SET X 700";
+    if (!Check(1, "Removed label")) return R;
+    Code.erase(Code.begin());
+    if (!Check(0, "Line removed above a missing label")) return R;
+    Code[5 * 700] = "L700: SET X 700";
+    if (!Check(1, "Restored label")) return R;
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_ScannerBufferModeMatchesLines()
+{
+    TestResult R;
+    R.Name = "Buffer scanning and parsing match line scanning and parsing";
+
+    const std::vector<std::string> Code = {"top: SET X ADD X -12", "\tIFN EQL X 2147483648", "  SETX set IF $ -", "", "JUMP top"};
+    std::string Source;
+    for (const std::string& Line : Code)
+    {
+        Source += Line + "\r\n";
+    }
+
+    Scanner Lines;
+    const std::vector<TokenLine> Expected = Lines.Scan(Code);
+    ConScannedSource Scanned;
+    Scanner::ScanSource(Source, Scanned);
+    bool bMatches = Scanned.Lines.size() == Expected.size() && Scanned.Errors == Lines.GetErrors();
+    for (size_t LineIndex = 0; bMatches && LineIndex < Expected.size(); ++LineIndex)
+    {
+        const ConScannedLine& Line = Scanned.Lines[LineIndex];
+        bMatches = Line.Text == Code[LineIndex] && Line.Indent == Expected[LineIndex].Indent
+            && Line.TokenCount == Expected[LineIndex].Tokens.size();
+        for (size_t TokenIndex = 0; bMatches && TokenIndex < Line.TokenCount; ++TokenIndex)
+        {
+            const ConTokenView& View = Scanned.Tokens[Line.FirstToken + TokenIndex];
+            const Token& Tok = Expected[LineIndex].Tokens[TokenIndex];
+            bMatches = View.Kind == Tok.Kind && View.Keyword == Tok.Keyword && View.Lexeme == Tok.Lexeme
+                && View.Literal == Tok.Literal && View.bHasLiteral == Tok.bHasLiteral
+                && View.Line == Tok.Line && View.Column == Tok.Column;
+        }
+    }
+    if (!bMatches || Scanned.Errors.size() != 3)
+    {
+        R.Reason = "Buffer tokens or errors differ from the line scanner";
+        return R;
+    }
+
+    // parsing the scanned buffer in place matches parsing the lines, errors included
+    const std::vector<std::vector<std::string>> Programs = {
+        {"top: INCR X", "IF LSR X 3", "  JUMP top", "REDO IF X", "  DECR X", "INCR X", "RET X"},
+        {"SET X", "JUMP nowhere", "POP X DAT0 OUT1"},
+        Code,
+    };
+    for (const std::vector<std::string>& Program : Programs)
+    {
+        std::string ProgramSource;
+        for (const std::string& Line : Program)
+        {
+            ProgramSource += Line + "\n";
+        }
+        ConScannedSource ProgramTokens;
+        Scanner::ScanSource(ProgramSource, ProgramTokens);
+        ConParser FromLines;
+        ConParser FromBuffer;
+        ConThread LinesThread;
+        ConThread BufferThread;
+        const bool bLinesParsed = FromLines.Parse(Program, LinesThread);
+        if (FromBuffer.Parse(ProgramTokens, BufferThread) != bLinesParsed || FromBuffer.GetErrors() != FromLines.GetErrors())
+        {
+            R.Reason = "Buffer parse result or errors differ from the line parse";
+            return R;
+        }
+        // only the first program is valid
+        if (bLinesParsed != (&Program == &Programs.front()))
+        {
+            R.Reason = "Program parsed unexpectedly: " + Program.front();
+            return R;
+        }
+        if (!bLinesParsed)
+        {
+            continue;
+        }
+        LinesThread.SetTraceEnabled(false);
+        BufferThread.SetTraceEnabled(false);
+        LinesThread.Execute();
+        BufferThread.Execute();
+        if (BufferThread.GetLineCount() != LinesThread.GetLineCount() || BufferThread.GetCycleCount() != LinesThread.GetCycleCount()
+            || BufferThread.GetReturnValue() != 1 || LinesThread.GetReturnValue() != 1)
+        {
+            R.Reason = "Buffer parse built a different program";
+            return R;
+        }
+    }
+
+    // keywords are exact and case-sensitive
+    if (FindKeyword("IFN") != ConKeyword::Ifn || FindKeyword("LSTN") != ConKeyword::Lstn
+        || FindKeyword("SETX") != ConKeyword::None || FindKeyword("set") != ConKeyword::None || FindKeyword("") != ConKeyword::None)
+    {
+        R.Reason = "Keyword lookup misclassified a word";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_KeywordDispatchErrors()
+{
+    TestResult R;
+    R.Name = "Keyword dispatch keeps its resolve errors";
+
+    struct ErrorCase
+    {
+        std::string Line;
+        std::string Error;
+    };
+    const std::vector<ErrorCase> Cases = {
+        {"SET X DATX", "[line 1, col 7] Invalid DAT index"},
+        {"SET X OUT99999999999", "[line 1, col 7] Invalid OUT index"},
+        {"set X 1", "[line 1, col 1] Unable to resolve token 'set'"},
+        {"SET X LIST", "[line 1, col 7] LIST token missing index"},
+        {"IF EQL X", "[line 1, col 1] IF requires either a single operand or a comparison with two operands"},
+    };
+    for (const ErrorCase& Case : Cases)
+    {
+        ConParser Parser;
+        ConThread Thread;
+        if (Parser.Parse({Case.Line}, Thread) || Parser.GetErrors().empty() || Parser.GetErrors().front() != Case.Error)
+        {
+            R.Reason = "'" + Case.Line + "' should fail with: " + Case.Error;
+            return R;
+        }
+    }
+
+    // a list index is its leading digits, so DAT5X names a list of its own
+    ConParser Parser;
+    ConThread Thread;
+    if (!Parser.Parse({"POP X DAT5X", "RET X"}, Thread) || Thread.FindListVar("DAT5X") == nullptr)
+    {
+        R.Reason = "DAT5X should parse as an input list";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_VerifiedLinesFailWhenReached()
+{
+    TestResult R;
+    R.Name = "Verified lines report static misuse only when reached";
+
+    const std::vector<std::string> Lines = {
+        "IF X",
+        "  POP Y X",
+        "POP Y X INCR X",
+        "RET X",
+    };
+    ConParser Parser;
+    ConThread Thread;
+    if (!Parser.Parse(Lines, Thread) || Thread.GetLine(2).GetStaticError() == nullptr)
+    {
+        R.Reason = "POP into a register should parse and be flagged by the verification pass";
+        return R;
+    }
+
+    // the guarded copy never runs; the unguarded one fails after the INCR that runs before it
+    const std::vector<std::string> Expected = {"[line 3, col 1] POP requires a list operand"};
+    for (const ConExecutionEngine Engine : {ConExecutionEngine::Tree, ConExecutionEngine::Bytecode})
+    {
+        const EngineRun Run = RunWithEngine(Lines, Engine, {}, 0);
+        if (Run.Errors != Expected || Run.bReturned || Run.Registers.empty() || Run.Registers[0] != 1)
+        {
+            R.Reason = std::string(Engine == ConExecutionEngine::Tree ? "Tree" : "Bytecode")
+                + " run should apply INCR then fail on POP";
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_ExecutionBudgetStopsRunawayJump()
+{
+    TestResult R;
+    R.Name = "Execution budgets stop runaway JUMP loops";
+
+    // the REDO cap never sees a JUMP loop, so only the budget ends it
+    const std::vector<std::string> Spin = {"TOP: INCR X", "JUMP TOP"};
+    ConExecutionBudget Cycles;
+    Cycles.MaxCycles = 1000;
+
+    struct EngineCase
+    {
+        ConExecutionEngine Engine;
+        bool bOptimize;
+    };
+    std::vector<EngineRun> Runs;
+    for (const EngineCase Case : {EngineCase{ConExecutionEngine::Tree, false}, EngineCase{ConExecutionEngine::Bytecode, false},
+                                  EngineCase{ConExecutionEngine::Bytecode, true}})
+    {
+        ConParser Parser;
+        ConThread Thread;
+        Parser.Parse(Spin, Thread);
+        Thread.SetExecutionEngine(Case.Engine);
+        Thread.SetBytecodeOptimization(Case.bOptimize);
+        Thread.SetExecutionBudget(Cycles);
+        SetupEngineRun(Thread, {}, 0, 0);
+        Thread.Execute();
+        if (Thread.GetExhaustedBudgetLimit() != ConBudgetLimit::Cycles || Thread.HadRuntimeError() ||
+            Thread.GetExecutedCycleCount() < Cycles.MaxCycles)
+        {
+            R.Reason = "Cycle budget should stop the loop once 1000 cycles have run";
+            return R;
+        }
+        Runs.push_back(CaptureEngineRun(Thread));
+    }
+    if (!(Runs[0] == Runs[1]) || !(Runs[0] == Runs[2]))
+    {
+        R.Reason = "Every engine should stop at the same line";
+        return R;
+    }
+
+    // a step budget on the tree engine is a line count, and stepping on is refused
+    ConParser Parser;
+    ConThread Thread;
+    Parser.Parse(Spin, Thread);
+    ConExecutionBudget Steps;
+    Steps.MaxSteps = 10;
+    Thread.SetExecutionBudget(Steps);
+    Thread.Execute();
+    if (Thread.GetThreadValue(0) != 5 || Thread.GetExhaustedBudgetLimit() != ConBudgetLimit::Steps ||
+        Thread.StepLine() != ConStepResult::BudgetExhausted || !Thread.IsFinished())
+    {
+        R.Reason = "Ten steps should run five iterations and then refuse to step";
+        return R;
+    }
+
+    ConExecutionBudget Deadline;
+    Deadline.MaxDuration = std::chrono::milliseconds(1);
+    Thread.SetExecutionBudget(Deadline);
+    Thread.ResetState();
+    Thread.Execute();
+    if (Thread.GetExhaustedBudgetLimit() != ConBudgetLimit::Deadline)
+    {
+        R.Reason = "A deadline should stop an endless loop";
+        return R;
+    }
+
+    // in a batch only the spinning lane is stopped, exactly where its scalar run stops
+    const std::vector<std::string> Guarded = {"TOP: IF X", "  JUMP TOP", "RET 7"};
+    ConThread Batched;
+    Parser.Parse(Guarded, Batched);
+    Batched.SetExecutionBudget(Cycles);
+    ConBatchState Batch;
+    Batched.BeginBatch(Batch, 2);
+    for (size_t Lane = 0; Lane < 2; ++Lane)
+    {
+        SetupEngineRun(Batched, {}, 0, static_cast<int32>(Lane));
+        Batched.CaptureBatchLane(Batch, Lane);
+    }
+    Batched.ExecuteBatch(Batch);
+    for (size_t Lane = 0; Lane < 2; ++Lane)
+    {
+        ConThread Scalar;
+        Parser.Parse(Guarded, Scalar);
+        Scalar.SetExecutionEngine(ConExecutionEngine::Bytecode);
+        Scalar.SetExecutionBudget(Cycles);
+        SetupEngineRun(Scalar, {}, 0, static_cast<int32>(Lane));
+        Scalar.Execute();
+        Batched.RestoreBatchLane(Batch, Lane);
+        if (!(CaptureEngineRun(Batched) == CaptureEngineRun(Scalar)) ||
+            Batched.WasBudgetExhausted() != (Lane == 1) || Scalar.WasBudgetExhausted() != (Lane == 1))
+        {
+            R.Reason = "Batch lane " + std::to_string(Lane) + " should match its budgeted scalar run";
+            return R;
+        }
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_ExecutionBudgetsMatchAcrossEngines()
+{
+    TestResult R;
+    R.Name = "Execution budgets stop every engine on the same line";
+
+    // merged label lines before and after an instruction, folded IFs and fused loop tails
+    const std::vector<std::vector<std::string>> Programs = {
+        {"SET Y 4", "INCR X", "IDLE:", "BACK: SET Z ADD Z X", "", "DECR Y", "JUMP GTR Y 0 BACK", "RET Z"},
+        {"POP X DAT0", "REDO IF X", "  SET Y ADD Y X", "  IF 1", "    SET OUT0 X", "  POP X DAT0", "RET Y"},
+        {"TOP: INCR X", "SET Y X SET Z Y", "JUMP TOP"},
+    };
+    const std::vector<std::vector<int32>> Inputs = {{3, 1, 4, 0}, {9, 8, 7, 6, 5, 4, 3, 2, 1, 0}};
+
+    size_t StoppedRuns = 0;
+    for (size_t ProgramIndex = 0; ProgramIndex < Programs.size(); ++ProgramIndex)
+    {
+        ConThread Threads[5];
+        for (size_t Index = 0; Index < 5; ++Index)
+        {
+            if (!ConParser().Parse(Programs[ProgramIndex], Threads[Index]))
+            {
+                R.Reason = "Parse failed for program " + std::to_string(ProgramIndex);
+                return R;
+            }
+            Threads[Index].SetTraceEnabled(false);
+            Threads[Index].SetRuntimeErrorEcho(false);
+            Threads[Index].SetExecutionEngine(Index == 0 ? ConExecutionEngine::Tree : ConExecutionEngine::Bytecode);
+            Threads[Index].SetBytecodeOptimization(Index == 2 || Index == 4);
+        }
+        // the tree, plain and optimized bytecode run alone; the last two run as lanes
+        ConThread& Tree = Threads[0];
+        for (int32 Limit = 1; Limit <= 120; ++Limit)
+        {
+            for (const bool bCycles : {true, false})
+            {
+                ConExecutionBudget Budget;
+                Budget.MaxCycles = bCycles ? Limit : 0;
+                Budget.MaxSteps = bCycles ? 0 : static_cast<uint64_t>(Limit);
+                std::vector<EngineRun> TreeRuns;
+                std::vector<ConBudgetLimit> TreeLimits;
+                for (ConThread& Thread : Threads)
+                {
+                    Thread.SetExecutionBudget(Budget);
+                }
+                for (const std::vector<int32>& Input : Inputs)
+                {
+                    SetupEngineRun(Tree, Input, 4, 0);
+                    Tree.Execute();
+                    TreeRuns.push_back(CaptureEngineRun(Tree));
+                    TreeLimits.push_back(Tree.GetExhaustedBudgetLimit());
+                    StoppedRuns += Tree.WasBudgetExhausted() ? 1 : 0;
+                    for (size_t Index = 1; Index <= 2; ++Index)
+                    {
+                        SetupEngineRun(Threads[Index], Input, 4, 0);
+                        Threads[Index].Execute();
+                        if (!(CaptureEngineRun(Threads[Index]) == TreeRuns.back()) ||
+                            Threads[Index].GetExhaustedBudgetLimit() != TreeLimits.back())
+                        {
+                            R.Reason = "Program " + std::to_string(ProgramIndex) + " stopped apart from the tree under a " +
+                                       (bCycles ? "cycle" : "step") + " limit of " + std::to_string(Limit);
+                            return R;
+                        }
+                    }
+                }
+                for (size_t Index = 3; Index <= 4; ++Index)
+                {
+                    ConBatchState Batch;
+                    Threads[Index].BeginBatch(Batch, Inputs.size());
+                    for (size_t Lane = 0; Lane < Inputs.size(); ++Lane)
+                    {
+                        SetupEngineRun(Threads[Index], Inputs[Lane], 4, 0);
+                        Threads[Index].CaptureBatchLane(Batch, Lane);
+                    }
+                    Threads[Index].ExecuteBatch(Batch);
+                    for (size_t Lane = 0; Lane < Inputs.size(); ++Lane)
+                    {
+                        Threads[Index].RestoreBatchLane(Batch, Lane);
+                        if (!(CaptureEngineRun(Threads[Index]) == TreeRuns[Lane]) ||
+                            Threads[Index].GetExhaustedBudgetLimit() != TreeLimits[Lane])
+                        {
+                            R.Reason = "Lane " + std::to_string(Lane) + " of program " + std::to_string(ProgramIndex) +
+                                       " stopped apart from the tree under a " + (bCycles ? "cycle" : "step") +
+                                       " limit of " + std::to_string(Limit);
+                            return R;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (StoppedRuns == 0)
+    {
+        R.Reason = "No budget ever stopped a run";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_SnapshotForksRunningThread()
+{
+    TestResult R;
+    R.Name = "Snapshots fork a paused run";
+
+    const std::vector<std::string> Program = {"SET Y 4", "REDO IF Y", "  POP X DAT0", "  SET OUT0 ADD X Y", "  DECR Y", "RET Y"};
+    const std::vector<int32> Dat0 = {5, 6, 7, 8};
+    const EngineRun Reference = RunWithEngine(Program, ConExecutionEngine::Tree, Dat0, 4);
+    auto Finish = [](ConThread& Thread)
+    {
+        while (Thread.StepLine() == ConStepResult::Running)
+        {
+        }
+        return CaptureEngineRun(Thread);
+    };
+
+    // pause before the second DECR Y
+    ConParser Parser;
+    ConThread Thread;
+    Parser.Parse(Program, Thread);
+    SetupEngineRun(Thread, Dat0, 4, 0);
+    Thread.BeginRun();
+    if (Thread.RunUntil(4) != ConStepResult::Running || Thread.RunUntil(4) != ConStepResult::Running || Thread.GetProgramCounter() != 4)
+    {
+        R.Reason = "RunUntil should stop each time line 4 is next";
+        return R;
+    }
+    const ConThreadSnapshot Snapshot = Thread.CaptureSnapshot();
+    // capturing hands OUT0's values to the snapshot, which the thread then reads in place
+    const int32* const Out0Data = Thread.FindListVar("OUT0")->GetView().Data;
+    std::shared_ptr<const std::vector<int32>> CapturedOut0;
+    for (const ConListSnapshot& Saved : Snapshot.State->Lists)
+    {
+        if (Saved.Values != nullptr && Saved.Values->data() == Out0Data)
+        {
+            CapturedOut0 = Saved.Values;
+        }
+    }
+    if (CapturedOut0 == nullptr || *CapturedOut0 != std::vector<int32>({9, 9}))
+    {
+        R.Reason = "Capturing should share OUT0's values with the snapshot instead of copying them";
+        return R;
+    }
+    if (!(Finish(Thread) == Reference) || *CapturedOut0 != std::vector<int32>({9, 9}))
+    {
+        R.Reason = "Pausing and capturing should not change the run or, later, the snapshot";
+        return R;
+    }
+    if (!Thread.RestoreSnapshot(Snapshot) || !(Finish(Thread) == Reference))
+    {
+        R.Reason = "Restoring into the same thread should replay the rest of the run";
+        return R;
+    }
+
+    // a fork with a different register diverges without touching the snapshot
+    ConThread Fork;
+    Parser.Parse(Program, Fork);
+    Fork.RestoreSnapshot(Snapshot);
+    Fork.SetThreadValue(1, 1);
+    const EngineRun Diverged = Finish(Fork);
+    if (Diverged.Out0 != std::vector<int32>({9, 9}) || Diverged.ReturnValue != 0)
+    {
+        R.Reason = "The fork should leave the loop after its own DECR Y";
+        return R;
+    }
+    if (!Fork.RestoreSnapshot(Snapshot) || !(Finish(Fork) == Reference))
+    {
+        R.Reason = "A fresh thread restored from the snapshot should finish like the original";
+        return R;
+    }
+
+    // lists read the snapshot's values in place until they are written
+    Fork.RestoreSnapshot(Snapshot);
+    Fork.StepLine();
+    const ConThreadSnapshot Again = Fork.CaptureSnapshot();
+    for (size_t Index = 0; Index < Snapshot.State->Lists.size(); ++Index)
+    {
+        if (Again.State->Lists[Index].Values != Snapshot.State->Lists[Index].Values)
+        {
+            R.Reason = "Unchanged lists should share the snapshot's values";
+            return R;
+        }
+    }
+
+    ConThread Stepped;
+    Parser.Parse(Program, Stepped);
+    Stepped.RestoreSnapshot(Snapshot);
+    Thread.RestoreSnapshot(Snapshot);
+    Stepped.Step(3);
+    for (int32 Count = 0; Count < 3; ++Count)
+    {
+        Thread.StepLine();
+    }
+    if (!(CaptureEngineRun(Stepped) == CaptureEngineRun(Thread)) || Stepped.GetProgramCounter() != Thread.GetProgramCounter())
+    {
+        R.Reason = "Step(3) should match three StepLine calls";
+        return R;
+    }
+
+    ConThread Other;
+    Parser.Parse({"INCR X", "RET X"}, Other);
+    if (Other.RestoreSnapshot(Snapshot))
+    {
+        R.Reason = "A snapshot should not restore into a different program";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
+TestResult Test_SnapshotResumesDeadline()
+{
+    TestResult R;
+    R.Name = "Snapshots restored after the deadline get the time that was left";
+
+    // over 4096 lines after the pause, so the meter reads the clock again before the end
+    const std::vector<std::string> Program = {"SET Y 3000", "REDO IF Y", "  DECR Y", "RET Y"};
+    ConExecutionBudget Budget;
+    Budget.MaxDuration = std::chrono::milliseconds(200);
+
+    ConParser Parser;
+    ConThread Thread;
+    Parser.Parse(Program, Thread);
+    Thread.SetTraceEnabled(false);
+    Thread.SetExecutionBudget(Budget);
+    Thread.BeginRun();
+    Thread.RunUntil(2);
+    const ConThreadSnapshot Snapshot = Thread.CaptureSnapshot();
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+    ConThread Fork;
+    Parser.Parse(Program, Fork);
+    Fork.SetTraceEnabled(false);
+    if (!Fork.RestoreSnapshot(Snapshot))
+    {
+        R.Reason = "Restore failed";
+        return R;
+    }
+    while (Fork.StepLine() == ConStepResult::Running)
+    {
+    }
+    if (Fork.WasBudgetExhausted() || !Fork.HasReturnValue() || Fork.GetReturnValue() != 0)
+    {
+        R.Reason = "The time spent paused should not count against the restored run";
+        return R;
+    }
+
+    R.Passed = true;
+    return R;
+}
+
 } // namespace
 
 int main()
@@ -407,6 +2342,30 @@ int main()
     Results.push_back(Test_IfSingleVariableTruthy());
     Results.push_back(Test_IfnSingleVariableTruthy());
     Results.push_back(Test_RedoSingleVariableTruthy());
+    Results.push_back(Test_BytecodeMatchesTree());
+    Results.push_back(Test_ExecutedCycleCount());
+    Results.push_back(Test_ExecuteDoesNotAllocate());
+    Results.push_back(Test_ResetStateReusesThread());
+    Results.push_back(Test_ProgramSendListen());
+    Results.push_back(Test_ParallelRunnerIsDeterministic());
+    Results.push_back(Test_TraceRecorderMatchesLiveTrace());
+    Results.push_back(Test_RegisterFileSurvivesThreadMove());
+    Results.push_back(Test_ArenaOwnsParsedProgram());
+    Results.push_back(Test_BatchLanesMatchScalar());
+    Results.push_back(Test_SuperoptimizerFindsCheaperProgram());
+    Results.push_back(Test_OptimizedBytecodeMatchesPlain());
+    Results.push_back(Test_FusedBytecodeMatchesPlain());
+    Results.push_back(Test_LineProfileCountsExecution());
+    Results.push_back(Test_PuzzleLoaderAndCache());
+    Results.push_back(Test_BorrowedDatListsReadInPlace());
+    Results.push_back(Test_IncrementalParserMatchesFullParse());
+    Results.push_back(Test_ScannerBufferModeMatchesLines());
+    Results.push_back(Test_KeywordDispatchErrors());
+    Results.push_back(Test_VerifiedLinesFailWhenReached());
+    Results.push_back(Test_ExecutionBudgetStopsRunawayJump());
+    Results.push_back(Test_ExecutionBudgetsMatchAcrossEngines());
+    Results.push_back(Test_SnapshotForksRunningThread());
+    Results.push_back(Test_SnapshotResumesDeadline());
 
     int Passed = 0;
     int Failed = 0;
@@ -0,0 +1,96 @@
+// TraceTool.cpp – records binary execution traces and renders them offline.
+//
+// Usage:
+//   conch_trace <trace_file>
+//       prints the trace in the same format as the live debug trace
+//   conch_trace record <puzzle.json> <solution> <test_number> <trace_file>
+//       runs one puzzle test with a ConTraceRecorder streaming to trace_file
+
+#include "../TestApp/Puzzle.h"
+#include "../TestApp/TestRunner.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/Conchpiler/thread.h"
+#include "../src/Conchpiler/trace.h"
+
+namespace
+{
+
+void PrintUsage()
+{
+    std::cerr << "Usage: conch_trace <trace_file>\n"
+                 "       conch_trace record <puzzle.json> <solution> <test_number> <trace_file>\n";
+}
+
+int Decode(const std::string& Path)
+{
+    ConTraceLog Log;
+    std::string Error;
+    if (!ReadTraceFile(Path, Log, Error))
+    {
+        std::cerr << Error << "\n";
+        return 1;
+    }
+    RenderTrace(Log, std::cout);
+    return 0;
+}
+
+int Record(const std::string& PuzzlePath, const std::string& SolutionPath,
+           const std::string& TestNumber, const std::string& TracePath)
+{
+    PuzzleData Puzzle;
+    std::vector<std::string> Code;
+    std::string Error;
+    if (!LoadPuzzleFromFile(PuzzlePath, Puzzle, Error) || !LoadCodeFromFile(SolutionPath, Code, Error))
+    {
+        std::cerr << Error << "\n";
+        return 1;
+    }
+    const long Test = std::strtol(TestNumber.c_str(), nullptr, 10);
+    if (Test < 1 || static_cast<size_t>(Test) > Puzzle.Tests.size())
+    {
+        std::cerr << "Test number must be between 1 and " << Puzzle.Tests.size() << "\n";
+        return 1;
+    }
+
+    ConThread Thread;
+    int StaticCycles = 0;
+    std::vector<std::string> ParseErrors;
+    if (!ComputeStaticCycleCount(Code, Thread, StaticCycles, ParseErrors))
+    {
+        for (const std::string& E : ParseErrors) std::cerr << E << "\n";
+        return 1;
+    }
+
+    ConTraceRecorder Recorder;
+    if (!Recorder.OpenFile(TracePath, Error))
+    {
+        std::cerr << Error << "\n";
+        return 1;
+    }
+    Thread.SetTraceRecorder(&Recorder);
+    const TestCaseResult Result = RunTestCase(Puzzle.Tests[static_cast<size_t>(Test) - 1], Thread);
+    std::cerr << (Result.Passed() ? "PASS" : "FAIL") << " (" << Result.ExecutedCycles
+              << " cycles executed), trace written to " << TracePath << "\n";
+    return 0;
+}
+
+} // namespace
+
+int main(int Argc, char** Argv)
+{
+    if (Argc == 2)
+    {
+        return Decode(Argv[1]);
+    }
+    if (Argc == 6 && std::string(Argv[1]) == "record")
+    {
+        return Record(Argv[2], Argv[3], Argv[4], Argv[5]);
+    }
+    PrintUsage();
+    return 2;
+}
@@ -0,0 +1,136 @@
+#include "arena.h"
+
+#include <cstdlib>
+
+ConArena::ConArena(const size_t InBlockSize)
+    : BlockSize(InBlockSize)
+{
+}
+
+ConArena::~ConArena()
+{
+    RunDestructors();
+    FreeBlocks(Head);
+}
+
+ConArena::ConArena(ConArena&& Other) noexcept
+    : Head(Other.Head)
+    , Destructors(Other.Destructors)
+    , BlockSize(Other.BlockSize)
+    , BytesUsed(Other.BytesUsed)
+{
+    Other.Head = nullptr;
+    Other.Destructors = nullptr;
+    Other.BytesUsed = 0;
+}
+
+ConArena& ConArena::operator=(ConArena&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        RunDestructors();
+        FreeBlocks(Head);
+        Head = Other.Head;
+        Destructors = Other.Destructors;
+        BlockSize = Other.BlockSize;
+        BytesUsed = Other.BytesUsed;
+        Other.Head = nullptr;
+        Other.Destructors = nullptr;
+        Other.BytesUsed = 0;
+    }
+    return *this;
+}
+
+char* ConArena::BlockData(Block* const InBlock)
+{
+    return reinterpret_cast<char*>(InBlock) + BlockHeaderSize;
+}
+
+void* ConArena::Allocate(const size_t Size, const size_t Alignment)
+{
+    if (Head != nullptr)
+    {
+        const size_t Offset = (Head->Used + Alignment - 1) & ~(Alignment - 1);
+        if (Offset + Size <= Head->Size)
+        {
+            Head->Used = Offset + Size;
+            BytesUsed += Size;
+            return BlockData(Head) + Offset;
+        }
+    }
+
+    // oversized requests get a block of their own
+    const size_t DataSize = Size + Alignment > BlockSize ? Size + Alignment : BlockSize;
+    Block* NewBlock = static_cast<Block*>(std::malloc(BlockHeaderSize + DataSize));
+    if (NewBlock == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    NewBlock->Next = Head;
+    NewBlock->Size = DataSize;
+    NewBlock->Used = 0;
+    Head = NewBlock;
+    return Allocate(Size, Alignment);
+}
+
+void ConArena::Reset()
+{
+    RunDestructors();
+    if (Head == nullptr)
+    {
+        return;
+    }
+    // keep the oldest block, the one sized for a typical program
+    Block* Keep = Head;
+    Block* Rest = nullptr;
+    while (Keep->Next != nullptr)
+    {
+        Block* Next = Keep->Next;
+        Keep->Next = Rest;
+        Rest = Keep;
+        Keep = Next;
+    }
+    FreeBlocks(Rest);
+    Keep->Used = 0;
+    Head = Keep;
+    BytesUsed = 0;
+}
+
+size_t ConArena::GetBlockCount() const
+{
+    size_t Count = 0;
+    for (const Block* It = Head; It != nullptr; It = It->Next)
+    {
+        ++Count;
+    }
+    return Count;
+}
+
+void ConArena::AddDestructor(void* const Object, void (*Destroy)(void*))
+{
+    Destructor* Entry = static_cast<Destructor*>(Allocate(sizeof(Destructor), alignof(Destructor)));
+    Entry->Destroy = Destroy;
+    Entry->Object = Object;
+    Entry->Next = Destructors;
+    Destructors = Entry;
+}
+
+void ConArena::RunDestructors()
+{
+    // newest first, so objects go away in the reverse of their construction
+    for (Destructor* Entry = Destructors; Entry != nullptr; Entry = Entry->Next)
+    {
+        Entry->Destroy(Entry->Object);
+    }
+    Destructors = nullptr;
+}
+
+void ConArena::FreeBlocks(Block* First)
+{
+    while (First != nullptr)
+    {
+        Block* Next = First->Next;
+        std::free(First);
+        First = Next;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "common.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bump allocator for everything a parsed program owns. Objects are carved out of large
+// blocks and never freed individually; destroying or resetting the arena runs the
+// destructors that need running and releases the whole program at once.
+struct ConArena
+{
+    explicit ConArena(size_t InBlockSize = 4096);
+    ~ConArena();
+    ConArena(const ConArena&) = delete;
+    ConArena& operator=(const ConArena&) = delete;
+    ConArena(ConArena&& Other) noexcept;
+    ConArena& operator=(ConArena&& Other) noexcept;
+
+    template <typename T, typename... ArgTypes>
+    T* New(ArgTypes&&... Args)
+    {
+        T* Object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<ArgTypes>(Args)...);
+        if constexpr (!std::is_trivially_destructible<T>::value)
+        {
+            AddDestructor(Object, [](void* Ptr) { static_cast<T*>(Ptr)->~T(); });
+        }
+        return Object;
+    }
+
+    void* Allocate(size_t Size, size_t Alignment);
+    // destroys every object and keeps the first block for the next program
+    void Reset();
+    size_t GetBytesUsed() const { return BytesUsed; }
+    size_t GetBlockCount() const;
+
+private:
+    struct Block
+    {
+        Block* Next;
+        size_t Size;
+        size_t Used;
+    };
+    // block data starts after the header, aligned for any object type
+    static constexpr size_t BlockHeaderSize = (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    struct Destructor
+    {
+        void (*Destroy)(void*);
+        void* Object;
+        Destructor* Next;
+    };
+
+    void AddDestructor(void* Object, void (*Destroy)(void*));
+    void RunDestructors();
+    void FreeBlocks(Block* First);
+    static char* BlockData(Block* InBlock);
+
+    Block* Head = nullptr;
+    Destructor* Destructors = nullptr;
+    size_t BlockSize = 0;
+    size_t BytesUsed = 0;
+};
@@ -0,0 +1,52 @@
+#include "batch.h"
+
+#include <utility>
+
+void ConBatchState::Resize(const size_t InLaneCount, const size_t InRegisterCount, const size_t InListCount)
+{
+    LaneCount = InLaneCount;
+    RegisterCount = InRegisterCount;
+    ListCount = InListCount;
+    Values.assign(RegisterCount * LaneCount, 0);
+    Caches.assign(RegisterCount * LaneCount, 0);
+    Lists.resize(ListCount * LaneCount);
+    ExecutedCycles.assign(LaneCount, 0);
+    ReturnValues.assign(LaneCount, 0);
+    DidReturn.assign(LaneCount, 0);
+    ReturnHasValue.assign(LaneCount, 0);
+    Errors.assign(LaneCount, std::string());
+    BudgetLimits.assign(LaneCount, 0);
+    GroupSteps = 0;
+    LaneSteps = 0;
+}
+
+void ConBatchState::TruncateLanes(const size_t InLaneCount)
+{
+    if (InLaneCount >= LaneCount)
+    {
+        return;
+    }
+    // rows only ever move towards the front, so compacting in order never overwrites a lane
+    // before it is read
+    auto CompactRows = [this, InLaneCount](auto& Rows, const size_t RowCount)
+    {
+        for (size_t Row = 1; Row < RowCount; ++Row)
+        {
+            for (size_t Lane = 0; Lane < InLaneCount; ++Lane)
+            {
+                Rows[Row * InLaneCount + Lane] = std::move(Rows[Row * LaneCount + Lane]);
+            }
+        }
+        Rows.resize(RowCount * InLaneCount);
+    };
+    CompactRows(Values, RegisterCount);
+    CompactRows(Caches, RegisterCount);
+    CompactRows(Lists, ListCount);
+    LaneCount = InLaneCount;
+    ExecutedCycles.resize(LaneCount);
+    ReturnValues.resize(LaneCount);
+    DidReturn.resize(LaneCount);
+    ReturnHasValue.resize(LaneCount);
+    Errors.resize(LaneCount);
+    BudgetLimits.resize(LaneCount);
+}
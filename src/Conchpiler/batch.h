@@ -0,0 +1,47 @@
+#pragma once
+#include "budget.h"
+#include "common.h"
+#include "variable.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Machine state for running one compiled thread over many independent inputs in lockstep.
+// Every register and list is a row with one entry per lane, so Values[Register * LaneCount + Lane]
+// and Lists[List * LaneCount + Lane]. Lanes are filled from the thread with
+// ConThread::CaptureBatchLane, run together by ConThread::ExecuteBatch and copied back for
+// inspection with ConThread::RestoreBatchLane.
+struct ConBatchState
+{
+    void Resize(size_t InLaneCount, size_t InRegisterCount, size_t InListCount);
+    // drops every lane from InLaneCount on, keeping the lanes before it as they were captured
+    void TruncateLanes(size_t InLaneCount);
+
+    size_t LaneCount = 0;
+    size_t RegisterCount = 0;
+    size_t ListCount = 0;
+    std::vector<int32> Values;
+    std::vector<int32> Caches;
+    std::vector<ConVariableList> Lists;
+
+    // per-lane results of the last ExecuteBatch
+    std::vector<int32> ExecutedCycles;
+    std::vector<int32> ReturnValues;
+    std::vector<uint8_t> DidReturn;
+    std::vector<uint8_t> ReturnHasValue;
+    // the runtime error a lane stopped on, formatted as the scalar engine reports it; empty if none
+    std::vector<std::string> Errors;
+    // the ConBudgetLimit that stopped a lane, as its underlying value; 0 when none did
+    std::vector<uint8_t> BudgetLimits;
+    // instructions dispatched and lane-instructions run; LaneSteps / GroupSteps is the average
+    // number of lanes that shared each dispatch, LaneCount when no lane ever diverged
+    uint64_t GroupSteps = 0;
+    uint64_t LaneSteps = 0;
+
+    // scheduling scratch, kept so repeated batches reuse the storage
+    std::vector<int32> LanePcs;
+    std::vector<int32> LaneLoops;
+    std::vector<uint32_t> Group;
+    std::vector<ConBudgetMeter> Meters;
+};
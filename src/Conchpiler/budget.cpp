@@ -0,0 +1,104 @@
+#include "budget.h"
+
+#include <algorithm>
+#include <limits>
+
+const char* GetBudgetLimitName(const ConBudgetLimit Limit)
+{
+    switch (Limit)
+    {
+    case ConBudgetLimit::Steps:
+        return "steps";
+    case ConBudgetLimit::Cycles:
+        return "cycles";
+    case ConBudgetLimit::Deadline:
+        return "time";
+    default:
+        return "none";
+    }
+}
+
+void ConBudgetMeter::Begin(const ConExecutionBudget& InBudget, const int32 InStepCycleBound)
+{
+    Budget = InBudget;
+    StepCycleBound = std::max(InStepCycleBound, 1);
+    StepsUsed = 0;
+    Granted = 0;
+    Countdown = 0;
+    Exhausted = ConBudgetLimit::None;
+    if (Budget.MaxDuration > Budget.MaxDuration.zero())
+    {
+        Deadline = std::chrono::steady_clock::now() + Budget.MaxDuration;
+    }
+}
+
+bool ConBudgetMeter::Check(const int32 ExecutedCycles)
+{
+    if (Exhausted != ConBudgetLimit::None)
+    {
+        return false;
+    }
+    // the whole previous grant has run by the time its countdown reaches zero
+    StepsUsed += Granted;
+    Granted = 0;
+
+    uint64_t Next = std::numeric_limits<uint64_t>::max();
+    if (Budget.MaxSteps > 0)
+    {
+        if (StepsUsed >= Budget.MaxSteps)
+        {
+            Exhausted = ConBudgetLimit::Steps;
+            return false;
+        }
+        Next = std::min(Next, Budget.MaxSteps - StepsUsed);
+    }
+    if (Budget.MaxCycles > 0)
+    {
+        if (ExecutedCycles >= Budget.MaxCycles)
+        {
+            Exhausted = ConBudgetLimit::Cycles;
+            return false;
+        }
+        // no step in the grant can start at or past the limit, since each charges at most the bound
+        const uint64_t CyclesLeft = static_cast<uint64_t>(Budget.MaxCycles - ExecutedCycles);
+        Next = std::min(Next, std::max<uint64_t>(CyclesLeft / static_cast<uint64_t>(StepCycleBound), 1));
+    }
+    if (Budget.MaxDuration > Budget.MaxDuration.zero())
+    {
+        if (std::chrono::steady_clock::now() >= Deadline)
+        {
+            Exhausted = ConBudgetLimit::Deadline;
+            return false;
+        }
+        Next = std::min(Next, DeadlineCheckInterval);
+    }
+
+    // this step is the first of the grant
+    Granted = Next;
+    Countdown = Next - 1;
+    return true;
+}
+
+void ConBudgetMeter::Stop(const ConBudgetLimit Limit)
+{
+    Exhausted = Limit;
+    Countdown = 0;
+    Granted = 0;
+}
+
+std::chrono::steady_clock::duration ConBudgetMeter::GetRemainingDuration() const
+{
+    if (Budget.MaxDuration <= Budget.MaxDuration.zero())
+    {
+        return Budget.MaxDuration.zero();
+    }
+    return std::max(Deadline - std::chrono::steady_clock::now(), Budget.MaxDuration.zero());
+}
+
+void ConBudgetMeter::ResumeDeadline(const std::chrono::steady_clock::duration Remaining)
+{
+    if (Budget.MaxDuration > Budget.MaxDuration.zero())
+    {
+        Deadline = std::chrono::steady_clock::now() + Remaining;
+    }
+}
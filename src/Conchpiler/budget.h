@@ -0,0 +1,85 @@
+#pragma once
+#include "common.h"
+
+#include <chrono>
+#include <cstdint>
+
+// the limit of a ConExecutionBudget that stopped a run
+enum class ConBudgetLimit : uint8_t
+{
+    None,
+    Steps,
+    Cycles,
+    Deadline
+};
+
+// "steps", "cycles" or "time", for messages
+const char* GetBudgetLimitName(ConBudgetLimit Limit);
+
+// Limits for a single run; a zero field is no limit. A step is one source line on every engine,
+// and each batch lane counts its own steps, so a run stops on the same line whichever engine
+// runs it. A SEND or LSTN that blocks is not a step until it completes.
+struct ConExecutionBudget
+{
+    uint64_t MaxSteps = 0;
+    // executed cycles, as GetExecutedCycleCount reports them
+    int32 MaxCycles = 0;
+    // wall-clock deadline, measured from the start of each run
+    std::chrono::steady_clock::duration MaxDuration = std::chrono::steady_clock::duration::zero();
+
+    bool IsUnlimited() const { return MaxSteps == 0 && MaxCycles <= 0 && MaxDuration <= MaxDuration.zero(); }
+};
+
+// Amortized budget checks for a dispatch loop. Tick is a single decrement until the current
+// grant of steps runs out; Check then tests every limit and grants the next run of steps. Grants
+// are sized so no limit is overshot: a step is refused exactly when the step limit is used up or
+// the cycles before it already reach MaxCycles. The clock is read at most every
+// DeadlineCheckInterval steps, and not at all without a deadline.
+struct ConBudgetMeter
+{
+    static constexpr uint64_t DeadlineCheckInterval = 4096;
+
+    // StepCycleBound is the most cycles any one step can charge
+    void Begin(const ConExecutionBudget& Budget, int32 StepCycleBound);
+    // false when the grant is used up and Check must run before the next step
+    bool Tick()
+    {
+        if (Countdown == 0)
+        {
+            return false;
+        }
+        --Countdown;
+        return true;
+    }
+    // takes Steps steps at once if the grant covers them all; otherwise takes none
+    bool Tick(const uint64_t Steps)
+    {
+        if (Countdown < Steps)
+        {
+            return false;
+        }
+        Countdown -= Steps;
+        return true;
+    }
+    // gives back the step the last Tick or granting Check took, for a line that blocked
+    void Refund() { ++Countdown; }
+    // true grants the next step; false leaves the meter stopped on the limit that ran out
+    bool Check(int32 ExecutedCycles);
+    void Stop(ConBudgetLimit Limit);
+    // time left before the deadline, zero once it passed or without one; snapshots save this
+    // rather than the deadline itself so a paused run does not age while it waits
+    std::chrono::steady_clock::duration GetRemainingDuration() const;
+    // moves the deadline to Remaining from now, for a run resumed from a snapshot
+    void ResumeDeadline(std::chrono::steady_clock::duration Remaining);
+    ConBudgetLimit GetExhaustedLimit() const { return Exhausted; }
+    bool IsExhausted() const { return Exhausted != ConBudgetLimit::None; }
+
+private:
+    ConExecutionBudget Budget;
+    std::chrono::steady_clock::time_point Deadline;
+    int32 StepCycleBound = 1;
+    uint64_t StepsUsed = 0;
+    uint64_t Granted = 0;
+    uint64_t Countdown = 0;
+    ConBudgetLimit Exhausted = ConBudgetLimit::None;
+};
@@ -0,0 +1,747 @@
+#include "bytecode.h"
+
+#include "op.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace
+{
+bool IsBranch(const ConOpcode Opcode)
+{
+    return Opcode == ConOpcode::If || Opcode == ConOpcode::LoopHead || Opcode == ConOpcode::Redo || Opcode == ConOpcode::Jump;
+}
+
+bool FallsThrough(const ConInstruction& Inst)
+{
+    switch (Inst.Opcode)
+    {
+    case ConOpcode::Ret:
+    case ConOpcode::Trap:
+        return false;
+    case ConOpcode::Jump:
+        return Inst.bHasCondition || Inst.Target < 0;
+    default:
+        return true;
+    }
+}
+
+// whether executing the instruction can raise a runtime error and stop the thread
+bool CanFail(const ConInstruction& Inst)
+{
+    switch (Inst.Opcode)
+    {
+    case ConOpcode::Nop:
+    case ConOpcode::Swp:
+    case ConOpcode::Incr:
+    case ConOpcode::Decr:
+        return false;
+    case ConOpcode::Pop:
+    case ConOpcode::At:
+    case ConOpcode::Redo:
+    case ConOpcode::Trap:
+        return true;
+    default:
+        // list reads and OUT appends check bounds and sizes
+        return Inst.A.IsList() || Inst.B.IsList() || Inst.C.IsList();
+    }
+}
+
+// the outcome of a condition built only from literals; false if it depends on machine state
+bool TryEvaluateCondition(const ConInstruction& Inst, bool& bOutResult)
+{
+    bool Result = true;
+    switch (Inst.Condition)
+    {
+    case ConConditionOp::None:
+        if (!Inst.B.IsValid())
+        {
+            bOutResult = !Inst.bInvert;
+            return true;
+        }
+        if (!Inst.B.IsImmediate())
+        {
+            return false;
+        }
+        Result = Inst.B.Value != 0;
+        break;
+    case ConConditionOp::GTR:
+    case ConConditionOp::LSR:
+    case ConConditionOp::EQL:
+        if (!Inst.B.IsImmediate() || !Inst.C.IsImmediate())
+        {
+            return false;
+        }
+        Result = Inst.Condition == ConConditionOp::GTR ? Inst.B.Value > Inst.C.Value
+            : Inst.Condition == ConConditionOp::LSR ? Inst.B.Value < Inst.C.Value
+            : Inst.B.Value == Inst.C.Value;
+        break;
+    }
+    bOutResult = Inst.bInvert ? !Result : Result;
+    return true;
+}
+
+// arithmetic wraps exactly as the engines' int32 operations do on the supported targets
+bool TryFoldBinary(const ConOpcode Opcode, const int32 Lhs, const int32 Rhs, int32& OutValue)
+{
+    const uint32_t A = static_cast<uint32_t>(Lhs);
+    const uint32_t B = static_cast<uint32_t>(Rhs);
+    switch (Opcode)
+    {
+    case ConOpcode::Add: OutValue = static_cast<int32>(A + B); return true;
+    case ConOpcode::Sub: OutValue = static_cast<int32>(A - B); return true;
+    case ConOpcode::Mul: OutValue = static_cast<int32>(A * B); return true;
+    case ConOpcode::And: OutValue = Lhs & Rhs; return true;
+    case ConOpcode::Or: OutValue = Lhs | Rhs; return true;
+    case ConOpcode::Xor: OutValue = Lhs ^ Rhs; return true;
+    case ConOpcode::Div:
+        // left to the runtime, which behaves however the host does
+        if (Lhs == std::numeric_limits<int32>::min() && Rhs == -1)
+        {
+            return false;
+        }
+        OutValue = Rhs == 0 ? 0 : Lhs / Rhs;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void MakeNop(ConInstruction& Inst)
+{
+    ConInstruction Nop;
+    Nop.bEndsLine = Inst.bEndsLine;
+    Nop.Line = Inst.Line;
+    Nop.Steps = Inst.Steps;
+    Nop.Cycles = Inst.Cycles;
+    Nop.TailSteps = Inst.TailSteps;
+    Nop.TailCycles = Inst.TailCycles;
+    Inst = Nop;
+}
+
+void MakeUnconditional(ConInstruction& Inst)
+{
+    Inst.Opcode = ConOpcode::Jump;
+    Inst.Condition = ConConditionOp::None;
+    Inst.bHasCondition = false;
+    Inst.bInvert = false;
+    Inst.A = ConOperand();
+    Inst.B = ConOperand();
+    Inst.C = ConOperand();
+    Inst.Aux = -1;
+}
+
+// only for register destinations: a list destination keeps its opcode, since a SET that
+// overflows OUT reports a different error than the op it would replace
+void MakeImmediateSet(ConInstruction& Inst, const int32 Value)
+{
+    Inst.Opcode = ConOpcode::Set;
+    Inst.B.Kind = ConOperandKind::Immediate;
+    Inst.B.Value = Value;
+    Inst.C = ConOperand();
+}
+
+bool FoldConstants(ConBytecode& Code)
+{
+    bool bChanged = false;
+    for (size_t Index = 0; Index < Code.Instructions.size(); ++Index)
+    {
+        ConInstruction& Inst = Code.Instructions[Index];
+        bool bCondition = false;
+        int32 Value = 0;
+        switch (Inst.Opcode)
+        {
+        case ConOpcode::Add:
+        case ConOpcode::Sub:
+        case ConOpcode::Mul:
+        case ConOpcode::Div:
+        case ConOpcode::And:
+        case ConOpcode::Or:
+        case ConOpcode::Xor:
+            if (!Inst.A.IsList() && Inst.B.IsImmediate() && Inst.C.IsImmediate() &&
+                TryFoldBinary(Inst.Opcode, Inst.B.Value, Inst.C.Value, Value))
+            {
+                MakeImmediateSet(Inst, Value);
+                bChanged = true;
+            }
+            break;
+        case ConOpcode::Not:
+            if (!Inst.A.IsList() && Inst.B.IsImmediate())
+            {
+                MakeImmediateSet(Inst, ~Inst.B.Value);
+                bChanged = true;
+            }
+            break;
+        case ConOpcode::If:
+            if (TryEvaluateCondition(Inst, bCondition))
+            {
+                // a false IF always skips its body, a true one never does
+                bCondition ? MakeNop(Inst) : MakeUnconditional(Inst);
+                bChanged = true;
+            }
+            break;
+        case ConOpcode::Jump:
+            if (!Inst.bHasCondition)
+            {
+                if (Inst.Target < 0 || static_cast<size_t>(Inst.Target) == Index + 1)
+                {
+                    MakeNop(Inst);
+                    bChanged = true;
+                }
+            }
+            else if (TryEvaluateCondition(Inst, bCondition))
+            {
+                bCondition ? MakeUnconditional(Inst) : MakeNop(Inst);
+                bChanged = true;
+            }
+            break;
+        case ConOpcode::LoopHead:
+            // a loop entered unconditionally; a skipped one also resets its REDO counter, so stays
+            if (!Inst.bHasCondition || (TryEvaluateCondition(Inst, bCondition) && bCondition))
+            {
+                MakeNop(Inst);
+                bChanged = true;
+            }
+            break;
+        case ConOpcode::Redo:
+            // a REDO that never loops never touches its iteration counter either
+            if (!Inst.A.IsRegister() &&
+                ((!Inst.bHasCondition && Inst.Aux == 0) ||
+                 (Inst.bHasCondition && TryEvaluateCondition(Inst, bCondition) && !bCondition)))
+            {
+                MakeNop(Inst);
+                bChanged = true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return bChanged;
+}
+
+// drops every instruction whose Keep entry is false and relinks branches to the next survivor
+void Compact(ConBytecode& Code, const std::vector<bool>& Keep)
+{
+    const size_t Count = Code.Instructions.size();
+    std::vector<int32> NewIndex(Count + 1, 0);
+    int32 Next = 0;
+    for (size_t Index = 0; Index < Count; ++Index)
+    {
+        NewIndex[Index] = Next;
+        Next += Keep[Index] ? 1 : 0;
+    }
+    NewIndex[Count] = Next;
+
+    size_t Out = 0;
+    for (size_t Index = 0; Index < Count; ++Index)
+    {
+        if (!Keep[Index])
+        {
+            continue;
+        }
+        ConInstruction& Inst = Code.Instructions[Index];
+        if (IsBranch(Inst.Opcode) && Inst.Target >= 0)
+        {
+            Inst.Target = NewIndex[static_cast<size_t>(Inst.Target)];
+        }
+        Code.Instructions[Out] = Inst;
+        Code.Locations[Out] = Code.Locations[Index];
+        if (!Code.MergedLines.empty() && Out != Index)
+        {
+            Code.MergedLines[Out] = std::move(Code.MergedLines[Index]);
+        }
+        ++Out;
+    }
+    Code.Instructions.resize(Out);
+    Code.Locations.resize(Out);
+    if (!Code.MergedLines.empty())
+    {
+        Code.MergedLines.resize(Out);
+    }
+    for (int32& Start : Code.LineStart)
+    {
+        Start = NewIndex[static_cast<size_t>(Start)];
+    }
+}
+
+bool RemoveUnreachable(ConBytecode& Code)
+{
+    const size_t Count = Code.Instructions.size();
+    std::vector<bool> Reached(Count, false);
+    std::vector<size_t> Pending;
+    if (Count > 0)
+    {
+        Reached[0] = true;
+        Pending.push_back(0);
+    }
+    auto Visit = [&](const int32 Index)
+    {
+        if (Index >= 0 && static_cast<size_t>(Index) < Count && !Reached[static_cast<size_t>(Index)])
+        {
+            Reached[static_cast<size_t>(Index)] = true;
+            Pending.push_back(static_cast<size_t>(Index));
+        }
+    };
+    while (!Pending.empty())
+    {
+        const size_t Index = Pending.back();
+        Pending.pop_back();
+        const ConInstruction& Inst = Code.Instructions[Index];
+        if (FallsThrough(Inst))
+        {
+            Visit(static_cast<int32>(Index + 1));
+        }
+        if (IsBranch(Inst.Opcode))
+        {
+            Visit(Inst.Target);
+        }
+    }
+    if (std::find(Reached.begin(), Reached.end(), false) == Reached.end())
+    {
+        return false;
+    }
+    Compact(Code, Reached);
+    return true;
+}
+
+// the cost of each line an instruction charges before it runs, or after it with bTail
+std::vector<int32> ListChargedLines(const ConBytecode& Code, const size_t Index, const bool bTail)
+{
+    const ConInstruction& Inst = Code.Instructions[Index];
+    std::vector<int32> Costs;
+    for (int32 Step = 0; Step < (bTail ? Inst.TailSteps : Inst.Steps); ++Step)
+    {
+        Costs.push_back(Code.GetLineCycles(Index, bTail, Step));
+    }
+    return Costs;
+}
+
+// moves the lines the Nop at Index charges onto Into: ahead of Into's own lines, or with bTail
+// after Into has run, so each line is still charged and budget-checked where it used to be
+void MergeNopLines(ConBytecode& Code, const size_t Index, const size_t Into, const bool bTail)
+{
+    std::vector<int32> Moved = ListChargedLines(Code, Index, false);
+    const std::vector<int32> NopTail = ListChargedLines(Code, Index, true);
+    Moved.insert(Moved.end(), NopTail.begin(), NopTail.end());
+    if (Moved.empty())
+    {
+        return;
+    }
+    std::vector<int32> Kept = ListChargedLines(Code, Into, bTail);
+    if (Code.MergedLines.empty())
+    {
+        Code.MergedLines.resize(Code.Instructions.size());
+    }
+    ConInstruction& Target = Code.Instructions[Into];
+    if (bTail)
+    {
+        Kept.insert(Kept.end(), Moved.begin(), Moved.end());
+        Target.TailSteps = static_cast<int32>(Kept.size());
+        Target.TailCycles += Code.Instructions[Index].Cycles + Code.Instructions[Index].TailCycles;
+        Code.MergedLines[Into].After = std::move(Kept);
+    }
+    else
+    {
+        Moved.insert(Moved.end(), Kept.begin(), Kept.end());
+        Target.Steps = static_cast<int32>(Moved.size());
+        Target.Cycles += Code.Instructions[Index].Cycles + Code.Instructions[Index].TailCycles;
+        Code.MergedLines[Into].Before = std::move(Moved);
+    }
+}
+
+// Removes Nops whose cycles can ride on a neighbour: the next instruction when this Nop is its
+// only way in, or the previous one when that always falls into this Nop and cannot fail. Nops
+// next to each other are left for the following round so each merge sees settled neighbours.
+bool RemoveNops(ConBytecode& Code)
+{
+    const size_t Count = Code.Instructions.size();
+    std::vector<int32> Predecessors(Count + 1, 0);
+    if (Count > 0)
+    {
+        ++Predecessors[0];
+    }
+    for (size_t Index = 0; Index < Count; ++Index)
+    {
+        const ConInstruction& Inst = Code.Instructions[Index];
+        if (FallsThrough(Inst))
+        {
+            ++Predecessors[Index + 1];
+        }
+        if (IsBranch(Inst.Opcode) && Inst.Target >= 0)
+        {
+            ++Predecessors[static_cast<size_t>(Inst.Target)];
+        }
+    }
+
+    std::vector<bool> Keep(Count, true);
+    bool bChanged = false;
+    for (size_t Index = 0; Index < Count; ++Index)
+    {
+        ConInstruction& Inst = Code.Instructions[Index];
+        if (Inst.Opcode != ConOpcode::Nop || (Index > 0 && !Keep[Index - 1]))
+        {
+            continue;
+        }
+        if (Index + 1 < Count && Predecessors[Index + 1] == 1)
+        {
+            MergeNopLines(Code, Index, Index + 1, false);
+        }
+        else if (Index > 0 && Predecessors[Index] == 1 && !IsBranch(Code.Instructions[Index - 1].Opcode) &&
+                 FallsThrough(Code.Instructions[Index - 1]) && !CanFail(Code.Instructions[Index - 1]))
+        {
+            MergeNopLines(Code, Index, Index - 1, true);
+        }
+        else
+        {
+            continue;
+        }
+        Keep[Index] = false;
+        bChanged = true;
+    }
+    if (bChanged)
+    {
+        Compact(Code, Keep);
+    }
+    return bChanged;
+}
+} // namespace
+
+void ConBytecode::Clear()
+{
+    Instructions.clear();
+    Locations.clear();
+    Traps.clear();
+    LineStart.clear();
+    MergedLines.clear();
+    bOptimized = false;
+}
+
+void ConBytecode::AssignLineCycles(const vector<ConLine>& Lines)
+{
+    for (size_t Index = 0; Index < Lines.size() && Index + 1 < LineStart.size(); ++Index)
+    {
+        ConInstruction& Inst = Instructions[static_cast<size_t>(LineStart[Index])];
+        Inst.Steps = 1;
+        Inst.Cycles = Lines[Index].GetCycleCount();
+    }
+}
+
+int32 ConBytecode::GetLineCycles(const size_t Index, const bool bTail, const int32 Step) const
+{
+    const ConInstruction& Inst = Instructions[Index];
+    if ((bTail ? Inst.TailSteps : Inst.Steps) == 1)
+    {
+        return bTail ? Inst.TailCycles : Inst.Cycles;
+    }
+    const ConMergedLines& Merged = MergedLines[Index];
+    return (bTail ? Merged.After : Merged.Before)[static_cast<size_t>(Step)];
+}
+
+ConBytecodeBuilder::ConBytecodeBuilder(const vector<ConVariableCached*>& InRegisters, const vector<ConVariableList*>& InLists, ConBytecode& InOut)
+    : Out(InOut)
+{
+    for (size_t Index = 0; Index < InRegisters.size(); ++Index)
+    {
+        if (InRegisters[Index] != nullptr)
+        {
+            RegisterIndex[InRegisters[Index]] = InRegisters[Index]->GetIndex();
+        }
+    }
+    for (size_t Index = 0; Index < InLists.size(); ++Index)
+    {
+        if (InLists[Index] != nullptr)
+        {
+            ListIndex[InLists[Index]] = static_cast<int32>(Index);
+        }
+    }
+}
+
+void ConBytecodeBuilder::Build(const vector<ConLine>& Lines)
+{
+    Out.Clear();
+    Out.LineStart.reserve(Lines.size() + 1);
+    for (size_t Index = 0; Index < Lines.size(); ++Index)
+    {
+        CurrentLine = static_cast<int32>(Index);
+        Out.LineStart.push_back(static_cast<int32>(Out.Instructions.size()));
+        BuildLine(Lines[Index], CurrentLine);
+    }
+    Out.LineStart.push_back(static_cast<int32>(Out.Instructions.size()));
+    Link(static_cast<int32>(Lines.size()));
+    Out.AssignLineCycles(Lines);
+}
+
+ConOperand ConBytecodeBuilder::Resolve(const VariableRef& Ref) const
+{
+    ConOperand Operand;
+    if (!Ref.IsValid())
+    {
+        return Operand;
+    }
+    switch (Ref.GetKind())
+    {
+    case VariableKind::Thread:
+    case VariableKind::Cache:
+    {
+        auto It = RegisterIndex.find(Ref.GetThreadOwner());
+        if (It != RegisterIndex.end())
+        {
+            Operand.Kind = Ref.IsThread() ? ConOperandKind::Register : ConOperandKind::Cache;
+            Operand.Value = It->second;
+        }
+        break;
+    }
+    case VariableKind::List:
+    {
+        auto It = ListIndex.find(Ref.GetList());
+        if (It != ListIndex.end())
+        {
+            Operand.Kind = ConOperandKind::List;
+            Operand.Value = It->second;
+        }
+        break;
+    }
+    case VariableKind::Literal:
+        // literals are never written after parsing, so the value can be baked in
+        Operand.Kind = ConOperandKind::Immediate;
+        Operand.Value = Ref.Read();
+        break;
+    }
+    return Operand;
+}
+
+void ConBytecodeBuilder::Emit(ConInstruction Inst, const ConSourceLocation& Location)
+{
+    Inst.Line = CurrentLine;
+    Out.Instructions.push_back(Inst);
+    Out.Locations.push_back(Location);
+}
+
+void ConBytecodeBuilder::EmitTrap(const ConSourceLocation& Location, const std::string& Message)
+{
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::Trap;
+    Inst.A.Kind = ConOperandKind::Immediate;
+    Inst.A.Value = static_cast<int32>(Out.Traps.size());
+    Out.Traps.push_back({Location, Message});
+    Emit(Inst, Location);
+}
+
+void ConBytecodeBuilder::EmitCondition(ConInstruction& Inst, const ConLine& Line)
+{
+    Inst.Condition = Line.GetCondition();
+    Inst.bHasCondition = Line.HasCondition();
+    Inst.bInvert = Line.IsInverted();
+    Inst.B = Resolve(Line.GetLeft());
+    Inst.C = Resolve(Line.GetRight());
+}
+
+void ConBytecodeBuilder::BuildLine(const ConLine& Line, const int32 LineIndex)
+{
+    const ConSourceLocation& Location = Line.GetLocation();
+
+    // mirrors the checks ConLine::EvaluateCondition performs on every evaluation
+    auto TrapInvalidCondition = [&](bool bEvaluated) -> bool
+    {
+        if (!bEvaluated)
+        {
+            return false;
+        }
+        if (Line.GetCondition() == ConConditionOp::None)
+        {
+            if (!Line.GetLeft().IsValid())
+            {
+                if (Line.GetKind() == ConLineKind::If)
+                {
+                    EmitTrap(Location, "Single-operand IF requires an operand");
+                    return true;
+                }
+                return false;
+            }
+            if (!Resolve(Line.GetLeft()).IsValid())
+            {
+                EmitTrap(Location, "Condition operand is not owned by this thread");
+                return true;
+            }
+            return false;
+        }
+        if (!Line.GetLeft().IsValid() || !Line.GetRight().IsValid())
+        {
+            EmitTrap(Location, "Condition requires two operands");
+            return true;
+        }
+        if (!Resolve(Line.GetLeft()).IsValid() || !Resolve(Line.GetRight()).IsValid())
+        {
+            EmitTrap(Location, "Condition operand is not owned by this thread");
+            return true;
+        }
+        return false;
+    };
+
+    switch (Line.GetKind())
+    {
+    case ConLineKind::Ops:
+    {
+        const size_t FirstInstruction = Out.Instructions.size();
+        for (const ConBaseOp* Op : Line.GetOps())
+        {
+            Op->Lower(*this);
+        }
+        if (Out.Instructions.size() == FirstInstruction)
+        {
+            ConInstruction Inst;
+            Inst.Opcode = ConOpcode::Nop;
+            Emit(Inst, Location);
+        }
+        Out.Instructions.back().bEndsLine = true;
+        break;
+    }
+    case ConLineKind::If:
+    {
+        if (TrapInvalidCondition(true))
+        {
+            break;
+        }
+        ConInstruction Inst;
+        Inst.Opcode = ConOpcode::If;
+        EmitCondition(Inst, Line);
+        Inst.Target = LineIndex + Line.GetSkipCount() + 1;
+        Inst.bEndsLine = true;
+        Emit(Inst, Location);
+        break;
+    }
+    case ConLineKind::Loop:
+    {
+        if (TrapInvalidCondition(Line.HasCondition()))
+        {
+            break;
+        }
+        ConInstruction Inst;
+        Inst.Opcode = ConOpcode::LoopHead;
+        EmitCondition(Inst, Line);
+        Inst.Target = Line.GetLoopExitIndex();
+        Inst.Aux = Line.GetLoopExitIndex() > 0 ? Line.GetLoopExitIndex() - 1 : -1;
+        Inst.bEndsLine = true;
+        Emit(Inst, Location);
+        break;
+    }
+    case ConLineKind::Redo:
+    {
+        if (TrapInvalidCondition(!Line.HasCounter() && Line.HasCondition()))
+        {
+            break;
+        }
+        ConInstruction Inst;
+        Inst.Opcode = ConOpcode::Redo;
+        EmitCondition(Inst, Line);
+        Inst.Aux = Line.IsInfiniteLoop() ? 1 : 0;
+        if (Line.HasCounter())
+        {
+            // a counter that is not a thread variable never loops, regardless of the condition
+            Inst.A = Resolve(Line.GetCounter());
+            if (!Inst.A.IsRegister())
+            {
+                Inst.A = ConOperand();
+                Inst.bHasCondition = false;
+                Inst.Aux = 0;
+            }
+        }
+        Inst.Target = Line.GetTargetIndex();
+        Inst.bEndsLine = true;
+        Emit(Inst, Location);
+        break;
+    }
+    case ConLineKind::Jump:
+    {
+        if (TrapInvalidCondition(Line.HasCondition()))
+        {
+            break;
+        }
+        ConInstruction Inst;
+        Inst.Opcode = ConOpcode::Jump;
+        EmitCondition(Inst, Line);
+        Inst.Target = Line.GetTargetIndex();
+        Inst.bEndsLine = true;
+        Emit(Inst, Location);
+        break;
+    }
+    case ConLineKind::Return:
+    {
+        ConInstruction Inst;
+        Inst.Opcode = ConOpcode::Ret;
+        if (Line.HasReturnValue())
+        {
+            Inst.A = Resolve(Line.GetReturnValue());
+            if (!Inst.A.IsValid())
+            {
+                EmitTrap(Location, "RET argument is invalid");
+                break;
+            }
+        }
+        Inst.bEndsLine = true;
+        Emit(Inst, Location);
+        break;
+    }
+    case ConLineKind::Send:
+        // mailboxes only exist while a ConProgram steps the thread line by line
+        EmitTrap(Location, "SEND requires a multi-thread program");
+        break;
+    case ConLineKind::Listen:
+        EmitTrap(Location, "LSTN requires a multi-thread program");
+        break;
+    default:
+    {
+        ConInstruction Inst;
+        Inst.Opcode = ConOpcode::Nop;
+        Inst.bEndsLine = true;
+        Emit(Inst, Location);
+        break;
+    }
+    }
+}
+
+void ConBytecodeBuilder::Link(const int32 LineCount)
+{
+    const int32 End = Out.LineStart.back();
+    auto ToInstruction = [&](int32 LineIndex) -> int32
+    {
+        if (LineIndex < 0)
+        {
+            return -1;
+        }
+        if (LineIndex >= LineCount)
+        {
+            return End;
+        }
+        return Out.LineStart[static_cast<size_t>(LineIndex)];
+    };
+
+    for (ConInstruction& Inst : Out.Instructions)
+    {
+        switch (Inst.Opcode)
+        {
+        case ConOpcode::If:
+        case ConOpcode::LoopHead:
+        case ConOpcode::Redo:
+        case ConOpcode::Jump:
+            Inst.Target = ToInstruction(Inst.Target);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void OptimizeBytecode(ConBytecode& Code)
+{
+    bool bChanged = true;
+    while (bChanged)
+    {
+        bChanged = FoldConstants(Code);
+        bChanged = RemoveUnreachable(Code) || bChanged;
+        bChanged = RemoveNops(Code) || bChanged;
+    }
+    Code.bOptimized = true;
+}
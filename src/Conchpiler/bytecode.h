@@ -0,0 +1,167 @@
+#pragma once
+#include "common.h"
+#include "line.h"
+#include "variable.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class ConOpcode : unsigned char
+{
+    Nop,
+    Set,
+    Swp,
+    Incr,
+    Decr,
+    Not,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    And,
+    Or,
+    Xor,
+    Pop,
+    At,
+    If,
+    LoopHead,
+    Redo,
+    Jump,
+    Ret,
+    Trap,
+    // fused pairs, only produced by FuseBytecode
+    PopRedo,
+    RedoLoop,
+    SetPop,
+    PopLoop
+};
+
+// opcodes the builder emits; fused opcodes (see fusion.h) are numbered after these
+constexpr size_t ConOpcodeBaseCount = static_cast<size_t>(ConOpcode::Trap) + 1;
+
+// the opcode a fused instruction started out as
+constexpr ConOpcode GetBaseOpcode(const ConOpcode Opcode)
+{
+    switch (Opcode)
+    {
+    case ConOpcode::PopRedo: return ConOpcode::Pop;
+    case ConOpcode::RedoLoop: return ConOpcode::Redo;
+    case ConOpcode::SetPop: return ConOpcode::Set;
+    case ConOpcode::PopLoop: return ConOpcode::Pop;
+    default: return Opcode;
+    }
+}
+
+enum class ConOperandKind : unsigned char
+{
+    None,
+    Register,
+    Cache,
+    List,
+    Immediate
+};
+
+// register file index, list index or immediate value depending on Kind
+struct ConOperand
+{
+    ConOperandKind Kind = ConOperandKind::None;
+    int32 Value = 0;
+
+    bool IsValid() const { return Kind != ConOperandKind::None; }
+    bool IsRegister() const { return Kind == ConOperandKind::Register; }
+    bool IsList() const { return Kind == ConOperandKind::List; }
+    bool IsImmediate() const { return Kind == ConOperandKind::Immediate; }
+};
+
+// A is the destination (or the single operand), B and C are sources or the condition operands.
+// Target holds an instruction index once the program is linked; -1 falls through.
+// Aux is the paired REDO line for LoopHead and the infinite-loop flag for Redo.
+// Steps counts the source lines that start right before the instruction runs and Cycles is
+// their cost: one line on its first instruction in a plain build, none mid-line, and more once
+// OptimizeBytecode merges Nop lines into it. TailSteps and TailCycles are lines merged in after
+// an instruction that always falls through, charged once it has run. Execution budgets are
+// checked before each of these lines, so every engine stops on the same line.
+struct ConInstruction
+{
+    ConOpcode Opcode = ConOpcode::Nop;
+    ConConditionOp Condition = ConConditionOp::None;
+    bool bHasCondition = false;
+    bool bInvert = false;
+    bool bEndsLine = false;
+    ConOperand A;
+    ConOperand B;
+    ConOperand C;
+    int32 Target = -1;
+    int32 Aux = -1;
+    int32 Line = 0;
+    int32 Steps = 0;
+    int32 Cycles = 0;
+    int32 TailSteps = 0;
+    int32 TailCycles = 0;
+};
+
+// the cost of each line merged into an instruction, in the order the lines ran
+struct ConMergedLines
+{
+    std::vector<int32> Before;
+    std::vector<int32> After;
+};
+
+struct ConBytecodeTrap
+{
+    ConSourceLocation Location;
+    std::string Message;
+};
+
+struct ConBytecode
+{
+    std::vector<ConInstruction> Instructions;
+    // parallel to Instructions, only read when reporting errors
+    std::vector<ConSourceLocation> Locations;
+    std::vector<ConBytecodeTrap> Traps;
+    // first instruction of every line, plus one entry for the end of the program
+    std::vector<int32> LineStart;
+    // parallel to Instructions once OptimizeBytecode has merged a line, otherwise empty; only
+    // read when a budget check falls between the lines an instruction carries
+    std::vector<ConMergedLines> MergedLines;
+    // set by OptimizeBytecode; lines may then share or lose instructions, so per-line
+    // cycles can no longer be reassigned and the program must be rebuilt instead
+    bool bOptimized = false;
+
+    void Clear();
+    bool IsEmpty() const { return LineStart.empty(); }
+    // copies each line's cycle cost onto its first instruction
+    void AssignLineCycles(const vector<ConLine>& Lines);
+    // the cost of the Step-th line charged before (or, with bTail, after) an instruction
+    int32 GetLineCycles(size_t Index, bool bTail, int32 Step) const;
+};
+
+// Folds literal operands and conditions, drops unreachable instructions and removes Nops.
+// Registers, lists, return values, runtime errors and executed cycles all come out exactly
+// as before: a Nop only goes away when a neighbour that always runs with it can carry its
+// lines, which are still charged and budget-checked one by one. Traces of the result skip the
+// lines that were removed.
+void OptimizeBytecode(ConBytecode& Code);
+
+// Lowers the ConLine tree into a flat instruction array with resolved operands.
+struct ConBytecodeBuilder
+{
+    ConBytecodeBuilder(const vector<ConVariableCached*>& InRegisters, const vector<ConVariableList*>& InLists, ConBytecode& InOut);
+
+    void Build(const vector<ConLine>& Lines);
+
+    ConOperand Resolve(const VariableRef& Ref) const;
+    void Emit(ConInstruction Inst, const ConSourceLocation& Location);
+    void EmitTrap(const ConSourceLocation& Location, const std::string& Message);
+
+private:
+    void BuildLine(const ConLine& Line, int32 LineIndex);
+    void EmitCondition(ConInstruction& Inst, const ConLine& Line);
+    void Link(int32 LineCount);
+
+    std::unordered_map<const ConVariableCached*, int32> RegisterIndex;
+    std::unordered_map<const ConVariableList*, int32> ListIndex;
+    ConBytecode& Out;
+    int32 CurrentLine = 0;
+};
@@ -20,15 +20,13 @@ inline std::string FormatErrorMessage(const ConSourceLocation& Location, const s
 
 struct ConParseError : public std::runtime_error
 {
-    ConParseError(const Token& InToken, const std::string& InMessage)
+    ConParseError(const ConTokenView& InToken, const std::string& InMessage)
         : std::runtime_error(InMessage)
-        , TokenInfo(InToken)
     {
         Location.Line = InToken.Line;
         Location.Column = InToken.Column;
     }
 
-    Token TokenInfo;
     ConSourceLocation Location;
 };
 
@@ -0,0 +1,122 @@
+#include "fusion.h"
+
+#include <algorithm>
+
+const char* GetOpcodeName(const ConOpcode Opcode)
+{
+    switch (Opcode)
+    {
+    case ConOpcode::Nop: return "Nop";
+    case ConOpcode::Set: return "Set";
+    case ConOpcode::Swp: return "Swp";
+    case ConOpcode::Incr: return "Incr";
+    case ConOpcode::Decr: return "Decr";
+    case ConOpcode::Not: return "Not";
+    case ConOpcode::Add: return "Add";
+    case ConOpcode::Sub: return "Sub";
+    case ConOpcode::Mul: return "Mul";
+    case ConOpcode::Div: return "Div";
+    case ConOpcode::And: return "And";
+    case ConOpcode::Or: return "Or";
+    case ConOpcode::Xor: return "Xor";
+    case ConOpcode::Pop: return "Pop";
+    case ConOpcode::At: return "At";
+    case ConOpcode::If: return "If";
+    case ConOpcode::LoopHead: return "LoopHead";
+    case ConOpcode::Redo: return "Redo";
+    case ConOpcode::Jump: return "Jump";
+    case ConOpcode::Ret: return "Ret";
+    case ConOpcode::Trap: return "Trap";
+    case ConOpcode::PopRedo: return "PopRedo";
+    case ConOpcode::RedoLoop: return "RedoLoop";
+    case ConOpcode::SetPop: return "SetPop";
+    case ConOpcode::PopLoop: return "PopLoop";
+    }
+    return "?";
+}
+
+void ConOpcodePairProfile::AddRun(const ConBytecode& Code, const ConTraceLog& Log)
+{
+    const size_t LineCount = Code.LineStart.empty() ? 0 : Code.LineStart.size() - 1;
+    bool bHasPrevious = false;
+    size_t Previous = 0;
+    for (const ConTraceRecord& Record : Log.Records)
+    {
+        if (Record.Kind != ConTraceRecordKind::Line || Record.LineIndex < 0 || static_cast<size_t>(Record.LineIndex) >= LineCount)
+        {
+            continue;
+        }
+        // every instruction of a line runs in order before the line is recorded
+        const size_t First = static_cast<size_t>(Code.LineStart[static_cast<size_t>(Record.LineIndex)]);
+        const size_t Last = static_cast<size_t>(Code.LineStart[static_cast<size_t>(Record.LineIndex) + 1]);
+        for (size_t Index = First; Index < Last; ++Index)
+        {
+            const size_t Current = static_cast<size_t>(Code.Instructions[Index].Opcode);
+            if (bHasPrevious && Previous < ConOpcodeBaseCount && Current < ConOpcodeBaseCount)
+            {
+                ++Counts[Previous][Current];
+                ++Total;
+            }
+            Previous = Current;
+            bHasPrevious = true;
+        }
+    }
+}
+
+std::vector<ConOpcodePairProfile::Entry> ConOpcodePairProfile::GetSortedEntries() const
+{
+    std::vector<Entry> Entries;
+    for (size_t First = 0; First < ConOpcodeBaseCount; ++First)
+    {
+        for (size_t Second = 0; Second < ConOpcodeBaseCount; ++Second)
+        {
+            if (Counts[First][Second] > 0)
+            {
+                Entries.push_back({static_cast<ConOpcode>(First), static_cast<ConOpcode>(Second), Counts[First][Second]});
+            }
+        }
+    }
+    std::stable_sort(Entries.begin(), Entries.end(), [](const Entry& A, const Entry& B) { return A.Count > B.Count; });
+    return Entries;
+}
+
+// The four most frequent pairs in conch_bench --profile over the puzzle corpus (222 pairs), all
+// from the loop tail: Pop->Redo 15.3%, Redo->LoopHead 13.1% (the REDO jumping back to its
+// head), then Set->Pop and Pop->LoopHead at 5.4% each. Nothing else reaches 5%.
+void FuseBytecode(ConBytecode& Code)
+{
+    std::vector<ConInstruction>& Instructions = Code.Instructions;
+    const size_t Count = Instructions.size();
+    // RedoLoop first: the Pop->Redo and Set->Pop handlers look at what they fall into
+    for (ConInstruction& Inst : Instructions)
+    {
+        if (Inst.Opcode == ConOpcode::Redo && Inst.Target >= 0 && static_cast<size_t>(Inst.Target) < Count &&
+            Instructions[static_cast<size_t>(Inst.Target)].Opcode == ConOpcode::LoopHead)
+        {
+            Inst.Opcode = ConOpcode::RedoLoop;
+        }
+    }
+    for (size_t Index = 0; Index + 1 < Count; ++Index)
+    {
+        ConInstruction& Inst = Instructions[Index];
+        const ConOpcode Next = GetBaseOpcode(Instructions[Index + 1].Opcode);
+        // the handlers charge lines only ahead of each half, so neither may carry lines after it
+        if (Inst.TailSteps != 0 || Instructions[Index + 1].TailSteps != 0)
+        {
+            continue;
+        }
+        if (Inst.Opcode == ConOpcode::Pop && Next == ConOpcode::Redo)
+        {
+            Inst.Opcode = ConOpcode::PopRedo;
+        }
+        else if (Inst.Opcode == ConOpcode::Set && Next == ConOpcode::Pop)
+        {
+            Inst.Opcode = ConOpcode::SetPop;
+        }
+        // the POP ahead of a loop that tests the popped value
+        else if (Inst.Opcode == ConOpcode::Pop && Next == ConOpcode::LoopHead)
+        {
+            Inst.Opcode = ConOpcode::PopLoop;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "common.h"
+#include "bytecode.h"
+#include "trace.h"
+
+#include <cstdint>
+#include <vector>
+
+const char* GetOpcodeName(ConOpcode Opcode);
+
+// How often each opcode ran straight after another, rebuilt from recorded runs of the plain
+// bytecode. conch_bench --profile prints this table for the puzzle corpus; the pairs
+// FuseBytecode fuses are the ones that dominate it.
+struct ConOpcodePairProfile
+{
+    struct Entry
+    {
+        ConOpcode First = ConOpcode::Nop;
+        ConOpcode Second = ConOpcode::Nop;
+        uint64_t Count = 0;
+    };
+
+    // Code must be the unoptimized bytecode the log was recorded from
+    void AddRun(const ConBytecode& Code, const ConTraceLog& Log);
+    // every pair that occurred, most frequent first
+    std::vector<Entry> GetSortedEntries() const;
+    uint64_t GetTotal() const { return Total; }
+
+private:
+    uint64_t Counts[ConOpcodeBaseCount][ConOpcodeBaseCount] = {};
+    uint64_t Total = 0;
+};
+
+// Rewrites the first instruction of each frequent pair into a fused opcode that also runs the
+// instruction after it, saving a dispatch. The second instruction stays in place, so branches
+// into it and error locations are unaffected, and the lines ahead of the second half are still
+// charged and budget-checked before it runs; the batch engine runs fused opcodes as their first
+// half. Pairs where either half carries lines after it are left alone. Only applied to
+// bytecode that is never traced.
+void FuseBytecode(ConBytecode& Code);
@@ -104,14 +104,20 @@ void ConLine::UpdateCycleCount(const int32 VarCount)
         AddCycles(1 + VarCount * ThreadTouches);
         break;
     }
+    case ConLineKind::Send:
+        AddCycles(1 + (ChannelOperand.TouchesThread() ? VarCount : 0));
+        break;
+    case ConLineKind::Listen:
+        AddCycles(1);
+        break;
     default:
         break;
     }
 }
 
-void ConLine::SetOps(const vector<ConBaseOp*>& InOps, ConSourceLocation InLocation)
+void ConLine::SetOps(vector<ConBaseOp*> InOps, ConSourceLocation InLocation)
 {
-    this->Ops = InOps;
+    this->Ops = std::move(InOps);
     Kind = ConLineKind::Ops;
     Condition = ConConditionOp::None;
     Left = VariableRef();
@@ -123,6 +129,8 @@ void ConLine::SetOps(const vector<ConBaseOp*>& InOps, ConSourceLocation InLocati
     bInfiniteLoop = false;
     Invert = false;
     Location = InLocation;
+    Channel = -1;
+    ChannelOperand = VariableRef();
     bHasReturnValue = false;
     ReturnValue = VariableRef();
 }
@@ -141,6 +149,8 @@ void ConLine::SetIf(const ConConditionOp Op, VariableRef Lhs, VariableRef Rhs, c
     Counter = VariableRef();
     bInfiniteLoop = false;
     Location = InLocation;
+    Channel = -1;
+    ChannelOperand = VariableRef();
     bHasReturnValue = false;
     ReturnValue = VariableRef();
 }
@@ -159,6 +169,8 @@ void ConLine::SetLoop(const ConConditionOp Op, VariableRef Lhs, VariableRef Rhs,
     Counter = VariableRef();
     bInfiniteLoop = false;
     Location = InLocation;
+    Channel = -1;
+    ChannelOperand = VariableRef();
     bHasReturnValue = false;
     ReturnValue = VariableRef();
 }
@@ -177,6 +189,8 @@ void ConLine::SetRedo(const int32 TargetIndex, VariableRef CounterVar, const boo
     Skip = 0;
     LoopExitIndex = -1;
     Location = InLocation;
+    Channel = -1;
+    ChannelOperand = VariableRef();
     bHasReturnValue = false;
     ReturnValue = VariableRef();
 }
@@ -195,6 +209,8 @@ void ConLine::SetJump(const int32 TargetIndex, const ConConditionOp Op, Variable
     Counter = VariableRef();
     bInfiniteLoop = false;
     Location = InLocation;
+    Channel = -1;
+    ChannelOperand = VariableRef();
     bHasReturnValue = false;
     ReturnValue = VariableRef();
 }
@@ -213,29 +229,60 @@ void ConLine::SetReturn(VariableRef RetVal, const bool bHasValue, const ConSourc
     bInfiniteLoop = false;
     Invert = false;
     Location = InLocation;
+    Channel = -1;
+    ChannelOperand = VariableRef();
     bHasReturnValue = bHasValue;
     ReturnValue = bHasReturnValue ? RetVal : VariableRef();
 }
 
+void ConLine::SetSend(const int32 TargetThread, VariableRef Value, const ConSourceLocation InLocation)
+{
+    Ops.clear();
+    Kind = ConLineKind::Send;
+    Condition = ConConditionOp::None;
+    Left = VariableRef();
+    Right = VariableRef();
+    Skip = 0;
+    LoopExitIndex = -1;
+    TargetIndex = -1;
+    Counter = VariableRef();
+    bInfiniteLoop = false;
+    Invert = false;
+    Location = InLocation;
+    Channel = TargetThread;
+    ChannelOperand = Value;
+    bHasReturnValue = false;
+    ReturnValue = VariableRef();
+}
+
+void ConLine::SetListen(const int32 SourceThread, VariableRef Dst, const ConSourceLocation InLocation)
+{
+    Ops.clear();
+    Kind = ConLineKind::Listen;
+    Condition = ConConditionOp::None;
+    Left = VariableRef();
+    Right = VariableRef();
+    Skip = 0;
+    LoopExitIndex = -1;
+    TargetIndex = -1;
+    Counter = VariableRef();
+    bInfiniteLoop = false;
+    Invert = false;
+    Location = InLocation;
+    Channel = SourceThread;
+    ChannelOperand = Dst;
+    bHasReturnValue = false;
+    ReturnValue = VariableRef();
+}
+
 bool ConLine::EvaluateCondition() const
 {
     if (Condition == ConConditionOp::None)
     {
-        if (!Left.IsValid())
-        {
-            if (Kind == ConLineKind::If)
-                throw ConRuntimeError(Location, "Single-operand IF requires an operand");
-            return Invert ? false : true;
-        }
-        const bool Result = Left.Read() != 0;
+        const bool Result = !Left.IsValid() || Left.Read() != 0;
         return Invert ? !Result : Result;
     }
 
-    if (!Left.IsValid() || !Right.IsValid())
-    {
-        throw ConRuntimeError(Location, "Condition requires two operands");
-    }
-
     bool Result = true;
     switch (Condition)
     {
@@ -253,3 +300,64 @@ bool ConLine::EvaluateCondition() const
     }
     return Invert ? !Result : Result;
 }
+
+const char* ConLine::VerifyCondition() const
+{
+    if (Condition == ConConditionOp::None)
+    {
+        return !Left.IsValid() && Kind == ConLineKind::If ? "Single-operand IF requires an operand" : nullptr;
+    }
+    if (!Left.IsValid() || !Right.IsValid())
+    {
+        return "Condition requires two operands";
+    }
+    return nullptr;
+}
+
+void ConLine::Verify()
+{
+    StaticError = nullptr;
+    StaticErrorLocation = Location;
+    VerifiedOpCount = Ops.size();
+    switch (Kind)
+    {
+    case ConLineKind::Ops:
+        for (size_t Index = 0; Index < Ops.size(); ++Index)
+        {
+            if (const char* Error = Ops[Index]->Verify())
+            {
+                StaticError = Error;
+                StaticErrorLocation = Ops[Index]->GetSourceLocation();
+                VerifiedOpCount = Index;
+                break;
+            }
+        }
+        break;
+    case ConLineKind::If:
+        StaticError = VerifyCondition();
+        break;
+    case ConLineKind::Loop:
+    case ConLineKind::Jump:
+        StaticError = HasCondition() ? VerifyCondition() : nullptr;
+        break;
+    case ConLineKind::Redo:
+        StaticError = !HasCounter() && HasCondition() ? VerifyCondition() : nullptr;
+        break;
+    default:
+        break;
+    }
+}
+
+const char* ConLine::RunOps(ConSourceLocation& OutErrorLocation)
+{
+    for (size_t Index = 0; Index < VerifiedOpCount; ++Index)
+    {
+        if (const char* Error = Ops[Index]->Run())
+        {
+            OutErrorLocation = Ops[Index]->GetSourceLocation();
+            return Error;
+        }
+    }
+    OutErrorLocation = StaticErrorLocation;
+    return StaticError;
+}
@@ -21,7 +21,11 @@ enum class ConLineKind
     Loop,
     Redo,
     Jump,
-    Return
+    Return,
+    // blocks until the target thread's mailbox has room
+    Send,
+    // blocks until a value arrives from the source thread
+    Listen
 };
 
 struct ConLine : public ConCompilable
@@ -32,16 +36,30 @@ public:
     virtual void Execute() override;
     virtual void UpdateCycleCount() override;
     void UpdateCycleCount(int32 VarCount);
-    void SetOps(const vector<ConBaseOp*>& InOps, ConSourceLocation InLocation);
+    void SetOps(vector<ConBaseOp*> InOps, ConSourceLocation InLocation);
     void SetIf(ConConditionOp Op, VariableRef Lhs, VariableRef Rhs, int32 SkipCount, bool bInvert, ConSourceLocation InLocation);
     void SetLoop(ConConditionOp Op, VariableRef Lhs, VariableRef Rhs, bool bInvert, int32 ExitIndex, ConSourceLocation InLocation);
     void SetRedo(int32 TargetIndex, VariableRef CounterVar, bool bInfinite, ConConditionOp Op, VariableRef Lhs, VariableRef Rhs, bool bInvert, ConSourceLocation InLocation);
     void SetJump(int32 TargetIndex, ConConditionOp Op, VariableRef Lhs, VariableRef Rhs, bool bInvert, ConSourceLocation InLocation);
     void SetReturn(VariableRef RetVal, bool bHasValue, ConSourceLocation InLocation);
+    void SetSend(int32 TargetThread, VariableRef Value, ConSourceLocation InLocation);
+    void SetListen(int32 SourceThread, VariableRef Dst, ConSourceLocation InLocation);
 
     ConLineKind GetKind() const { return Kind; }
+    const vector<ConBaseOp*>& GetOps() const { return Ops; }
+    ConConditionOp GetCondition() const { return Condition; }
+    const VariableRef& GetLeft() const { return Left; }
+    const VariableRef& GetRight() const { return Right; }
+    bool IsInverted() const { return Invert; }
     bool HasCondition() const { return Condition != ConConditionOp::None || Left.IsValid(); }
+    // only meaningful on a verified line; Verify reports the operands it would reject
     bool EvaluateCondition() const;
+    // finds, once after the line is built, the error it raises on every run, so running it needs no checks
+    void Verify();
+    const char* GetStaticError() const { return StaticError; }
+    const ConSourceLocation& GetStaticErrorLocation() const { return StaticErrorLocation; }
+    // runs a verified ops line, stopping at its static error; returns the error that stopped it, or nullptr
+    const char* RunOps(ConSourceLocation& OutErrorLocation);
     int32 GetSkipCount() const { return Skip; }
     int32 GetLoopExitIndex() const { return LoopExitIndex; }
     int32 GetTargetIndex() const { return TargetIndex; }
@@ -49,10 +67,13 @@ public:
     bool HasCounter() const { return Counter.IsThread(); }
     bool IsInfiniteLoop() const { return bInfiniteLoop; }
     const ConSourceLocation& GetLocation() const { return Location; }
-    void SetSourceText(const std::string& Text) { SourceText = Text; }
+    void SetSourceText(std::string Text) { SourceText = std::move(Text); }
     const std::string& GetSourceText() const { return SourceText; }
     bool HasReturnValue() const { return bHasReturnValue; }
     const VariableRef& GetReturnValue() const { return ReturnValue; }
+    // peer thread index for SEND/LSTN, and the value sent or the variable received into
+    int32 GetChannel() const { return Channel; }
+    const VariableRef& GetChannelOperand() const { return ChannelOperand; }
 
 private:
     // in reverse order of operation
@@ -71,4 +92,12 @@ private:
     std::string SourceText;
     VariableRef ReturnValue;
     bool bHasReturnValue = false;
+    int32 Channel = -1;
+    VariableRef ChannelOperand;
+    // set by Verify: the error and where it is raised, and how many ops run before it
+    const char* StaticError = nullptr;
+    ConSourceLocation StaticErrorLocation;
+    size_t VerifiedOpCount = 0;
+
+    const char* VerifyCondition() const;
 };
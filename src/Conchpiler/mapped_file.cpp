@@ -0,0 +1,138 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ConMappedFile::~ConMappedFile()
+{
+    Close();
+}
+
+ConMappedFile::ConMappedFile(ConMappedFile&& Other) noexcept
+{
+    *this = std::move(Other);
+}
+
+ConMappedFile& ConMappedFile::operator=(ConMappedFile&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        Close();
+        Data = std::exchange(Other.Data, nullptr);
+        ByteCount = std::exchange(Other.ByteCount, 0);
+        bOpen = std::exchange(Other.bOpen, false);
+#ifdef _WIN32
+        FileHandle = std::exchange(Other.FileHandle, nullptr);
+        MappingHandle = std::exchange(Other.MappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+bool ConMappedFile::Open(const std::string& Path, std::string& OutError)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER Size = {};
+    if (File == INVALID_HANDLE_VALUE || !GetFileSizeEx(File, &Size))
+    {
+        if (File != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(File);
+        }
+        OutError = "Failed to open list file: " + Path;
+        return false;
+    }
+    FileHandle = File;
+    ByteCount = static_cast<size_t>(Size.QuadPart);
+    // an empty file cannot be mapped, and has no values to borrow anyway
+    if (ByteCount > 0)
+    {
+        MappingHandle = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        Data = MappingHandle != nullptr ? MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    }
+#else
+    const int File = ::open(Path.c_str(), O_RDONLY);
+    struct stat Info = {};
+    if (File < 0 || ::fstat(File, &Info) != 0)
+    {
+        if (File >= 0)
+        {
+            ::close(File);
+        }
+        OutError = "Failed to open list file: " + Path;
+        return false;
+    }
+    ByteCount = static_cast<size_t>(Info.st_size);
+    // an empty file cannot be mapped, and has no values to borrow anyway
+    if (ByteCount > 0)
+    {
+        void* Mapped = ::mmap(nullptr, ByteCount, PROT_READ, MAP_PRIVATE, File, 0);
+        Data = Mapped != MAP_FAILED ? Mapped : nullptr;
+    }
+    // the mapping keeps the file contents reachable on its own
+    ::close(File);
+#endif
+    bOpen = true;
+    if (ByteCount > 0 && Data == nullptr)
+    {
+        Close();
+        OutError = "Failed to map list file: " + Path;
+        return false;
+    }
+    if (ByteCount % sizeof(int32) != 0)
+    {
+        Close();
+        OutError = "List file size is not a multiple of 4 bytes: " + Path;
+        return false;
+    }
+    return true;
+}
+
+void ConMappedFile::Close()
+{
+#ifdef _WIN32
+    if (Data != nullptr)
+    {
+        UnmapViewOfFile(Data);
+    }
+    if (MappingHandle != nullptr)
+    {
+        CloseHandle(MappingHandle);
+    }
+    if (FileHandle != nullptr)
+    {
+        CloseHandle(FileHandle);
+    }
+    FileHandle = nullptr;
+    MappingHandle = nullptr;
+#else
+    if (Data != nullptr)
+    {
+        ::munmap(const_cast<void*>(Data), ByteCount);
+    }
+#endif
+    Data = nullptr;
+    ByteCount = 0;
+    bOpen = false;
+}
+
+ConListView ConMappedFile::GetValues() const
+{
+    return ConListView{static_cast<const int32*>(Data), ByteCount / sizeof(int32)};
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "common.h"
+#include "variable.h"
+
+#include <string>
+
+// A file mapped read-only into memory, so list inputs of any size can be borrowed by a
+// ConVariableList without being read or copied. The contents are taken as native-endian int32
+// values; the mapping lasts until Close or destruction.
+struct ConMappedFile
+{
+    ConMappedFile() = default;
+    ~ConMappedFile();
+    ConMappedFile(const ConMappedFile&) = delete;
+    ConMappedFile& operator=(const ConMappedFile&) = delete;
+    ConMappedFile(ConMappedFile&& Other) noexcept;
+    ConMappedFile& operator=(ConMappedFile&& Other) noexcept;
+
+    // fails if the file cannot be mapped or its size is not a whole number of int32 values
+    bool Open(const std::string& Path, std::string& OutError);
+    void Close();
+    bool IsOpen() const { return bOpen; }
+
+    size_t GetByteCount() const { return ByteCount; }
+    ConListView GetValues() const;
+
+private:
+    const void* Data = nullptr;
+    size_t ByteCount = 0;
+    bool bOpen = false;
+#ifdef _WIN32
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#endif
+};
@@ -1,10 +1,56 @@
 #include "op.h"
 
+#include "bytecode.h"
+
 #include <array>
+#include <string>
 #include <utility>
 
-ConBaseOp::ConBaseOp(const vector<VariableRef>& InArgs)
-    : Args(InArgs)
+namespace
+{
+ConOpcode ToOpcode(const ConBinaryOpKind Kind)
+{
+    switch (Kind)
+    {
+    case ConBinaryOpKind::Add:
+        return ConOpcode::Add;
+    case ConBinaryOpKind::Sub:
+        return ConOpcode::Sub;
+    case ConBinaryOpKind::Mul:
+        return ConOpcode::Mul;
+    case ConBinaryOpKind::Div:
+        return ConOpcode::Div;
+    case ConBinaryOpKind::And:
+        return ConOpcode::And;
+    case ConBinaryOpKind::Or:
+        return ConOpcode::Or;
+    case ConBinaryOpKind::Xor:
+        return ConOpcode::Xor;
+    default:
+        return ConOpcode::Nop;
+    }
+}
+
+// resolves a thread destination, emitting the matching trap when the op would throw instead
+bool LowerThreadDestination(ConBytecodeBuilder& Builder, const ConBaseOp& Op, const VariableRef& DstRef, const char* Name, ConOperand& OutOperand)
+{
+    if (!DstRef.IsThread())
+    {
+        Builder.EmitTrap(Op.GetSourceLocation(), std::string(Name) + " destination must be a thread variable");
+        return false;
+    }
+    OutOperand = Builder.Resolve(DstRef);
+    if (!OutOperand.IsRegister())
+    {
+        Builder.EmitTrap(Op.GetSourceLocation(), std::string(Name) + " destination is invalid");
+        return false;
+    }
+    return true;
+}
+}
+
+ConBaseOp::ConBaseOp(vector<VariableRef> InArgs)
+    : Args(std::move(InArgs))
 {
     RefreshThreadMixSummary();
 }
@@ -19,6 +65,19 @@ void ConBaseOp::SetArgs(vector<VariableRef> InArgs)
     RefreshThreadMixSummary();
 }
 
+void ConBaseOp::Execute()
+{
+    const char* Error = Verify();
+    if (Error == nullptr)
+    {
+        Error = Run();
+    }
+    if (Error != nullptr)
+    {
+        throw ConRuntimeError(GetSourceLocation(), Error);
+    }
+}
+
 VariableRef ConBaseOp::GetReturn() const
 {
     if (!HasReturn() || GetArgs().empty())
@@ -174,28 +233,34 @@ const VariableRef& ConContextualReturnOp::GetDstArg() const
     return GetArgs().at(0);
 }
 
-vector<VariableRef> ConContextualReturnOp::GetSrcArg() const
+const VariableRef& ConContextualReturnOp::GetLhsArg() const
 {
     if (GetArgsCount() < 2)
     {
         throw ConRuntimeError(GetSourceLocation(), "Operation missing source argument");
     }
-    if (GetArgsCount() == 3)
+    return GetArgs()[GetArgsCount() > 2 ? 1 : 0];
+}
+
+const VariableRef& ConContextualReturnOp::GetRhsArg() const
+{
+    if (GetArgsCount() < 2)
     {
-        return {GetArgs().at(1), GetArgs().at(2)};
+        throw ConRuntimeError(GetSourceLocation(), "Operation missing source argument");
     }
-    return {GetDstArg(), GetArgs().at(1)};
+    return GetArgs()[GetArgsCount() > 2 ? 2 : 1];
 }
 
-ConBinaryOp::ConBinaryOp(const ConBinaryOpKind InKind, const vector<VariableRef>& InArgs)
-    : ConContextualReturnOp(InArgs)
+ConBinaryOp::ConBinaryOp(const ConBinaryOpKind InKind, vector<VariableRef> InArgs)
+    : ConContextualReturnOp(std::move(InArgs))
     , Kind(InKind)
 {
-    const vector<VariableRef> SrcArgs = GetSrcArg();
-    if (SrcArgs.size() == 2 && SrcArgs[0].IsLiteral() && SrcArgs[1].IsLiteral())
+    const VariableRef& Lhs = GetLhsArg();
+    const VariableRef& Rhs = GetRhsArg();
+    if (Lhs.IsLiteral() && Rhs.IsLiteral())
     {
         bHasPrecomputed = true;
-        PrecomputedValue = Compute(SrcArgs[0].Read(), SrcArgs[1].Read());
+        PrecomputedValue = Compute(Lhs.Read(), Rhs.Read());
     }
 }
 
@@ -222,255 +287,463 @@ int32 ConBinaryOp::Compute(const int32 Lhs, const int32 Rhs) const
     }
 }
 
-void ConBinaryOp::Execute()
+const char* ConBinaryOp::Verify() const
 {
-    const vector<VariableRef> SrcArg = GetSrcArg();
-    if (SrcArg.size() < 2 || !SrcArg.at(0).IsValid() || !SrcArg.at(1).IsValid())
+    if (GetArgsCount() < 2)
     {
-        throw ConRuntimeError(GetSourceLocation(), "Binary operation missing operands");
+        return "Operation missing source argument";
     }
-
-    VariableRef& DstRef = GetDstArg();
-    const int32 Result = bHasPrecomputed ? PrecomputedValue : Compute(SrcArg.at(0).Read(), SrcArg.at(1).Read());
+    if (!GetLhsArg().IsValid() || !GetRhsArg().IsValid())
+    {
+        return "Binary operation missing operands";
+    }
+    const VariableRef& DstRef = GetDstArg();
     if (DstRef.IsThread())
     {
-        ConVariableCached* Dst = DstRef.GetThread();
-        if (Dst == nullptr)
-        {
-            throw ConRuntimeError(GetSourceLocation(), "Binary operation destination is invalid");
-        }
-        Dst->SetVal(Result);
-        return;
+        return DstRef.GetThread() == nullptr ? "Binary operation destination is invalid" : nullptr;
     }
-    if (DstRef.IsList())
+    if (DstRef.IsList() && DstRef.GetList() != nullptr && DstRef.GetList()->IsOutput())
     {
-        ConVariableList* List = DstRef.GetList();
-        if (List == nullptr || !List->IsOutput())
-        {
-            throw ConRuntimeError(GetSourceLocation(), "Binary operation destination must be a thread or OUT list variable");
-        }
-        if (!List->TryAppend(Result))
-        {
-            throw ConRuntimeError(GetSourceLocation(), "OUT list cannot accept additional values");
-        }
-        return;
+        return nullptr;
     }
-    throw ConRuntimeError(GetSourceLocation(), "Binary operation destination must be a thread or OUT list variable");
+    return "Binary operation destination must be a thread or OUT list variable";
 }
 
-void ConIncrOp::Execute()
+const char* ConBinaryOp::Run()
 {
-    if (GetArgsCount() < 1)
+    const int32 Result = bHasPrecomputed ? PrecomputedValue : Compute(GetLhsArg().Read(), GetRhsArg().Read());
+    const VariableRef& DstRef = GetDstArg();
+    if (DstRef.IsThread())
     {
-        throw ConRuntimeError(GetSourceLocation(), "INCR requires a destination argument");
+        DstRef.GetThread()->SetVal(Result);
+        return nullptr;
     }
-    VariableRef& DstRef = GetArgRef(0);
-    if (!DstRef.IsThread())
+    return DstRef.GetList()->TryAppend(Result) ? nullptr : "OUT list cannot accept additional values";
+}
+
+const char* ConIncrOp::Verify() const
+{
+    if (GetArgsCount() < 1)
     {
-        throw ConRuntimeError(GetSourceLocation(), "INCR destination must be a thread variable");
+        return "INCR requires a destination argument";
     }
-    ConVariableCached* Dst = DstRef.GetThread();
-    if (Dst == nullptr)
+    if (!GetArgs()[0].IsThread())
     {
-        throw ConRuntimeError(GetSourceLocation(), "INCR destination is invalid");
+        return "INCR destination must be a thread variable";
     }
+    return GetArgs()[0].GetThread() == nullptr ? "INCR destination is invalid" : nullptr;
+}
+
+const char* ConIncrOp::Run()
+{
+    ConVariableCached* Dst = GetArgs()[0].GetThread();
     Dst->SetVal(Dst->GetVal() + 1);
+    return nullptr;
 }
 
-void ConDecrOp::Execute()
+const char* ConDecrOp::Verify() const
 {
     if (GetArgsCount() < 1)
     {
-        throw ConRuntimeError(GetSourceLocation(), "DECR requires a destination argument");
-    }
-    VariableRef& DstRef = GetArgRef(0);
-    if (!DstRef.IsThread())
-    {
-        throw ConRuntimeError(GetSourceLocation(), "DECR destination must be a thread variable");
+        return "DECR requires a destination argument";
     }
-    ConVariableCached* Dst = DstRef.GetThread();
-    if (Dst == nullptr)
+    if (!GetArgs()[0].IsThread())
     {
-        throw ConRuntimeError(GetSourceLocation(), "DECR destination is invalid");
+        return "DECR destination must be a thread variable";
     }
+    return GetArgs()[0].GetThread() == nullptr ? "DECR destination is invalid" : nullptr;
+}
+
+const char* ConDecrOp::Run()
+{
+    ConVariableCached* Dst = GetArgs()[0].GetThread();
     Dst->SetVal(Dst->GetVal() - 1);
+    return nullptr;
 }
 
-void ConNotOp::Execute()
+const char* ConNotOp::Verify() const
 {
     if (GetArgsCount() < 1)
     {
-        throw ConRuntimeError(GetSourceLocation(), "NOT requires a destination argument");
+        return "NOT requires a destination argument";
     }
-    VariableRef& DstRef = GetArgRef(0);
-
-    // Compute the result value first.
-    int32 Result = 0;
+    const VariableRef& DstRef = GetArgs()[0];
     if (GetArgsCount() == 1)
     {
         if (!DstRef.IsThread())
         {
-            throw ConRuntimeError(GetSourceLocation(), "NOT destination must be a thread variable");
+            return "NOT destination must be a thread variable";
         }
+        return DstRef.GetThread() == nullptr ? "NOT destination is invalid" : nullptr;
+    }
+    if (!GetArgs()[1].IsValid())
+    {
+        return "NOT source argument is invalid";
+    }
+    if (DstRef.IsThread())
+    {
+        return DstRef.GetThread() == nullptr ? "NOT destination is invalid" : nullptr;
+    }
+    if (DstRef.IsList() && DstRef.GetList() != nullptr && DstRef.GetList()->IsOutput())
+    {
+        return nullptr;
+    }
+    return "NOT destination must be a thread or OUT list variable";
+}
+
+const char* ConNotOp::Run()
+{
+    const VariableRef& DstRef = GetArgs()[0];
+    if (GetArgsCount() == 1)
+    {
         ConVariableCached* Dst = DstRef.GetThread();
-        if (Dst == nullptr)
+        Dst->SetVal(~Dst->GetVal());
+        return nullptr;
+    }
+    const int32 Result = ~GetArgs()[1].Read();
+    if (DstRef.IsThread())
+    {
+        DstRef.GetThread()->SetVal(Result);
+        return nullptr;
+    }
+    return DstRef.GetList()->TryAppend(Result) ? nullptr : "OUT list cannot accept additional values";
+}
+
+const char* ConPopOp::Verify() const
+{
+    if (GetArgsCount() < 2)
+    {
+        return "POP requires a destination and a list argument";
+    }
+    if (!GetArgs()[0].IsThread())
+    {
+        return "POP destination must be a thread variable";
+    }
+    if (GetArgs()[0].GetThread() == nullptr)
+    {
+        return "POP destination is invalid";
+    }
+    return GetArgs()[1].GetList() == nullptr ? "POP requires a list operand" : nullptr;
+}
+
+const char* ConPopOp::Run()
+{
+    GetArgs()[0].GetThread()->SetVal(GetArgs()[1].GetList()->Pop());
+    return nullptr;
+}
+
+const char* ConAtOp::Verify() const
+{
+    if (GetArgsCount() < 3)
+    {
+        return "AT requires a destination, list, and index";
+    }
+    if (!GetArgs()[0].IsThread())
+    {
+        return "AT destination must be a thread variable";
+    }
+    if (GetArgs()[0].GetThread() == nullptr)
+    {
+        return "AT destination is invalid";
+    }
+    if (GetArgs()[1].GetList() == nullptr)
+    {
+        return "AT requires a list operand";
+    }
+    return GetArgs()[2].IsValid() ? nullptr : "AT index argument is invalid";
+}
+
+const char* ConAtOp::Run()
+{
+    GetArgs()[0].GetThread()->SetVal(GetArgs()[1].GetList()->At(GetArgs()[2].Read()));
+    return nullptr;
+}
+
+const char* ConSetOp::Verify() const
+{
+    if (GetArgsCount() < 2)
+    {
+        return "SET requires a destination and a source";
+    }
+    if (!GetArgs()[1].IsValid())
+    {
+        return "SET source argument is invalid";
+    }
+    const VariableRef& DstRef = GetArgs()[0];
+    if (DstRef.IsThread())
+    {
+        return DstRef.GetThread() == nullptr ? "SET destination is invalid" : nullptr;
+    }
+    if (DstRef.IsList())
+    {
+        if (DstRef.GetList() == nullptr)
         {
-            throw ConRuntimeError(GetSourceLocation(), "NOT destination is invalid");
+            return "SET destination list is invalid";
         }
-        Dst->SetVal(~Dst->GetVal());
-        return;
+        return DstRef.GetList()->IsOutput() ? nullptr : "SET can only write to OUT lists";
+    }
+    return "SET destination must be a thread or OUT list variable";
+}
+
+const char* ConSetOp::Run()
+{
+    const VariableRef& DstRef = GetArgs()[0];
+    const int32 Value = GetArgs()[1].Read();
+    if (DstRef.IsThread())
+    {
+        DstRef.GetThread()->SetVal(Value);
+        return nullptr;
+    }
+    ConVariableList* List = DstRef.GetList();
+    if (List->TryAppend(Value))
+    {
+        return nullptr;
+    }
+    return List->HasExpectedSize() ? "OUT list exceeded expected size" : "OUT list cannot accept additional values";
+}
+
+const char* ConSwpOp::Verify() const
+{
+    if (GetArgsCount() < 1)
+    {
+        return "SWP requires a destination argument";
+    }
+    if (!GetArgs()[0].IsThread())
+    {
+        return "SWP destination must be a thread variable";
     }
+    return GetArgs()[0].GetThread() == nullptr ? "SWP destination is invalid" : nullptr;
+}
+
+const char* ConSwpOp::Run()
+{
+    GetArgs()[0].GetThread()->Swap();
+    return nullptr;
+}
 
-    const VariableRef& Src = GetArgRef(1);
-    if (!Src.IsValid())
+void ConBaseOp::Lower(ConBytecodeBuilder& Builder) const
+{
+    Builder.EmitTrap(GetSourceLocation(), "Operation is not supported by the bytecode engine");
+}
+
+void ConBinaryOp::Lower(ConBytecodeBuilder& Builder) const
+{
+    if (GetArgsCount() < 2)
     {
-        throw ConRuntimeError(GetSourceLocation(), "NOT source argument is invalid");
+        Builder.EmitTrap(GetSourceLocation(), "Operation missing source argument");
+        return;
+    }
+    ConInstruction Inst;
+    Inst.B = Builder.Resolve(GetLhsArg());
+    Inst.C = Builder.Resolve(GetRhsArg());
+    if (!Inst.B.IsValid() || !Inst.C.IsValid())
+    {
+        Builder.EmitTrap(GetSourceLocation(), "Binary operation missing operands");
+        return;
     }
-    Result = ~Src.Read();
 
+    const VariableRef& DstRef = GetDstArg();
+    Inst.A = Builder.Resolve(DstRef);
     if (DstRef.IsThread())
     {
-        ConVariableCached* Dst = DstRef.GetThread();
-        if (Dst == nullptr)
+        if (!Inst.A.IsRegister())
         {
-            throw ConRuntimeError(GetSourceLocation(), "NOT destination is invalid");
+            Builder.EmitTrap(GetSourceLocation(), "Binary operation destination is invalid");
+            return;
         }
-        Dst->SetVal(Result);
+    }
+    else if (!DstRef.IsList() || !Inst.A.IsList())
+    {
+        Builder.EmitTrap(GetSourceLocation(), "Binary operation destination must be a thread or OUT list variable");
         return;
     }
-    if (DstRef.IsList())
+
+    Inst.Opcode = ToOpcode(Kind);
+    if (bHasPrecomputed && Inst.A.IsRegister())
+    {
+        Inst.Opcode = ConOpcode::Set;
+        Inst.B.Kind = ConOperandKind::Immediate;
+        Inst.B.Value = PrecomputedValue;
+        Inst.C = ConOperand();
+    }
+    Builder.Emit(Inst, GetSourceLocation());
+}
+
+void ConIncrOp::Lower(ConBytecodeBuilder& Builder) const
+{
+    if (GetArgsCount() < 1)
     {
-        ConVariableList* List = DstRef.GetList();
-        if (List == nullptr || !List->IsOutput())
+        Builder.EmitTrap(GetSourceLocation(), "INCR requires a destination argument");
+        return;
+    }
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::Incr;
+    if (LowerThreadDestination(Builder, *this, GetArgs().at(0), "INCR", Inst.A))
+    {
+        Builder.Emit(Inst, GetSourceLocation());
+    }
+}
+
+void ConDecrOp::Lower(ConBytecodeBuilder& Builder) const
+{
+    if (GetArgsCount() < 1)
+    {
+        Builder.EmitTrap(GetSourceLocation(), "DECR requires a destination argument");
+        return;
+    }
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::Decr;
+    if (LowerThreadDestination(Builder, *this, GetArgs().at(0), "DECR", Inst.A))
+    {
+        Builder.Emit(Inst, GetSourceLocation());
+    }
+}
+
+void ConNotOp::Lower(ConBytecodeBuilder& Builder) const
+{
+    if (GetArgsCount() < 1)
+    {
+        Builder.EmitTrap(GetSourceLocation(), "NOT requires a destination argument");
+        return;
+    }
+    const VariableRef& DstRef = GetArgs().at(0);
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::Not;
+    if (GetArgsCount() == 1)
+    {
+        if (LowerThreadDestination(Builder, *this, DstRef, "NOT", Inst.A))
         {
-            throw ConRuntimeError(GetSourceLocation(), "NOT destination must be a thread or OUT list variable");
+            Inst.B = Inst.A;
+            Builder.Emit(Inst, GetSourceLocation());
         }
-        if (!List->TryAppend(Result))
+        return;
+    }
+
+    Inst.B = Builder.Resolve(GetArgs().at(1));
+    if (!Inst.B.IsValid())
+    {
+        Builder.EmitTrap(GetSourceLocation(), "NOT source argument is invalid");
+        return;
+    }
+    Inst.A = Builder.Resolve(DstRef);
+    if (DstRef.IsThread())
+    {
+        if (!Inst.A.IsRegister())
         {
-            throw ConRuntimeError(GetSourceLocation(), "OUT list cannot accept additional values");
+            Builder.EmitTrap(GetSourceLocation(), "NOT destination is invalid");
+            return;
         }
+    }
+    else if (!DstRef.IsList() || !Inst.A.IsList())
+    {
+        Builder.EmitTrap(GetSourceLocation(), "NOT destination must be a thread or OUT list variable");
         return;
     }
-    throw ConRuntimeError(GetSourceLocation(), "NOT destination must be a thread or OUT list variable");
+    Builder.Emit(Inst, GetSourceLocation());
 }
 
-void ConPopOp::Execute()
+void ConPopOp::Lower(ConBytecodeBuilder& Builder) const
 {
     if (GetArgsCount() < 2)
     {
-        throw ConRuntimeError(GetSourceLocation(), "POP requires a destination and a list argument");
-    }
-    VariableRef& DstRef = GetArgRef(0);
-    if (!DstRef.IsThread())
-    {
-        throw ConRuntimeError(GetSourceLocation(), "POP destination must be a thread variable");
+        Builder.EmitTrap(GetSourceLocation(), "POP requires a destination and a list argument");
+        return;
     }
-    ConVariableCached* Dst = DstRef.GetThread();
-    if (Dst == nullptr)
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::Pop;
+    if (!LowerThreadDestination(Builder, *this, GetArgs().at(0), "POP", Inst.A))
     {
-        throw ConRuntimeError(GetSourceLocation(), "POP destination is invalid");
+        return;
     }
-    const VariableRef& ListRef = GetArgRef(1);
-    ConVariableList* List = ListRef.GetList();
-    if (List == nullptr)
+    Inst.B = Builder.Resolve(GetArgs().at(1));
+    if (!Inst.B.IsList())
     {
-        throw ConRuntimeError(GetSourceLocation(), "POP requires a list operand");
+        Builder.EmitTrap(GetSourceLocation(), "POP requires a list operand");
+        return;
     }
-    Dst->SetVal(List->Pop());
+    Builder.Emit(Inst, GetSourceLocation());
 }
 
-void ConAtOp::Execute()
+void ConAtOp::Lower(ConBytecodeBuilder& Builder) const
 {
     if (GetArgsCount() < 3)
     {
-        throw ConRuntimeError(GetSourceLocation(), "AT requires a destination, list, and index");
-    }
-    VariableRef& DstRef = GetArgRef(0);
-    if (!DstRef.IsThread())
-    {
-        throw ConRuntimeError(GetSourceLocation(), "AT destination must be a thread variable");
+        Builder.EmitTrap(GetSourceLocation(), "AT requires a destination, list, and index");
+        return;
     }
-    ConVariableCached* Dst = DstRef.GetThread();
-    if (Dst == nullptr)
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::At;
+    if (!LowerThreadDestination(Builder, *this, GetArgs().at(0), "AT", Inst.A))
     {
-        throw ConRuntimeError(GetSourceLocation(), "AT destination is invalid");
+        return;
     }
-    const VariableRef& ListRef = GetArgRef(1);
-    ConVariableList* List = ListRef.GetList();
-    if (List == nullptr)
+    Inst.B = Builder.Resolve(GetArgs().at(1));
+    if (!Inst.B.IsList())
     {
-        throw ConRuntimeError(GetSourceLocation(), "AT requires a list operand");
+        Builder.EmitTrap(GetSourceLocation(), "AT requires a list operand");
+        return;
     }
-    const VariableRef& IndexRef = GetArgRef(2);
-    if (!IndexRef.IsValid())
+    Inst.C = Builder.Resolve(GetArgs().at(2));
+    if (!Inst.C.IsValid())
     {
-        throw ConRuntimeError(GetSourceLocation(), "AT index argument is invalid");
+        Builder.EmitTrap(GetSourceLocation(), "AT index argument is invalid");
+        return;
     }
-    Dst->SetVal(List->At(IndexRef.Read()));
+    Builder.Emit(Inst, GetSourceLocation());
 }
 
-void ConSetOp::Execute()
+void ConSetOp::Lower(ConBytecodeBuilder& Builder) const
 {
     if (GetArgsCount() < 2)
     {
-        throw ConRuntimeError(GetSourceLocation(), "SET requires a destination and a source");
+        Builder.EmitTrap(GetSourceLocation(), "SET requires a destination and a source");
+        return;
     }
-    VariableRef& DstRef = GetArgRef(0);
-    const VariableRef& SrcRef = GetArgRef(1);
-    if (!SrcRef.IsValid())
+    const VariableRef& DstRef = GetArgs().at(0);
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::Set;
+    Inst.B = Builder.Resolve(GetArgs().at(1));
+    if (!Inst.B.IsValid())
     {
-        throw ConRuntimeError(GetSourceLocation(), "SET source argument is invalid");
+        Builder.EmitTrap(GetSourceLocation(), "SET source argument is invalid");
+        return;
     }
+    Inst.A = Builder.Resolve(DstRef);
     if (DstRef.IsThread())
     {
-        ConVariableCached* Dst = DstRef.GetThread();
-        if (Dst == nullptr)
+        if (!Inst.A.IsRegister())
         {
-            throw ConRuntimeError(GetSourceLocation(), "SET destination is invalid");
+            Builder.EmitTrap(GetSourceLocation(), "SET destination is invalid");
+            return;
         }
-        Dst->SetVal(SrcRef.Read());
-        return;
     }
-    if (DstRef.IsList())
+    else if (DstRef.IsList())
     {
-        ConVariableList* List = DstRef.GetList();
-        if (List == nullptr)
-        {
-            throw ConRuntimeError(GetSourceLocation(), "SET destination list is invalid");
-        }
-        if (!List->IsOutput())
+        if (!Inst.A.IsList())
         {
-            throw ConRuntimeError(GetSourceLocation(), "SET can only write to OUT lists");
-        }
-        const int32 Value = SrcRef.Read();
-        if (!List->TryAppend(Value))
-        {
-            if (List->HasExpectedSize())
-            {
-                throw ConRuntimeError(GetSourceLocation(), "OUT list exceeded expected size");
-            }
-            throw ConRuntimeError(GetSourceLocation(), "OUT list cannot accept additional values");
+            Builder.EmitTrap(GetSourceLocation(), "SET destination list is invalid");
+            return;
         }
+    }
+    else
+    {
+        Builder.EmitTrap(GetSourceLocation(), "SET destination must be a thread or OUT list variable");
         return;
     }
-    throw ConRuntimeError(GetSourceLocation(), "SET destination must be a thread or OUT list variable");
+    Builder.Emit(Inst, GetSourceLocation());
 }
 
-void ConSwpOp::Execute()
+void ConSwpOp::Lower(ConBytecodeBuilder& Builder) const
 {
     if (GetArgsCount() < 1)
     {
-        throw ConRuntimeError(GetSourceLocation(), "SWP requires a destination argument");
-    }
-    VariableRef& DstRef = GetArgRef(0);
-    if (!DstRef.IsThread())
-    {
-        throw ConRuntimeError(GetSourceLocation(), "SWP destination must be a thread variable");
+        Builder.EmitTrap(GetSourceLocation(), "SWP requires a destination argument");
+        return;
     }
-    ConVariableCached* Dst = DstRef.GetThread();
-    if (Dst == nullptr)
+    ConInstruction Inst;
+    Inst.Opcode = ConOpcode::Swp;
+    if (LowerThreadDestination(Builder, *this, GetArgs().at(0), "SWP", Inst.A))
     {
-        throw ConRuntimeError(GetSourceLocation(), "SWP destination is invalid");
+        Builder.Emit(Inst, GetSourceLocation());
     }
-    Dst->Swap();
 }
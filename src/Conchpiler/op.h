@@ -6,6 +6,8 @@
 
 #include <vector>
 
+struct ConBytecodeBuilder;
+
 struct ThreadMixSummary
 {
     int32 UniqueThreadVars = 0;
@@ -16,8 +18,15 @@ struct ThreadMixSummary
 struct ConBaseOp : public ConCompilable
 {
     ConBaseOp() = default;
-    explicit ConBaseOp(const vector<VariableRef>& InArgs);
+    explicit ConBaseOp(vector<VariableRef> InArgs);
     virtual ~ConBaseOp() override {};
+    // checked run for callers outside a verified thread: throws whatever Verify or Run report
+    virtual void Execute() override final;
+    // the error this op raises on every run whatever the thread state, or nullptr; threads call it
+    // once after parsing so the run loop only handles genuine runtime failures
+    virtual const char* Verify() const { return nullptr; }
+    // runs an op that passed Verify; returns the runtime error (a full OUT list), or nullptr
+    virtual const char* Run() { return nullptr; }
     virtual void SetArgs(vector<VariableRef> Args);
     virtual int32 GetMaxArgs() const { return 2; }
     virtual bool HasReturn() const { return false; }
@@ -36,6 +45,9 @@ struct ConBaseOp : public ConCompilable
     bool MixesMultipleThreadVariables() const;
     std::vector<ConVariableCached*> GetThreadParticipants() const;
 
+    // emits the flat instructions for this op, trapping where Execute would throw
+    virtual void Lower(ConBytecodeBuilder& Builder) const;
+
 protected:
     vector<VariableRef>& GetMutableArgs();
     VariableRef& GetArgRef(int32 Index);
@@ -54,10 +66,12 @@ struct ConContextualReturnOp : public ConBaseOp
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 3; }
     virtual bool HasReturn() const override { return GetArgsCount() > 2; }
-    virtual void Execute() override {}
+    virtual void Lower(ConBytecodeBuilder&) const override {}
     VariableRef& GetDstArg();
     const VariableRef& GetDstArg() const;
-    vector<VariableRef> GetSrcArg() const;
+    // source operands are read in place: args 1 and 2 with a return, otherwise args 0 and 1
+    const VariableRef& GetLhsArg() const;
+    const VariableRef& GetRhsArg() const;
 };
 
 enum class ConBinaryOpKind
@@ -73,8 +87,10 @@ enum class ConBinaryOpKind
 
 struct ConBinaryOp final : public ConContextualReturnOp
 {
-    ConBinaryOp(ConBinaryOpKind InKind, const std::vector<VariableRef>& InArgs);
-    virtual void Execute() override;
+    ConBinaryOp(ConBinaryOpKind InKind, std::vector<VariableRef> InArgs);
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 
 private:
     ConBinaryOpKind Kind;
@@ -87,21 +103,27 @@ struct ConIncrOp final : public ConBaseOp
 {
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 1; }
-    virtual void Execute() override;
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 };
 
 struct ConDecrOp final : public ConBaseOp
 {
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 1; }
-    virtual void Execute() override;
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 };
 
 struct ConNotOp final : public ConBaseOp
 {
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 2; }
-    virtual void Execute() override;
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 };
 
 struct ConPopOp final : public ConBaseOp
@@ -109,7 +131,9 @@ struct ConPopOp final : public ConBaseOp
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 2; }
     virtual bool HasReturn() const override { return true; }
-    virtual void Execute() override;
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 };
 
 struct ConAtOp final : public ConBaseOp
@@ -117,7 +141,9 @@ struct ConAtOp final : public ConBaseOp
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 3; }
     virtual bool HasReturn() const override { return true; }
-    virtual void Execute() override;
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 };
 
 struct ConSetOp final : public ConBaseOp
@@ -125,7 +151,9 @@ struct ConSetOp final : public ConBaseOp
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 2; }
     virtual bool HasReturn() const override { return false; }
-    virtual void Execute() override;
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 };
 
 struct ConSwpOp final : public ConBaseOp
@@ -133,7 +161,9 @@ struct ConSwpOp final : public ConBaseOp
     using ConBaseOp::ConBaseOp;
     virtual int32 GetMaxArgs() const override { return 1; }
     virtual bool HasReturn() const override { return false; }
-    virtual void Execute() override;
+    virtual const char* Verify() const override;
+    virtual const char* Run() override;
+    virtual void Lower(ConBytecodeBuilder& Builder) const override;
 };
 
 
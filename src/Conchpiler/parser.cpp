@@ -3,27 +3,64 @@
 #include <algorithm>
 #include <array>
 #include <cctype>
+#include <charconv>
+#include <cstddef>
 #include <sstream>
 #include <unordered_map>
 
 namespace
 {
-ConConditionOp ParseComparisonToken(const std::string& Comp)
+ConConditionOp ParseComparisonToken(const ConTokenView& Comp)
 {
-    if (Comp == "GTR")
+    if (Comp.Keyword == ConKeyword::Gtr)
     {
         return ConConditionOp::GTR;
     }
-    if (Comp == "LSR")
+    if (Comp.Keyword == ConKeyword::Lsr)
     {
         return ConConditionOp::LSR;
     }
     return ConConditionOp::EQL;
 }
 
-bool IsComparisonToken(const std::string& Comp)
+bool IsComparisonToken(const ConTokenView& Comp)
 {
-    return Comp == "GTR" || Comp == "LSR" || Comp == "EQL";
+    return Comp.Keyword == ConKeyword::Gtr || Comp.Keyword == ConKeyword::Lsr || Comp.Keyword == ConKeyword::Eql;
+}
+
+bool FindBinaryOp(const ConKeyword Keyword, ConBinaryOpKind& OutKind)
+{
+    switch (Keyword)
+    {
+    case ConKeyword::Add: OutKind = ConBinaryOpKind::Add; return true;
+    case ConKeyword::Sub: OutKind = ConBinaryOpKind::Sub; return true;
+    case ConKeyword::Mul: OutKind = ConBinaryOpKind::Mul; return true;
+    case ConKeyword::Div: OutKind = ConBinaryOpKind::Div; return true;
+    case ConKeyword::And: OutKind = ConBinaryOpKind::And; return true;
+    case ConKeyword::Or: OutKind = ConBinaryOpKind::Or; return true;
+    case ConKeyword::Xor: OutKind = ConBinaryOpKind::Xor; return true;
+    default: return false;
+    }
+}
+
+// SEND and LSTN address peers by program index: T0, T1, ...
+int32 ParseThreadTarget(const ConTokenView& Tok)
+{
+    const std::string_view Lexeme = Tok.Lexeme;
+    if (Tok.Kind != ConTokenType::Identifier || Lexeme.size() < 2 || Lexeme[0] != 'T')
+    {
+        throw ConParseError(Tok, "Expected a thread target such as T0");
+    }
+    int32 Index = 0;
+    for (size_t Pos = 1; Pos < Lexeme.size(); ++Pos)
+    {
+        if (std::isdigit(static_cast<unsigned char>(Lexeme[Pos])) == 0 || Index > 9999)
+        {
+            throw ConParseError(Tok, "Expected a thread target such as T0");
+        }
+        Index = Index * 10 + (Lexeme[Pos] - '0');
+    }
+    return Index;
 }
 }
 
@@ -35,22 +72,23 @@ ConParser::ConParser()
 void ConParser::Reset()
 {
     VarStorage.clear();
-    ConstStorage.clear();
     ListStorage.clear();
-    OpStorage.clear();
+    LiteralPool.clear();
     VarMap.clear();
+    Arena.Reset();
 
     const std::array<std::string, 3> BaseVars = {"X", "Y", "Z"};
+    RegisterStorage = Arena.New<ConRegisterFile>(BaseVars.size());
     for (const std::string& Name : BaseVars)
     {
-        VarStorage.emplace_back(std::make_unique<ConVariableCached>());
-        ConVariableCached* Var = VarStorage.back().get();
+        ConVariableCached* Var = Arena.New<ConVariableCached>(RegisterStorage, static_cast<int32>(VarStorage.size()));
+        VarStorage.push_back(Var);
         VarMap[Name] = VariableRef::ThreadVar(Var);
         VarMap[Name + "C"] = VariableRef::CacheVar(Var);
     }
 }
 
-void ConParser::ReportError(const Token& Tok, const std::string& Message)
+void ConParser::ReportError(const ConTokenView& Tok, const std::string& Message)
 {
     ConSourceLocation Location;
     Location.Line = Tok.Line;
@@ -65,7 +103,7 @@ void ConParser::ReportError(const ConParseError& Error)
     Errors.push_back(FormatErrorMessage(Error.Location, Error.what()));
 }
 
-VariableRef ConParser::ResolveToken(const Token& Tok)
+VariableRef ConParser::ResolveToken(const ConTokenView& Tok)
 {
     if (Tok.Kind == ConTokenType::Number)
     {
@@ -73,11 +111,11 @@ VariableRef ConParser::ResolveToken(const Token& Tok)
         {
             throw ConParseError(Tok, "Numeric token missing literal value");
         }
-        ConstStorage.emplace_back(std::make_unique<ConVariableAbsolute>(Tok.Literal));
-        return VariableRef::LiteralVar(ConstStorage.back().get());
+        return InternLiteral(Tok.Literal);
     }
 
-    const std::string& Lexeme = Tok.Lexeme;
+    std::string& Lexeme = NameBuffer;
+    Lexeme.assign(Tok.Lexeme.data(), Tok.Lexeme.size());
     auto It = VarMap.find(Lexeme);
     if (It != VarMap.end())
     {
@@ -89,17 +127,14 @@ VariableRef ConParser::ResolveToken(const Token& Tok)
         {
             return false;
         }
-        const std::string IndexStr = Lexeme.substr(Prefix.size());
-        if (IndexStr.empty())
+        if (Lexeme.size() == Prefix.size())
         {
             throw ConParseError(Tok, std::string(Label) + " token missing index");
         }
+        // the index is its leading digits; anything after them stays part of the list name
         int32 Index = 0;
-        try
-        {
-            Index = std::stoi(IndexStr);
-        }
-        catch (const std::exception&)
+        const char* IndexBegin = Lexeme.data() + Prefix.size();
+        if (std::from_chars(IndexBegin, Lexeme.data() + Lexeme.size(), Index).ec != std::errc())
         {
             throw ConParseError(Tok, "Invalid " + std::string(Label) + " index");
         }
@@ -107,8 +142,8 @@ VariableRef ConParser::ResolveToken(const Token& Tok)
         {
             throw ConParseError(Tok, std::string(Label) + " index must be non-negative");
         }
-        ListStorage.emplace_back(std::make_unique<ConVariableList>());
-        ConVariableList* List = ListStorage.back().get();
+        ConVariableList* List = Arena.New<ConVariableList>();
+        ListStorage.push_back(List);
         List->SetRole(Role);
         VarMap[Lexeme] = VariableRef::ListVar(List);
         return true;
@@ -126,64 +161,60 @@ VariableRef ConParser::ResolveToken(const Token& Tok)
         return VarMap[Lexeme];
     }
 
-    try
-    {
-        const int32 Val = std::stoi(Lexeme);
-        ConstStorage.emplace_back(std::make_unique<ConVariableAbsolute>(Val));
-        return VariableRef::LiteralVar(ConstStorage.back().get());
-    }
-    catch (const std::exception&)
+    // numbers were resolved above, so an unknown identifier or a stray colon is an error
+    throw ConParseError(Tok, "Unable to resolve token '" + Lexeme + "'");
+}
+
+VariableRef ConParser::InternLiteral(const int32 Value)
+{
+    ConVariableAbsolute*& Literal = LiteralPool[Value];
+    if (Literal == nullptr)
     {
-        throw ConParseError(Tok, "Unable to resolve token '" + Lexeme + "'");
+        Literal = Arena.New<ConVariableAbsolute>(Value);
     }
+    return VariableRef::LiteralVar(Literal);
 }
 
-std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
+std::vector<ConBaseOp*> ConParser::ParseTokens(const ConTokenSpan& Tokens)
 {
     std::vector<ConBaseOp*> Ops;
-    const size_t InitialOpStorageSize = OpStorage.size();
-    struct StackEntry
-    {
-        VariableRef Value;
-        Token TokenInfo;
-    };
-
-    std::vector<StackEntry> Stack;
+    std::vector<StackEntry>& Stack = OperandStack;
+    Stack.clear();
 
-    auto PushEntry = [&](const VariableRef& Ref, const Token& Tok)
+    auto PushEntry = [&](const VariableRef& Ref, const ConTokenView& Tok)
     {
         StackEntry Entry;
         Entry.Value = Ref;
-        Entry.TokenInfo = Tok;
+        Entry.TokenInfo = &Tok;
         Stack.push_back(Entry);
     };
 
-    auto PopValue = [&](const Token& Context) -> StackEntry
+    auto PopValue = [&](const ConTokenView& Context) -> StackEntry
     {
         if (Stack.empty())
         {
-            throw ConParseError(Context, "Not enough values before '" + Context.Lexeme + "'");
+            throw ConParseError(Context, "Not enough values before '" + std::string(Context.Lexeme) + "'");
         }
         StackEntry Entry = Stack.back();
         Stack.pop_back();
         if (!Entry.Value.IsValid())
         {
-            throw ConParseError(Entry.TokenInfo, "Invalid value before '" + Context.Lexeme + "'");
+            throw ConParseError(*Entry.TokenInfo, "Invalid value before '" + std::string(Context.Lexeme) + "'");
         }
         return Entry;
     };
 
-    auto PopThread = [&](const Token& Context) -> StackEntry
+    auto PopThread = [&](const ConTokenView& Context) -> StackEntry
     {
         StackEntry Entry = PopValue(Context);
         if (!Entry.Value.IsThread())
         {
-            throw ConParseError(Entry.TokenInfo, "Expected thread variable");
+            throw ConParseError(*Entry.TokenInfo, "Expected thread variable");
         }
         return Entry;
     };
 
-    auto PopSetDestination = [&](const Token& Context) -> StackEntry
+    auto PopSetDestination = [&](const ConTokenView& Context) -> StackEntry
     {
         StackEntry Entry = PopValue(Context);
         if (Entry.Value.IsThread())
@@ -195,31 +226,31 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
             ConVariableList* List = Entry.Value.GetList();
             if (List == nullptr)
             {
-                throw ConParseError(Entry.TokenInfo, "SET destination list is invalid");
+                throw ConParseError(*Entry.TokenInfo, "SET destination list is invalid");
             }
             if (!List->IsOutput())
             {
-                throw ConParseError(Entry.TokenInfo, "SET destination must be a thread or OUT list variable");
+                throw ConParseError(*Entry.TokenInfo, "SET destination must be a thread or OUT list variable");
             }
             return Entry;
         }
-        throw ConParseError(Entry.TokenInfo, "SET destination must be a thread or OUT list variable");
+        throw ConParseError(*Entry.TokenInfo, "SET destination must be a thread or OUT list variable");
     };
 
     auto IsInlineSet = [&](int32 Index) -> bool
     {
-        return Index >= 2 && Tokens.at(Index - 2).Kind == ConTokenType::Identifier && Tokens.at(Index - 2).Lexeme == "SET";
+        return Index >= 2 && Tokens[Index - 2].Keyword == ConKeyword::Set;
     };
 
     auto ResolveInlineDestination = [&](int32 Index) -> StackEntry
     {
-        const Token& DestToken = Tokens.at(Index - 1);
+        const ConTokenView& DestToken = Tokens[Index - 1];
         VariableRef Dst = ResolveToken(DestToken);
         if (Dst.IsThread())
         {
             StackEntry Entry;
             Entry.Value = Dst;
-            Entry.TokenInfo = DestToken;
+            Entry.TokenInfo = &DestToken;
             return Entry;
         }
         if (Dst.IsList())
@@ -235,37 +266,25 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
             }
             StackEntry Entry;
             Entry.Value = Dst;
-            Entry.TokenInfo = DestToken;
+            Entry.TokenInfo = &DestToken;
             return Entry;
         }
         throw ConParseError(DestToken, "Inline destination must be a thread or OUT list variable");
     };
 
-    auto StoreOp = [&](std::unique_ptr<ConBaseOp> Op, const StackEntry& ResultEntry, const Token& OpToken)
+    // ops from a line that fails to parse stay in the arena until the next Reset; the parse fails anyway
+    auto StoreOp = [&](ConBaseOp* Op, const StackEntry& ResultEntry, const ConTokenView& OpToken)
     {
         Op->SetSourceLocation({OpToken.Line, OpToken.Column});
-        OpStorage.emplace_back(std::move(Op));
-        ConBaseOp* Stored = OpStorage.back().get();
-        Ops.push_back(Stored);
+        Ops.push_back(Op);
         Stack.push_back(ResultEntry);
     };
 
-    static const std::unordered_map<std::string, ConBinaryOpKind> BinaryOpMap =
-    {
-        {"ADD", ConBinaryOpKind::Add},
-        {"SUB", ConBinaryOpKind::Sub},
-        {"MUL", ConBinaryOpKind::Mul},
-        {"DIV", ConBinaryOpKind::Div},
-        {"AND", ConBinaryOpKind::And},
-        {"OR", ConBinaryOpKind::Or},
-        {"XOR", ConBinaryOpKind::Xor}
-    };
-
     try
     {
         for (int32 i = static_cast<int32>(Tokens.size()) - 1; i >= 0; --i)
         {
-            const Token& Tok = Tokens.at(i);
+            const ConTokenView& Tok = Tokens[i];
             if (Tok.Kind == ConTokenType::Colon)
             {
                 continue;
@@ -273,31 +292,30 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
 
             if (Tok.Kind == ConTokenType::Identifier)
             {
-                auto BinaryIt = BinaryOpMap.find(Tok.Lexeme);
+                ConBinaryOpKind Kind = ConBinaryOpKind::Add;
 
-                if (Tok.Lexeme == "SET")
+                if (Tok.Keyword == ConKeyword::Set)
                 {
                     StackEntry DstEntry = PopSetDestination(Tok);
                     StackEntry SrcEntry = PopValue(Tok);
                     std::vector<VariableRef> Args = {DstEntry.Value, SrcEntry.Value};
-                    StoreOp(std::make_unique<ConSetOp>(Args), DstEntry, Tok);
+                    StoreOp(Arena.New<ConSetOp>(std::move(Args)), DstEntry, Tok);
                 }
-                else if (Tok.Lexeme == "SWP")
+                else if (Tok.Keyword == ConKeyword::Swp)
                 {
                     StackEntry VarEntry = PopThread(Tok);
                     std::vector<VariableRef> Args = {VarEntry.Value};
-                    StoreOp(std::make_unique<ConSwpOp>(Args), VarEntry, Tok);
+                    StoreOp(Arena.New<ConSwpOp>(std::move(Args)), VarEntry, Tok);
                 }
-                else if (BinaryIt != BinaryOpMap.end())
+                else if (FindBinaryOp(Tok.Keyword, Kind))
                 {
-                    const ConBinaryOpKind Kind = BinaryIt->second;
                     if (IsInlineSet(i))
                     {
                         StackEntry SrcA = PopValue(Tok);
                         StackEntry SrcB = PopValue(Tok);
                         StackEntry DstEntry = ResolveInlineDestination(i);
                         std::vector<VariableRef> Args = {DstEntry.Value, SrcA.Value, SrcB.Value};
-                        StoreOp(std::make_unique<ConBinaryOp>(Kind, Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConBinaryOp>(Kind, std::move(Args)), DstEntry, Tok);
                         i -= 2;
                     }
                     else
@@ -305,48 +323,48 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
                         StackEntry DstEntry = PopThread(Tok);
                         StackEntry SrcEntry = PopValue(Tok);
                         std::vector<VariableRef> Args = {DstEntry.Value, SrcEntry.Value};
-                        StoreOp(std::make_unique<ConBinaryOp>(Kind, Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConBinaryOp>(Kind, std::move(Args)), DstEntry, Tok);
                     }
                 }
-                else if (Tok.Lexeme == "INCR" || Tok.Lexeme == "DECR")
+                else if (Tok.Keyword == ConKeyword::Incr || Tok.Keyword == ConKeyword::Decr)
                 {
                     StackEntry DstEntry = PopThread(Tok);
-                    if (Tok.Lexeme == "INCR")
+                    if (Tok.Keyword == ConKeyword::Incr)
                     {
                         std::vector<VariableRef> Args = {DstEntry.Value};
-                        StoreOp(std::make_unique<ConIncrOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConIncrOp>(std::move(Args)), DstEntry, Tok);
                     }
                     else
                     {
                         std::vector<VariableRef> Args = {DstEntry.Value};
-                        StoreOp(std::make_unique<ConDecrOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConDecrOp>(std::move(Args)), DstEntry, Tok);
                     }
                 }
-                else if (Tok.Lexeme == "NOT")
+                else if (Tok.Keyword == ConKeyword::Not)
                 {
                     if (IsInlineSet(i))
                     {
                         StackEntry SrcEntry = PopValue(Tok);
                         StackEntry DstEntry = ResolveInlineDestination(i);
                         std::vector<VariableRef> Args = {DstEntry.Value, SrcEntry.Value};
-                        StoreOp(std::make_unique<ConNotOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConNotOp>(std::move(Args)), DstEntry, Tok);
                         i -= 2;
                     }
                     else
                     {
                         StackEntry DstEntry = PopThread(Tok);
                         std::vector<VariableRef> Args = {DstEntry.Value};
-                        StoreOp(std::make_unique<ConNotOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConNotOp>(std::move(Args)), DstEntry, Tok);
                     }
                 }
-                else if (Tok.Lexeme == "POP")
+                else if (Tok.Keyword == ConKeyword::Pop)
                 {
                     if (IsInlineSet(i))
                     {
                         StackEntry ListEntry = PopValue(Tok);
                         StackEntry DstEntry = ResolveInlineDestination(i);
                         std::vector<VariableRef> Args = {DstEntry.Value, ListEntry.Value};
-                        StoreOp(std::make_unique<ConPopOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConPopOp>(std::move(Args)), DstEntry, Tok);
                         i -= 2;
                     }
                     else
@@ -354,10 +372,10 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
                         StackEntry DstEntry = PopThread(Tok);
                         StackEntry ListEntry = PopValue(Tok);
                         std::vector<VariableRef> Args = {DstEntry.Value, ListEntry.Value};
-                        StoreOp(std::make_unique<ConPopOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConPopOp>(std::move(Args)), DstEntry, Tok);
                     }
                 }
-                else if (Tok.Lexeme == "AT")
+                else if (Tok.Keyword == ConKeyword::At)
                 {
                     if (IsInlineSet(i))
                     {
@@ -365,7 +383,7 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
                         StackEntry IndexEntry = PopValue(Tok);
                         StackEntry DstEntry = ResolveInlineDestination(i);
                         std::vector<VariableRef> Args = {DstEntry.Value, ListEntry.Value, IndexEntry.Value};
-                        StoreOp(std::make_unique<ConAtOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConAtOp>(std::move(Args)), DstEntry, Tok);
                         i -= 2;
                     }
                     else
@@ -374,7 +392,7 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
                         StackEntry ListEntry = PopValue(Tok);
                         StackEntry IndexEntry = PopValue(Tok);
                         std::vector<VariableRef> Args = {DstEntry.Value, ListEntry.Value, IndexEntry.Value};
-                        StoreOp(std::make_unique<ConAtOp>(Args), DstEntry, Tok);
+                        StoreOp(Arena.New<ConAtOp>(std::move(Args)), DstEntry, Tok);
                     }
                 }
                 else
@@ -393,10 +411,6 @@ std::vector<ConBaseOp*> ConParser::ParseTokens(const std::vector<Token>& Tokens)
     catch (const ConParseError& Error)
     {
         ReportError(Error);
-        while (OpStorage.size() > InitialOpStorageSize)
-        {
-            OpStorage.pop_back();
-        }
         Ops.clear();
     }
 
@@ -410,7 +424,9 @@ enum class ParsedLineType
     Loop,
     Redo,
     Jump,
-    Return
+    Return,
+    Send,
+    Listen
 };
 
 struct ParsedLine
@@ -433,213 +449,305 @@ struct ParsedLine
     std::string SourceText;
     VariableRef ReturnValue;
     bool bHasReturnValue = false;
+    int32 Channel = -1;
+    VariableRef ChannelOperand;
 };
 
-bool ConParser::Parse(const std::vector<std::string>& Lines, ConThread& OutThread)
+namespace
 {
-    Reset();
-    Errors.clear();
-    bHadError = false;
-
-    Scanner Tokenizer(Lines);
-    std::vector<TokenLine> TokenLines = Tokenizer.Scan();
-    const std::vector<std::string>& ScanErrors = Tokenizer.GetErrors();
-    Errors.insert(Errors.end(), ScanErrors.begin(), ScanErrors.end());
-    if (!ScanErrors.empty())
+// the generated line that closes a REDO IF block and checks its condition again
+ParsedLine MakeLoopCheck(const ParsedLine& LoopLine)
+{
+    ParsedLine RedoLine;
+    RedoLine.Indent = LoopLine.Indent;
+    RedoLine.Kind = ParsedLineType::Redo;
+    RedoLine.Cmp = LoopLine.Cmp;
+    RedoLine.Lhs = LoopLine.Lhs;
+    RedoLine.Rhs = LoopLine.Rhs;
+    RedoLine.Invert = LoopLine.Invert;
+    RedoLine.Location = LoopLine.Location;
+    if (!LoopLine.SourceText.empty())
     {
-        bHadError = true;
-        return false;
+        RedoLine.SourceText = LoopLine.SourceText + "  (loop check)";
     }
-
-    std::vector<ParsedLine> Parsed;
-    Parsed.reserve(TokenLines.size());
-
-    struct LoopEntry
+    else
     {
-        int32 Indent;
-        int32 LoopIndex;
-    };
-    std::vector<LoopEntry> LoopStack;
+        RedoLine.SourceText = "REDO";
+    }
+    return RedoLine;
+}
 
-    auto AppendRedoForLoop = [&](const LoopEntry& Entry)
+ConLine BuildLine(ParsedLine& P)
+{
+    ConLine Line;
+    switch (P.Kind)
     {
-        if (Entry.LoopIndex < 0 || Entry.LoopIndex >= static_cast<int32>(Parsed.size()))
-        {
-            return;
-        }
+    case ParsedLineType::Ops:
+        Line.SetOps(std::move(P.Ops), P.Location);
+        break;
+    case ParsedLineType::If:
+        Line.SetIf(P.Cmp, P.Lhs, P.Rhs, P.SkipCount, P.Invert, P.Location);
+        break;
+    case ParsedLineType::Loop:
+        Line.SetLoop(P.Cmp, P.Lhs, P.Rhs, P.Invert, P.LoopExitIndex, P.Location);
+        break;
+    case ParsedLineType::Redo:
+        Line.SetRedo(P.TargetIndex, P.Counter, P.InfiniteLoop, P.Cmp, P.Lhs, P.Rhs, P.Invert, P.Location);
+        break;
+    case ParsedLineType::Jump:
+        Line.SetJump(P.TargetIndex, P.Cmp, P.Lhs, P.Rhs, P.Invert, P.Location);
+        break;
+    case ParsedLineType::Return:
+        Line.SetReturn(P.ReturnValue, P.bHasReturnValue, P.Location);
+        break;
+    case ParsedLineType::Send:
+        Line.SetSend(P.Channel, P.ChannelOperand, P.Location);
+        break;
+    case ParsedLineType::Listen:
+        Line.SetListen(P.Channel, P.ChannelOperand, P.Location);
+        break;
+    }
+    Line.SetSourceText(std::move(P.SourceText));
+    return Line;
+}
 
-        const ParsedLine& LoopLine = Parsed[Entry.LoopIndex];
-        ParsedLine RedoLine;
-        RedoLine.Indent = LoopLine.Indent;
-        RedoLine.Kind = ParsedLineType::Redo;
-        RedoLine.Cmp = LoopLine.Cmp;
-        RedoLine.Lhs = LoopLine.Lhs;
-        RedoLine.Rhs = LoopLine.Rhs;
-        RedoLine.Invert = LoopLine.Invert;
-        RedoLine.Location = LoopLine.Location;
-        if (!LoopLine.SourceText.empty())
-        {
-            RedoLine.SourceText = LoopLine.SourceText + "  (loop check)";
-        }
-        else
-        {
-            RedoLine.SourceText = "REDO";
-        }
-        Parsed.push_back(std::move(RedoLine));
-    };
+std::string MissingLabelMessage(const std::string& Label)
+{
+    return "JUMP target label not found: " + Label;
+}
 
-    for (size_t LineIndex = 0; LineIndex < TokenLines.size(); ++LineIndex)
+// grows or shrinks the range of OldCount items at Start to NewCount, moving only what follows it
+template <typename T>
+void ResizeRange(std::vector<T>& Items, const size_t Start, const size_t OldCount, const size_t NewCount)
+{
+    if (NewCount > OldCount)
+    {
+        Items.insert(Items.begin() + static_cast<std::ptrdiff_t>(Start + OldCount), NewCount - OldCount, T());
+    }
+    else if (NewCount < OldCount)
     {
-        const TokenLine& LineTokens = TokenLines[LineIndex];
-        const int32 CurrentIndent = LineTokens.Indent;
+        Items.erase(Items.begin() + static_cast<std::ptrdiff_t>(Start + NewCount), Items.begin() + static_cast<std::ptrdiff_t>(Start + OldCount));
+    }
+}
+}
 
-        while (!LoopStack.empty() && CurrentIndent <= LoopStack.back().Indent)
-        {
-            LoopEntry Entry = LoopStack.back();
-            LoopStack.pop_back();
-            AppendRedoForLoop(Entry);
-        }
+void ConParser::ParseLine(const ConScannedSource& Source, const size_t LineIndex, ParsedLine& P)
+{
+    const ConScannedLine& Line = Source.Lines[LineIndex];
+    P.Indent = Line.Indent;
+    P.SourceText = std::string(Line.Text);
 
-        ParsedLine P;
-        P.Indent = CurrentIndent;
-        if (LineIndex < Lines.size())
-        {
-            P.SourceText = Lines[LineIndex];
-        }
+    ConTokenSpan Tokens = Source.GetTokens(Line);
 
-        std::vector<Token> Tokens = LineTokens.Tokens;
+    if (Tokens.size() >= 2 && Tokens[0].Kind == ConTokenType::Identifier && Tokens[1].Kind == ConTokenType::Colon)
+    {
+        P.Label = std::string(Tokens[0].Lexeme);
+        Tokens.Data += 2;
+        Tokens.Count -= 2;
+    }
 
-        if (Tokens.size() >= 2 && Tokens[0].Kind == ConTokenType::Identifier && Tokens[1].Kind == ConTokenType::Colon)
-        {
-            P.Label = Tokens[0].Lexeme;
-            Tokens.erase(Tokens.begin(), Tokens.begin() + 2);
-        }
+    if (Tokens.empty())
+    {
+        return;
+    }
 
-        if (Tokens.empty())
+    const ConTokenView& CommandToken = Tokens[0];
+    P.Location = {CommandToken.Line, CommandToken.Column};
+    const ConKeyword Command = CommandToken.Keyword;
+
+    auto EnsureArgs = [&](size_t Count, const char* Message) -> bool
+    {
+        if (Tokens.size() < Count)
         {
-            Parsed.push_back(std::move(P));
-            continue;
+            ReportError(CommandToken, Message);
+            return false;
         }
+        return true;
+    };
 
-        const Token& CommandToken = Tokens[0];
-        P.Location = {CommandToken.Line, CommandToken.Column};
-        const std::string& Command = CommandToken.Lexeme;
-
-        auto EnsureArgs = [&](size_t Count, const std::string& Message) -> bool
+    try
+    {
+        if (Command == ConKeyword::If || Command == ConKeyword::Ifn)
         {
-            if (Tokens.size() < Count)
+            constexpr size_t SingleOperandIfTokenCount = 2;
+            constexpr size_t ComparisonIfTokenCount = 4;
+            if (Tokens.size() == SingleOperandIfTokenCount)
             {
-                ReportError(CommandToken, Message);
-                return false;
+                P.Kind = ParsedLineType::If;
+                P.Invert = Command == ConKeyword::Ifn;
+                P.Cmp = ConConditionOp::None;
+                P.Lhs = ResolveToken(Tokens[1]);
+                return;
             }
-            return true;
-        };
-
-        try
+            if (!EnsureArgs(ComparisonIfTokenCount, "IF requires either a single operand or a comparison with two operands"))
+            {
+                return;
+            }
+            P.Kind = ParsedLineType::If;
+            P.Invert = Command == ConKeyword::Ifn;
+            P.Cmp = ParseComparisonToken(Tokens[1]);
+            P.Lhs = ResolveToken(Tokens[2]);
+            P.Rhs = ResolveToken(Tokens[3]);
+        }
+        else if (Command == ConKeyword::Redo)
         {
-            if (Command == "IF" || Command == "IFN")
+            constexpr size_t ExactSingleOperandRedoTokenCount = 3;
+            constexpr size_t MinComparisonRedoTokenCount = 5;
+            if (Tokens.size() >= 2 && (Tokens[1].Keyword == ConKeyword::If || Tokens[1].Keyword == ConKeyword::Ifn))
             {
-                constexpr size_t SingleOperandIfTokenCount = 2;
-                constexpr size_t ComparisonIfTokenCount = 4;
-                if (Tokens.size() == SingleOperandIfTokenCount)
+                P.Kind = ParsedLineType::Loop;
+                P.Invert = Tokens[1].Keyword == ConKeyword::Ifn;
+                if (Tokens.size() == ExactSingleOperandRedoTokenCount)
                 {
-                    P.Kind = ParsedLineType::If;
-                    P.Invert = Command == "IFN";
                     P.Cmp = ConConditionOp::None;
-                    P.Lhs = ResolveToken(Tokens[1]);
-                    Parsed.push_back(std::move(P));
-                    continue;
+                    P.Lhs = ResolveToken(Tokens[2]);
                 }
-                if (!EnsureArgs(ComparisonIfTokenCount, "IF requires either a single operand or a comparison with two operands"))
+                else if (Tokens.size() >= MinComparisonRedoTokenCount &&
+                    IsComparisonToken(Tokens[3]))
                 {
-                    Parsed.push_back(std::move(P));
-                    continue;
-                }
-                P.Kind = ParsedLineType::If;
-                P.Invert = Command == "IFN";
-                P.Cmp = ParseComparisonToken(Tokens[1].Lexeme);
-                P.Lhs = ResolveToken(Tokens[2]);
-                P.Rhs = ResolveToken(Tokens[3]);
-            }
-            else if (Command == "REDO")
-            {
-                constexpr size_t ExactSingleOperandRedoTokenCount = 3;
-                constexpr size_t MinComparisonRedoTokenCount = 5;
-                if (Tokens.size() >= 2 && Tokens[1].Kind == ConTokenType::Identifier &&
-                    (Tokens[1].Lexeme == "IF" || Tokens[1].Lexeme == "IFN"))
-                {
-                    P.Kind = ParsedLineType::Loop;
-                    P.Invert = Tokens[1].Lexeme == "IFN";
-                    if (Tokens.size() == ExactSingleOperandRedoTokenCount)
-                    {
-                        P.Cmp = ConConditionOp::None;
-                        P.Lhs = ResolveToken(Tokens[2]);
-                    }
-                    else if (Tokens.size() >= MinComparisonRedoTokenCount &&
-                        Tokens[3].Kind == ConTokenType::Identifier && IsComparisonToken(Tokens[3].Lexeme))
-                    {
-                        P.Cmp = ParseComparisonToken(Tokens[3].Lexeme);
-                        P.Lhs = ResolveToken(Tokens[2]);
-                        P.Rhs = ResolveToken(Tokens[4]);
-                    }
-                    else
-                    {
-                        throw ConParseError(CommandToken, "REDO now requires 'IF' followed by either a single operand or a comparison");
-                    }
+                    P.Cmp = ParseComparisonToken(Tokens[3]);
+                    P.Lhs = ResolveToken(Tokens[2]);
+                    P.Rhs = ResolveToken(Tokens[4]);
                 }
                 else
                 {
                     throw ConParseError(CommandToken, "REDO now requires 'IF' followed by either a single operand or a comparison");
                 }
             }
-            else if (Command == "LOOP")
+            else
             {
-                throw ConParseError(CommandToken, "'LOOP' has been removed; use 'REDO IF' instead");
+                throw ConParseError(CommandToken, "REDO now requires 'IF' followed by either a single operand or a comparison");
             }
-            else if (Command == "JUMP")
+        }
+        else if (Command == ConKeyword::Loop)
+        {
+            throw ConParseError(CommandToken, "'LOOP' has been removed; use 'REDO IF' instead");
+        }
+        else if (Command == ConKeyword::Jump)
+        {
+            P.Kind = ParsedLineType::Jump;
+            size_t LabelIndex = 1;
+            if (Tokens.size() >= 5 && IsComparisonToken(Tokens[1]))
             {
-                P.Kind = ParsedLineType::Jump;
-                size_t LabelIndex = 1;
-                if (Tokens.size() >= 5 && Tokens[1].Kind == ConTokenType::Identifier && IsComparisonToken(Tokens[1].Lexeme))
-                {
-                    P.Cmp = ParseComparisonToken(Tokens[1].Lexeme);
-                    P.Lhs = ResolveToken(Tokens[2]);
-                    P.Rhs = ResolveToken(Tokens[3]);
-                    LabelIndex = 4;
-                }
-                if (LabelIndex < Tokens.size())
-                {
-                    P.TargetLabel = Tokens[LabelIndex].Lexeme;
-                }
-                else
-                {
-                    ReportError(CommandToken, "JUMP requires a label target");
-                }
+                P.Cmp = ParseComparisonToken(Tokens[1]);
+                P.Lhs = ResolveToken(Tokens[2]);
+                P.Rhs = ResolveToken(Tokens[3]);
+                LabelIndex = 4;
             }
-            else if (Command == "RET")
+            if (LabelIndex < Tokens.size())
             {
-                P.Kind = ParsedLineType::Return;
-                if (Tokens.size() > 2)
-                {
-                    ReportError(Tokens[2], "RET accepts at most one argument");
-                }
-                if (Tokens.size() >= 2)
-                {
-                    P.ReturnValue = ResolveToken(Tokens[1]);
-                    P.bHasReturnValue = true;
-                }
+                P.TargetLabel = std::string(Tokens[LabelIndex].Lexeme);
             }
             else
             {
-                P.Kind = ParsedLineType::Ops;
-                P.Ops = ParseTokens(Tokens);
+                ReportError(CommandToken, "JUMP requires a label target");
+            }
+        }
+        else if (Command == ConKeyword::Ret)
+        {
+            P.Kind = ParsedLineType::Return;
+            if (Tokens.size() > 2)
+            {
+                ReportError(Tokens[2], "RET accepts at most one argument");
+            }
+            if (Tokens.size() >= 2)
+            {
+                P.ReturnValue = ResolveToken(Tokens[1]);
+                P.bHasReturnValue = true;
+            }
+        }
+        else if (Command == ConKeyword::Send)
+        {
+            if (Tokens.size() != 3)
+            {
+                throw ConParseError(CommandToken, "SEND requires a target thread and a value");
+            }
+            P.Kind = ParsedLineType::Send;
+            P.Channel = ParseThreadTarget(Tokens[1]);
+            P.ChannelOperand = ResolveToken(Tokens[2]);
+            if (P.ChannelOperand.IsList())
+            {
+                throw ConParseError(Tokens[2], "SEND value must be a thread variable or literal");
+            }
+        }
+        else if (Command == ConKeyword::Lstn)
+        {
+            if (Tokens.size() != 3)
+            {
+                throw ConParseError(CommandToken, "LSTN requires a destination and a source thread");
             }
+            P.Kind = ParsedLineType::Listen;
+            P.ChannelOperand = ResolveToken(Tokens[1]);
+            if (!P.ChannelOperand.IsThread())
+            {
+                throw ConParseError(Tokens[1], "LSTN destination must be a thread variable");
+            }
+            P.Channel = ParseThreadTarget(Tokens[2]);
         }
-        catch (const ConParseError& Error)
+        else
         {
-            ReportError(Error);
+            P.Kind = ParsedLineType::Ops;
+            P.Ops = ParseTokens(Tokens);
         }
+    }
+    catch (const ConParseError& Error)
+    {
+        ReportError(Error);
+    }
+}
 
+bool ConParser::Parse(const std::vector<std::string>& Lines, ConThread& OutThread)
+{
+    Scanner::ScanLines(Lines, Scanned);
+    return Parse(Scanned, OutThread);
+}
+
+bool ConParser::Parse(const ConScannedSource& Source, ConThread& OutThread)
+{
+    Reset();
+    Errors.clear();
+    bHadError = false;
+
+    if (!Source.Errors.empty())
+    {
+        Errors = Source.Errors;
+        bHadError = true;
+        return false;
+    }
+
+    std::vector<ParsedLine> Parsed;
+    Parsed.reserve(Source.Lines.size());
+
+    struct LoopEntry
+    {
+        int32 Indent;
+        int32 LoopIndex;
+    };
+    std::vector<LoopEntry> LoopStack;
+
+    auto AppendRedoForLoop = [&](const LoopEntry& Entry)
+    {
+        if (Entry.LoopIndex < 0 || Entry.LoopIndex >= static_cast<int32>(Parsed.size()))
+        {
+            return;
+        }
+
+        Parsed.push_back(MakeLoopCheck(Parsed[Entry.LoopIndex]));
+    };
+
+    for (size_t LineIndex = 0; LineIndex < Source.Lines.size(); ++LineIndex)
+    {
+        const int32 CurrentIndent = Source.Lines[LineIndex].Indent;
+
+        while (!LoopStack.empty() && CurrentIndent <= LoopStack.back().Indent)
+        {
+            LoopEntry Entry = LoopStack.back();
+            LoopStack.pop_back();
+            AppendRedoForLoop(Entry);
+        }
+
+        ParsedLine P;
+        ParseLine(Source, LineIndex, P);
         Parsed.push_back(std::move(P));
 
         if (!Parsed.empty() && Parsed.back().Kind == ParsedLineType::Loop)
@@ -694,7 +802,7 @@ bool ConParser::Parse(const std::vector<std::string>& Lines, ConThread& OutThrea
             }
             if (Match < 0)
             {
-                ReportError(Token{}, "Loop check must have a matching REDO IF header");
+                ReportError(ConTokenView{}, "Loop check must have a matching REDO IF header");
             }
             else
             {
@@ -728,7 +836,7 @@ bool ConParser::Parse(const std::vector<std::string>& Lines, ConThread& OutThrea
             auto ItLabel = LabelMap.find(P.TargetLabel);
             if (ItLabel == LabelMap.end())
             {
-                ReportError(Token{}, "JUMP target label not found: " + P.TargetLabel);
+                ReportError(ConTokenView{}, MissingLabelMessage(P.TargetLabel));
             }
             else
             {
@@ -742,38 +850,11 @@ bool ConParser::Parse(const std::vector<std::string>& Lines, ConThread& OutThrea
         return false;
     }
 
-    std::vector<ConVariableCached*> Vars;
-    for (auto& V : VarStorage)
+    ConThread Thread(VarStorage);
+    Thread.ReserveLines(Parsed.size());
+    for (ParsedLine& P : Parsed)
     {
-        Vars.push_back(V.get());
-    }
-    ConThread Thread(Vars);
-    for (const ParsedLine& P : Parsed)
-    {
-        ConLine Line;
-        switch (P.Kind)
-        {
-        case ParsedLineType::Ops:
-            Line.SetOps(P.Ops, P.Location);
-            break;
-        case ParsedLineType::If:
-            Line.SetIf(P.Cmp, P.Lhs, P.Rhs, P.SkipCount, P.Invert, P.Location);
-            break;
-        case ParsedLineType::Loop:
-            Line.SetLoop(P.Cmp, P.Lhs, P.Rhs, P.Invert, P.LoopExitIndex, P.Location);
-            break;
-        case ParsedLineType::Redo:
-            Line.SetRedo(P.TargetIndex, P.Counter, P.InfiniteLoop, P.Cmp, P.Lhs, P.Rhs, P.Invert, P.Location);
-            break;
-        case ParsedLineType::Jump:
-            Line.SetJump(P.TargetIndex, P.Cmp, P.Lhs, P.Rhs, P.Invert, P.Location);
-            break;
-        case ParsedLineType::Return:
-            Line.SetReturn(P.ReturnValue, P.bHasReturnValue, P.Location);
-            break;
-        }
-        Line.SetSourceText(P.SourceText);
-        Thread.ConstructLine(Line);
+        Thread.ConstructLine(BuildLine(P));
     }
     std::unordered_map<std::string, ConVariableList*> ListNameMap;
     for (const auto& Pair : VarMap)
@@ -793,7 +874,193 @@ bool ConParser::Parse(const std::vector<std::string>& Lines, ConThread& OutThrea
         }
     }
 
-    Thread.SetOwnedStorage(std::move(VarStorage), std::move(ConstStorage), std::move(ListStorage), std::move(OpStorage), std::move(ListNameMap));
+    Thread.SetOwnedStorage(std::move(Arena), RegisterStorage, std::move(ListStorage), std::move(ListNameMap));
+    // line costs are fixed once parsed; the executed counter charges them per visit
+    Thread.UpdateCycleCount();
+    Thread.CompileBytecode();
     OutThread = std::move(Thread);
     return true;
 }
+
+void ConParser::BeginLines()
+{
+    Reset();
+    Errors.clear();
+    bHadError = false;
+}
+
+void ConParser::SummarizeLine(const ConScannedSource& Source, const size_t LineIndex, ConLineSummary& Out)
+{
+    const size_t FirstError = Errors.size();
+    ParsedLine P;
+    ParseLine(Source, LineIndex, P);
+    Out.Errors.assign(Errors.begin() + static_cast<std::ptrdiff_t>(FirstError), Errors.end());
+    Errors.resize(FirstError);
+    Out.bScanError = false;
+    Out.Label = P.Label;
+    Out.bJump = P.Kind == ParsedLineType::Jump;
+    Out.JumpTarget = P.TargetLabel;
+    Out.Cycles = 0;
+    if (!Out.Errors.empty())
+    {
+        // a program with errors has no cycle count
+        return;
+    }
+
+    const int32 VarCount = static_cast<int32>(VarStorage.size());
+    if (P.Kind == ParsedLineType::Loop)
+    {
+        ParsedLine Check = MakeLoopCheck(P);
+        ConLine CheckLine = BuildLine(Check);
+        CheckLine.UpdateCycleCount(VarCount);
+        Out.Cycles += CheckLine.GetCycleCount();
+    }
+    ConLine Line = BuildLine(P);
+    Line.UpdateCycleCount(VarCount);
+    Out.Cycles += Line.GetCycleCount();
+}
+
+bool ConIncrementalParser::Update(const std::vector<std::string>& Lines)
+{
+    const size_t OldCount = SourceLines.size();
+    const size_t NewCount = Lines.size();
+    const size_t SharedCount = std::min(OldCount, NewCount);
+
+    size_t Prefix = 0;
+    while (Prefix < SharedCount && SourceLines[Prefix] == Lines[Prefix])
+    {
+        ++Prefix;
+    }
+    if (bHasResult && Prefix == OldCount && OldCount == NewCount)
+    {
+        ReparsedLineCount = 0;
+        return bValid;
+    }
+    size_t Suffix = 0;
+    while (Suffix < SharedCount - Prefix && SourceLines[OldCount - 1 - Suffix] == Lines[NewCount - 1 - Suffix])
+    {
+        ++Suffix;
+    }
+
+    // swap the edited range [Prefix, End) for the new lines and keep everything around it
+    const size_t OldEnd = OldCount - Suffix;
+    const size_t NewEnd = NewCount - Suffix;
+    for (size_t Index = Prefix; Index < OldEnd; ++Index)
+    {
+        Count(Summaries[Index], -1);
+    }
+    ResizeRange(SourceLines, Prefix, OldEnd - Prefix, NewEnd - Prefix);
+    ResizeRange(Summaries, Prefix, OldEnd - Prefix, NewEnd - Prefix);
+    std::copy(Lines.begin() + Prefix, Lines.begin() + NewEnd, SourceLines.begin() + Prefix);
+
+    Parser.BeginLines();
+    ReparsedLineCount = 0;
+    for (size_t Index = Prefix; Index < NewEnd; ++Index)
+    {
+        ParseLine(Index);
+    }
+    if (OldEnd != NewEnd && ErrorLineCount > 0)
+    {
+        // errors carry their line number in the message, so moved lines with errors are parsed again
+        for (size_t Index = NewEnd; Index < NewCount; ++Index)
+        {
+            if (!Summaries[Index].Errors.empty())
+            {
+                Count(Summaries[Index], -1);
+                ParseLine(Index);
+            }
+        }
+    }
+
+    bHasResult = true;
+    bValid = ErrorLineCount == 0 && MissingLabelCount == 0;
+    CollectErrors();
+    return bValid;
+}
+
+void ConIncrementalParser::ParseLine(const size_t Index)
+{
+    LineTokens.Tokens.clear();
+    LineTokens.Lines.clear();
+    LineTokens.Errors.clear();
+    Scanner::AppendLine(SourceLines[Index], static_cast<int32>(Index + 1), LineTokens);
+    ConLineSummary& Summary = Summaries[Index];
+    if (LineTokens.Errors.empty())
+    {
+        Parser.SummarizeLine(LineTokens, 0, Summary);
+    }
+    else
+    {
+        Summary = ConLineSummary();
+        Summary.Errors = LineTokens.Errors;
+        Summary.bScanError = true;
+    }
+    Count(Summary, 1);
+    ++ReparsedLineCount;
+}
+
+void ConIncrementalParser::Count(const ConLineSummary& Summary, const int32 Sign)
+{
+    CycleTotal += Sign * Summary.Cycles;
+    if (!Summary.Errors.empty())
+    {
+        ErrorLineCount += Sign;
+        ScanErrorLineCount += Summary.bScanError ? Sign : 0;
+    }
+    auto Release = [this](const std::string& Label, const LabelUse& Use)
+    {
+        if (Use.Definitions == 0 && Use.Jumps == 0)
+        {
+            Labels.erase(Label);
+        }
+    };
+    if (!Summary.Label.empty())
+    {
+        LabelUse& Use = Labels[Summary.Label];
+        Use.Definitions += Sign;
+        // the first definition resolves every JUMP to the label, and losing the last one undoes it
+        if (Use.Definitions == (Sign > 0 ? 1 : 0))
+        {
+            MissingLabelCount -= Sign * Use.Jumps;
+        }
+        Release(Summary.Label, Use);
+    }
+    if (Summary.bJump)
+    {
+        LabelUse& Use = Labels[Summary.JumpTarget];
+        Use.Jumps += Sign;
+        if (Use.Definitions == 0)
+        {
+            MissingLabelCount += Sign;
+        }
+        Release(Summary.JumpTarget, Use);
+    }
+}
+
+void ConIncrementalParser::CollectErrors()
+{
+    Errors.clear();
+    if (bValid)
+    {
+        return;
+    }
+    // a full parse stops at scan errors, and reports missing labels after every line's own errors
+    for (const ConLineSummary& Summary : Summaries)
+    {
+        if (ScanErrorLineCount == 0 || Summary.bScanError)
+        {
+            Errors.insert(Errors.end(), Summary.Errors.begin(), Summary.Errors.end());
+        }
+    }
+    if (ScanErrorLineCount > 0 || MissingLabelCount == 0)
+    {
+        return;
+    }
+    for (const ConLineSummary& Summary : Summaries)
+    {
+        if (Summary.bJump && Labels.at(Summary.JumpTarget).Definitions == 0)
+        {
+            Errors.push_back(FormatErrorMessage(ConSourceLocation(), MissingLabelMessage(Summary.JumpTarget)));
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "arena.h"
 #include "errors.h"
 #include "scanner.h"
 #include "thread.h"
@@ -8,28 +9,120 @@
 #include <unordered_map>
 #include <vector>
 
+struct ParsedLine;
+
+// What a full parse needs from one line once the lines around it are known. The static cost and
+// labels of a line depend on nothing else, so ConIncrementalParser keeps one per source line.
+struct ConLineSummary
+{
+    // scan or parse errors, formatted with the line's number
+    std::vector<std::string> Errors;
+    // the errors are scan errors, and the line was not parsed
+    bool bScanError = false;
+    std::string Label;
+    bool bJump = false;
+    std::string JumpTarget;
+    // the line's static cycles plus those of the loop check a REDO IF line generates
+    int32 Cycles = 0;
+};
+
 struct ConParser
 {
     ConParser();
 
     bool Parse(const vector<string>& Lines, ConThread& OutThread);
+    // parses a scanned buffer in place, such as one from Scanner::ScanSource; nothing is copied
+    // out of its tokens but the lines' text and the names of new variables and labels
+    bool Parse(const ConScannedSource& Source, ConThread& OutThread);
     const std::vector<std::string>& GetErrors() const { return Errors; }
     bool HadError() const { return bHadError; }
 
+    // Line-at-a-time parsing for ConIncrementalParser. BeginLines frees what earlier lines
+    // allocated; SummarizeLine parses one scanned line on its own into Out, leaving GetErrors alone.
+    void BeginLines();
+    void SummarizeLine(const ConScannedSource& Source, size_t LineIndex, ConLineSummary& Out);
+
 private:
     void Reset();
+    // everything about a line that does not depend on the lines around it
+    void ParseLine(const ConScannedSource& Source, size_t LineIndex, ParsedLine& P);
 
-    std::vector<std::unique_ptr<ConVariableCached>> VarStorage;
-    std::vector<std::unique_ptr<ConVariableAbsolute>> ConstStorage;
-    std::vector<std::unique_ptr<ConVariableList>> ListStorage;
-    std::vector<std::unique_ptr<ConBaseOp>> OpStorage;
+    // registers, literals, lists and ops of the program being parsed; handed to the thread on success
+    ConArena Arena;
+    ConRegisterFile* RegisterStorage = nullptr;
+    std::vector<ConVariableCached*> VarStorage;
+    std::vector<ConVariableList*> ListStorage;
+    // one literal per distinct value; literals are never written, so operands can share them
+    std::unordered_map<int32, ConVariableAbsolute*> LiteralPool;
     std::unordered_map<std::string, VariableRef> VarMap;
     std::vector<std::string> Errors;
     bool bHadError = false;
+    // the tokens of Parse(Lines), kept to reuse their storage
+    ConScannedSource Scanned;
+    // an identifier being looked up in VarMap, reused so lookups do not allocate
+    std::string NameBuffer;
 
-    VariableRef ResolveToken(const Token& Tok);
-    std::vector<ConBaseOp*> ParseTokens(const std::vector<Token>& Tokens);
-    void ReportError(const Token& Tok, const std::string& Message);
+    struct StackEntry
+    {
+        VariableRef Value;
+        const ConTokenView* TokenInfo = nullptr;
+    };
+    // operand stack of ParseTokens, reused from line to line
+    std::vector<StackEntry> OperandStack;
+
+    VariableRef ResolveToken(const ConTokenView& Tok);
+    VariableRef InternLiteral(int32 Value);
+    std::vector<ConBaseOp*> ParseTokens(const ConTokenSpan& Tokens);
+    void ReportError(const ConTokenView& Tok, const std::string& Message);
     void ReportError(const ConParseError& Error);
 };
 
+// Re-parses a program as it is edited. Each update compares the new text with the last one and
+// parses only the lines that changed, keeping a ConLineSummary for every other line. Unchanged
+// lines are not touched when lines above them are inserted or removed, unless they carry errors,
+// whose messages name the line. The cycle total and the label and JUMP counts are adjusted for the
+// lines swapped in and out, so a clean edit costs the diff plus the edited lines however long the
+// program is. The diagnostics and cycle count match a full ConParser::Parse of the same text;
+// while there are errors, listing them in order walks the summaries once.
+class ConIncrementalParser
+{
+public:
+    // returns true when the current text parses cleanly; an unchanged text returns the last result
+    bool Update(const std::vector<std::string>& Lines);
+
+    bool IsValid() const { return bValid; }
+    const std::vector<std::string>& GetErrors() const { return Errors; }
+    // static cycle estimate of the last clean parse, 0 otherwise
+    int32 GetCycleCount() const { return bValid ? CycleTotal : 0; }
+    // lines scanned and parsed by the last update
+    size_t GetReparsedLineCount() const { return ReparsedLineCount; }
+
+private:
+    // how often a label is defined and jumped to
+    struct LabelUse
+    {
+        int32 Definitions = 0;
+        int32 Jumps = 0;
+    };
+
+    void ParseLine(size_t Index);
+    // adds a line's summary to the running totals, or takes it back out
+    void Count(const ConLineSummary& Summary, int32 Sign);
+    void CollectErrors();
+
+    ConParser Parser;
+    // the line being parsed, reused from line to line
+    ConScannedSource LineTokens;
+    std::vector<std::string> SourceLines;
+    std::vector<ConLineSummary> Summaries;
+    std::unordered_map<std::string, LabelUse> Labels;
+    std::vector<std::string> Errors;
+    int32 CycleTotal = 0;
+    int32 ErrorLineCount = 0;
+    int32 ScanErrorLineCount = 0;
+    // JUMP lines whose label is not defined anywhere
+    int32 MissingLabelCount = 0;
+    size_t ReparsedLineCount = 0;
+    bool bValid = false;
+    bool bHasResult = false;
+};
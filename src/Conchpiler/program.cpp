@@ -0,0 +1,193 @@
+#include "program.h"
+
+#include <string>
+#include <utility>
+
+namespace
+{
+std::string ThreadLabel(const size_t Index)
+{
+    return "T" + std::to_string(Index);
+}
+}
+
+void ConProgram::AddThread(ConThread&& Thread)
+{
+    Threads.push_back(std::move(Thread));
+}
+
+void ConProgram::SetChannelCapacity(const size_t Capacity)
+{
+    ChannelCapacity = Capacity > 0 ? Capacity : 1;
+}
+
+void ConProgram::Execute()
+{
+    RuntimeErrors.clear();
+    bDeadlocked = false;
+    bBudgetExhausted = false;
+    ExecutedCycles = 0;
+    ResetMailboxes();
+    BusyCycles.assign(Threads.size(), 0);
+    for (size_t Index = 0; Index < Threads.size(); ++Index)
+    {
+        Threads[Index].AttachToProgram(this, static_cast<int32>(Index));
+        Threads[Index].BeginRun();
+    }
+
+    while (true)
+    {
+        bool bAnyRunning = false;
+        bool bProgress = false;
+        for (size_t Index = 0; Index < Threads.size(); ++Index)
+        {
+            ConThread& Thread = Threads[Index];
+            if (BusyCycles[Index] > 0)
+            {
+                bAnyRunning = true;
+                bProgress = true;
+                continue;
+            }
+            if (Thread.IsFinished())
+            {
+                continue;
+            }
+            bAnyRunning = true;
+
+            // lines that cost nothing (blank lines, free loop heads) do not hold the thread for a cycle
+            ConStepResult Result = ConStepResult::Running;
+            do
+            {
+                const int32 CyclesBefore = Thread.GetExecutedCycleCount();
+                Result = Thread.StepLine();
+                if (Result == ConStepResult::Blocked)
+                {
+                    break;
+                }
+                bProgress = true;
+                BusyCycles[Index] = Thread.GetExecutedCycleCount() - CyclesBefore;
+            }
+            while (Result == ConStepResult::Running && BusyCycles[Index] == 0);
+
+            if (Result == ConStepResult::Error)
+            {
+                for (const std::string& Error : Thread.GetRuntimeErrors())
+                {
+                    RuntimeErrors.push_back(ThreadLabel(Index) + ": " + Error);
+                }
+                return;
+            }
+            if (Result == ConStepResult::BudgetExhausted)
+            {
+                bBudgetExhausted = true;
+                return;
+            }
+        }
+
+        if (!bAnyRunning)
+        {
+            return;
+        }
+        if (!bProgress)
+        {
+            ReportDeadlock();
+            return;
+        }
+
+        ++ExecutedCycles;
+        for (int32& Busy : BusyCycles)
+        {
+            if (Busy > 0)
+            {
+                --Busy;
+            }
+        }
+    }
+}
+
+void ConProgram::UpdateCycleCount()
+{
+    ConCompilable::UpdateCycleCount();
+    for (ConThread& Thread : Threads)
+    {
+        Thread.UpdateCycleCount();
+        AddCycles(Thread.GetCycleCount());
+    }
+}
+
+void ConProgram::ResetState()
+{
+    for (ConThread& Thread : Threads)
+    {
+        Thread.ResetState();
+    }
+    ResetMailboxes();
+    RuntimeErrors.clear();
+    bDeadlocked = false;
+    bBudgetExhausted = false;
+    ExecutedCycles = 0;
+}
+
+bool ConProgram::TrySend(const int32 From, const int32 To, const int32 Value)
+{
+    ConMailbox& Mailbox = GetMailbox(From, To);
+    if (Mailbox.Count == Mailbox.Slots.size())
+    {
+        return false;
+    }
+    Mailbox.Slots[(Mailbox.Head + Mailbox.Count) % Mailbox.Slots.size()] = Value;
+    ++Mailbox.Count;
+    return true;
+}
+
+bool ConProgram::TryReceive(const int32 To, const int32 From, int32& OutValue)
+{
+    ConMailbox& Mailbox = GetMailbox(From, To);
+    if (Mailbox.Count == 0)
+    {
+        return false;
+    }
+    OutValue = Mailbox.Slots[Mailbox.Head];
+    Mailbox.Head = (Mailbox.Head + 1) % Mailbox.Slots.size();
+    --Mailbox.Count;
+    return true;
+}
+
+ConProgram::ConMailbox& ConProgram::GetMailbox(const int32 From, const int32 To)
+{
+    return Mailboxes[static_cast<size_t>(From) * Threads.size() + static_cast<size_t>(To)];
+}
+
+void ConProgram::ResetMailboxes()
+{
+    Mailboxes.resize(Threads.size() * Threads.size());
+    for (ConMailbox& Mailbox : Mailboxes)
+    {
+        if (Mailbox.Slots.size() != ChannelCapacity)
+        {
+            Mailbox.Slots.assign(ChannelCapacity, 0);
+        }
+        Mailbox.Head = 0;
+        Mailbox.Count = 0;
+    }
+}
+
+void ConProgram::ReportDeadlock()
+{
+    bDeadlocked = true;
+    std::string Message = "Deadlock after " + std::to_string(ExecutedCycles) + " cycles:";
+    for (size_t Index = 0; Index < Threads.size(); ++Index)
+    {
+        const ConLine* Line = Threads[Index].IsFinished() ? nullptr : Threads[Index].GetCurrentLine();
+        if (Line == nullptr)
+        {
+            continue;
+        }
+        Message += " " + ThreadLabel(Index) + " blocked on ";
+        Message += Line->GetKind() == ConLineKind::Send ? "SEND to " : "LSTN from ";
+        Message += ThreadLabel(static_cast<size_t>(Line->GetChannel()));
+        Message += " at line " + std::to_string(Line->GetLocation().Line) + ";";
+    }
+    Message.pop_back();
+    RuntimeErrors.push_back(Message);
+}
@@ -1,14 +1,67 @@
 #pragma once
 #include "common.h"
+#include "compilable.h"
 #include "thread.h"
 
+#include <string>
+#include <vector>
+
 using namespace std;
 
-class ConProgram
+// Runs several threads in lockstep. Every cycle each thread that is not busy runs its next
+// line and then stays busy for that line's cycle cost. SEND/LSTN go through a bounded mailbox
+// per ordered pair of threads and block, without being charged, until they can complete.
+struct ConProgram final : public ConCompilable
 {
-    
+public:
+    ConProgram() = default;
+    ConProgram(const ConProgram&) = delete;
+    ConProgram& operator=(const ConProgram&) = delete;
+
+    // threads are addressed by the order they are added: T0, T1, ...
+    void AddThread(ConThread&& Thread);
+    size_t GetThreadCount() const { return Threads.size(); }
+    bool HasThread(int32 Index) const { return Index >= 0 && static_cast<size_t>(Index) < Threads.size(); }
+    ConThread& GetThread(size_t Index) { return Threads.at(Index); }
+    const ConThread& GetThread(size_t Index) const { return Threads.at(Index); }
+
+    void SetChannelCapacity(size_t Capacity);
+    size_t GetChannelCapacity() const { return ChannelCapacity; }
+
+    virtual void Execute() override;
+    // sum of the threads' static estimates
+    virtual void UpdateCycleCount() override;
+    // lockstep cycles until the last thread finished; per-thread totals live on each ConThread
+    int32 GetExecutedCycleCount() const { return ExecutedCycles; }
+    void ResetState();
+
+    bool HadRuntimeError() const { return !RuntimeErrors.empty(); }
+    bool HadDeadlock() const { return bDeadlocked; }
+    // a thread ran out of its ConExecutionBudget, which stops the whole program
+    bool WasBudgetExhausted() const { return bBudgetExhausted; }
+    const std::vector<std::string>& GetRuntimeErrors() const { return RuntimeErrors; }
+
+    bool TrySend(int32 From, int32 To, int32 Value);
+    bool TryReceive(int32 To, int32 From, int32& OutValue);
+
 private:
-    
+    struct ConMailbox
+    {
+        std::vector<int32> Slots;
+        size_t Head = 0;
+        size_t Count = 0;
+    };
+
+    ConMailbox& GetMailbox(int32 From, int32 To);
+    void ResetMailboxes();
+    void ReportDeadlock();
+
     vector<ConThread> Threads;
-    
+    std::vector<ConMailbox> Mailboxes;
+    std::vector<int32> BusyCycles;
+    size_t ChannelCapacity = 1;
+    int32 ExecutedCycles = 0;
+    bool bDeadlocked = false;
+    bool bBudgetExhausted = false;
+    std::vector<std::string> RuntimeErrors;
 };
@@ -1,40 +1,63 @@
 #include "scanner.h"
 
-#include <cctype>
+#include <array>
+#include <charconv>
 #include <sstream>
 
 namespace
 {
-bool IsIdentifierStart(char C)
+enum ConCharClass : uint8_t
 {
-    return std::isalpha(static_cast<unsigned char>(C)) != 0 || C == '_';
-}
+    CharIdentifierStart = 1,
+    CharIdentifierPart = 2,
+    CharDigit = 4
+};
 
-bool IsIdentifierPart(char C)
+// ASCII-only classes by byte, so scanning does not go through the locale-aware <cctype> calls
+constexpr std::array<uint8_t, 256> MakeCharClasses()
 {
-    return std::isalnum(static_cast<unsigned char>(C)) != 0 || C == '_';
-}
+    std::array<uint8_t, 256> Classes{};
+    for (int C = 'a'; C <= 'z'; ++C)
+    {
+        Classes[C] = CharIdentifierStart | CharIdentifierPart;
+        Classes[C - 'a' + 'A'] = CharIdentifierStart | CharIdentifierPart;
+    }
+    for (int C = '0'; C <= '9'; ++C)
+    {
+        Classes[C] = CharIdentifierPart | CharDigit;
+    }
+    Classes['_'] = CharIdentifierStart | CharIdentifierPart;
+    return Classes;
 }
 
-Scanner::Scanner(const std::vector<std::string>& InLines)
-    : Lines(InLines)
+constexpr std::array<uint8_t, 256> CharClasses = MakeCharClasses();
+
+bool HasClass(const char C, const uint8_t Class)
 {
+    return (CharClasses[static_cast<unsigned char>(C)] & Class) != 0;
 }
 
-std::vector<TokenLine> Scanner::Scan()
+// keywords are at most four characters, so packing the bytes gives each one a unique switch label
+constexpr uint32_t PackKeyword(const std::string_view Text)
 {
-    std::vector<TokenLine> Result;
-    Result.reserve(Lines.size());
-    for (size_t Index = 0; Index < Lines.size(); ++Index)
+    uint32_t Packed = 0;
+    for (const char C : Text)
     {
-        TokenLine Line;
-        ScanLine(Lines[Index], static_cast<int32>(Index + 1), Line);
-        Result.push_back(std::move(Line));
+        Packed = (Packed << 8) | static_cast<unsigned char>(C);
     }
-    return Result;
+    return Packed;
+}
+
+void AddError(std::vector<std::string>& Errors, const int32 LineNumber, const int32 ColumnNumber, const std::string& Message)
+{
+    std::ostringstream Stream;
+    Stream << "[line " << LineNumber << ", col " << ColumnNumber << "] " << Message;
+    Errors.push_back(Stream.str());
 }
 
-void Scanner::ScanLine(const std::string& LineText, const int32 LineNumber, TokenLine& OutLine)
+// shared by both scanning modes; hands each token to Emit and returns the line's indent
+template <typename EmitFn>
+int32 ScanText(const std::string_view LineText, const int32 LineNumber, std::vector<std::string>& Errors, EmitFn&& Emit)
 {
     size_t Position = 0;
     int32 Indent = 0;
@@ -43,92 +66,193 @@ void Scanner::ScanLine(const std::string& LineText, const int32 LineNumber, Toke
         Indent += (LineText[Position] == '\t') ? 4 : 1;
         ++Position;
     }
-    OutLine.Indent = Indent;
 
     while (Position < LineText.size())
     {
-        char Current = LineText[Position];
+        const char Current = LineText[Position];
         if (Current == ' ' || Current == '\t')
         {
             ++Position;
             continue;
         }
 
-        const int32 Column = static_cast<int32>(Position + 1);
+        ConTokenView Tok;
+        Tok.Line = LineNumber;
+        Tok.Column = static_cast<int32>(Position + 1);
 
-        if (IsIdentifierStart(Current))
+        if (HasClass(Current, CharIdentifierStart))
         {
-            size_t Start = Position;
-            while (Position < LineText.size() && IsIdentifierPart(LineText[Position]))
+            const size_t Start = Position;
+            while (Position < LineText.size() && HasClass(LineText[Position], CharIdentifierPart))
             {
                 ++Position;
             }
-            Token Tok;
             Tok.Kind = ConTokenType::Identifier;
             Tok.Lexeme = LineText.substr(Start, Position - Start);
-            Tok.Line = LineNumber;
-            Tok.Column = Column;
-            OutLine.Tokens.push_back(std::move(Tok));
+            Tok.Keyword = FindKeyword(Tok.Lexeme);
+            Emit(Tok);
             continue;
         }
 
-        if (Current == '-' || std::isdigit(static_cast<unsigned char>(Current)) != 0)
+        if (Current == '-' || HasClass(Current, CharDigit))
         {
-            size_t Start = Position;
+            const size_t Start = Position;
             if (Current == '-')
             {
                 ++Position;
-                if (Position >= LineText.size() || std::isdigit(static_cast<unsigned char>(LineText[Position])) == 0)
+                if (Position >= LineText.size() || !HasClass(LineText[Position], CharDigit))
                 {
-                    AddError(LineNumber, Column, "Standalone '-' is not a valid literal");
+                    AddError(Errors, LineNumber, Tok.Column, "Standalone '-' is not a valid literal");
                     continue;
                 }
             }
-            while (Position < LineText.size() && std::isdigit(static_cast<unsigned char>(LineText[Position])) != 0)
+            while (Position < LineText.size() && HasClass(LineText[Position], CharDigit))
             {
                 ++Position;
             }
-            const std::string Lexeme = LineText.substr(Start, Position - Start);
-            Token Tok;
             Tok.Kind = ConTokenType::Number;
-            Tok.Lexeme = Lexeme;
-            Tok.Line = LineNumber;
-            Tok.Column = Column;
-            try
-            {
-                Tok.Literal = std::stoi(Lexeme);
-                Tok.bHasLiteral = true;
-            }
-            catch (const std::exception&)
+            Tok.Lexeme = LineText.substr(Start, Position - Start);
+            const std::from_chars_result Result = std::from_chars(Tok.Lexeme.data(), Tok.Lexeme.data() + Tok.Lexeme.size(), Tok.Literal);
+            Tok.bHasLiteral = Result.ec == std::errc();
+            if (!Tok.bHasLiteral)
             {
-                AddError(LineNumber, Column, "Numeric literal out of range");
-                Tok.bHasLiteral = false;
+                AddError(Errors, LineNumber, Tok.Column, "Numeric literal out of range");
                 Tok.Literal = 0;
             }
-            OutLine.Tokens.push_back(std::move(Tok));
+            Emit(Tok);
             continue;
         }
 
         if (Current == ':')
         {
-            Token Tok;
             Tok.Kind = ConTokenType::Colon;
-            Tok.Lexeme = ":";
-            Tok.Line = LineNumber;
-            Tok.Column = Column;
-            OutLine.Tokens.push_back(std::move(Tok));
+            Tok.Lexeme = LineText.substr(Position, 1);
+            Emit(Tok);
             ++Position;
             continue;
         }
 
-        AddError(LineNumber, Column, std::string("Unexpected character '") + Current + "'");
+        AddError(Errors, LineNumber, Tok.Column, std::string("Unexpected character '") + Current + "'");
         ++Position;
     }
+    return Indent;
+}
 }
 
-void Scanner::AddError(const int32 LineNumber, const int32 ColumnNumber, const std::string& Message)
+ConKeyword FindKeyword(const std::string_view Text)
 {
-    std::ostringstream Stream;
-    Stream << "[line " << LineNumber << ", col " << ColumnNumber << "] " << Message;
-    Errors.push_back(Stream.str());
+    if (Text.size() < 2 || Text.size() > 4)
+    {
+        return ConKeyword::None;
+    }
+    switch (PackKeyword(Text))
+    {
+    case PackKeyword("SET"): return ConKeyword::Set;
+    case PackKeyword("SWP"): return ConKeyword::Swp;
+    case PackKeyword("ADD"): return ConKeyword::Add;
+    case PackKeyword("SUB"): return ConKeyword::Sub;
+    case PackKeyword("MUL"): return ConKeyword::Mul;
+    case PackKeyword("DIV"): return ConKeyword::Div;
+    case PackKeyword("AND"): return ConKeyword::And;
+    case PackKeyword("OR"): return ConKeyword::Or;
+    case PackKeyword("XOR"): return ConKeyword::Xor;
+    case PackKeyword("INCR"): return ConKeyword::Incr;
+    case PackKeyword("DECR"): return ConKeyword::Decr;
+    case PackKeyword("NOT"): return ConKeyword::Not;
+    case PackKeyword("POP"): return ConKeyword::Pop;
+    case PackKeyword("AT"): return ConKeyword::At;
+    case PackKeyword("IF"): return ConKeyword::If;
+    case PackKeyword("IFN"): return ConKeyword::Ifn;
+    case PackKeyword("REDO"): return ConKeyword::Redo;
+    case PackKeyword("LOOP"): return ConKeyword::Loop;
+    case PackKeyword("JUMP"): return ConKeyword::Jump;
+    case PackKeyword("RET"): return ConKeyword::Ret;
+    case PackKeyword("SEND"): return ConKeyword::Send;
+    case PackKeyword("LSTN"): return ConKeyword::Lstn;
+    case PackKeyword("GTR"): return ConKeyword::Gtr;
+    case PackKeyword("LSR"): return ConKeyword::Lsr;
+    case PackKeyword("EQL"): return ConKeyword::Eql;
+    default: return ConKeyword::None;
+    }
+}
+
+std::vector<TokenLine> Scanner::Scan(const std::vector<std::string>& Lines)
+{
+    std::vector<TokenLine> Result;
+    Result.reserve(Lines.size());
+    for (size_t Index = 0; Index < Lines.size(); ++Index)
+    {
+        TokenLine Line;
+        ScanLine(Lines[Index], static_cast<int32>(Index + 1), Line);
+        Result.push_back(std::move(Line));
+    }
+    return Result;
+}
+
+void Scanner::ScanLine(const std::string_view LineText, const int32 LineNumber, TokenLine& OutLine)
+{
+    // space-separated tokens fit in one allocation; only runs of colons can outgrow it
+    OutLine.Tokens.reserve(OutLine.Tokens.size() + (LineText.size() + 1) / 2);
+    OutLine.Indent = ScanText(LineText, LineNumber, Errors, [&OutLine](const ConTokenView& View)
+    {
+        Token Tok;
+        Tok.Kind = View.Kind;
+        Tok.Keyword = View.Keyword;
+        Tok.Lexeme = std::string(View.Lexeme);
+        Tok.Literal = View.Literal;
+        Tok.bHasLiteral = View.bHasLiteral;
+        Tok.Line = View.Line;
+        Tok.Column = View.Column;
+        OutLine.Tokens.push_back(std::move(Tok));
+    });
+}
+
+void Scanner::ScanSource(const std::string_view Source, ConScannedSource& Out)
+{
+    Out.Tokens.clear();
+    Out.Lines.clear();
+    Out.Errors.clear();
+
+    // a final newline ends the last line rather than starting an empty one
+    size_t LineStart = 0;
+    while (LineStart < Source.size())
+    {
+        size_t LineEnd = Source.find('\n', LineStart);
+        const size_t NextStart = LineEnd == std::string_view::npos ? Source.size() : LineEnd + 1;
+        if (LineEnd == std::string_view::npos)
+        {
+            LineEnd = Source.size();
+        }
+        if (LineEnd > LineStart && Source[LineEnd - 1] == '\r')
+        {
+            --LineEnd;
+        }
+
+        AppendLine(Source.substr(LineStart, LineEnd - LineStart), static_cast<int32>(Out.Lines.size() + 1), Out);
+        LineStart = NextStart;
+    }
+}
+
+void Scanner::ScanLines(const std::vector<std::string>& Lines, ConScannedSource& Out)
+{
+    Out.Tokens.clear();
+    Out.Lines.clear();
+    Out.Errors.clear();
+    for (size_t Index = 0; Index < Lines.size(); ++Index)
+    {
+        AppendLine(Lines[Index], static_cast<int32>(Index + 1), Out);
+    }
+}
+
+void Scanner::AppendLine(const std::string_view LineText, const int32 LineNumber, ConScannedSource& Out)
+{
+    ConScannedLine Line;
+    Line.Text = LineText;
+    Line.FirstToken = static_cast<uint32_t>(Out.Tokens.size());
+    Line.Indent = ScanText(LineText, LineNumber, Out.Errors, [&Out](const ConTokenView& View)
+    {
+        Out.Tokens.push_back(View);
+    });
+    Line.TokenCount = static_cast<uint32_t>(Out.Tokens.size()) - Line.FirstToken;
+    Out.Lines.push_back(Line);
 }
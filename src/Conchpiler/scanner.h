@@ -2,7 +2,9 @@
 
 #include "common.h"
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class ConTokenType
@@ -13,9 +15,44 @@ enum class ConTokenType
     EndOfLine
 };
 
+// reserved words; the scanner classifies each identifier once so later stages can switch on it
+enum class ConKeyword : uint8_t
+{
+    None,
+    Set,
+    Swp,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    And,
+    Or,
+    Xor,
+    Incr,
+    Decr,
+    Not,
+    Pop,
+    At,
+    If,
+    Ifn,
+    Redo,
+    Loop,
+    Jump,
+    Ret,
+    Send,
+    Lstn,
+    Gtr,
+    Lsr,
+    Eql
+};
+
+// keywords are case-sensitive; anything else is ConKeyword::None
+ConKeyword FindKeyword(std::string_view Text);
+
 struct Token
 {
     ConTokenType Kind = ConTokenType::Identifier;
+    ConKeyword Keyword = ConKeyword::None;
     std::string Lexeme;
     int32 Literal = 0;
     bool bHasLiteral = false;
@@ -29,18 +66,68 @@ struct TokenLine
     std::vector<Token> Tokens;
 };
 
+// a token that points into the scanned buffer instead of owning its text
+struct ConTokenView
+{
+    ConTokenType Kind = ConTokenType::Identifier;
+    ConKeyword Keyword = ConKeyword::None;
+    std::string_view Lexeme;
+    int32 Literal = 0;
+    bool bHasLiteral = false;
+    int32 Line = 0;
+    int32 Column = 0;
+};
+
+// one line of a ConScannedSource; its tokens are Tokens[FirstToken, FirstToken + TokenCount)
+struct ConScannedLine
+{
+    std::string_view Text;
+    int32 Indent = 0;
+    uint32_t FirstToken = 0;
+    uint32_t TokenCount = 0;
+};
+
+// a run of tokens read in place, such as a line without its label
+struct ConTokenSpan
+{
+    const ConTokenView* Data = nullptr;
+    size_t Count = 0;
+
+    const ConTokenView* begin() const { return Data; }
+    const ConTokenView* end() const { return Data + Count; }
+    size_t size() const { return Count; }
+    bool empty() const { return Count == 0; }
+    const ConTokenView& operator[](const size_t Index) const { return Data[Index]; }
+};
+
+// tokens of a whole source buffer in one flat array; views stay valid while the buffer does
+struct ConScannedSource
+{
+    std::vector<ConTokenView> Tokens;
+    std::vector<ConScannedLine> Lines;
+    std::vector<std::string> Errors;
+
+    ConTokenSpan GetTokens(const ConScannedLine& Line) const { return {Tokens.data() + Line.FirstToken, Line.TokenCount}; }
+};
+
 class Scanner
 {
 public:
-    explicit Scanner(const std::vector<std::string>& InLines);
-
-    std::vector<TokenLine> Scan();
+    // tokens own copies of their lexemes, so the result does not refer back to Lines
+    std::vector<TokenLine> Scan(const std::vector<std::string>& Lines);
+    // scans a single line on its own; any errors are appended to GetErrors()
+    void ScanLine(std::string_view LineText, int32 LineNumber, TokenLine& OutLine);
     const std::vector<std::string>& GetErrors() const { return Errors; }
 
-private:
-    void ScanLine(const std::string& LineText, int32 LineNumber, TokenLine& OutLine);
-    void AddError(int32 LineNumber, int32 ColumnNumber, const std::string& Message);
+    // scans a contiguous buffer of newline-separated lines into Out, reusing its storage, so a
+    // repeated scan allocates nothing once Out has grown; errors go to Out.Errors. Out's lexemes
+    // and line texts point into Source, so Source must outlive every read of Out
+    static void ScanSource(std::string_view Source, ConScannedSource& Out);
+    // the same for a program already split into lines; Out points into the strings of Lines
+    static void ScanLines(const std::vector<std::string>& Lines, ConScannedSource& Out);
+    // appends LineText to Out as line LineNumber, pointing into LineText
+    static void AppendLine(std::string_view LineText, int32 LineNumber, ConScannedSource& Out);
 
-    std::vector<std::string> Lines;
+private:
     std::vector<std::string> Errors;
 };
@@ -0,0 +1,59 @@
+#pragma once
+#include "budget.h"
+#include "common.h"
+#include "variable.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// one list as it was when the snapshot was taken
+struct ConListSnapshot
+{
+    // the values, shared with every snapshot and restored thread that still has them unchanged;
+    // null while the list borrowed outside memory, which External then points at
+    std::shared_ptr<const std::vector<int32>> Values;
+    const int32* External = nullptr;
+    size_t ExternalCount = 0;
+    size_t Cursor = 0;
+    int32 CurrentValue = 0;
+    ConListRole Role = ConListRole::General;
+    size_t ExpectedSize = std::numeric_limits<size_t>::max();
+};
+
+// Everything a paused run needs to carry on, captured between two lines: the next line, the
+// registers and caches, the lists with their cursors, the REDO counters, the cycles, errors and
+// return state so far and what is left of the budget.
+struct ConThreadSnapshotState
+{
+    size_t ProgramCounter = 0;
+    std::vector<int32> Values;
+    std::vector<int32> Caches;
+    std::vector<ConListSnapshot> Lists;
+    std::vector<int32> LoopIterations;
+    int32 ExecutedCycles = 0;
+    std::vector<std::string> RuntimeErrors;
+    bool bHadRuntimeError = false;
+    bool bDidReturn = false;
+    bool bReturnHasValue = false;
+    int32 ReturnValue = 0;
+    ConBudgetMeter BudgetMeter;
+    // what was left of the deadline; restoring re-anchors the meter's deadline to it
+    std::chrono::steady_clock::duration RemainingDuration = std::chrono::steady_clock::duration::zero();
+    // the shape of the program it came from, checked on restore
+    size_t LineCount = 0;
+};
+
+// Copy-on-write handle to a captured run, made by ConThread::CaptureSnapshot. The state is never
+// changed once captured, so copies share it and cost a reference count. Capturing moves each
+// owned list's values into the snapshot instead of copying them; the captured thread and any
+// thread restored from it read them in place and only copy a list once they append to it.
+struct ConThreadSnapshot
+{
+    std::shared_ptr<const ConThreadSnapshotState> State;
+
+    bool IsValid() const { return State != nullptr; }
+};
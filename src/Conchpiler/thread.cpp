@@ -1,6 +1,9 @@
 #include "common.h"
 #include "thread.h"
+
 #include "errors.h"
+#include "fusion.h"
+#include "program.h"
 #include <algorithm>
 #include <cctype>
 #include <exception>
@@ -14,6 +17,8 @@
 
 namespace
 {
+constexpr int32 LoopIterationLimit = 9999;
+
 std::string RegisterName(size_t Index)
 {
     switch (Index)
@@ -42,93 +47,6 @@ std::string ToUpperCopy(const std::string& Text)
     return Result;
 }
 
-struct TraceSnapshot
-{
-    TraceSnapshot() : BoundThread(nullptr) {}
-
-    void Reset(const vector<ConVariableCached*>& ThreadVariables,
-               const std::vector<std::pair<std::string, std::vector<int32>>>& Lists)
-    {
-        BoundThread = &ThreadVariables;
-        Values.resize(ThreadVariables.size());
-        Caches.resize(ThreadVariables.size());
-        Defined.resize(ThreadVariables.size());
-        for (size_t i = 0; i < ThreadVariables.size(); ++i)
-        {
-            const ConVariableCached* Var = ThreadVariables[i];
-            if (Var != nullptr)
-            {
-                Defined[i] = true;
-                Values[i] = Var->GetVal();
-                Caches[i] = Var->GetCache();
-            }
-            else
-            {
-                Defined[i] = false;
-                Values[i] = 0;
-                Caches[i] = 0;
-            }
-        }
-
-        ListValues.clear();
-        for (const auto& Entry : Lists)
-        {
-            ListValues[Entry.first] = Entry.second;
-        }
-    }
-
-    void EnsureAligned(const vector<ConVariableCached*>& ThreadVariables,
-                       const std::vector<std::pair<std::string, std::vector<int32>>>& Lists)
-    {
-        if (BoundThread != &ThreadVariables || Values.size() != ThreadVariables.size())
-        {
-            Reset(ThreadVariables, Lists);
-            return;
-        }
-
-        for (const auto& Entry : Lists)
-        {
-            if (ListValues.find(Entry.first) == ListValues.end())
-            {
-                ListValues[Entry.first] = Entry.second;
-            }
-        }
-
-        for (auto It = ListValues.begin(); It != ListValues.end();)
-        {
-            bool bPresent = false;
-            for (const auto& Entry : Lists)
-            {
-                if (Entry.first == It->first)
-                {
-                    bPresent = true;
-                    break;
-                }
-            }
-            if (!bPresent)
-            {
-                It = ListValues.erase(It);
-            }
-            else
-            {
-                ++It;
-            }
-        }
-    }
-
-    const vector<ConVariableCached*>* BoundThread;
-    std::vector<int32> Values;
-    std::vector<int32> Caches;
-    std::vector<bool> Defined;
-    std::unordered_map<std::string, std::vector<int32>> ListValues;
-};
-
-TraceSnapshot& GetTraceSnapshot()
-{
-    static TraceSnapshot Snapshot;
-    return Snapshot;
-}
-
 std::vector<std::pair<std::string, std::vector<int32>>> CollectListStates(const ConThread& Thread)
 {
     std::vector<std::pair<std::string, std::vector<int32>>> States;
@@ -139,16 +57,15 @@ std::vector<std::pair<std::string, std::vector<int32>>> CollectListStates(const
         const ConVariableList* List = Thread.FindListVar(Name);
         if (List != nullptr)
         {
-            const std::vector<int32>& Values = List->GetValues();
+            const ConListView Values = List->GetView();
             States.push_back(std::make_pair(Name, std::vector<int32>(Values.begin(), Values.end())));
         }
     }
     return States;
 }
 
-void ResetTraceSnapshot(const ConThread& Thread, const vector<ConVariableCached*>& ThreadVariables)
+void ResetTraceSnapshot(const ConThread& Thread, ConTraceSnapshot& Snapshot, const vector<ConVariableCached*>& ThreadVariables)
 {
-    TraceSnapshot& Snapshot = GetTraceSnapshot();
     Snapshot.Reset(ThreadVariables, CollectListStates(Thread));
 }
 
@@ -168,10 +85,10 @@ std::string FormatListValues(const std::vector<int32>& Values)
     return Oss.str();
 }
 
-std::string FormatTraceState(const vector<ConVariableCached*>& ThreadVariables,
+std::string FormatTraceState(ConTraceSnapshot& Snapshot,
+                             const vector<ConVariableCached*>& ThreadVariables,
                              const std::vector<std::pair<std::string, std::vector<int32>>>& Lists)
 {
-    TraceSnapshot& Snapshot = GetTraceSnapshot();
     Snapshot.EnsureAligned(ThreadVariables, Lists);
 
     std::vector<std::string> Segments;
@@ -338,382 +255,1859 @@ int32 ResolveLineNumber(const ConSourceLocation& Location, size_t Index)
 }
 
 void PrintTrace(const ConThread& Thread,
-                const char* Label,
+                ConTraceSnapshot& Snapshot,
+                const ConTraceEvent Event,
                 const ConSourceLocation& Location,
                 size_t Index,
                 const std::string& SourceText,
                 const vector<ConVariableCached*>& ThreadVariables)
 {
-    static const char* const TRACE_COLOR = "\033[35m";
-    static const char* const REGISTER_COLOR = "\033[36m";
-    static const char* const RESET_COLOR = "\033[0m";
-    static const size_t REGISTER_COLUMN = 64;
+    const std::vector<std::pair<std::string, std::vector<int32>>> ListStates = CollectListStates(Thread);
+    const std::string RegisterState = FormatTraceState(Snapshot, ThreadVariables, ListStates);
+    std::cout << FormatTraceLine(ResolveLineNumber(Location, Index), GetTraceEventLabel(Event), SourceText, RegisterState) << std::endl;
+}
 
-    std::ostringstream PrefixStream;
-    PrefixStream << "[Line " << ResolveLineNumber(Location, Index);
-    if (Label != nullptr && Label[0] != '\0')
-    {
-        PrefixStream << ' ' << Label;
-    }
-    if (!SourceText.empty())
-    {
-        PrefixStream << "] " << SourceText;
-    }
-    else
+// the scalar engine's machine: register operands index straight into the thread's register file
+struct ConScalarMachine
+{
+    int32* Values = nullptr;
+    int32* Caches = nullptr;
+    ConVariableList* const* Lists = nullptr;
+
+    int32& Value(const int32 Index) const { return Values[Index]; }
+    int32& Cache(const int32 Index) const { return Caches[Index]; }
+    ConVariableList* List(const int32 Index) const { return Lists[Index]; }
+};
+
+// one lane of a ConBatchState; every register and list row is Stride entries long
+struct ConLaneMachine
+{
+    int32* Values = nullptr;
+    int32* Caches = nullptr;
+    ConVariableList* Lists = nullptr;
+    size_t Stride = 0;
+
+    int32& Value(const int32 Index) const { return Values[static_cast<size_t>(Index) * Stride]; }
+    int32& Cache(const int32 Index) const { return Caches[static_cast<size_t>(Index) * Stride]; }
+    ConVariableList* List(const int32 Index) const { return Lists + static_cast<size_t>(Index) * Stride; }
+};
+
+template <typename TMachine>
+inline void SetRegister(const TMachine& Machine, const int32 Index, const int32 Value)
+{
+    Machine.Cache(Index) = Machine.Value(Index);
+    Machine.Value(Index) = Value;
+}
+
+template <typename TMachine>
+inline int32 ReadOperand(const ConOperand& Operand, const TMachine& Machine)
+{
+    switch (Operand.Kind)
     {
-        PrefixStream << "]";
+    case ConOperandKind::Register:
+        return Machine.Value(Operand.Value);
+    case ConOperandKind::Cache:
+        return Machine.Cache(Operand.Value);
+    case ConOperandKind::Immediate:
+        return Operand.Value;
+    case ConOperandKind::List:
+        return Machine.List(Operand.Value)->GetVal();
+    default:
+        return 0;
     }
+}
 
-    const std::string Prefix = PrefixStream.str();
-    const size_t VisiblePrefixLength = Prefix.size();
-    const std::vector<std::pair<std::string, std::vector<int32>>> ListStates = CollectListStates(Thread);
-    const std::string RegisterState = FormatTraceState(ThreadVariables, ListStates);
-
-    std::ostringstream Oss;
-    Oss << TRACE_COLOR << Prefix;
-    if (!RegisterState.empty())
+template <typename TMachine>
+inline bool EvaluateInstructionCondition(const ConInstruction& Inst, const TMachine& Machine)
+{
+    bool Result = true;
+    switch (Inst.Condition)
     {
-        size_t Padding = 1;
-        if (VisiblePrefixLength < REGISTER_COLUMN)
+    case ConConditionOp::None:
+        if (!Inst.B.IsValid())
         {
-            Padding = REGISTER_COLUMN - VisiblePrefixLength;
+            return !Inst.bInvert;
         }
-        Oss << std::string(Padding, ' ') << REGISTER_COLOR << RegisterState << RESET_COLOR;
-    }
-    else
-    {
-        Oss << RESET_COLOR;
+        Result = ReadOperand(Inst.B, Machine) != 0;
+        break;
+    case ConConditionOp::GTR:
+        Result = ReadOperand(Inst.B, Machine) > ReadOperand(Inst.C, Machine);
+        break;
+    case ConConditionOp::LSR:
+        Result = ReadOperand(Inst.B, Machine) < ReadOperand(Inst.C, Machine);
+        break;
+    case ConConditionOp::EQL:
+        Result = ReadOperand(Inst.B, Machine) == ReadOperand(Inst.C, Machine);
+        break;
     }
-
-    std::cout << Oss.str() << std::endl;
-}
+    return Inst.bInvert ? !Result : Result;
 }
 
-void ConThread::Execute()
+// appends to an OUT list destination; returns the runtime error the equivalent op would raise, if any
+const char* AppendToList(ConVariableList* List, const ConOpcode Opcode, const int32 Value)
 {
-    ResetRuntimeErrors();
-    ResetTraceSnapshot(*this, ThreadVariables);
-    size_t i = 0;
-    std::vector<int32> LoopIterations(Lines.size(), 0);
-    constexpr int32 LoopIterationLimit = 9999;
-    while (i < Lines.size())
+    switch (Opcode)
     {
-        ConLine& Line = Lines[i];
-        const ConSourceLocation Location = Line.GetLocation();
-        const size_t LineIndex = i;
-        try
+    case ConOpcode::Set:
+        if (!List->IsOutput())
         {
-            switch (Line.GetKind())
-            {
-            case ConLineKind::Ops:
-            {
-                Line.Execute();
-                ++i;
-                if (bTraceExecution)
-                {
-                    PrintTrace(*this, "OPS", Location, LineIndex, Line.GetSourceText(), ThreadVariables);
-                }
-                break;
-            }
-            case ConLineKind::If:
-            {
-                const bool bCondition = Line.EvaluateCondition();
-                if (!bCondition)
-                {
-                    i += Line.GetSkipCount() + 1;
-                }
-                else
-                {
-                    ++i;
-                }
-                if (bTraceExecution)
-                {
-                    PrintTrace(*this, bCondition ? "IF=TRUE" : "IF=FALSE", Location, LineIndex, Line.GetSourceText(), ThreadVariables);
-                }
-                break;
-            }
-            case ConLineKind::Loop:
-            {
-                const int32 ExitIndex = Line.GetLoopExitIndex();
-                const int32 RedoIndex = ExitIndex > 0 ? ExitIndex - 1 : -1;
-                bool bRuns = true;
-                if (Line.HasCondition())
-                {
-                    const bool bCondition = Line.EvaluateCondition();
-                    if (!bCondition)
-                    {
-                        bRuns = false;
-                        if (ExitIndex >= 0)
-                        {
-                            i = static_cast<size_t>(ExitIndex);
-                        }
-                        else
-                        {
-                            ++i;
-                        }
-                    }
-                    else
-                    {
-                        ++i;
-                    }
-                }
-                else
-                {
-                    ++i;
-                }
-                if (!bRuns && RedoIndex >= 0)
-                {
-                    const size_t RedoIdx = static_cast<size_t>(RedoIndex);
-                    if (RedoIdx < LoopIterations.size())
-                    {
-                        LoopIterations[RedoIdx] = 0;
-                    }
-                }
-                if (bTraceExecution)
-                {
-                    PrintTrace(*this, bRuns ? "REDO-HEAD" : "REDO-SKIP", Location, LineIndex, Line.GetSourceText(), ThreadVariables);
-                }
-                break;
-            }
-            case ConLineKind::Redo:
-            {
-                bool bLoop = Line.IsInfiniteLoop();
-                if (Line.HasCounter())
-                {
-                    ConVariableCached* Counter = Line.GetCounter().GetThread();
-                    if (Counter != nullptr)
-                    {
-                        const int32 NewVal = Counter->GetVal() - 1;
-                        Counter->SetVal(NewVal);
-                        bLoop = NewVal != 0;
-                    }
-                    else
-                    {
-                        bLoop = false;
-                    }
-                }
-                else if (Line.HasCondition())
-                {
-                    bLoop = Line.EvaluateCondition();
-                }
-
-                if (bLoop)
-                {
-                    int32& IterationCount = LoopIterations[LineIndex];
-                    ++IterationCount;
-                    if (IterationCount > LoopIterationLimit)
-                    {
-                        throw ConRuntimeError(Location, "Loop exceeded 9999 iterations");
-                    }
-
-                    const int32 TargetIndex = Line.GetTargetIndex();
-                    if (TargetIndex >= 0)
-                    {
-                        i = static_cast<size_t>(TargetIndex);
-                    }
-                    else
-                    {
-                        ++i;
-                    }
-                }
-                else
-                {
-                    LoopIterations[LineIndex] = 0;
-                    ++i;
-                }
-                if (bTraceExecution)
-                {
-                    PrintTrace(*this, bLoop ? "REDO" : "REDO-EXIT", Location, LineIndex, Line.GetSourceText(), ThreadVariables);
-                }
-                break;
-            }
-            case ConLineKind::Jump:
-            {
-                bool bJump = true;
-                if (Line.HasCondition())
-                {
-                    bJump = Line.EvaluateCondition();
-                }
-                if (bJump)
-                {
-                    const int32 TargetIndex = Line.GetTargetIndex();
-                    if (TargetIndex >= 0)
-                    {
-                        i = static_cast<size_t>(TargetIndex);
-                    }
-                    else
-                    {
-                        ++i;
-                    }
-                }
-                else
-                {
-                    ++i;
-                }
-                if (bTraceExecution)
-                {
-                    PrintTrace(*this, bJump ? "JUMP" : "NO-JUMP", Location, LineIndex, Line.GetSourceText(), ThreadVariables);
-                }
-                break;
-            }
-            case ConLineKind::Return:
-            {
-                bDidReturn = true;
-                bReturnHasValue = Line.HasReturnValue();
-                if (bReturnHasValue)
-                {
-                    const VariableRef& RetRef = Line.GetReturnValue();
-                    if (!RetRef.IsValid())
-                    {
-                        throw ConRuntimeError(Location, "RET argument is invalid");
-                    }
-                    ReturnValue = RetRef.Read();
-                }
-                else
-                {
-                    ReturnValue = 0;
-                }
-                i = Lines.size();
-                if (bTraceExecution)
-                {
-                    PrintTrace(*this, "RET", Location, LineIndex, Line.GetSourceText(), ThreadVariables);
-                }
-                break;
-            }
-            default:
-            {
-                ++i;
-                if (bTraceExecution)
-                {
-                    PrintTrace(*this, "STEP", Location, LineIndex, Line.GetSourceText(), ThreadVariables);
-                }
-                break;
-            }
-            }
+            return "SET can only write to OUT lists";
         }
-        catch (const ConRuntimeError& Error)
+        if (!List->TryAppend(Value))
         {
-            ReportRuntimeError(Error);
-            break;
+            return List->HasExpectedSize() ? "OUT list exceeded expected size" : "OUT list cannot accept additional values";
         }
-        catch (const std::exception& Ex)
+        return nullptr;
+    case ConOpcode::Not:
+        if (!List->IsOutput())
         {
-            ConRuntimeError Wrapped(Line.GetLocation(), Ex.what());
-            ReportRuntimeError(Wrapped);
-            break;
+            return "NOT destination must be a thread or OUT list variable";
+        }
+        break;
+    default:
+        if (!List->IsOutput())
+        {
+            return "Binary operation destination must be a thread or OUT list variable";
         }
+        break;
     }
-}
-
-void ConThread::UpdateCycleCount()
-{
-    ConCompilable::UpdateCycleCount();
-    const int32 VarCount = int32(ThreadVariables.size());
-    for (ConLine& Line : Lines)
+    if (!List->TryAppend(Value))
     {
-        Line.UpdateCycleCount(VarCount);
-        AddCycles(Line.GetCycleCount());
+        return "OUT list cannot accept additional values";
     }
+    return nullptr;
 }
 
-void ConThread::SetVariables(const vector<ConVariableCached*>& InVariables)
+// what one instruction did for one lane; the batch engine acts on errors, traps and returns
+struct ConInstructionOutcome
 {
-    ThreadVariables = InVariables;
-}
+    // runtime error raised at the instruction
+    const char* Error = nullptr;
+    // the instruction was a Trap; its message and location are in ConBytecode::Traps
+    bool bTrapped = false;
+    bool bReturned = false;
+    bool bReturnHasValue = false;
+    int32 ReturnValue = 0;
+};
 
-void ConThread::SetOwnedStorage(std::vector<std::unique_ptr<ConVariableCached>>&& CachedVars,
-                                std::vector<std::unique_ptr<ConVariableAbsolute>>&& ConstVars,
-                                std::vector<std::unique_ptr<ConVariableList>>&& ListVars,
-                                std::vector<std::unique_ptr<ConBaseOp>>&& Ops,
-                                std::unordered_map<std::string, ConVariableList*>&& ListNameMap)
+// Runs one Opcode instruction for one batch lane and moves Pc past it. Mirrors the switch in
+// ExecuteBytecodeImpl, which stays hand-inlined because the scalar engine is the hot path; the
+// opcode is a template argument so a lane group pays for dispatch once rather than per lane.
+template <ConOpcode Opcode, typename TMachine>
+inline ConInstructionOutcome StepLane(const ConInstruction& Inst, int32& Pc, const int32 End,
+                                      const TMachine& Machine, int32* const LoopIterations, const size_t LoopCount)
 {
-    OwnedVarStorage = std::move(CachedVars);
-    OwnedConstStorage = std::move(ConstVars);
-    OwnedListStorage = std::move(ListVars);
-    OwnedOpStorage = std::move(Ops);
-    ListLookup = std::move(ListNameMap);
-    ReverseListLookup.clear();
-    for (const auto& Pair : ListLookup)
+    ConInstructionOutcome Outcome;
+    auto Store = [&](const int32 Value)
     {
-        if (Pair.second != nullptr)
+        if (Inst.A.IsRegister())
         {
-            ReverseListLookup[Pair.second] = Pair.first;
+            SetRegister(Machine, Inst.A.Value, Value);
         }
-    }
-}
-
-void ConThread::ConstructLine(const ConLine &Line)
-{
-    Lines.push_back(Line);
-}
-
-void ConThread::SetTraceEnabled(const bool bEnabled)
-{
-    bTraceExecution = bEnabled;
-}
+        else
+        {
+            Outcome.Error = AppendToList(Machine.List(Inst.A.Value), Opcode, Value);
+        }
+    };
 
-ConVariableCached* ConThread::GetThreadVar(const size_t Index)
-{
-    if (Index >= ThreadVariables.size())
+    if constexpr (Opcode == ConOpcode::Set)
     {
-        return nullptr;
+        Store(ReadOperand(Inst.B, Machine));
     }
-    return ThreadVariables[Index];
-}
-
-const ConVariableCached* ConThread::GetThreadVar(const size_t Index) const
-{
-    if (Index >= ThreadVariables.size())
+    else if constexpr (Opcode == ConOpcode::Swp)
     {
-        return nullptr;
+        std::swap(Machine.Value(Inst.A.Value), Machine.Cache(Inst.A.Value));
     }
-    return ThreadVariables[Index];
-}
-
-int32 ConThread::GetThreadValue(const size_t Index) const
-{
-    const ConVariableCached* Var = GetThreadVar(Index);
-    return Var != nullptr ? Var->GetVal() : 0;
-}
-
-int32 ConThread::GetThreadCacheValue(const size_t Index) const
-{
-    const ConVariableCached* Var = GetThreadVar(Index);
-    return Var != nullptr ? Var->GetCache() : 0;
-}
-
-void ConThread::SetThreadValue(const size_t Index, const int32 Value)
-{
-    ConVariableCached* Var = GetThreadVar(Index);
-    if (Var != nullptr)
+    else if constexpr (Opcode == ConOpcode::Incr)
     {
-        Var->SetVal(Value);
+        SetRegister(Machine, Inst.A.Value, Machine.Value(Inst.A.Value) + 1);
     }
-}
-
-ConVariableList* ConThread::GetListVar(const size_t Index)
-{
-    if (Index >= OwnedListStorage.size())
+    else if constexpr (Opcode == ConOpcode::Decr)
     {
-        return nullptr;
+        SetRegister(Machine, Inst.A.Value, Machine.Value(Inst.A.Value) - 1);
     }
-    return OwnedListStorage[Index].get();
-}
-
-const ConVariableList* ConThread::GetListVar(const size_t Index) const
-{
-    if (Index >= OwnedListStorage.size())
+    else if constexpr (Opcode == ConOpcode::Not)
     {
-        return nullptr;
+        Store(~ReadOperand(Inst.B, Machine));
     }
-    return OwnedListStorage[Index].get();
-}
-
-ConVariableList* ConThread::FindListVar(const std::string& Name)
-{
-    const std::string Upper = ToUpperCopy(Name);
-    auto It = ListLookup.find(Upper);
-    if (It == ListLookup.end())
+    else if constexpr (Opcode == ConOpcode::Add)
+    {
+        Store(ReadOperand(Inst.B, Machine) + ReadOperand(Inst.C, Machine));
+    }
+    else if constexpr (Opcode == ConOpcode::Sub)
+    {
+        Store(ReadOperand(Inst.B, Machine) - ReadOperand(Inst.C, Machine));
+    }
+    else if constexpr (Opcode == ConOpcode::Mul)
+    {
+        Store(ReadOperand(Inst.B, Machine) * ReadOperand(Inst.C, Machine));
+    }
+    else if constexpr (Opcode == ConOpcode::Div)
+    {
+        const int32 Lhs = ReadOperand(Inst.B, Machine);
+        const int32 Rhs = ReadOperand(Inst.C, Machine);
+        Store(Rhs == 0 ? 0 : Lhs / Rhs);
+    }
+    else if constexpr (Opcode == ConOpcode::And)
+    {
+        Store(ReadOperand(Inst.B, Machine) & ReadOperand(Inst.C, Machine));
+    }
+    else if constexpr (Opcode == ConOpcode::Or)
+    {
+        Store(ReadOperand(Inst.B, Machine) | ReadOperand(Inst.C, Machine));
+    }
+    else if constexpr (Opcode == ConOpcode::Xor)
+    {
+        Store(ReadOperand(Inst.B, Machine) ^ ReadOperand(Inst.C, Machine));
+    }
+    else if constexpr (Opcode == ConOpcode::Pop)
+    {
+        SetRegister(Machine, Inst.A.Value, Machine.List(Inst.B.Value)->Pop());
+    }
+    else if constexpr (Opcode == ConOpcode::At)
+    {
+        SetRegister(Machine, Inst.A.Value, Machine.List(Inst.B.Value)->At(ReadOperand(Inst.C, Machine)));
+    }
+    else if constexpr (Opcode == ConOpcode::If)
+    {
+        Pc = EvaluateInstructionCondition(Inst, Machine) ? Pc + 1 : Inst.Target;
+        return Outcome;
+    }
+    else if constexpr (Opcode == ConOpcode::LoopHead)
+    {
+        if (!Inst.bHasCondition || EvaluateInstructionCondition(Inst, Machine))
+        {
+            ++Pc;
+            return Outcome;
+        }
+        Pc = Inst.Target >= 0 ? Inst.Target : Pc + 1;
+        if (Inst.Aux >= 0 && static_cast<size_t>(Inst.Aux) < LoopCount)
+        {
+            LoopIterations[Inst.Aux] = 0;
+        }
+        return Outcome;
+    }
+    else if constexpr (Opcode == ConOpcode::Redo)
+    {
+        bool bLoop = Inst.Aux != 0;
+        if (Inst.A.IsRegister())
+        {
+            const int32 NewVal = Machine.Value(Inst.A.Value) - 1;
+            SetRegister(Machine, Inst.A.Value, NewVal);
+            bLoop = NewVal != 0;
+        }
+        else if (Inst.bHasCondition)
+        {
+            bLoop = EvaluateInstructionCondition(Inst, Machine);
+        }
+
+        int32& IterationCount = LoopIterations[Inst.Line];
+        if (!bLoop)
+        {
+            IterationCount = 0;
+            ++Pc;
+            return Outcome;
+        }
+        if (++IterationCount > LoopIterationLimit)
+        {
+            Outcome.Error = "Loop exceeded 9999 iterations";
+            return Outcome;
+        }
+        Pc = Inst.Target >= 0 ? Inst.Target : Pc + 1;
+        return Outcome;
+    }
+    else if constexpr (Opcode == ConOpcode::Jump)
+    {
+        const bool bJump = !Inst.bHasCondition || EvaluateInstructionCondition(Inst, Machine);
+        Pc = (bJump && Inst.Target >= 0) ? Inst.Target : Pc + 1;
+        return Outcome;
+    }
+    else if constexpr (Opcode == ConOpcode::Ret)
+    {
+        Outcome.bReturned = true;
+        Outcome.bReturnHasValue = Inst.A.IsValid();
+        Outcome.ReturnValue = Outcome.bReturnHasValue ? ReadOperand(Inst.A, Machine) : 0;
+        Pc = End;
+        return Outcome;
+    }
+    else if constexpr (Opcode == ConOpcode::Trap)
+    {
+        Outcome.bTrapped = true;
+        return Outcome;
+    }
+    if (Outcome.Error == nullptr)
+    {
+        ++Pc;
+    }
+    return Outcome;
+}
+
+// everything a lane group needs besides the instruction itself
+struct ConLaneGroupContext
+{
+    ConBatchState* Batch = nullptr;
+    const ConBytecode* Bytecode = nullptr;
+    const vector<ConLine>* Lines = nullptr;
+    int32 End = 0;
+    size_t LoopCount = 0;
+    bool bEchoErrors = true;
+};
+
+// the scalar engine reports and prints a runtime error the moment it happens; lanes do the same
+void FailLane(const ConLaneGroupContext& Context, const uint32_t Lane, const ConSourceLocation& Location, const std::string& Message)
+{
+    ConBatchState& Batch = *Context.Batch;
+    Batch.Errors[Lane] = FormatErrorMessage(Location, Message);
+    if (Context.bEchoErrors)
+    {
+        std::cerr << Batch.Errors[Lane] << std::endl;
+    }
+    Batch.LanePcs[Lane] = Context.End;
+}
+
+// runs the instruction at Pc for every lane in the batch's current group
+template <ConOpcode Opcode>
+void RunLaneGroup(const ConLaneGroupContext& Context, const ConInstruction& Inst, const int32 Pc)
+{
+    ConBatchState& Batch = *Context.Batch;
+    ConLaneMachine Machine;
+    Machine.Stride = Batch.LaneCount;
+    for (const uint32_t Lane : Batch.Group)
+    {
+        Machine.Values = Batch.Values.data() + Lane;
+        Machine.Caches = Batch.Caches.data() + Lane;
+        Machine.Lists = Batch.Lists.data() + Lane;
+        const ConInstructionOutcome Outcome = StepLane<Opcode>(Inst, Batch.LanePcs[Lane], Context.End, Machine,
+                                                               Batch.LaneLoops.data() + Lane * Context.LoopCount, Context.LoopCount);
+        if (Outcome.Error != nullptr)
+        {
+            FailLane(Context, Lane, Context.Bytecode->Locations[static_cast<size_t>(Pc)], Outcome.Error);
+        }
+        else if (Outcome.bTrapped)
+        {
+            const ConBytecodeTrap& Trap = Context.Bytecode->Traps[static_cast<size_t>(Inst.A.Value)];
+            FailLane(Context, Lane, Trap.Location, Trap.Message);
+        }
+        else if (Outcome.bReturned)
+        {
+            Batch.DidReturn[Lane] = 1;
+            Batch.ReturnHasValue[Lane] = Outcome.bReturnHasValue ? 1 : 0;
+            Batch.ReturnValues[Lane] = Outcome.ReturnValue;
+        }
+    }
+}
+
+// ChargeLines once the current grant runs out among an instruction's lines: each line is
+// checked on its own, exactly where the tree engine checks it
+bool ChargeLinesOneByOne(ConBudgetMeter& Meter, int32& ExecutedCycles, const ConBytecode& Code, const int32 Index, const bool bTail)
+{
+    const ConInstruction& Inst = Code.Instructions[static_cast<size_t>(Index)];
+    for (int32 Step = 0; Step < (bTail ? Inst.TailSteps : Inst.Steps); ++Step)
+    {
+        if (!Meter.Tick() && !Meter.Check(ExecutedCycles))
+        {
+            return false;
+        }
+        ExecutedCycles += Code.GetLineCycles(static_cast<size_t>(Index), bTail, Step);
+    }
+    return true;
+}
+
+// Charges the lines an instruction carries before it runs, or after it with bTail, checking the
+// budget ahead of each line as the tree engine does; false once a limit has stopped the run
+bool ChargeLines(ConBudgetMeter& Meter, int32& ExecutedCycles, const ConBytecode& Code, const int32 Index, const bool bTail)
+{
+    const ConInstruction& Inst = Code.Instructions[static_cast<size_t>(Index)];
+    if (Meter.Tick(static_cast<uint64_t>(bTail ? Inst.TailSteps : Inst.Steps)))
+    {
+        ExecutedCycles += bTail ? Inst.TailCycles : Inst.Cycles;
+        return true;
+    }
+    return ChargeLinesOneByOne(Meter, ExecutedCycles, Code, Index, bTail);
+}
+
+// a source operand as a lane row; an immediate is a single entry read with stride 0
+struct ConLaneRow
+{
+    const int32* Data = nullptr;
+    size_t Stride = 0;
+};
+
+inline bool GetLaneRow(const ConOperand& Operand, const ConBatchState& Batch, ConLaneRow& OutRow)
+{
+    switch (Operand.Kind)
+    {
+    case ConOperandKind::Register:
+        OutRow.Data = Batch.Values.data() + static_cast<size_t>(Operand.Value) * Batch.LaneCount;
+        OutRow.Stride = 1;
+        return true;
+    case ConOperandKind::Cache:
+        OutRow.Data = Batch.Caches.data() + static_cast<size_t>(Operand.Value) * Batch.LaneCount;
+        OutRow.Stride = 1;
+        return true;
+    case ConOperandKind::Immediate:
+        OutRow.Data = &Operand.Value;
+        OutRow.Stride = 0;
+        return true;
+    default:
+        return false;
+    }
+}
+
+template <typename TFunc>
+inline void StoreLaneRow(ConBatchState& Batch, const int32 Register, const ConLaneRow& Lhs, const ConLaneRow& Rhs, TFunc Func)
+{
+    int32* const Values = Batch.Values.data() + static_cast<size_t>(Register) * Batch.LaneCount;
+    int32* const Caches = Batch.Caches.data() + static_cast<size_t>(Register) * Batch.LaneCount;
+    for (size_t Lane = 0; Lane < Batch.LaneCount; ++Lane)
+    {
+        const int32 Result = Func(Lhs.Data[Lane * Lhs.Stride], Rhs.Data[Lane * Rhs.Stride]);
+        Caches[Lane] = Values[Lane];
+        Values[Lane] = Result;
+    }
+}
+
+// Runs a register-to-register instruction for every lane in one pass over the rows. Returns false
+// for anything touching lists or control flow, which then runs lane by lane.
+inline bool ExecuteLaneRows(const ConInstruction& Inst, ConBatchState& Batch)
+{
+    if (!Inst.A.IsRegister())
+    {
+        return false;
+    }
+    ConLaneRow Self;
+    GetLaneRow(Inst.A, Batch, Self);
+    ConLaneRow Lhs;
+    ConLaneRow Rhs;
+    const bool bUnary = GetLaneRow(Inst.B, Batch, Lhs);
+    const bool bBinary = bUnary && GetLaneRow(Inst.C, Batch, Rhs);
+    switch (GetBaseOpcode(Inst.Opcode))
+    {
+    case ConOpcode::Swp:
+    {
+        int32* const Values = Batch.Values.data() + static_cast<size_t>(Inst.A.Value) * Batch.LaneCount;
+        int32* const Caches = Batch.Caches.data() + static_cast<size_t>(Inst.A.Value) * Batch.LaneCount;
+        std::swap_ranges(Values, Values + Batch.LaneCount, Caches);
+        return true;
+    }
+    case ConOpcode::Incr:
+        StoreLaneRow(Batch, Inst.A.Value, Self, Self, [](const int32 Value, int32) { return Value + 1; });
+        return true;
+    case ConOpcode::Decr:
+        StoreLaneRow(Batch, Inst.A.Value, Self, Self, [](const int32 Value, int32) { return Value - 1; });
+        return true;
+    case ConOpcode::Set:
+        if (!bUnary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Lhs, [](const int32 Value, int32) { return Value; });
+        return true;
+    case ConOpcode::Not:
+        if (!bUnary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Lhs, [](const int32 Value, int32) { return ~Value; });
+        return true;
+    case ConOpcode::Add:
+        if (!bBinary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Rhs, [](const int32 L, const int32 R) { return L + R; });
+        return true;
+    case ConOpcode::Sub:
+        if (!bBinary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Rhs, [](const int32 L, const int32 R) { return L - R; });
+        return true;
+    case ConOpcode::Mul:
+        if (!bBinary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Rhs, [](const int32 L, const int32 R) { return L * R; });
+        return true;
+    case ConOpcode::Div:
+        if (!bBinary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Rhs, [](const int32 L, const int32 R) { return R == 0 ? 0 : L / R; });
+        return true;
+    case ConOpcode::And:
+        if (!bBinary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Rhs, [](const int32 L, const int32 R) { return L & R; });
+        return true;
+    case ConOpcode::Or:
+        if (!bBinary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Rhs, [](const int32 L, const int32 R) { return L | R; });
+        return true;
+    case ConOpcode::Xor:
+        if (!bBinary) return false;
+        StoreLaneRow(Batch, Inst.A.Value, Lhs, Rhs, [](const int32 L, const int32 R) { return L ^ R; });
+        return true;
+    default:
+        return false;
+    }
+}
+}
+
+void ConTraceSnapshot::Reset(const vector<ConVariableCached*>& ThreadVariables,
+                             const std::vector<std::pair<std::string, std::vector<int32>>>& Lists)
+{
+    BoundThread = &ThreadVariables;
+    Values.resize(ThreadVariables.size());
+    Caches.resize(ThreadVariables.size());
+    Defined.resize(ThreadVariables.size());
+    for (size_t i = 0; i < ThreadVariables.size(); ++i)
+    {
+        const ConVariableCached* Var = ThreadVariables[i];
+        if (Var != nullptr)
+        {
+            Defined[i] = true;
+            Values[i] = Var->GetVal();
+            Caches[i] = Var->GetCache();
+        }
+        else
+        {
+            Defined[i] = false;
+            Values[i] = 0;
+            Caches[i] = 0;
+        }
+    }
+
+    ListValues.clear();
+    for (const auto& Entry : Lists)
+    {
+        ListValues[Entry.first] = Entry.second;
+    }
+}
+
+void ConTraceSnapshot::EnsureAligned(const vector<ConVariableCached*>& ThreadVariables,
+                                     const std::vector<std::pair<std::string, std::vector<int32>>>& Lists)
+{
+    if (BoundThread != &ThreadVariables || Values.size() != ThreadVariables.size())
+    {
+        Reset(ThreadVariables, Lists);
+        return;
+    }
+
+    for (const auto& Entry : Lists)
+    {
+        if (ListValues.find(Entry.first) == ListValues.end())
+        {
+            ListValues[Entry.first] = Entry.second;
+        }
+    }
+
+    for (auto It = ListValues.begin(); It != ListValues.end();)
+    {
+        bool bPresent = false;
+        for (const auto& Entry : Lists)
+        {
+            if (Entry.first == It->first)
+            {
+                bPresent = true;
+                break;
+            }
+        }
+        if (!bPresent)
+        {
+            It = ListValues.erase(It);
+        }
+        else
+        {
+            ++It;
+        }
+    }
+}
+
+void ConThread::Execute()
+{
+    if (Engine == ConExecutionEngine::Bytecode)
+    {
+        ExecuteBytecode();
+    }
+    else
+    {
+        ExecuteTree();
+    }
+}
+
+void ConThread::ExecuteTree()
+{
+    BeginRun();
+    if (TraceRecorder != nullptr)
+    {
+        while (StepLineImpl<ConTraceRecorded>() == ConStepResult::Running)
+        {
+        }
+        TraceRecorder->Flush();
+    }
+    else if (bTraceExecution)
+    {
+        while (StepLineImpl<ConTraceOn>() == ConStepResult::Running)
+        {
+        }
+    }
+    else if (bProfileLines)
+    {
+        while (StepLineImpl<ConTraceProfiled>() == ConStepResult::Running)
+        {
+        }
+    }
+    else
+    {
+        while (StepLineImpl<ConTraceOff>() == ConStepResult::Running)
+        {
+        }
+    }
+}
+
+void ConThread::BeginRun()
+{
+    ResetRuntimeErrors();
+    if (TraceRecorder != nullptr)
+    {
+        BeginRecording();
+    }
+    else if (bTraceExecution)
+    {
+        ResetTraceSnapshot(*this, TraceSnapshot, ThreadVariables);
+    }
+    PrepareLineProfile();
+    ProgramCounter = 0;
+    LoopIterations.assign(Lines.size(), 0);
+    BudgetMeter.Begin(Budget, Budget.MaxCycles > 0 ? GetLineCycleBound() : 1);
+}
+
+bool ConThread::IsFinished() const
+{
+    return bHadRuntimeError || bDidReturn || ProgramCounter >= Lines.size() || BudgetMeter.IsExhausted();
+}
+
+const ConLine* ConThread::GetCurrentLine() const
+{
+    return ProgramCounter < Lines.size() ? &Lines[ProgramCounter] : nullptr;
+}
+
+ConStepResult ConThread::StepLine()
+{
+    if (TraceRecorder != nullptr)
+    {
+        return StepLineImpl<ConTraceRecorded>();
+    }
+    if (bTraceExecution)
+    {
+        return StepLineImpl<ConTraceOn>();
+    }
+    return bProfileLines ? StepLineImpl<ConTraceProfiled>() : StepLineImpl<ConTraceOff>();
+}
+
+ConStepResult ConThread::Step(const size_t Count)
+{
+    ConStepResult Result = ConStepResult::Running;
+    for (size_t Index = 0; Index < Count && Result == ConStepResult::Running; ++Index)
+    {
+        Result = StepLine();
+    }
+    return Result;
+}
+
+ConStepResult ConThread::RunUntil(const size_t LineIndex)
+{
+    ConStepResult Result = StepLine();
+    while (Result == ConStepResult::Running && ProgramCounter != LineIndex)
+    {
+        Result = StepLine();
+    }
+    return Result;
+}
+
+ConThreadSnapshot ConThread::CaptureSnapshot()
+{
+    auto State = std::make_shared<ConThreadSnapshotState>();
+    State->ProgramCounter = ProgramCounter;
+    State->Values.reserve(ThreadVariables.size());
+    State->Caches.reserve(ThreadVariables.size());
+    for (const ConVariableCached* Var : ThreadVariables)
+    {
+        State->Values.push_back(Var != nullptr ? Var->GetVal() : 0);
+        State->Caches.push_back(Var != nullptr ? Var->GetCache() : 0);
+    }
+
+    State->Lists.resize(OwnedListStorage.size());
+    for (size_t Index = 0; Index < OwnedListStorage.size(); ++Index)
+    {
+        ConVariableList& List = *OwnedListStorage[Index];
+        const ConListView View = List.GetView();
+        ConListSnapshot& Saved = State->Lists[Index];
+        const ConListSnapshot* Shared = SharedSnapshot != nullptr ? &SharedSnapshot->Lists[Index] : nullptr;
+        if (List.IsBorrowed() && Shared != nullptr && Shared->Values != nullptr && View.Data == Shared->Values->data())
+        {
+            // untouched since the last capture or restore, so the values are shared again
+            Saved.Values = Shared->Values;
+        }
+        else if (List.IsBorrowed())
+        {
+            Saved.External = View.Data;
+            Saved.ExternalCount = View.Count;
+        }
+        else
+        {
+            // the list hands its values over and reads them back in place until its next write
+            const size_t Cursor = List.GetCursor();
+            const int32 CurrentValue = List.GetVal();
+            Saved.Values = std::make_shared<const std::vector<int32>>(List.TakeValues());
+            List.BorrowValues(Saved.Values->data(), Saved.Values->size());
+            List.RestorePosition(Cursor, CurrentValue);
+        }
+        Saved.Cursor = List.GetCursor();
+        Saved.CurrentValue = List.GetVal();
+        Saved.Role = List.GetRole();
+        Saved.ExpectedSize = List.GetExpectedSize();
+    }
+
+    State->LoopIterations = LoopIterations;
+    State->ExecutedCycles = ExecutedCycles;
+    State->RuntimeErrors = RuntimeErrors;
+    State->bHadRuntimeError = bHadRuntimeError;
+    State->bDidReturn = bDidReturn;
+    State->bReturnHasValue = bReturnHasValue;
+    State->ReturnValue = ReturnValue;
+    State->BudgetMeter = BudgetMeter;
+    State->RemainingDuration = BudgetMeter.GetRemainingDuration();
+    State->LineCount = Lines.size();
+
+    // keeps the values the lists now borrow alive
+    SharedSnapshot = State;
+    ConThreadSnapshot Snapshot;
+    Snapshot.State = std::move(State);
+    return Snapshot;
+}
+
+bool ConThread::RestoreSnapshot(const ConThreadSnapshot& Snapshot)
+{
+    if (!Snapshot.IsValid())
+    {
+        return false;
+    }
+    const ConThreadSnapshotState& State = *Snapshot.State;
+    if (State.LineCount != Lines.size() || State.Values.size() != ThreadVariables.size() || State.Lists.size() != OwnedListStorage.size())
+    {
+        return false;
+    }
+
+    // held so the borrowed list values outlive this run
+    SharedSnapshot = Snapshot.State;
+    for (size_t Index = 0; Index < ThreadVariables.size(); ++Index)
+    {
+        if (ThreadVariables[Index] != nullptr)
+        {
+            ThreadVariables[Index]->SetVal(State.Values[Index]);
+            ThreadVariables[Index]->SetCache(State.Caches[Index]);
+        }
+    }
+    for (size_t Index = 0; Index < OwnedListStorage.size(); ++Index)
+    {
+        ConVariableList& List = *OwnedListStorage[Index];
+        const ConListSnapshot& Saved = State.Lists[Index];
+        if (Saved.Values != nullptr)
+        {
+            List.BorrowValues(Saved.Values->data(), Saved.Values->size());
+        }
+        else
+        {
+            List.BorrowValues(Saved.External, Saved.ExternalCount);
+        }
+        List.SetRole(Saved.Role);
+        List.SetExpectedSize(Saved.ExpectedSize);
+        List.RestorePosition(Saved.Cursor, Saved.CurrentValue);
+    }
+
+    ProgramCounter = State.ProgramCounter;
+    LoopIterations = State.LoopIterations;
+    // a snapshot taken before any run has no counters yet
+    LoopIterations.resize(Lines.size(), 0);
+    ExecutedCycles = State.ExecutedCycles;
+    RuntimeErrors = State.RuntimeErrors;
+    bHadRuntimeError = State.bHadRuntimeError;
+    bDidReturn = State.bDidReturn;
+    bReturnHasValue = State.bReturnHasValue;
+    ReturnValue = State.ReturnValue;
+    BudgetMeter = State.BudgetMeter;
+    BudgetMeter.ResumeDeadline(State.RemainingDuration);
+    PrepareLineProfile();
+    if (bTraceExecution)
+    {
+        ResetTraceSnapshot(*this, TraceSnapshot, ThreadVariables);
+    }
+    return true;
+}
+
+void ConThread::BeginRecording()
+{
+    ConTraceLog Header;
+    Header.LineNumbers.reserve(Lines.size());
+    Header.SourceLines.reserve(Lines.size());
+    for (size_t Index = 0; Index < Lines.size(); ++Index)
+    {
+        Header.LineNumbers.push_back(ResolveLineNumber(Lines[Index].GetLocation(), Index));
+        Header.SourceLines.push_back(Lines[Index].GetSourceText());
+    }
+    for (size_t Index = 0; Index < ThreadVariables.size(); ++Index)
+    {
+        Header.RegisterNames.push_back(RegisterName(Index));
+    }
+    std::vector<const ConVariableList*> WatchedLists;
+    for (const std::string& Name : GetListNames())
+    {
+        Header.ListNames.push_back(Name);
+        WatchedLists.push_back(FindListVar(Name));
+    }
+    TraceRecorder->Begin(Header, ThreadVariables, WatchedLists);
+}
+
+void ConThread::PrepareLineProfile()
+{
+    if (bProfileLines && LineProfile.size() != Lines.size())
+    {
+        LineProfile.assign(Lines.size(), ConLineProfile());
+    }
+}
+
+void ConThread::ResetLineProfile()
+{
+    LineProfile.assign(bProfileLines ? Lines.size() : 0, ConLineProfile());
+}
+
+int32 ConThread::GetSourceLineNumber(const size_t LineIndex) const
+{
+    return LineIndex < Lines.size() ? ResolveLineNumber(Lines[LineIndex].GetLocation(), LineIndex) : 0;
+}
+
+template <typename TracePolicy>
+void ConThread::TraceLine(const ConTraceEvent Event, const ConSourceLocation& Location, const size_t LineIndex, const ConLine& Line)
+{
+    if constexpr (TracePolicy::bProfile)
+    {
+        LineProfile[LineIndex].Record(Event, Line.GetCycleCount());
+    }
+    else if constexpr (TracePolicy::bPrint || TracePolicy::bRecord)
+    {
+        if (bProfileLines)
+        {
+            LineProfile[LineIndex].Record(Event, Line.GetCycleCount());
+        }
+    }
+    if constexpr (TracePolicy::bPrint)
+    {
+        PrintTrace(*this, TraceSnapshot, Event, Location, LineIndex, Line.GetSourceText(), ThreadVariables);
+    }
+    if constexpr (TracePolicy::bRecord)
+    {
+        TraceRecorder->RecordLine(Event, static_cast<int32>(LineIndex));
+    }
+}
+
+template <typename TracePolicy>
+ConStepResult ConThread::StepLineImpl()
+{
+    if (bHadRuntimeError)
+    {
+        return ConStepResult::Error;
+    }
+    if (bDidReturn || ProgramCounter >= Lines.size())
+    {
+        return ConStepResult::Finished;
+    }
+    if (!BudgetMeter.Tick() && !BudgetMeter.Check(ExecutedCycles))
+    {
+        return ConStepResult::BudgetExhausted;
+    }
+
+    size_t& i = ProgramCounter;
+    ConLine& Line = Lines[i];
+    const ConSourceLocation Location = Line.GetLocation();
+    const size_t LineIndex = i;
+    ExecutedCycles += Line.GetCycleCount();
+    auto Fail = [&](const ConSourceLocation& ErrorLocation, const char* Message)
+    {
+        ReportRuntimeError(ConRuntimeError(ErrorLocation, Message));
+        return ConStepResult::Error;
+    };
+    // ops lines stop at their static error inside RunOps; other lines raise it before doing anything
+    if (Line.GetStaticError() != nullptr && Line.GetKind() != ConLineKind::Ops)
+    {
+        return Fail(Line.GetStaticErrorLocation(), Line.GetStaticError());
+    }
+    switch (Line.GetKind())
+    {
+    case ConLineKind::Ops:
+    {
+        ConSourceLocation ErrorLocation;
+        if (const char* Error = Line.RunOps(ErrorLocation))
+        {
+            return Fail(ErrorLocation, Error);
+        }
+        ++i;
+        TraceLine<TracePolicy>(ConTraceEvent::Ops, Location, LineIndex, Line);
+        break;
+    }
+    case ConLineKind::If:
+    {
+        const bool bCondition = Line.EvaluateCondition();
+        if (!bCondition)
+        {
+            i += Line.GetSkipCount() + 1;
+        }
+        else
+        {
+            ++i;
+        }
+        TraceLine<TracePolicy>(bCondition ? ConTraceEvent::IfTrue : ConTraceEvent::IfFalse, Location, LineIndex, Line);
+        break;
+    }
+    case ConLineKind::Loop:
+    {
+        const int32 ExitIndex = Line.GetLoopExitIndex();
+        const int32 RedoIndex = ExitIndex > 0 ? ExitIndex - 1 : -1;
+        bool bRuns = true;
+        if (Line.HasCondition())
+        {
+            const bool bCondition = Line.EvaluateCondition();
+            if (!bCondition)
+            {
+                bRuns = false;
+                if (ExitIndex >= 0)
+                {
+                    i = static_cast<size_t>(ExitIndex);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        else
+        {
+            ++i;
+        }
+        if (!bRuns && RedoIndex >= 0)
+        {
+            const size_t RedoIdx = static_cast<size_t>(RedoIndex);
+            if (RedoIdx < LoopIterations.size())
+            {
+                LoopIterations[RedoIdx] = 0;
+            }
+        }
+        TraceLine<TracePolicy>(bRuns ? ConTraceEvent::RedoHead : ConTraceEvent::RedoSkip, Location, LineIndex, Line);
+        break;
+    }
+    case ConLineKind::Redo:
+    {
+        bool bLoop = Line.IsInfiniteLoop();
+        if (Line.HasCounter())
+        {
+            ConVariableCached* Counter = Line.GetCounter().GetThread();
+            if (Counter != nullptr)
+            {
+                const int32 NewVal = Counter->GetVal() - 1;
+                Counter->SetVal(NewVal);
+                bLoop = NewVal != 0;
+            }
+            else
+            {
+                bLoop = false;
+            }
+        }
+        else if (Line.HasCondition())
+        {
+            bLoop = Line.EvaluateCondition();
+        }
+
+        if (bLoop)
+        {
+            int32& IterationCount = LoopIterations[LineIndex];
+            ++IterationCount;
+            if (IterationCount > LoopIterationLimit)
+            {
+                return Fail(Location, "Loop exceeded 9999 iterations");
+            }
+
+            const int32 TargetIndex = Line.GetTargetIndex();
+            if (TargetIndex >= 0)
+            {
+                i = static_cast<size_t>(TargetIndex);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        else
+        {
+            LoopIterations[LineIndex] = 0;
+            ++i;
+        }
+        TraceLine<TracePolicy>(bLoop ? ConTraceEvent::Redo : ConTraceEvent::RedoExit, Location, LineIndex, Line);
+        break;
+    }
+    case ConLineKind::Jump:
+    {
+        bool bJump = true;
+        if (Line.HasCondition())
+        {
+            bJump = Line.EvaluateCondition();
+        }
+        if (bJump)
+        {
+            const int32 TargetIndex = Line.GetTargetIndex();
+            if (TargetIndex >= 0)
+            {
+                i = static_cast<size_t>(TargetIndex);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        else
+        {
+            ++i;
+        }
+        TraceLine<TracePolicy>(bJump ? ConTraceEvent::Jump : ConTraceEvent::NoJump, Location, LineIndex, Line);
+        break;
+    }
+    case ConLineKind::Return:
+    {
+        bDidReturn = true;
+        bReturnHasValue = Line.HasReturnValue();
+        if (bReturnHasValue)
+        {
+            const VariableRef& RetRef = Line.GetReturnValue();
+            if (!RetRef.IsValid())
+            {
+                return Fail(Location, "RET argument is invalid");
+            }
+            ReturnValue = RetRef.Read();
+        }
+        else
+        {
+            ReturnValue = 0;
+        }
+        i = Lines.size();
+        TraceLine<TracePolicy>(ConTraceEvent::Ret, Location, LineIndex, Line);
+        break;
+    }
+    case ConLineKind::Send:
+    {
+        if (Program == nullptr)
+        {
+            return Fail(Location, "SEND requires a multi-thread program");
+        }
+        if (!Program->HasThread(Line.GetChannel()))
+        {
+            return Fail(Location, "SEND target thread does not exist");
+        }
+        const VariableRef& Value = Line.GetChannelOperand();
+        if (!Value.IsValid())
+        {
+            return Fail(Location, "SEND value is invalid");
+        }
+        if (!Program->TrySend(ProgramIndex, Line.GetChannel(), Value.Read()))
+        {
+            // a blocked line is retried on the next cycle and only charged, cycles and step, once
+            // it completes
+            ExecutedCycles -= Line.GetCycleCount();
+            BudgetMeter.Refund();
+            return ConStepResult::Blocked;
+        }
+        ++i;
+        TraceLine<TracePolicy>(ConTraceEvent::Send, Location, LineIndex, Line);
+        break;
+    }
+    case ConLineKind::Listen:
+    {
+        if (Program == nullptr)
+        {
+            return Fail(Location, "LSTN requires a multi-thread program");
+        }
+        if (!Program->HasThread(Line.GetChannel()))
+        {
+            return Fail(Location, "LSTN source thread does not exist");
+        }
+        ConVariableCached* Dst = Line.GetChannelOperand().GetThread();
+        if (Dst == nullptr)
+        {
+            return Fail(Location, "LSTN destination is invalid");
+        }
+        int32 Received = 0;
+        if (!Program->TryReceive(ProgramIndex, Line.GetChannel(), Received))
+        {
+            ExecutedCycles -= Line.GetCycleCount();
+            BudgetMeter.Refund();
+            return ConStepResult::Blocked;
+        }
+        Dst->SetVal(Received);
+        ++i;
+        TraceLine<TracePolicy>(ConTraceEvent::Listen, Location, LineIndex, Line);
+        break;
+    }
+    default:
+    {
+        ++i;
+        TraceLine<TracePolicy>(ConTraceEvent::Step, Location, LineIndex, Line);
+        break;
+    }
+    }
+    return IsFinished() ? ConStepResult::Finished : ConStepResult::Running;
+}
+
+void ConThread::ExecuteBytecode()
+{
+    ResetRuntimeErrors();
+    EnsureBytecode();
+    PrepareLineProfile();
+    BudgetMeter.Begin(Budget, Budget.MaxCycles > 0 ? GetLineCycleBound() : 1);
+    if (TraceRecorder != nullptr)
+    {
+        BeginRecording();
+        ExecuteBytecodeImpl<ConTraceRecorded>();
+        TraceRecorder->Flush();
+    }
+    else if (bTraceExecution)
+    {
+        ResetTraceSnapshot(*this, TraceSnapshot, ThreadVariables);
+        ExecuteBytecodeImpl<ConTraceOn>();
+    }
+    else if (bProfileLines)
+    {
+        ExecuteBytecodeImpl<ConTraceProfiled>();
+    }
+    else
+    {
+        ExecuteBytecodeImpl<ConTraceOff>();
+    }
+}
+
+template <typename TracePolicy>
+void ConThread::ExecuteBytecodeImpl()
+{
+    const ConInstruction* const Code = Bytecode.Instructions.data();
+    const int32 End = static_cast<int32>(Bytecode.Instructions.size());
+    ConScalarMachine Machine;
+    if (BytecodeRegisters != nullptr)
+    {
+        Machine.Values = BytecodeRegisters->Values.data();
+        Machine.Caches = BytecodeRegisters->Caches.data();
+    }
+    Machine.Lists = BytecodeLists.data();
+    LoopIterations.assign(Lines.size(), 0);
+    int32 Pc = 0;
+
+    auto Fail = [&](const char* Message)
+    {
+        ReportRuntimeError(ConRuntimeError(Bytecode.Locations[static_cast<size_t>(Pc)], Message));
+    };
+    // false once the budget stopped the run ahead of one of the lines
+    auto Charge = [&](const int32 Index, const bool bTail) -> bool
+    {
+        return ChargeLines(BudgetMeter, ExecutedCycles, Bytecode, Index, bTail);
+    };
+    auto Store = [&](const ConInstruction& Inst, const int32 Value) -> bool
+    {
+        if (Inst.A.IsRegister())
+        {
+            SetRegister(Machine, Inst.A.Value, Value);
+            return true;
+        }
+        if (const char* Error = AppendToList(Machine.List(Inst.A.Value), GetBaseOpcode(Inst.Opcode), Value))
+        {
+            Fail(Error);
+            return false;
+        }
+        return true;
+    };
+    // the second half of a fused pair that falls or jumps into the LoopHead at Pc; false once
+    // the budget stopped the thread
+    auto RunLoopHead = [&]() -> bool
+    {
+        const ConInstruction& Head = Code[Pc];
+        if (Head.Steps != 0 && !Charge(Pc, false))
+        {
+            return false;
+        }
+        if (!Head.bHasCondition || EvaluateInstructionCondition(Head, Machine))
+        {
+            ++Pc;
+            return true;
+        }
+        Pc = Head.Target >= 0 ? Head.Target : Pc + 1;
+        if (Head.Aux >= 0 && static_cast<size_t>(Head.Aux) < LoopIterations.size())
+        {
+            LoopIterations[static_cast<size_t>(Head.Aux)] = 0;
+        }
+        return true;
+    };
+    // the loop tail of a fused pair: Redo at Pc, which as a RedoLoop also runs the LoopHead it
+    // jumps back to; false once the iteration limit or the budget stopped the thread
+    auto RunRedo = [&](const ConInstruction& Redo) -> bool
+    {
+        bool bLoop = Redo.Aux != 0;
+        if (Redo.A.IsRegister())
+        {
+            const int32 NewVal = Machine.Value(Redo.A.Value) - 1;
+            SetRegister(Machine, Redo.A.Value, NewVal);
+            bLoop = NewVal != 0;
+        }
+        else if (Redo.bHasCondition)
+        {
+            bLoop = EvaluateInstructionCondition(Redo, Machine);
+        }
+
+        int32& IterationCount = LoopIterations[static_cast<size_t>(Redo.Line)];
+        if (!bLoop)
+        {
+            IterationCount = 0;
+            ++Pc;
+            return true;
+        }
+        if (++IterationCount > LoopIterationLimit)
+        {
+            Fail("Loop exceeded 9999 iterations");
+            return false;
+        }
+        if (Redo.Opcode != ConOpcode::RedoLoop)
+        {
+            Pc = Redo.Target >= 0 ? Redo.Target : Pc + 1;
+            return true;
+        }
+        Pc = Redo.Target;
+        return RunLoopHead();
+    };
+
+    while (Pc < End)
+    {
+        const ConInstruction& Inst = Code[Pc];
+        if (Inst.Steps != 0 && !Charge(Pc, false))
+        {
+            return;
+        }
+        ConTraceEvent TraceEvent = ConTraceEvent::Ops;
+        switch (Inst.Opcode)
+        {
+        case ConOpcode::Nop:
+            ++Pc;
+            break;
+        case ConOpcode::Set:
+            if (!Store(Inst, ReadOperand(Inst.B, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Swp:
+            std::swap(Machine.Value(Inst.A.Value), Machine.Cache(Inst.A.Value));
+            ++Pc;
+            break;
+        case ConOpcode::Incr:
+            SetRegister(Machine, Inst.A.Value, Machine.Value(Inst.A.Value) + 1);
+            ++Pc;
+            break;
+        case ConOpcode::Decr:
+            SetRegister(Machine, Inst.A.Value, Machine.Value(Inst.A.Value) - 1);
+            ++Pc;
+            break;
+        case ConOpcode::Not:
+            if (!Store(Inst, ~ReadOperand(Inst.B, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Add:
+            if (!Store(Inst, ReadOperand(Inst.B, Machine) + ReadOperand(Inst.C, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Sub:
+            if (!Store(Inst, ReadOperand(Inst.B, Machine) - ReadOperand(Inst.C, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Mul:
+            if (!Store(Inst, ReadOperand(Inst.B, Machine) * ReadOperand(Inst.C, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Div:
+        {
+            const int32 Lhs = ReadOperand(Inst.B, Machine);
+            const int32 Rhs = ReadOperand(Inst.C, Machine);
+            if (!Store(Inst, Rhs == 0 ? 0 : Lhs / Rhs))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        }
+        case ConOpcode::And:
+            if (!Store(Inst, ReadOperand(Inst.B, Machine) & ReadOperand(Inst.C, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Or:
+            if (!Store(Inst, ReadOperand(Inst.B, Machine) | ReadOperand(Inst.C, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Xor:
+            if (!Store(Inst, ReadOperand(Inst.B, Machine) ^ ReadOperand(Inst.C, Machine)))
+            {
+                return;
+            }
+            ++Pc;
+            break;
+        case ConOpcode::Pop:
+            SetRegister(Machine, Inst.A.Value, Machine.List(Inst.B.Value)->Pop());
+            ++Pc;
+            break;
+        case ConOpcode::At:
+            SetRegister(Machine, Inst.A.Value, Machine.List(Inst.B.Value)->At(ReadOperand(Inst.C, Machine)));
+            ++Pc;
+            break;
+        case ConOpcode::If:
+        {
+            const bool bCondition = EvaluateInstructionCondition(Inst, Machine);
+            Pc = bCondition ? Pc + 1 : Inst.Target;
+            TraceEvent = bCondition ? ConTraceEvent::IfTrue : ConTraceEvent::IfFalse;
+            break;
+        }
+        case ConOpcode::LoopHead:
+        {
+            const bool bRuns = !Inst.bHasCondition || EvaluateInstructionCondition(Inst, Machine);
+            if (bRuns)
+            {
+                ++Pc;
+            }
+            else
+            {
+                Pc = Inst.Target >= 0 ? Inst.Target : Pc + 1;
+                if (Inst.Aux >= 0 && static_cast<size_t>(Inst.Aux) < LoopIterations.size())
+                {
+                    LoopIterations[static_cast<size_t>(Inst.Aux)] = 0;
+                }
+            }
+            TraceEvent = bRuns ? ConTraceEvent::RedoHead : ConTraceEvent::RedoSkip;
+            break;
+        }
+        case ConOpcode::Redo:
+        {
+            bool bLoop = Inst.Aux != 0;
+            if (Inst.A.IsRegister())
+            {
+                const int32 NewVal = Machine.Value(Inst.A.Value) - 1;
+                SetRegister(Machine, Inst.A.Value, NewVal);
+                bLoop = NewVal != 0;
+            }
+            else if (Inst.bHasCondition)
+            {
+                bLoop = EvaluateInstructionCondition(Inst, Machine);
+            }
+
+            int32& IterationCount = LoopIterations[static_cast<size_t>(Inst.Line)];
+            if (bLoop)
+            {
+                if (++IterationCount > LoopIterationLimit)
+                {
+                    Fail("Loop exceeded 9999 iterations");
+                    return;
+                }
+                Pc = Inst.Target >= 0 ? Inst.Target : Pc + 1;
+            }
+            else
+            {
+                IterationCount = 0;
+                ++Pc;
+            }
+            TraceEvent = bLoop ? ConTraceEvent::Redo : ConTraceEvent::RedoExit;
+            break;
+        }
+        case ConOpcode::Jump:
+        {
+            const bool bJump = !Inst.bHasCondition || EvaluateInstructionCondition(Inst, Machine);
+            Pc = (bJump && Inst.Target >= 0) ? Inst.Target : Pc + 1;
+            TraceEvent = bJump ? ConTraceEvent::Jump : ConTraceEvent::NoJump;
+            break;
+        }
+        case ConOpcode::Ret:
+            bDidReturn = true;
+            bReturnHasValue = Inst.A.IsValid();
+            ReturnValue = bReturnHasValue ? ReadOperand(Inst.A, Machine) : 0;
+            Pc = End;
+            TraceEvent = ConTraceEvent::Ret;
+            break;
+        case ConOpcode::Trap:
+        {
+            const ConBytecodeTrap& Trap = Bytecode.Traps[static_cast<size_t>(Inst.A.Value)];
+            ReportRuntimeError(ConRuntimeError(Trap.Location, Trap.Message));
+            return;
+        }
+        // fused pairs (fusion.h) never run traced; the second half is charged and reported at
+        // its own Pc
+        case ConOpcode::PopRedo:
+            SetRegister(Machine, Inst.A.Value, Machine.List(Inst.B.Value)->Pop());
+            ++Pc;
+            if ((Code[Pc].Steps != 0 && !Charge(Pc, false)) || !RunRedo(Code[Pc]))
+            {
+                return;
+            }
+            break;
+        case ConOpcode::RedoLoop:
+            if (!RunRedo(Inst))
+            {
+                return;
+            }
+            break;
+        case ConOpcode::SetPop:
+        {
+            if (!Store(Inst, ReadOperand(Inst.B, Machine)))
+            {
+                return;
+            }
+            const ConInstruction& Next = Code[++Pc];
+            if (Next.Steps != 0 && !Charge(Pc, false))
+            {
+                return;
+            }
+            SetRegister(Machine, Next.A.Value, Machine.List(Next.B.Value)->Pop());
+            ++Pc;
+            break;
+        }
+        case ConOpcode::PopLoop:
+            SetRegister(Machine, Inst.A.Value, Machine.List(Inst.B.Value)->Pop());
+            ++Pc;
+            if (!RunLoopHead())
+            {
+                return;
+            }
+            break;
+        }
+
+        if constexpr (TracePolicy::bPrint || TracePolicy::bRecord || TracePolicy::bProfile)
+        {
+            if (Inst.bEndsLine)
+            {
+                const ConLine& Line = Lines[static_cast<size_t>(Inst.Line)];
+                TraceLine<TracePolicy>(TraceEvent, Line.GetLocation(), static_cast<size_t>(Inst.Line), Line);
+            }
+        }
+        // only instructions that always fall through carry lines after them
+        if (Inst.TailSteps != 0 && !Charge(Pc - 1, true))
+        {
+            return;
+        }
+    }
+}
+
+void ConThread::BeginBatch(ConBatchState& Batch, const size_t LaneCount) const
+{
+    const size_t RegisterCount = BytecodeRegisters != nullptr ? BytecodeRegisters->Size() : ThreadVariables.size();
+    Batch.Resize(LaneCount, RegisterCount, OwnedListStorage.size());
+}
+
+void ConThread::CaptureBatchLane(ConBatchState& Batch, const size_t Lane) const
+{
+    for (const ConVariableCached* Var : ThreadVariables)
+    {
+        const size_t Slot = static_cast<size_t>(Var->GetIndex()) * Batch.LaneCount + Lane;
+        Batch.Values[Slot] = Var->GetVal();
+        Batch.Caches[Slot] = Var->GetCache();
+    }
+    for (size_t Index = 0; Index < OwnedListStorage.size(); ++Index)
+    {
+        Batch.Lists[Index * Batch.LaneCount + Lane] = *OwnedListStorage[Index];
+    }
+}
+
+void ConThread::RestoreBatchLane(const ConBatchState& Batch, const size_t Lane)
+{
+    for (ConVariableCached* Var : ThreadVariables)
+    {
+        const size_t Slot = static_cast<size_t>(Var->GetIndex()) * Batch.LaneCount + Lane;
+        Var->SetVal(Batch.Values[Slot]);
+        Var->SetCache(Batch.Caches[Slot]);
+    }
+    for (size_t Index = 0; Index < OwnedListStorage.size(); ++Index)
+    {
+        *OwnedListStorage[Index] = Batch.Lists[Index * Batch.LaneCount + Lane];
+    }
+    ResetRuntimeErrors();
+    if (!Batch.Errors[Lane].empty())
+    {
+        bHadRuntimeError = true;
+        RuntimeErrors.push_back(Batch.Errors[Lane]);
+    }
+    bDidReturn = Batch.DidReturn[Lane] != 0;
+    bReturnHasValue = Batch.ReturnHasValue[Lane] != 0;
+    ReturnValue = Batch.ReturnValues[Lane];
+    ExecutedCycles = Batch.ExecutedCycles[Lane];
+    BudgetMeter.Stop(static_cast<ConBudgetLimit>(Batch.BudgetLimits[Lane]));
+}
+
+void ConThread::ExecuteBatch(ConBatchState& Batch)
+{
+    EnsureBytecode();
+    const size_t LaneCount = Batch.LaneCount;
+    const size_t LoopCount = Lines.size();
+    const ConInstruction* const Code = Bytecode.Instructions.data();
+    const int32 End = static_cast<int32>(Bytecode.Instructions.size());
+
+    std::fill(Batch.ExecutedCycles.begin(), Batch.ExecutedCycles.end(), 0);
+    std::fill(Batch.ReturnValues.begin(), Batch.ReturnValues.end(), 0);
+    std::fill(Batch.DidReturn.begin(), Batch.DidReturn.end(), 0);
+    std::fill(Batch.ReturnHasValue.begin(), Batch.ReturnHasValue.end(), 0);
+    std::fill(Batch.Errors.begin(), Batch.Errors.end(), std::string());
+    std::fill(Batch.BudgetLimits.begin(), Batch.BudgetLimits.end(), 0);
+    Batch.GroupSteps = 0;
+    Batch.LaneSteps = 0;
+
+    std::vector<int32>& LanePcs = Batch.LanePcs;
+    std::vector<int32>& LaneLoops = Batch.LaneLoops;
+    std::vector<uint32_t>& Group = Batch.Group;
+    LanePcs.assign(LaneCount, 0);
+    LaneLoops.assign(LaneCount * LoopCount, 0);
+    Group.reserve(LaneCount);
+
+    ConLaneGroupContext Context;
+    Context.Batch = &Batch;
+    Context.Bytecode = &Bytecode;
+    Context.Lines = &Lines;
+    Context.End = End;
+    Context.LoopCount = LoopCount;
+    Context.bEchoErrors = bEchoRuntimeErrors;
+
+    // every lane meters its own budget, so it stops on the line its scalar run would
+    std::vector<ConBudgetMeter>& Meters = Batch.Meters;
+    Meters.assign(LaneCount, ConBudgetMeter());
+    const int32 StepCycleBound = Budget.MaxCycles > 0 ? GetLineCycleBound() : 1;
+    for (ConBudgetMeter& Meter : Meters)
+    {
+        Meter.Begin(Budget, StepCycleBound);
+    }
+    // charges the group's lanes for the lines at Index; lanes a limit stops leave the group
+    auto ChargeGroup = [&](const int32 Index, const bool bTail)
+    {
+        size_t Kept = 0;
+        for (size_t Slot = 0; Slot < Group.size(); ++Slot)
+        {
+            const uint32_t Lane = Group[Slot];
+            if (ChargeLines(Meters[Lane], Batch.ExecutedCycles[Lane], Bytecode, Index, bTail))
+            {
+                Group[Kept++] = Lane;
+                continue;
+            }
+            LanePcs[Lane] = End;
+            Batch.BudgetLimits[Lane] = static_cast<uint8_t>(Meters[Lane].GetExhaustedLimit());
+        }
+        Group.resize(Kept);
+    };
+    while (true)
+    {
+        // the lanes at the lowest program counter run next; the rest wait there to rejoin them
+        int32 Pc = End;
+        Group.clear();
+        for (size_t Lane = 0; Lane < LaneCount; ++Lane)
+        {
+            const int32 LanePc = LanePcs[Lane];
+            if (LanePc < Pc)
+            {
+                Pc = LanePc;
+                Group.clear();
+            }
+            if (LanePc == Pc)
+            {
+                Group.push_back(static_cast<uint32_t>(Lane));
+            }
+        }
+        if (Pc >= End)
+        {
+            break;
+        }
+
+        const ConInstruction& Inst = Code[Pc];
+        if (Inst.Steps != 0)
+        {
+            ChargeGroup(Pc, false);
+            if (Group.empty())
+            {
+                continue;
+            }
+        }
+        ++Batch.GroupSteps;
+        Batch.LaneSteps += Group.size();
+        if (Group.size() == LaneCount && ExecuteLaneRows(Inst, Batch))
+        {
+            std::fill(LanePcs.begin(), LanePcs.end(), Pc + 1);
+            if (Inst.TailSteps != 0)
+            {
+                ChargeGroup(Pc, true);
+            }
+            continue;
+        }
+
+        switch (Inst.Opcode)
+        {
+        case ConOpcode::Nop:
+            RunLaneGroup<ConOpcode::Nop>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Set:
+            RunLaneGroup<ConOpcode::Set>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Swp:
+            RunLaneGroup<ConOpcode::Swp>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Incr:
+            RunLaneGroup<ConOpcode::Incr>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Decr:
+            RunLaneGroup<ConOpcode::Decr>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Not:
+            RunLaneGroup<ConOpcode::Not>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Add:
+            RunLaneGroup<ConOpcode::Add>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Sub:
+            RunLaneGroup<ConOpcode::Sub>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Mul:
+            RunLaneGroup<ConOpcode::Mul>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Div:
+            RunLaneGroup<ConOpcode::Div>(Context, Inst, Pc);
+            break;
+        case ConOpcode::And:
+            RunLaneGroup<ConOpcode::And>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Or:
+            RunLaneGroup<ConOpcode::Or>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Xor:
+            RunLaneGroup<ConOpcode::Xor>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Pop:
+            RunLaneGroup<ConOpcode::Pop>(Context, Inst, Pc);
+            break;
+        case ConOpcode::At:
+            RunLaneGroup<ConOpcode::At>(Context, Inst, Pc);
+            break;
+        case ConOpcode::If:
+            RunLaneGroup<ConOpcode::If>(Context, Inst, Pc);
+            break;
+        case ConOpcode::LoopHead:
+            RunLaneGroup<ConOpcode::LoopHead>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Redo:
+            RunLaneGroup<ConOpcode::Redo>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Jump:
+            RunLaneGroup<ConOpcode::Jump>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Ret:
+            RunLaneGroup<ConOpcode::Ret>(Context, Inst, Pc);
+            break;
+        case ConOpcode::Trap:
+            RunLaneGroup<ConOpcode::Trap>(Context, Inst, Pc);
+            break;
+        // lanes step one instruction at a time, so fused pairs run as their first half
+        case ConOpcode::PopRedo:
+            RunLaneGroup<ConOpcode::Pop>(Context, Inst, Pc);
+            break;
+        case ConOpcode::SetPop:
+            RunLaneGroup<ConOpcode::Set>(Context, Inst, Pc);
+            break;
+        case ConOpcode::PopLoop:
+            RunLaneGroup<ConOpcode::Pop>(Context, Inst, Pc);
+            break;
+        case ConOpcode::RedoLoop:
+            RunLaneGroup<ConOpcode::Redo>(Context, Inst, Pc);
+            break;
+        }
+        // instructions with lines after them never fail, so every lane in the group fell through
+        if (Inst.TailSteps != 0)
+        {
+            ChargeGroup(Pc, true);
+        }
+    }
+}
+
+int32 ConThread::GetLineCycleBound() const
+{
+    int32 Bound = 0;
+    for (const ConLine& Line : Lines)
+    {
+        Bound = std::max(Bound, Line.GetCycleCount());
+    }
+    return Bound;
+}
+
+void ConThread::UpdateCycleCount()
+{
+    ConCompilable::UpdateCycleCount();
+    const int32 VarCount = int32(ThreadVariables.size());
+    for (ConLine& Line : Lines)
+    {
+        Line.UpdateCycleCount(VarCount);
+        AddCycles(Line.GetCycleCount());
+    }
+    if (Bytecode.bOptimized)
+    {
+        // optimized lines may share instructions, so their new costs need a fresh build
+        bBytecodeDirty = true;
+    }
+    else if (!bBytecodeDirty)
+    {
+        Bytecode.AssignLineCycles(Lines);
+    }
+}
+
+void ConThread::SetVariables(const vector<ConVariableCached*>& InVariables)
+{
+    ThreadVariables = InVariables;
+    bBytecodeDirty = true;
+}
+
+void ConThread::SetOwnedStorage(ConArena&& Storage,
+                                ConRegisterFile* const Registers,
+                                std::vector<ConVariableList*>&& ListVars,
+                                std::unordered_map<std::string, ConVariableList*>&& ListNameMap)
+{
+    OwnedStorage = std::move(Storage);
+    OwnedRegisters = Registers;
+    OwnedListStorage = std::move(ListVars);
+    ListLookup = std::move(ListNameMap);
+    ReverseListLookup.clear();
+    for (const auto& Pair : ListLookup)
+    {
+        if (Pair.second != nullptr)
+        {
+            ReverseListLookup[Pair.second] = Pair.first;
+        }
+    }
+    bBytecodeDirty = true;
+}
+
+void ConThread::ConstructLine(const ConLine &Line)
+{
+    Lines.push_back(Line);
+    Lines.back().Verify();
+    bBytecodeDirty = true;
+}
+
+void ConThread::ConstructLine(ConLine&& Line)
+{
+    Lines.push_back(std::move(Line));
+    Lines.back().Verify();
+    bBytecodeDirty = true;
+}
+
+void ConThread::CompileBytecode()
+{
+    BytecodeLists.clear();
+    BytecodeLists.reserve(OwnedListStorage.size());
+    for (ConVariableList* List : OwnedListStorage)
+    {
+        BytecodeLists.push_back(List);
+    }
+    BytecodeRegisters = ThreadVariables.empty() || ThreadVariables.front() == nullptr ? nullptr : ThreadVariables.front()->GetFile();
+    ConBytecodeBuilder Builder(ThreadVariables, BytecodeLists, Bytecode);
+    Builder.Build(Lines);
+    if (WantsOptimizedBytecode())
+    {
+        OptimizeBytecode(Bytecode);
+        FuseBytecode(Bytecode);
+    }
+    bBytecodeDirty = false;
+}
+
+void ConThread::EnsureBytecode()
+{
+    if (bBytecodeDirty || Bytecode.bOptimized != WantsOptimizedBytecode())
+    {
+        CompileBytecode();
+    }
+}
+
+void ConThread::SetTraceEnabled(const bool bEnabled)
+{
+    bTraceExecution = bEnabled;
+}
+
+ConVariableCached* ConThread::GetThreadVar(const size_t Index)
+{
+    if (Index >= ThreadVariables.size())
+    {
+        return nullptr;
+    }
+    return ThreadVariables[Index];
+}
+
+const ConVariableCached* ConThread::GetThreadVar(const size_t Index) const
+{
+    if (Index >= ThreadVariables.size())
+    {
+        return nullptr;
+    }
+    return ThreadVariables[Index];
+}
+
+int32 ConThread::GetThreadValue(const size_t Index) const
+{
+    const ConVariableCached* Var = GetThreadVar(Index);
+    return Var != nullptr ? Var->GetVal() : 0;
+}
+
+int32 ConThread::GetThreadCacheValue(const size_t Index) const
+{
+    const ConVariableCached* Var = GetThreadVar(Index);
+    return Var != nullptr ? Var->GetCache() : 0;
+}
+
+void ConThread::SetThreadValue(const size_t Index, const int32 Value)
+{
+    ConVariableCached* Var = GetThreadVar(Index);
+    if (Var != nullptr)
+    {
+        Var->SetVal(Value);
+    }
+}
+
+ConVariableList* ConThread::GetListVar(const size_t Index)
+{
+    if (Index >= OwnedListStorage.size())
+    {
+        return nullptr;
+    }
+    return OwnedListStorage[Index];
+}
+
+const ConVariableList* ConThread::GetListVar(const size_t Index) const
+{
+    if (Index >= OwnedListStorage.size())
+    {
+        return nullptr;
+    }
+    return OwnedListStorage[Index];
+}
+
+ConVariableList* ConThread::FindListVar(const std::string& Name)
+{
+    const std::string Upper = ToUpperCopy(Name);
+    auto It = ListLookup.find(Upper);
+    if (It == ListLookup.end())
     {
         return nullptr;
     }
@@ -758,7 +2152,41 @@ void ConThread::ReportRuntimeError(const ConRuntimeError& Error)
     bHadRuntimeError = true;
     const std::string Formatted = FormatErrorMessage(Error.Location, Error.what());
     RuntimeErrors.push_back(Formatted);
-    std::cerr << Formatted << std::endl;
+    if (bEchoRuntimeErrors)
+    {
+        std::cerr << Formatted << std::endl;
+    }
+}
+
+void ConThread::ResetState()
+{
+    if (OwnedRegisters != nullptr)
+    {
+        OwnedRegisters->Reset();
+    }
+    else
+    {
+        for (ConVariableCached* Var : ThreadVariables)
+        {
+            if (Var != nullptr)
+            {
+                Var->Reset();
+            }
+        }
+    }
+    for (ConVariableList* List : OwnedListStorage)
+    {
+        if (List->IsOutput())
+        {
+            List->Clear();
+        }
+        else
+        {
+            List->Reset();
+        }
+    }
+    ProgramCounter = 0;
+    ResetRuntimeErrors();
 }
 
 void ConThread::ResetRuntimeErrors()
@@ -768,4 +2196,6 @@ void ConThread::ResetRuntimeErrors()
     bDidReturn = false;
     bReturnHasValue = false;
     ReturnValue = 0;
+    ExecutedCycles = 0;
+    BudgetMeter = ConBudgetMeter();
 }
@@ -1,11 +1,90 @@
 #pragma once
+#include "arena.h"
+#include "batch.h"
+#include "budget.h"
+#include "bytecode.h"
 #include "line.h"
+#include "snapshot.h"
+#include "trace.h"
 #include "variable.h"
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+struct ConProgram;
+
+// last traced register and list values, so each trace line only prints what changed.
+// owned per thread so concurrent runs never share trace state
+struct ConTraceSnapshot
+{
+    void Reset(const vector<ConVariableCached*>& ThreadVariables,
+               const std::vector<std::pair<std::string, std::vector<int32>>>& Lists);
+    void EnsureAligned(const vector<ConVariableCached*>& ThreadVariables,
+                       const std::vector<std::pair<std::string, std::vector<int32>>>& Lists);
+
+    const vector<ConVariableCached*>* BoundThread = nullptr;
+    std::vector<int32> Values;
+    std::vector<int32> Caches;
+    std::vector<bool> Defined;
+    std::unordered_map<std::string, std::vector<int32>> ListValues;
+};
+
+enum class ConStepResult
+{
+    // the line ran and more lines remain
+    Running,
+    // SEND or LSTN could not complete; the same line is retried on the next step
+    Blocked,
+    // RET ran or execution fell off the last line
+    Finished,
+    // a runtime error was reported
+    Error,
+    // the run's ConExecutionBudget ran out before the line; nothing was reported as an error
+    BudgetExhausted
+};
+
+// compile-time tracing policies; the untraced instantiations contain no trace code at all
+struct ConTraceOff
+{
+    static constexpr bool bPrint = false;
+    static constexpr bool bRecord = false;
+    static constexpr bool bProfile = false;
+};
+
+// the coloured human-readable trace on stdout
+struct ConTraceOn
+{
+    static constexpr bool bPrint = true;
+    static constexpr bool bRecord = false;
+    static constexpr bool bProfile = false;
+};
+
+// binary records into a ConTraceRecorder
+struct ConTraceRecorded
+{
+    static constexpr bool bPrint = false;
+    static constexpr bool bRecord = true;
+    static constexpr bool bProfile = false;
+};
+
+// per-line counters only; traced runs check for profiling at runtime instead
+struct ConTraceProfiled
+{
+    static constexpr bool bPrint = false;
+    static constexpr bool bRecord = false;
+    static constexpr bool bProfile = true;
+};
+
+enum class ConExecutionEngine
+{
+    // walks the ConLine tree; the reference implementation
+    Tree,
+    // runs the flat instruction array produced by ConBytecodeBuilder
+    Bytecode
+};
+
 struct ConThread final : public ConCompilable
 {
 public:
@@ -13,16 +92,75 @@ public:
     explicit ConThread(const vector<ConVariableCached*>& InVariables) : ThreadVariables(InVariables) {}
     virtual void Execute() override;
     virtual void UpdateCycleCount() override;
+    // cycles charged by the most recent Execute, following the path actually taken
+    int32 GetExecutedCycleCount() const { return ExecutedCycles; }
     void SetVariables(const vector<ConVariableCached*>& InVariables);
-    void SetOwnedStorage(std::vector<std::unique_ptr<ConVariableCached>>&& CachedVars,
-                         std::vector<std::unique_ptr<ConVariableAbsolute>>&& ConstVars,
-                         std::vector<std::unique_ptr<ConVariableList>>&& ListVars,
-                         std::vector<std::unique_ptr<ConBaseOp>>&& Ops,
+    // takes the arena holding the parsed program; Registers and ListVars point into it
+    void SetOwnedStorage(ConArena&& Storage,
+                         ConRegisterFile* Registers,
+                         std::vector<ConVariableList*>&& ListVars,
                          std::unordered_map<std::string, ConVariableList*>&& ListNameMap);
     void ConstructLine(const ConLine& Line);
+    void ConstructLine(ConLine&& Line);
+    void ReserveLines(size_t Count) { Lines.reserve(Count); }
+    void CompileBytecode();
+    // rewinds the thread to its just-parsed state: registers and caches zeroed, list cursors
+    // rewound and OUT lists emptied. Lines, bytecode and owned storage are kept.
+    void ResetState();
+    const ConBytecode& GetBytecode() const { return Bytecode; }
+
+    // Lockstep batch execution with bytecode semantics. Set each lane up on this thread as for a
+    // normal run and capture it, run the batch, then restore a lane to inspect it as if it had
+    // just been executed alone. Lanes that branch apart are masked and rejoin at the lowest
+    // program counter; tracing does not apply to batch runs.
+    void BeginBatch(ConBatchState& Batch, size_t LaneCount) const;
+    void CaptureBatchLane(ConBatchState& Batch, size_t Lane) const;
+    void ExecuteBatch(ConBatchState& Batch);
+    void RestoreBatchLane(const ConBatchState& Batch, size_t Lane);
+
+    void SetExecutionEngine(ConExecutionEngine InEngine) { Engine = InEngine; }
+    ConExecutionEngine GetExecutionEngine() const { return Engine; }
+    // runs OptimizeBytecode over the bytecode before executing it. Results, errors and executed
+    // cycles are unchanged and the static estimate still comes from the lines; traced runs use
+    // the plain bytecode so every line still shows up.
+    void SetBytecodeOptimization(bool bEnabled) { bOptimizeBytecode = bEnabled; }
+    bool IsBytecodeOptimizationEnabled() const { return bOptimizeBytecode; }
+
+    // resumable line-by-line execution with tree semantics; Execute is BeginRun plus StepLine until done
+    void BeginRun();
+    ConStepResult StepLine();
+    bool IsFinished() const;
+    const ConLine* GetCurrentLine() const;
+    size_t GetProgramCounter() const { return ProgramCounter; }
+    // runs up to Count lines, stopping early when the run blocks, finishes, fails or runs out of
+    // budget; returns the last line's result
+    ConStepResult Step(size_t Count);
+    // runs at least one line, then on until LineIndex is the next line to run or the run stops
+    ConStepResult RunUntil(size_t LineIndex);
+
+    // Pausing and forking runs. A snapshot holds a run as it stands between two lines. Restoring
+    // it into this thread, or into another thread parsed from the same source, sets up a run that
+    // StepLine, Step and RunUntil carry on from there, with tree semantics whatever the engine.
+    // Restore returns false and changes nothing when the registers, lists or lines do not match.
+    // Capturing hands the lists' values to the snapshot, and the thread then reads them in place
+    // like a restored one, so nothing is copied until a list is appended to.
+    ConThreadSnapshot CaptureSnapshot();
+    bool RestoreSnapshot(const ConThreadSnapshot& Snapshot);
+    // gives SEND/LSTN access to the program's mailboxes; Index is this thread's slot
+    void AttachToProgram(ConProgram* InProgram, int32 Index) { Program = InProgram; ProgramIndex = Index; }
+
+    // limits for every following run, including batch runs; the default has none
+    void SetExecutionBudget(const ConExecutionBudget& InBudget) { Budget = InBudget; }
+    const ConExecutionBudget& GetExecutionBudget() const { return Budget; }
+    // the limit that stopped the last run, or None when it ended on its own
+    ConBudgetLimit GetExhaustedBudgetLimit() const { return BudgetMeter.GetExhaustedLimit(); }
+    bool WasBudgetExhausted() const { return BudgetMeter.IsExhausted(); }
 
     bool HadRuntimeError() const { return bHadRuntimeError; }
     const std::vector<std::string>& GetRuntimeErrors() const { return RuntimeErrors; }
+    // runtime errors are printed to stderr as they happen unless this is turned off
+    void SetRuntimeErrorEcho(bool bEnabled) { bEchoRuntimeErrors = bEnabled; }
+    bool IsRuntimeErrorEchoEnabled() const { return bEchoRuntimeErrors; }
 
     bool DidReturn() const { return bDidReturn; }
     bool HasReturnValue() const { return bDidReturn && bReturnHasValue; }
@@ -30,6 +168,21 @@ public:
 
     void SetTraceEnabled(bool bEnabled);
     bool IsTraceEnabled() const { return bTraceExecution; }
+    // while set, runs record into Recorder instead of printing; the recorder must outlive the runs
+    void SetTraceRecorder(ConTraceRecorder* Recorder) { TraceRecorder = Recorder; }
+    ConTraceRecorder* GetTraceRecorder() const { return TraceRecorder; }
+
+    // Per-line counters, index-aligned with the parsed lines and summed over every run until
+    // ResetLineProfile. Profiled runs use the plain bytecode, since optimized lines may share
+    // instructions; batch runs are not profiled.
+    void SetLineProfiling(bool bEnabled) { bProfileLines = bEnabled; }
+    bool IsLineProfilingEnabled() const { return bProfileLines; }
+    const std::vector<ConLineProfile>& GetLineProfile() const { return LineProfile; }
+    void ResetLineProfile();
+    size_t GetLineCount() const { return Lines.size(); }
+    const ConLine& GetLine(size_t LineIndex) const { return Lines[LineIndex]; }
+    // the source line a parsed line came from; generated REDO checks share their loop's line
+    int32 GetSourceLineNumber(size_t LineIndex) const;
 
     size_t GetThreadVarCount() const { return ThreadVariables.size(); }
     ConVariableCached* GetThreadVar(size_t Index);
@@ -39,6 +192,7 @@ public:
     void SetThreadValue(size_t Index, int32 Value);
 
     size_t GetListVarCount() const { return OwnedListStorage.size(); }
+    const ConArena& GetStorage() const { return OwnedStorage; }
     ConVariableList* GetListVar(size_t Index);
     const ConVariableList* GetListVar(size_t Index) const;
     ConVariableList* FindListVar(const std::string& Name);
@@ -47,20 +201,59 @@ public:
     std::vector<std::string> GetListNames() const;
 
 private:
+    void ExecuteTree();
+    void ExecuteBytecode();
+    template <typename TracePolicy>
+    ConStepResult StepLineImpl();
+    template <typename TracePolicy>
+    void ExecuteBytecodeImpl();
+    template <typename TracePolicy>
+    void TraceLine(ConTraceEvent Event, const ConSourceLocation& Location, size_t LineIndex, const ConLine& Line);
+    void PrepareLineProfile();
+    void BeginRecording();
     void ReportRuntimeError(const ConRuntimeError& Error);
+    bool WantsOptimizedBytecode() const
+    {
+        return bOptimizeBytecode && !bTraceExecution && TraceRecorder == nullptr && !bProfileLines;
+    }
+    void EnsureBytecode();
     void ResetRuntimeErrors();
+    // the most cycles one line can charge, for ConBudgetMeter::Begin
+    int32 GetLineCycleBound() const;
 
     vector<ConVariableCached*> ThreadVariables;
     vector<ConLine> Lines;
-    std::vector<std::unique_ptr<ConVariableCached>> OwnedVarStorage;
-    std::vector<std::unique_ptr<ConVariableAbsolute>> OwnedConstStorage;
-    std::vector<std::unique_ptr<ConVariableList>> OwnedListStorage;
-    std::vector<std::unique_ptr<ConBaseOp>> OwnedOpStorage;
+    ConArena OwnedStorage;
+    ConRegisterFile* OwnedRegisters = nullptr;
+    std::vector<ConVariableList*> OwnedListStorage;
     std::unordered_map<std::string, ConVariableList*> ListLookup;
     std::unordered_map<ConVariableList*, std::string> ReverseListLookup;
+    ConBytecode Bytecode;
+    std::vector<ConVariableList*> BytecodeLists;
+    // the file every register handle points into; bytecode operands index it directly
+    ConRegisterFile* BytecodeRegisters = nullptr;
+    bool bBytecodeDirty = true;
+    bool bOptimizeBytecode = false;
+    // per-REDO iteration counts, kept as a member so repeated runs reuse the storage
+    std::vector<int32> LoopIterations;
+    ConExecutionEngine Engine = ConExecutionEngine::Tree;
+    ConExecutionBudget Budget;
+    ConBudgetMeter BudgetMeter;
+    // the snapshot last captured or restored; lists read its values in place until they are written
+    std::shared_ptr<const ConThreadSnapshotState> SharedSnapshot;
+    ConTraceSnapshot TraceSnapshot;
+    ConTraceRecorder* TraceRecorder = nullptr;
     std::vector<std::string> RuntimeErrors;
     bool bHadRuntimeError = false;
-    bool bTraceExecution = true;
+    bool bEchoRuntimeErrors = true;
+    // opt-in: tracing prints every line and is far slower than execution itself
+    bool bTraceExecution = false;
+    bool bProfileLines = false;
+    std::vector<ConLineProfile> LineProfile;
+    int32 ExecutedCycles = 0;
+    size_t ProgramCounter = 0;
+    ConProgram* Program = nullptr;
+    int32 ProgramIndex = -1;
     bool bDidReturn = false;
     bool bReturnHasValue = false;
     int32 ReturnValue = 0;
@@ -0,0 +1,469 @@
+#include "trace.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+const char TraceMagic[8] = {'C', 'O', 'N', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t TraceVersion = 1;
+
+template <typename ValueType>
+void WritePod(std::ostream& Out, const ValueType& Value)
+{
+    Out.write(reinterpret_cast<const char*>(&Value), sizeof(ValueType));
+}
+
+template <typename ValueType>
+bool ReadPod(std::istream& In, ValueType& Value)
+{
+    return static_cast<bool>(In.read(reinterpret_cast<char*>(&Value), sizeof(ValueType)));
+}
+
+void WriteString(std::ostream& Out, const std::string& Text)
+{
+    WritePod(Out, static_cast<uint32_t>(Text.size()));
+    Out.write(Text.data(), static_cast<std::streamsize>(Text.size()));
+}
+
+bool ReadString(std::istream& In, std::string& Text)
+{
+    uint32_t Size = 0;
+    if (!ReadPod(In, Size))
+    {
+        return false;
+    }
+    Text.resize(Size);
+    return Size == 0 || static_cast<bool>(In.read(&Text[0], Size));
+}
+
+void WriteStrings(std::ostream& Out, const std::vector<std::string>& Strings)
+{
+    WritePod(Out, static_cast<uint32_t>(Strings.size()));
+    for (const std::string& Text : Strings)
+    {
+        WriteString(Out, Text);
+    }
+}
+
+bool ReadStrings(std::istream& In, std::vector<std::string>& Strings)
+{
+    uint32_t Count = 0;
+    if (!ReadPod(In, Count))
+    {
+        return false;
+    }
+    Strings.resize(Count);
+    for (std::string& Text : Strings)
+    {
+        if (!ReadString(In, Text))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void WriteHeader(std::ostream& Out, const ConTraceLog& Log)
+{
+    Out.write(TraceMagic, sizeof(TraceMagic));
+    WritePod(Out, TraceVersion);
+    WritePod(Out, Log.DroppedRecords);
+    WritePod(Out, static_cast<uint32_t>(Log.LineNumbers.size()));
+    for (const int32 LineNumber : Log.LineNumbers)
+    {
+        WritePod(Out, LineNumber);
+    }
+    WriteStrings(Out, Log.SourceLines);
+    WriteStrings(Out, Log.RegisterNames);
+    WriteStrings(Out, Log.ListNames);
+}
+
+void WriteRecords(std::ostream& Out, const ConTraceRecord* Records, const size_t Count)
+{
+    Out.write(reinterpret_cast<const char*>(Records), static_cast<std::streamsize>(Count * sizeof(ConTraceRecord)));
+}
+}
+
+const char* GetTraceEventLabel(const ConTraceEvent Event)
+{
+    switch (Event)
+    {
+    case ConTraceEvent::Ops:
+        return "OPS";
+    case ConTraceEvent::IfTrue:
+        return "IF=TRUE";
+    case ConTraceEvent::IfFalse:
+        return "IF=FALSE";
+    case ConTraceEvent::RedoHead:
+        return "REDO-HEAD";
+    case ConTraceEvent::RedoSkip:
+        return "REDO-SKIP";
+    case ConTraceEvent::Redo:
+        return "REDO";
+    case ConTraceEvent::RedoExit:
+        return "REDO-EXIT";
+    case ConTraceEvent::Jump:
+        return "JUMP";
+    case ConTraceEvent::NoJump:
+        return "NO-JUMP";
+    case ConTraceEvent::Ret:
+        return "RET";
+    case ConTraceEvent::Send:
+        return "SEND";
+    case ConTraceEvent::Listen:
+        return "LSTN";
+    case ConTraceEvent::Step:
+        return "STEP";
+    }
+    return "STEP";
+}
+
+void ConLineProfile::Merge(const ConLineProfile& Other)
+{
+    Executions += Other.Executions;
+    Cycles += Other.Cycles;
+    IfTaken += Other.IfTaken;
+    IfNotTaken += Other.IfNotTaken;
+    RedoIterations += Other.RedoIterations;
+    RedoExits += Other.RedoExits;
+}
+
+void ConTraceLog::Clear()
+{
+    LineNumbers.clear();
+    SourceLines.clear();
+    RegisterNames.clear();
+    ListNames.clear();
+    DroppedRecords = 0;
+    Records.clear();
+}
+
+std::string FormatTraceLine(const int32 LineNumber, const char* Label, const std::string& SourceText, const std::string& State)
+{
+    static const char* const TRACE_COLOR = "\033[35m";
+    static const char* const REGISTER_COLOR = "\033[36m";
+    static const char* const RESET_COLOR = "\033[0m";
+    static const size_t REGISTER_COLUMN = 64;
+
+    std::ostringstream PrefixStream;
+    PrefixStream << "[Line " << LineNumber;
+    if (Label != nullptr && Label[0] != '\0')
+    {
+        PrefixStream << ' ' << Label;
+    }
+    if (!SourceText.empty())
+    {
+        PrefixStream << "] " << SourceText;
+    }
+    else
+    {
+        PrefixStream << "]";
+    }
+
+    const std::string Prefix = PrefixStream.str();
+    std::ostringstream Oss;
+    Oss << TRACE_COLOR << Prefix;
+    if (!State.empty())
+    {
+        size_t Padding = 1;
+        if (Prefix.size() < REGISTER_COLUMN)
+        {
+            Padding = REGISTER_COLUMN - Prefix.size();
+        }
+        Oss << std::string(Padding, ' ') << REGISTER_COLOR << State << RESET_COLOR;
+    }
+    else
+    {
+        Oss << RESET_COLOR;
+    }
+    return Oss.str();
+}
+
+void RenderTrace(const ConTraceLog& Log, std::ostream& Out)
+{
+    if (Log.DroppedRecords > 0)
+    {
+        Out << "(" << Log.DroppedRecords << " earlier records were overwritten)\n";
+    }
+
+    std::vector<bool> RegisterChanged(Log.RegisterNames.size(), false);
+    std::vector<int32> Values(Log.RegisterNames.size(), 0);
+    std::vector<int32> Caches(Log.RegisterNames.size(), 0);
+    std::vector<std::vector<int32>> Appended(Log.ListNames.size());
+
+    for (const ConTraceRecord& Record : Log.Records)
+    {
+        switch (Record.Kind)
+        {
+        case ConTraceRecordKind::Register:
+            if (Record.Slot < Values.size())
+            {
+                RegisterChanged[Record.Slot] = true;
+                Values[Record.Slot] = Record.Value;
+                Caches[Record.Slot] = Record.Cache;
+            }
+            break;
+        case ConTraceRecordKind::ListAppend:
+            if (Record.Slot < Appended.size())
+            {
+                Appended[Record.Slot].push_back(Record.Value);
+            }
+            break;
+        case ConTraceRecordKind::Line:
+        {
+            std::vector<std::string> Segments;
+            std::ostringstream RegisterStream;
+            bool bAnyRegisterChanges = false;
+            for (size_t i = 0; i < RegisterChanged.size(); ++i)
+            {
+                if (!RegisterChanged[i])
+                {
+                    continue;
+                }
+                if (bAnyRegisterChanges)
+                {
+                    RegisterStream << "  ";
+                }
+                RegisterStream << Log.RegisterNames[i] << '=' << Values[i] << " (C=" << Caches[i] << ')';
+                bAnyRegisterChanges = true;
+                RegisterChanged[i] = false;
+            }
+            if (bAnyRegisterChanges)
+            {
+                Segments.push_back(RegisterStream.str());
+            }
+            for (size_t i = 0; i < Appended.size(); ++i)
+            {
+                if (Appended[i].empty())
+                {
+                    continue;
+                }
+                std::ostringstream ListStream;
+                ListStream << Log.ListNames[i] << " += [";
+                for (size_t j = 0; j < Appended[i].size(); ++j)
+                {
+                    ListStream << (j > 0 ? ", " : "") << Appended[i][j];
+                }
+                ListStream << ']';
+                Segments.push_back(ListStream.str());
+                Appended[i].clear();
+            }
+
+            std::string State;
+            if (!Segments.empty())
+            {
+                State = "| ";
+                for (size_t i = 0; i < Segments.size(); ++i)
+                {
+                    State += (i > 0 ? "  " : "") + Segments[i];
+                }
+            }
+
+            const size_t Index = static_cast<size_t>(Record.LineIndex);
+            const int32 LineNumber = Index < Log.LineNumbers.size() ? Log.LineNumbers[Index] : Record.LineIndex + 1;
+            const std::string Source = Index < Log.SourceLines.size() ? Log.SourceLines[Index] : std::string();
+            Out << FormatTraceLine(LineNumber, GetTraceEventLabel(Record.Event), Source, State) << '\n';
+            break;
+        }
+        }
+    }
+}
+
+bool WriteTraceFile(const std::string& Path, const ConTraceLog& Log, std::string& OutError)
+{
+    std::ofstream Out(Path, std::ios::binary | std::ios::trunc);
+    if (!Out)
+    {
+        OutError = "Unable to write to file: " + Path;
+        return false;
+    }
+    WriteHeader(Out, Log);
+    WriteRecords(Out, Log.Records.data(), Log.Records.size());
+    return static_cast<bool>(Out);
+}
+
+bool ReadTraceFile(const std::string& Path, ConTraceLog& OutLog, std::string& OutError)
+{
+    std::ifstream In(Path, std::ios::binary);
+    if (!In)
+    {
+        OutError = "Unable to open file: " + Path;
+        return false;
+    }
+
+    char Magic[sizeof(TraceMagic)] = {};
+    uint32_t Version = 0;
+    if (!In.read(Magic, sizeof(Magic)) || std::memcmp(Magic, TraceMagic, sizeof(Magic)) != 0 || !ReadPod(In, Version))
+    {
+        OutError = Path + " is not a Conch trace";
+        return false;
+    }
+    if (Version != TraceVersion)
+    {
+        OutError = "Unsupported trace version " + std::to_string(Version);
+        return false;
+    }
+
+    OutLog.Clear();
+    uint32_t LineCount = 0;
+    bool bOk = ReadPod(In, OutLog.DroppedRecords) && ReadPod(In, LineCount);
+    OutLog.LineNumbers.resize(bOk ? LineCount : 0);
+    for (int32& LineNumber : OutLog.LineNumbers)
+    {
+        bOk = bOk && ReadPod(In, LineNumber);
+    }
+    bOk = bOk && ReadStrings(In, OutLog.SourceLines) && ReadStrings(In, OutLog.RegisterNames) && ReadStrings(In, OutLog.ListNames);
+    if (!bOk)
+    {
+        OutError = "Truncated trace header in " + Path;
+        return false;
+    }
+
+    ConTraceRecord Record;
+    while (ReadPod(In, Record))
+    {
+        OutLog.Records.push_back(Record);
+    }
+    return true;
+}
+
+ConTraceRecorder::ConTraceRecorder(const size_t Capacity)
+    : Ring(Capacity > 0 ? Capacity : 1)
+{
+}
+
+bool ConTraceRecorder::OpenFile(const std::string& Path, std::string& OutError)
+{
+    File.close();
+    File.open(Path, std::ios::binary | std::ios::trunc);
+    if (!File)
+    {
+        OutError = "Unable to write to file: " + Path;
+        bFileMode = false;
+        return false;
+    }
+    bFileMode = true;
+    return true;
+}
+
+void ConTraceRecorder::Begin(const ConTraceLog& InHeader,
+                             const std::vector<ConVariableCached*>& InRegisters,
+                             const std::vector<const ConVariableList*>& InLists)
+{
+    Header = InHeader;
+    Header.Records.clear();
+    Header.DroppedRecords = 0;
+    Head = 0;
+    Count = 0;
+    Dropped = 0;
+
+    Registers = InRegisters;
+    Lists = InLists;
+    LastValues.assign(Registers.size(), 0);
+    LastCaches.assign(Registers.size(), 0);
+    for (size_t i = 0; i < Registers.size(); ++i)
+    {
+        if (Registers[i] != nullptr)
+        {
+            LastValues[i] = Registers[i]->GetVal();
+            LastCaches[i] = Registers[i]->GetCache();
+        }
+    }
+    LastSizes.assign(Lists.size(), 0);
+    for (size_t i = 0; i < Lists.size(); ++i)
+    {
+        LastSizes[i] = Lists[i] != nullptr ? Lists[i]->Size() : 0;
+    }
+
+    if (bFileMode)
+    {
+        File.seekp(0);
+        WriteHeader(File, Header);
+    }
+}
+
+void ConTraceRecorder::RecordChanges(const int32 LineIndex)
+{
+    for (size_t i = 0; i < Registers.size(); ++i)
+    {
+        const ConVariableCached* Var = Registers[i];
+        if (Var == nullptr || (Var->GetVal() == LastValues[i] && Var->GetCache() == LastCaches[i]))
+        {
+            continue;
+        }
+        LastValues[i] = Var->GetVal();
+        LastCaches[i] = Var->GetCache();
+        ConTraceRecord& Record = Push();
+        Record.LineIndex = LineIndex;
+        Record.Kind = ConTraceRecordKind::Register;
+        Record.Slot = static_cast<uint16_t>(i);
+        Record.Value = LastValues[i];
+        Record.Cache = LastCaches[i];
+    }
+    // lists only ever grow while a thread runs, so new entries are the appends
+    for (size_t i = 0; i < Lists.size(); ++i)
+    {
+        const ConVariableList* List = Lists[i];
+        if (List == nullptr || List->Size() == LastSizes[i])
+        {
+            continue;
+        }
+        const ConListView Values = List->GetView();
+        for (size_t j = LastSizes[i]; j < Values.size(); ++j)
+        {
+            ConTraceRecord& Record = Push();
+            Record.LineIndex = LineIndex;
+            Record.Kind = ConTraceRecordKind::ListAppend;
+            Record.Slot = static_cast<uint16_t>(i);
+            Record.Value = Values[j];
+        }
+        LastSizes[i] = Values.size();
+    }
+}
+
+ConTraceRecord& ConTraceRecorder::Push()
+{
+    if (Count == Ring.size())
+    {
+        if (bFileMode)
+        {
+            Flush();
+        }
+        else
+        {
+            Head = (Head + 1) % Ring.size();
+            --Count;
+            ++Dropped;
+        }
+    }
+    ConTraceRecord& Record = Ring[(Head + Count) % Ring.size()];
+    ++Count;
+    Record = ConTraceRecord();
+    return Record;
+}
+
+void ConTraceRecorder::Flush()
+{
+    if (!bFileMode || Count == 0)
+    {
+        return;
+    }
+    // in file mode the ring never wraps, so the buffered records are contiguous from Head
+    WriteRecords(File, Ring.data() + Head, Count);
+    File.flush();
+    Head = 0;
+    Count = 0;
+}
+
+ConTraceLog ConTraceRecorder::GetLog() const
+{
+    ConTraceLog Log = Header;
+    Log.DroppedRecords = Dropped;
+    Log.Records.reserve(Count);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        Log.Records.push_back(Ring[(Head + i) % Ring.size()]);
+    }
+    return Log;
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include "common.h"
+#include "variable.h"
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// what a traced line did; rendered as the label in "[Line N LABEL] source"
+enum class ConTraceEvent : uint8_t
+{
+    Ops,
+    IfTrue,
+    IfFalse,
+    RedoHead,
+    RedoSkip,
+    Redo,
+    RedoExit,
+    Jump,
+    NoJump,
+    Ret,
+    Send,
+    Listen,
+    Step
+};
+
+const char* GetTraceEventLabel(ConTraceEvent Event);
+
+// What one line did over every profiled run. Counted when the line finishes, like a trace line,
+// so a line that raises a runtime error is not counted.
+struct ConLineProfile
+{
+    uint64_t Executions = 0;
+    uint64_t Cycles = 0;
+    uint64_t IfTaken = 0;
+    uint64_t IfNotTaken = 0;
+    // REDO went back to its head, or left the loop (at the end of the body or by skipping it
+    // from the head)
+    uint64_t RedoIterations = 0;
+    uint64_t RedoExits = 0;
+
+    void Record(const ConTraceEvent Event, const int32 LineCycles)
+    {
+        ++Executions;
+        Cycles += static_cast<uint64_t>(LineCycles);
+        switch (Event)
+        {
+        case ConTraceEvent::IfTrue:
+            ++IfTaken;
+            break;
+        case ConTraceEvent::IfFalse:
+            ++IfNotTaken;
+            break;
+        case ConTraceEvent::Redo:
+            ++RedoIterations;
+            break;
+        case ConTraceEvent::RedoExit:
+        case ConTraceEvent::RedoSkip:
+            ++RedoExits;
+            break;
+        default:
+            break;
+        }
+    }
+    void Merge(const ConLineProfile& Other);
+};
+
+enum class ConTraceRecordKind : uint8_t
+{
+    // a line finished; Event says how
+    Line,
+    // register Slot now holds Value with cache Cache
+    Register,
+    // Value was appended to list Slot
+    ListAppend
+};
+
+// Fixed-size trace record. The changes a line made are recorded just before that line's
+// Line record, so a reader accumulates changes until it reaches the Line they belong to.
+struct ConTraceRecord
+{
+    int32 LineIndex = 0;
+    ConTraceRecordKind Kind = ConTraceRecordKind::Line;
+    ConTraceEvent Event = ConTraceEvent::Step;
+    uint16_t Slot = 0;
+    int32 Value = 0;
+    int32 Cache = 0;
+};
+
+static_assert(sizeof(ConTraceRecord) == 16, "trace records are written to disk as-is");
+
+// One recorded run: enough of the program to render the human-readable trace without it.
+struct ConTraceLog
+{
+    std::vector<int32> LineNumbers;
+    std::vector<std::string> SourceLines;
+    std::vector<std::string> RegisterNames;
+    std::vector<std::string> ListNames;
+    // records lost because a ring buffer wrapped before it was read
+    uint64_t DroppedRecords = 0;
+    std::vector<ConTraceRecord> Records;
+
+    void Clear();
+};
+
+// formats one trace line; shared by the live trace and the offline decoder so both read the same
+std::string FormatTraceLine(int32 LineNumber, const char* Label, const std::string& SourceText, const std::string& State);
+
+// renders every Line record of Log the way the live trace prints it
+void RenderTrace(const ConTraceLog& Log, std::ostream& Out);
+
+bool WriteTraceFile(const std::string& Path, const ConTraceLog& Log, std::string& OutError);
+bool ReadTraceFile(const std::string& Path, ConTraceLog& OutLog, std::string& OutError);
+
+// Records execution as ConTraceRecords into a preallocated buffer. Without a file the buffer
+// is a ring that keeps the most recent records; with OpenFile it is flushed to disk each time
+// it fills, so a full run is kept at a fixed memory cost. Each Begin starts a new recording.
+struct ConTraceRecorder
+{
+    explicit ConTraceRecorder(size_t Capacity = 1 << 16);
+    ConTraceRecorder(const ConTraceRecorder&) = delete;
+    ConTraceRecorder& operator=(const ConTraceRecorder&) = delete;
+
+    bool OpenFile(const std::string& Path, std::string& OutError);
+
+    // Header describes the program; its Records are ignored. The registers and lists are
+    // watched for changes until the next Begin.
+    void Begin(const ConTraceLog& Header,
+               const std::vector<ConVariableCached*>& InRegisters,
+               const std::vector<const ConVariableList*>& InLists);
+    void RecordLine(ConTraceEvent Event, int32 LineIndex)
+    {
+        RecordChanges(LineIndex);
+        ConTraceRecord& Record = Push();
+        Record.LineIndex = LineIndex;
+        Record.Kind = ConTraceRecordKind::Line;
+        Record.Event = Event;
+    }
+    // writes buffered records to the file, if one is open
+    void Flush();
+
+    // header plus the buffered records in order; in file mode only the unflushed tail
+    ConTraceLog GetLog() const;
+    uint64_t GetDroppedCount() const { return Dropped; }
+
+private:
+    void RecordChanges(int32 LineIndex);
+    ConTraceRecord& Push();
+
+    std::vector<ConTraceRecord> Ring;
+    size_t Head = 0;
+    size_t Count = 0;
+    uint64_t Dropped = 0;
+    ConTraceLog Header;
+    std::ofstream File;
+    bool bFileMode = false;
+
+    std::vector<ConVariableCached*> Registers;
+    std::vector<const ConVariableList*> Lists;
+    std::vector<int32> LastValues;
+    std::vector<int32> LastCaches;
+    std::vector<size_t> LastSizes;
+};
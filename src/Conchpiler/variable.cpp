@@ -1,43 +1,7 @@
 #include "variable.h"
 
-ConVariableCached::ConVariableCached()
-    : CacheAccessor(*this)
-{
-}
-
-ConVariableCached::ConVariableCached(const ConVariableCached& Other)
-    : CacheAccessor(*this)
-    , Val(Other.Val)
-    , Cache(Other.Cache)
-{
-}
-
-ConVariableCached& ConVariableCached::operator=(const ConVariableCached& Other)
-{
-    if (this != &Other)
-    {
-        Val = Other.Val;
-        Cache = Other.Cache;
-    }
-    return *this;
-}
-
-ConVariableCached::ConVariableCached(ConVariableCached&& Other) noexcept
-    : CacheAccessor(*this)
-    , Val(Other.Val)
-    , Cache(Other.Cache)
-{
-}
-
-ConVariableCached& ConVariableCached::operator=(ConVariableCached&& Other) noexcept
-{
-    if (this != &Other)
-    {
-        Val = Other.Val;
-        Cache = Other.Cache;
-    }
-    return *this;
-}
+#include <algorithm>
+#include <utility>
 
 int32 ConVariableAbsolute::GetVal() const
 {
@@ -49,42 +13,21 @@ void ConVariableAbsolute::SetVal(const int32 NewVal)
     Val = NewVal;   
 }
 
-int32 ConVariableCached::GetVal() const
-{
-    return Val;
-}
-
-void ConVariableCached::SetVal(const int32 NewVal)
-{
-    Cache = Val;
-    Val = NewVal;
-}
-
-int32 ConVariableCached::GetCache() const
+void ConRegisterFile::Reset()
 {
-    return Cache;
-}
-
-void ConVariableCached::SetCache(const int32 NewVal)
-{
-    Cache = NewVal;
+    std::fill(Values.begin(), Values.end(), 0);
+    std::fill(Caches.begin(), Caches.end(), 0);
 }
 
 void ConVariableCached::Swap()
 {
-    const int32 Temp = Val;
-    Val = Cache;
-    Cache = Temp;
-}
-
-ConVariable* ConVariableCached::GetCacheVariable()
-{
-    return &CacheAccessor;
+    std::swap(File->Values[Index], File->Caches[Index]);
 }
 
-const ConVariable* ConVariableCached::GetCacheVariable() const
+void ConVariableCached::Reset()
 {
-    return &CacheAccessor;
+    File->Values[Index] = 0;
+    File->Caches[Index] = 0;
 }
 
 ConVariableList::ConVariableList(const vector<int32>& InValues)
@@ -108,9 +51,10 @@ void ConVariableList::SetVal(const int32 NewVal)
 
 int32 ConVariableList::Pop()
 {
-    if (Cursor < Storage.size())
+    const ConListView Values = GetView();
+    if (Cursor < Values.Count)
     {
-        CurrentValue = Storage.at(Cursor);
+        CurrentValue = Values.Data[Cursor];
         ++Cursor;
     }
     else
@@ -122,9 +66,10 @@ int32 ConVariableList::Pop()
 
 int32 ConVariableList::At(const int32 Index) const
 {
-    if (Index >= 0 && static_cast<size_t>(Index) < Storage.size())
+    const ConListView Values = GetView();
+    if (Index >= 0 && static_cast<size_t>(Index) < Values.Count)
     {
-        CurrentValue = Storage.at(static_cast<size_t>(Index));
+        CurrentValue = Values.Data[static_cast<size_t>(Index)];
         return CurrentValue;
     }
     CurrentValue = 0;
@@ -133,28 +78,55 @@ int32 ConVariableList::At(const int32 Index) const
 
 void ConVariableList::Push(const int32 Value)
 {
+    if (Borrowed != nullptr)
+    {
+        Storage.assign(Borrowed, Borrowed + BorrowedCount);
+        StopBorrowing();
+    }
     Storage.push_back(Value);
     CurrentValue = Value;
 }
 
 void ConVariableList::SetValues(const vector<int32>& Values)
 {
+    StopBorrowing();
     Storage = Values;
     Cursor = 0;
     CurrentValue = Storage.empty() ? 0 : Storage.front();
 }
 
+void ConVariableList::BorrowValues(const int32* const Values, const size_t Count)
+{
+    Storage.clear();
+    Borrowed = Count > 0 ? Values : nullptr;
+    BorrowedCount = Borrowed != nullptr ? Count : 0;
+    Cursor = 0;
+    CurrentValue = BorrowedCount > 0 ? Borrowed[0] : 0;
+}
+
+bool ConVariableList::IsBorrowed() const
+{
+    return Borrowed != nullptr;
+}
+
+void ConVariableList::StopBorrowing()
+{
+    Borrowed = nullptr;
+    BorrowedCount = 0;
+}
+
 bool ConVariableList::Empty() const
 {
-    return Storage.empty();
+    return Size() == 0;
 }
 
 void ConVariableList::Reset()
 {
+    const ConListView Values = GetView();
     Cursor = 0;
-    if (!Storage.empty())
+    if (!Values.empty())
     {
-        CurrentValue = Storage.front();
+        CurrentValue = Values[0];
     }
     else
     {
@@ -162,14 +134,49 @@ void ConVariableList::Reset()
     }
 }
 
+size_t ConVariableList::GetCursor() const
+{
+    return Cursor;
+}
+
+void ConVariableList::RestorePosition(const size_t InCursor, const int32 InCurrentValue)
+{
+    Cursor = InCursor;
+    CurrentValue = InCurrentValue;
+}
+
+void ConVariableList::Clear()
+{
+    StopBorrowing();
+    Storage.clear();
+    Cursor = 0;
+    CurrentValue = 0;
+}
+
+vector<int32> ConVariableList::TakeValues()
+{
+    vector<int32> Values = std::move(Storage);
+    Storage.clear();
+    return Values;
+}
+
 const vector<int32>& ConVariableList::GetValues() const
 {
     return Storage;
 }
 
+ConListView ConVariableList::GetView() const
+{
+    if (Borrowed != nullptr)
+    {
+        return ConListView{Borrowed, BorrowedCount};
+    }
+    return ConListView{Storage.data(), Storage.size()};
+}
+
 size_t ConVariableList::Size() const
 {
-    return Storage.size();
+    return Borrowed != nullptr ? BorrowedCount : Storage.size();
 }
 
 void ConVariableList::SetRole(const ConListRole InRole)
@@ -221,7 +228,7 @@ bool ConVariableList::CanAppend() const
     {
         return true;
     }
-    return Storage.size() < ExpectedSize;
+    return Size() < ExpectedSize;
 }
 
 bool ConVariableList::TryAppend(const int32 Value)
@@ -243,13 +250,12 @@ VariableRef::VariableRef(const VariableKind InKind, ConVariable* const InPtr, Co
 
 VariableRef VariableRef::ThreadVar(ConVariableCached* const Var)
 {
-    return VariableRef(VariableKind::Thread, Var, Var);
+    return VariableRef(VariableKind::Thread, nullptr, Var);
 }
 
 VariableRef VariableRef::CacheVar(ConVariableCached* const Var)
 {
-    ConVariable* CachePtr = Var != nullptr ? Var->GetCacheVariable() : nullptr;
-    return VariableRef(VariableKind::Cache, CachePtr, Var);
+    return VariableRef(VariableKind::Cache, nullptr, Var);
 }
 
 VariableRef VariableRef::ListVar(ConVariableList* const Var)
@@ -274,13 +280,38 @@ ConVariableAbsolute* VariableRef::GetLiteral() const
 
 int32 VariableRef::Read() const
 {
-    return Ptr != nullptr ? Ptr->GetVal() : 0;
+    switch (Kind)
+    {
+    case VariableKind::Thread:
+        return ThreadOwner != nullptr ? ThreadOwner->GetVal() : 0;
+    case VariableKind::Cache:
+        return ThreadOwner != nullptr ? ThreadOwner->GetCache() : 0;
+    default:
+        return Ptr != nullptr ? Ptr->GetVal() : 0;
+    }
 }
 
 void VariableRef::Write(const int32 Value) const
 {
-    if (Ptr != nullptr)
+    switch (Kind)
     {
-        Ptr->SetVal(Value);
+    case VariableKind::Thread:
+        if (ThreadOwner != nullptr)
+        {
+            ThreadOwner->SetVal(Value);
+        }
+        break;
+    case VariableKind::Cache:
+        if (ThreadOwner != nullptr)
+        {
+            ThreadOwner->SetCache(Value);
+        }
+        break;
+    default:
+        if (Ptr != nullptr)
+        {
+            Ptr->SetVal(Value);
+        }
+        break;
     }
 }
@@ -26,7 +26,7 @@ struct ConVariable
     virtual void SetVal(int32 NewVal) = 0;
 };
 
-struct ConVariableAbsolute : public ConVariable
+struct ConVariableAbsolute final : public ConVariable
 {
     ConVariableAbsolute() = default;
     ConVariableAbsolute(const int32 InVal)
@@ -37,43 +37,64 @@ private:
     int32 Val = 0;
 };
 
-struct ConVariableCached : public ConVariable
+// A thread's registers: values and caches in parallel arrays, addressed by register index.
+// The count is fixed when the file is created, so it follows however many registers are declared.
+struct ConRegisterFile
 {
-    ConVariableCached();
-    ConVariableCached(const ConVariableCached& Other);
-    ConVariableCached& operator=(const ConVariableCached& Other);
-    ConVariableCached(ConVariableCached&& Other) noexcept;
-    ConVariableCached& operator=(ConVariableCached&& Other) noexcept;
+    ConRegisterFile() = default;
+    explicit ConRegisterFile(size_t Count) : Values(Count, 0), Caches(Count, 0) {}
 
-    virtual int32 GetVal() const override;
-    virtual void SetVal(int32 NewVal) override;
-    int32 GetCache() const;
-    void SetCache(int32 NewVal);
-    // swaps the value and the cache
-    void Swap();
+    size_t Size() const { return Values.size(); }
+    // zeroes every value and cache
+    void Reset();
 
-    ConVariable* GetCacheVariable();
-    const ConVariable* GetCacheVariable() const;
+    vector<int32> Values;
+    vector<int32> Caches;
+};
 
-private:
-    struct CacheProxy : public ConVariable
+// Handle to one register of a ConRegisterFile. Setting the value moves the previous one into
+// the cache, as a cached variable always has.
+struct ConVariableCached final
+{
+    ConVariableCached() = default;
+    ConVariableCached(ConRegisterFile* InFile, int32 InIndex)
+        : File(InFile), Index(InIndex) {}
+
+    int32 GetVal() const { return File->Values[Index]; }
+    void SetVal(const int32 NewVal)
     {
-        explicit CacheProxy(ConVariableCached& InOwner)
-            : Owner(InOwner) {}
+        File->Caches[Index] = File->Values[Index];
+        File->Values[Index] = NewVal;
+    }
+    int32 GetCache() const { return File->Caches[Index]; }
+    void SetCache(const int32 NewVal) { File->Caches[Index] = NewVal; }
+    // swaps the value and the cache
+    void Swap();
+    // zeroes both the value and the cache
+    void Reset();
 
-        virtual int32 GetVal() const override { return Owner.GetCache(); }
-        virtual void SetVal(int32 NewVal) override { Owner.SetCache(NewVal); }
+    ConRegisterFile* GetFile() const { return File; }
+    int32 GetIndex() const { return Index; }
 
-    private:
-        ConVariableCached& Owner;
-    };
+private:
+    ConRegisterFile* File = nullptr;
+    int32 Index = 0;
+};
 
-    CacheProxy CacheAccessor;
-    int32 Val = 0;
-    int32 Cache = 0;
+// Read-only view of a list's values, whether the list owns them or borrows them.
+struct ConListView
+{
+    const int32* Data = nullptr;
+    size_t Count = 0;
+
+    const int32* begin() const { return Data; }
+    const int32* end() const { return Data + Count; }
+    size_t size() const { return Count; }
+    bool empty() const { return Count == 0; }
+    int32 operator[](const size_t Index) const { return Data[Index]; }
 };
 
-struct ConVariableList : public ConVariable
+struct ConVariableList final : public ConVariable
 {
     ConVariableList() = default;
     explicit ConVariableList(const vector<int32>& InValues);
@@ -85,9 +106,23 @@ struct ConVariableList : public ConVariable
     int32 At(int32 Index) const;
     void Push(int32 Value);
     void SetValues(const vector<int32>& Values);
+    // reads Values in place instead of copying them, e.g. from a mapped file. The memory must stay
+    // valid until the next SetValues or Clear; the first write copies it into the list's own storage
+    void BorrowValues(const int32* Values, size_t Count);
+    bool IsBorrowed() const;
     bool Empty() const;
     void Reset();
+    // where the next POP reads from; RestorePosition puts the cursor and the value last read or
+    // written back as they were, e.g. from a snapshot
+    size_t GetCursor() const;
+    void RestorePosition(size_t InCursor, int32 InCurrentValue);
+    // drops every value but keeps the storage for the next run
+    void Clear();
+    // moves the owned values out, e.g. for a snapshot to share; the cursor is left as it was
+    vector<int32> TakeValues();
+    // the values the list owns, which are none while it borrows; GetView reads either
     const vector<int32>& GetValues() const;
+    ConListView GetView() const;
     size_t Size() const;
 
     void SetRole(ConListRole InRole);
@@ -101,7 +136,12 @@ struct ConVariableList : public ConVariable
     bool TryAppend(int32 Value);
 
 private:
+    void StopBorrowing();
+
     vector<int32> Storage;
+    // set while the values live outside the list; Storage is empty then
+    const int32* Borrowed = nullptr;
+    size_t BorrowedCount = 0;
     mutable int32 CurrentValue = 0;
     size_t Cursor = 0;
     ConListRole Role = ConListRole::General;
@@ -118,7 +158,7 @@ struct VariableRef
     static VariableRef ListVar(ConVariableList* Var);
     static VariableRef LiteralVar(ConVariableAbsolute* Var);
 
-    bool IsValid() const { return Ptr != nullptr; }
+    bool IsValid() const { return Ptr != nullptr || ThreadOwner != nullptr; }
     VariableKind GetKind() const { return Kind; }
     bool IsThread() const { return Kind == VariableKind::Thread; }
     bool IsCache() const { return Kind == VariableKind::Cache; }
@@ -126,7 +166,6 @@ struct VariableRef
     bool IsLiteral() const { return Kind == VariableKind::Literal; }
     bool TouchesThread() const { return Kind == VariableKind::Thread || Kind == VariableKind::Cache; }
 
-    ConVariable* GetVariable() const { return Ptr; }
     ConVariableCached* GetThread() const { return IsThread() ? ThreadOwner : nullptr; }
     ConVariableCached* GetThreadOwner() const { return ThreadOwner; }
     ConVariableList* GetList() const;
@@ -137,6 +176,7 @@ struct VariableRef
 
 private:
     VariableKind Kind = VariableKind::Literal;
+    // the list or literal; registers and caches are reached through ThreadOwner
     ConVariable* Ptr = nullptr;
     ConVariableCached* ThreadOwner = nullptr;
 };